@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "AmbisonicBinauralDecoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "HeadModelHrtf.h"
+
+namespace TBE {
+AmbisonicBinauralDecoder::AmbisonicBinauralDecoder(
+    const HeadModelHrtf& hrtf,
+    int maxBufferSize,
+    int order)
+    : order_(std::max(1, std::min(order, SphericalHarmonics::kMaxOrder))),
+      numChannels_(SphericalHarmonics::getNumChannels(order_)),
+      maxBufferSize_(maxBufferSize),
+      filterLength_(hrtf.getLength()) {
+  const SphericalHarmonics::Quadrature quadrature;
+  float maxRe[SphericalHarmonics::kMaxOrder + 1];
+  SphericalHarmonics::getMaxReWeights(order_, maxRe);
+
+  std::vector<double> accumulator(static_cast<size_t>(numChannels_) * filterLength_, 0.0);
+  std::vector<float> left(filterLength_);
+  std::vector<float> right(filterLength_);
+
+  for (int s = 0; s < SphericalHarmonics::Quadrature::kNumPoints; ++s) {
+    const float x = quadrature.x[s];
+    const float y = quadrature.y[s];
+    const float z = quadrature.z[s];
+    // ambiX (front, left, up) -> engine (right, up, forward)
+    hrtf.compute(TBVector(-y, z, x), left.data(), right.data());
+
+    float sh[kMaxChannels];
+    SphericalHarmonics::evaluate(x, y, z, order_, sh);
+
+    for (int n = 0; n < numChannels_; ++n) {
+      const int l = SphericalHarmonics::getOrderForChannel(n);
+      // Projection decoder: loudspeaker gain = w_s * sum_n (2l + 1) * maxRe_l * Y_n(d_s) * a_n
+      const double gain = quadrature.weight[s] * (2 * l + 1) * maxRe[l] * sh[n];
+      double* filter = &accumulator[static_cast<size_t>(n) * filterLength_];
+      for (int t = 0; t < filterLength_; ++t) {
+        filter[t] += gain * left[t];
+      }
+    }
+  }
+
+  filters_.resize(accumulator.size());
+  for (size_t i = 0; i < accumulator.size(); ++i) {
+    filters_[i] = static_cast<float>(accumulator[i]);
+  }
+
+  history_.assign(static_cast<size_t>(numChannels_) * (filterLength_ - 1 + maxBufferSize_), 0.f);
+  silentBlocks_.assign(numChannels_, 0);
+  symmetric_.assign(maxBufferSize_, 0.f);
+  antisymmetric_.assign(maxBufferSize_, 0.f);
+}
+
+int AmbisonicBinauralDecoder::getOrder() const {
+  return order_;
+}
+
+int AmbisonicBinauralDecoder::getNumChannels() const {
+  return numChannels_;
+}
+
+int AmbisonicBinauralDecoder::getFilterLength() const {
+  return filterLength_;
+}
+
+const float* AmbisonicBinauralDecoder::getFilter(int acn) const {
+  return &filters_[static_cast<size_t>(acn) * filterLength_];
+}
+
+void AmbisonicBinauralDecoder::process(
+    const float* const* input,
+    float* left,
+    float* right,
+    int numFrames) {
+  numFrames = std::min(numFrames, maxBufferSize_);
+  const int historyLength = filterLength_ - 1;
+  const int stride = historyLength + maxBufferSize_;
+  // A channel whose input has been silent for long enough has a silent output too
+  const int blocksToFlush = (historyLength + numFrames - 1) / std::max(1, numFrames) + 1;
+
+  std::fill(symmetric_.begin(), symmetric_.begin() + numFrames, 0.f);
+  std::fill(antisymmetric_.begin(), antisymmetric_.begin() + numFrames, 0.f);
+
+  for (int n = 0; n < numChannels_; ++n) {
+    const float* in = input[n];
+    float* history = &history_[static_cast<size_t>(n) * stride];
+
+    bool silent = true;
+    for (int i = 0; i < numFrames; ++i) {
+      if (in[i] != 0.f) {
+        silent = false;
+        break;
+      }
+    }
+    silentBlocks_[n] = silent ? silentBlocks_[n] + 1 : 0;
+    if (silentBlocks_[n] > blocksToFlush) {
+      continue;
+    }
+
+    // Append the block after the last filterLength_ - 1 input samples
+    std::memcpy(history + historyLength, in, numFrames * sizeof(float));
+
+    const float* filter = getFilter(n);
+    float* out = SphericalHarmonics::isLeftRightSymmetric(n) ? symmetric_.data()
+                                                             : antisymmetric_.data();
+    for (int t = 0; t < filterLength_; ++t) {
+      const float h = filter[t];
+      const float* x = history + historyLength - t;
+      for (int i = 0; i < numFrames; ++i) {
+        out[i] += h * x[i];
+      }
+    }
+
+    std::memmove(history, history + numFrames, historyLength * sizeof(float));
+  }
+
+  for (int i = 0; i < numFrames; ++i) {
+    left[i] = symmetric_[i] + antisymmetric_[i];
+    right[i] = symmetric_[i] - antisymmetric_[i];
+  }
+}
+
+void AmbisonicBinauralDecoder::reset() {
+  std::fill(history_.begin(), history_.end(), 0.f);
+  std::fill(silentBlocks_.begin(), silentBlocks_.end(), 0);
+}
+} // namespace TBE
@@ -0,0 +1,67 @@
+#ifndef FBA_AMBISONICBINAURALDECODER_H
+#define FBA_AMBISONICBINAURALDECODER_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <vector>
+#include "SphericalHarmonics.h"
+
+namespace TBE {
+class HeadModelHrtf;
+
+/// Renders an ambiX sound field to binaural stereo. A max-rE weighted virtual loudspeaker decoder
+/// on a 32 point spherical quadrature is folded together with the HRIR of each loudspeaker into one
+/// FIR filter per ACN channel, so the cost does not depend on the number of loudspeakers. The head
+/// model is left/right symmetric: the right ear filter of a channel equals the left ear filter,
+/// negated for channels that are antisymmetric about the median plane, which halves the number of
+/// convolutions.
+class AmbisonicBinauralDecoder {
+ public:
+  static const int kMaxChannels = SphericalHarmonics::kMaxChannels;
+
+  /// @param hrtf Head model used to generate the virtual loudspeaker HRIRs
+  /// @param maxBufferSize Largest block size passed to process()
+  /// @param order Ambisonic order, between 1 and SphericalHarmonics::kMaxOrder
+  AmbisonicBinauralDecoder(const HeadModelHrtf& hrtf, int maxBufferSize, int order);
+
+  /// @return The ambisonic order of the decoder
+  int getOrder() const;
+
+  /// @return The number of ACN channels processed
+  int getNumChannels() const;
+
+  /// @return The number of taps of each filter
+  int getFilterLength() const;
+
+  /// @return The left ear filter of an ACN channel. The right ear filter is identical for
+  /// left/right symmetric channels and negated otherwise.
+  const float* getFilter(int acn) const;
+
+  /// Decode a block
+  /// @param input getNumChannels() planar ambiX channels
+  /// @param left Left output, overwritten
+  /// @param right Right output, overwritten
+  /// @param numFrames Number of frames, up to maxBufferSize
+  void process(const float* const* input, float* left, float* right, int numFrames);
+
+  /// Clear the convolution history
+  void reset();
+
+ private:
+  const int order_;
+  const int numChannels_;
+  const int maxBufferSize_;
+  int filterLength_;
+  std::vector<float> filters_; // numChannels_ x filterLength_
+  std::vector<float> history_; // numChannels_ x (filterLength_ - 1 + maxBufferSize_)
+  std::vector<int> silentBlocks_; // Consecutive silent input blocks per channel
+  std::vector<float> symmetric_;
+  std::vector<float> antisymmetric_;
+};
+} // namespace TBE
+
+#endif // FBA_AMBISONICBINAURALDECODER_H
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "AmbisonicHrtfDecoder.h"
+#include <algorithm>
+#include <cmath>
+#include "BinauralFilterBank.h"
+
+namespace TBE {
+namespace {
+/// Transform a filter back to its HRIR, with the delay removed from it put back
+void getImpulseResponse(
+    const BinauralFilters& filters,
+    int index,
+    Fft& fft,
+    std::vector<float>& time,
+    std::vector<float>& output) {
+  const PartitionedFilter& filter = filters.getFilter(index);
+  const int blockSize = filter.getBlockSize();
+  const int delay = std::max(0, static_cast<int>(std::lround(filters.getDelay(index))));
+  output.assign(static_cast<size_t>(filter.getNumPartitions()) * blockSize + delay, 0.f);
+  for (int p = 0; p < filter.getNumPartitions(); ++p) {
+    // The spectra are scaled by the inverse FFT normalisation already, and each partition was
+    // zero padded to two blocks
+    fft.inverse(filter.getReal(p), filter.getImag(p), time.data());
+    std::copy(time.begin(), time.begin() + blockSize, output.begin() + delay + p * blockSize);
+  }
+}
+} // namespace
+
+AmbisonicHrtfDecoder::AmbisonicHrtfDecoder(const BinauralFilters& filters, int order)
+    : order_(std::max(1, std::min(order, SphericalHarmonics::kMaxOrder))),
+      numChannels_(SphericalHarmonics::getNumChannels(order_)),
+      blockSize_(filters.getBlockSize()),
+      fft_(2 * filters.getBlockSize()) {
+  const int length = filters.getNumPartitions() * blockSize_ +
+      static_cast<int>(std::ceil(std::max(0.f, filters.getMaxDelay())));
+  numPartitions_ = std::max(1, (length + blockSize_ - 1) / blockSize_);
+
+  const SphericalHarmonics::Quadrature quadrature;
+  float maxRe[SphericalHarmonics::kMaxOrder + 1];
+  SphericalHarmonics::getMaxReWeights(order_, maxRe);
+
+  // Left ear filters of every channel, then right ear filters
+  std::vector<double> accumulator(static_cast<size_t>(2 * numChannels_) * length, 0.0);
+  std::vector<float> hrir;
+  time_.assign(fft_.getSize(), 0.f);
+
+  for (int s = 0; s < SphericalHarmonics::Quadrature::kNumPoints; ++s) {
+    const float x = quadrature.x[s];
+    const float y = quadrature.y[s];
+    const float z = quadrature.z[s];
+    // ambiX (front, left, up) -> engine (right, up, forward)
+    int indices[2];
+    filters.getIndices(TBVector(-y, z, x), indices[0], indices[1]);
+
+    float sh[SphericalHarmonics::kMaxChannels];
+    SphericalHarmonics::evaluate(x, y, z, order_, sh);
+
+    for (int ear = 0; ear < 2; ++ear) {
+      getImpulseResponse(filters, indices[ear], fft_, time_, hrir);
+      const int count = std::min(length, static_cast<int>(hrir.size()));
+      for (int n = 0; n < numChannels_; ++n) {
+        const int l = SphericalHarmonics::getOrderForChannel(n);
+        // Projection decoder: loudspeaker gain = w_s * sum_n (2l + 1) * maxRe_l * Y_n(d_s) * a_n
+        const double gain = quadrature.weight[s] * (2 * l + 1) * maxRe[l] * sh[n];
+        double* filter = &accumulator[static_cast<size_t>(ear * numChannels_ + n) * length];
+        for (int t = 0; t < count; ++t) {
+          filter[t] += gain * hrir[t];
+        }
+      }
+    }
+  }
+
+  std::vector<float> impulseResponse(length);
+  for (int f = 0; f < 2 * numChannels_; ++f) {
+    const double* filter = &accumulator[static_cast<size_t>(f) * length];
+    for (int t = 0; t < length; ++t) {
+      impulseResponse[t] = static_cast<float>(filter[t]);
+    }
+    filters_.emplace_back(new PartitionedFilter(impulseResponse.data(), length, blockSize_));
+  }
+
+  for (int n = 0; n < numChannels_; ++n) {
+    convolvers_.emplace_back(new PartitionedConvolver(blockSize_, numPartitions_));
+  }
+  silentBlocks_.assign(numChannels_, 0);
+  for (int ear = 0; ear < 2; ++ear) {
+    accRe_[ear].assign(fft_.getNumBins(), 0.f);
+    accIm_[ear].assign(fft_.getNumBins(), 0.f);
+  }
+}
+
+int AmbisonicHrtfDecoder::getOrder() const {
+  return order_;
+}
+
+int AmbisonicHrtfDecoder::getNumChannels() const {
+  return numChannels_;
+}
+
+int AmbisonicHrtfDecoder::getBlockSize() const {
+  return blockSize_;
+}
+
+const PartitionedFilter& AmbisonicHrtfDecoder::getFilter(int acn, int ear) const {
+  return *filters_[static_cast<size_t>(ear * numChannels_ + acn)];
+}
+
+void AmbisonicHrtfDecoder::processAdd(
+    const float* const* input,
+    float* left,
+    float* right,
+    int numFrames) {
+  // The delay line of a channel is silent once it has only been given silence
+  const int blocksToFlush = numPartitions_ + 1;
+
+  for (int offset = 0; offset + blockSize_ <= numFrames; offset += blockSize_) {
+    for (int ear = 0; ear < 2; ++ear) {
+      std::fill(accRe_[ear].begin(), accRe_[ear].end(), 0.f);
+      std::fill(accIm_[ear].begin(), accIm_[ear].end(), 0.f);
+    }
+
+    bool audible = false;
+    for (int n = 0; n < numChannels_; ++n) {
+      const float* in = input[n] + offset;
+      bool silent = true;
+      for (int i = 0; i < blockSize_; ++i) {
+        if (in[i] != 0.f) {
+          silent = false;
+          break;
+        }
+      }
+      silentBlocks_[n] = silent ? silentBlocks_[n] + 1 : 0;
+      if (silentBlocks_[n] > blocksToFlush) {
+        continue;
+      }
+
+      PartitionedConvolver& convolver = *convolvers_[n];
+      convolver.pushInput(in);
+      for (int ear = 0; ear < 2; ++ear) {
+        convolver.accumulate(getFilter(n, ear), accRe_[ear].data(), accIm_[ear].data());
+      }
+      audible = true;
+    }
+    if (!audible) {
+      continue;
+    }
+
+    float* outputs[2] = {left + offset, right + offset};
+    for (int ear = 0; ear < 2; ++ear) {
+      // Overlap-save: the second block of the circular convolution is valid
+      fft_.inverse(accRe_[ear].data(), accIm_[ear].data(), time_.data());
+      const float* valid = time_.data() + blockSize_;
+      float* out = outputs[ear];
+      for (int i = 0; i < blockSize_; ++i) {
+        out[i] += valid[i];
+      }
+    }
+  }
+}
+
+void AmbisonicHrtfDecoder::reset() {
+  for (auto& convolver : convolvers_) {
+    convolver->reset();
+  }
+  std::fill(silentBlocks_.begin(), silentBlocks_.end(), 0);
+}
+} // namespace TBE
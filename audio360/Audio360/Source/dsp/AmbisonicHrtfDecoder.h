@@ -0,0 +1,71 @@
+#ifndef FBA_AMBISONICHRTFDECODER_H
+#define FBA_AMBISONICHRTFDECODER_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Fft.h"
+#include "PartitionedConvolver.h"
+#include "SphericalHarmonics.h"
+
+namespace TBE {
+class BinauralFilters;
+
+/// Renders an ambiX bus to binaural stereo through spherical harmonic domain HRIRs, for objects
+/// rendered binaurally with BinauralRendering::AMBISONIC. The HRIRs of the BinauralFilters at the
+/// points of a spherical quadrature are folded into one filter per ear and ACN channel, with the
+/// max-rE weighted projection of AmbisonicBinauralDecoder. Measured HRTFs aren't left/right
+/// symmetric, so each channel has its own filter for both ears: 2 x (N + 1)^2 filters in all.
+///
+/// Every channel is transformed once per block into its own frequency-domain delay line, and the
+/// products of all channels are summed per ear before a single inverse FFT per ear. Channels whose
+/// delay line has gone silent are skipped.
+class AmbisonicHrtfDecoder {
+ public:
+  /// @param filters HRIRs of the quadrature's directions, only used by the constructor. Filters
+  /// with their delays removed get them back, rounded to the sample.
+  /// @param order Ambisonic order, between 1 and SphericalHarmonics::kMaxOrder
+  AmbisonicHrtfDecoder(const BinauralFilters& filters, int order);
+
+  /// @return The ambisonic order of the decoder
+  int getOrder() const;
+
+  /// @return The number of ACN channels processed
+  int getNumChannels() const;
+
+  int getBlockSize() const;
+
+  /// @return The filter of an ACN channel for an ear, 0 for left and 1 for right
+  const PartitionedFilter& getFilter(int acn, int ear) const;
+
+  /// Render a block and add it to the outputs
+  /// @param input getNumChannels() planar ambiX channels
+  /// @param left Left output, accumulated
+  /// @param right Right output, accumulated
+  /// @param numFrames Number of frames, a multiple of the block size
+  void processAdd(const float* const* input, float* left, float* right, int numFrames);
+
+  /// Clear the convolution history
+  void reset();
+
+ private:
+  const int order_;
+  const int numChannels_;
+  const int blockSize_;
+  int numPartitions_{0};
+  std::vector<std::unique_ptr<PartitionedFilter>> filters_; // Left and right of each channel
+  std::vector<std::unique_ptr<PartitionedConvolver>> convolvers_; // One per channel
+  std::vector<int> silentBlocks_; // Consecutive silent input blocks per channel
+  Fft fft_;
+  std::vector<float> accRe_[2]; // Spectrum of each ear's output block
+  std::vector<float> accIm_[2];
+  std::vector<float> time_;
+};
+} // namespace TBE
+
+#endif // FBA_AMBISONICHRTFDECODER_H
@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "AmbisonicRotator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FBA_ROTATOR_SSE 1
+#include <emmintrin.h>
+#endif
+#if FBA_ROTATOR_SSE && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// Compiled with a target attribute and only called if the CPU reports AVX2 and FMA
+#define FBA_ROTATOR_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FBA_ROTATOR_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace TBE {
+static const SphericalHarmonics::Quadrature& getQuadrature() {
+  static const SphericalHarmonics::Quadrature quadrature;
+  return quadrature;
+}
+
+namespace {
+void processAddScalar(
+    float* output,
+    const float* const* inputs,
+    const float* start,
+    const float* delta,
+    int numInputs,
+    int numFrames) {
+  for (int j = 0; j < numInputs; ++j) {
+    const float* in = inputs[j];
+    for (int n = 0; n < numFrames; ++n) {
+      output[n] += (start[j] + delta[j] * static_cast<float>(n + 1)) * in[n];
+    }
+  }
+}
+
+#if FBA_ROTATOR_SSE
+void processAddSse(
+    float* output,
+    const float* const* inputs,
+    const float* start,
+    const float* delta,
+    int numInputs,
+    int numFrames) {
+  // Each output vector is accumulated over all inputs before it is stored
+  const __m128 four = _mm_set1_ps(4.f);
+  __m128 index = _mm_setr_ps(1.f, 2.f, 3.f, 4.f);
+  int n = 0;
+  for (; n + 4 <= numFrames; n += 4) {
+    __m128 acc = _mm_loadu_ps(output + n);
+    for (int j = 0; j < numInputs; ++j) {
+      const __m128 gain =
+          _mm_add_ps(_mm_set1_ps(start[j]), _mm_mul_ps(_mm_set1_ps(delta[j]), index));
+      acc = _mm_add_ps(acc, _mm_mul_ps(gain, _mm_loadu_ps(inputs[j] + n)));
+    }
+    _mm_storeu_ps(output + n, acc);
+    index = _mm_add_ps(index, four);
+  }
+  for (; n < numFrames; ++n) {
+    for (int j = 0; j < numInputs; ++j) {
+      output[n] += (start[j] + delta[j] * static_cast<float>(n + 1)) * inputs[j][n];
+    }
+  }
+}
+#endif
+
+#if FBA_ROTATOR_AVX2
+__attribute__((target("avx2,fma"))) void processAddAvx2(
+    float* output,
+    const float* const* inputs,
+    const float* start,
+    const float* delta,
+    int numInputs,
+    int numFrames) {
+  const __m256 eight = _mm256_set1_ps(8.f);
+  __m256 index = _mm256_setr_ps(1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f);
+  int n = 0;
+  for (; n + 8 <= numFrames; n += 8) {
+    __m256 acc = _mm256_loadu_ps(output + n);
+    for (int j = 0; j < numInputs; ++j) {
+      const __m256 gain =
+          _mm256_fmadd_ps(_mm256_set1_ps(delta[j]), index, _mm256_set1_ps(start[j]));
+      acc = _mm256_fmadd_ps(gain, _mm256_loadu_ps(inputs[j] + n), acc);
+    }
+    _mm256_storeu_ps(output + n, acc);
+    index = _mm256_add_ps(index, eight);
+  }
+  for (; n < numFrames; ++n) {
+    for (int j = 0; j < numInputs; ++j) {
+      output[n] += (start[j] + delta[j] * static_cast<float>(n + 1)) * inputs[j][n];
+    }
+  }
+}
+#endif
+
+#if FBA_ROTATOR_NEON
+void processAddNeon(
+    float* output,
+    const float* const* inputs,
+    const float* start,
+    const float* delta,
+    int numInputs,
+    int numFrames) {
+  const float32x4_t four = vdupq_n_f32(4.f);
+  const float first[4] = {1.f, 2.f, 3.f, 4.f};
+  float32x4_t index = vld1q_f32(first);
+  int n = 0;
+  for (; n + 4 <= numFrames; n += 4) {
+    float32x4_t acc = vld1q_f32(output + n);
+    for (int j = 0; j < numInputs; ++j) {
+      const float32x4_t gain = vmlaq_n_f32(vdupq_n_f32(start[j]), index, delta[j]);
+      acc = vmlaq_f32(acc, gain, vld1q_f32(inputs[j] + n));
+    }
+    vst1q_f32(output + n, acc);
+    index = vaddq_f32(index, four);
+  }
+  for (; n < numFrames; ++n) {
+    for (int j = 0; j < numInputs; ++j) {
+      output[n] += (start[j] + delta[j] * static_cast<float>(n + 1)) * inputs[j][n];
+    }
+  }
+}
+#endif
+
+/// Rotation matrices of real spherical harmonics, one band per order, indexed by m + l
+struct Bands {
+  double r[SphericalHarmonics::kMaxOrder + 1][7][7];
+
+  double get(int l, int m, int n) const {
+    return r[l][m + l][n + l];
+  }
+
+  /// The P function of Ivanic and Ruedenberg (1996, with the 1998 corrections)
+  double p(int i, int l, int a, int b) const {
+    if (b == l) {
+      return get(1, i, 1) * get(l - 1, a, l - 1) - get(1, i, -1) * get(l - 1, a, -l + 1);
+    }
+    if (b == -l) {
+      return get(1, i, 1) * get(l - 1, a, -l + 1) + get(1, i, -1) * get(l - 1, a, l - 1);
+    }
+    return get(1, i, 0) * get(l - 1, a, b);
+  }
+
+  double u(int l, int m, int n) const {
+    return p(0, l, m, n);
+  }
+
+  double v(int l, int m, int n) const {
+    if (m == 0) {
+      return p(1, l, 1, n) + p(-1, l, -1, n);
+    }
+    if (m > 0) {
+      const double d = m == 1 ? 1.0 : 0.0;
+      return p(1, l, m - 1, n) * std::sqrt(1.0 + d) - p(-1, l, -m + 1, n) * (1.0 - d);
+    }
+    const double d = m == -1 ? 1.0 : 0.0;
+    return p(1, l, m + 1, n) * (1.0 - d) + p(-1, l, -m - 1, n) * std::sqrt(1.0 + d);
+  }
+
+  double w(int l, int m, int n) const {
+    if (m > 0) {
+      return p(1, l, m + 1, n) + p(-1, l, -m - 1, n);
+    }
+    return p(1, l, m - 1, n) - p(-1, l, -m + 1, n);
+  }
+};
+} // namespace
+
+AmbisonicRotator::AmbisonicRotator() : kernel_(getKernelFunction(getBestKernel())) {
+  std::memset(current_, 0, sizeof(current_));
+  std::memset(target_, 0, sizeof(target_));
+}
+
+bool AmbisonicRotator::isKernelSupported(Kernel kernel) {
+  switch (kernel) {
+    case Kernel::SCALAR:
+      return true;
+#if FBA_ROTATOR_SSE
+    case Kernel::SSE:
+      return true;
+#endif
+#if FBA_ROTATOR_AVX2
+    case Kernel::AVX2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#if FBA_ROTATOR_NEON
+    case Kernel::NEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+AmbisonicRotator::Kernel AmbisonicRotator::getBestKernel() {
+  static const Kernel kFastestFirst[] = {Kernel::AVX2, Kernel::SSE, Kernel::NEON};
+  for (Kernel kernel : kFastestFirst) {
+    if (isKernelSupported(kernel)) {
+      return kernel;
+    }
+  }
+  return Kernel::SCALAR;
+}
+
+AmbisonicRotator::KernelFunction AmbisonicRotator::getKernelFunction(Kernel kernel) {
+  switch (kernel) {
+#if FBA_ROTATOR_SSE
+    case Kernel::SSE:
+      return processAddSse;
+#endif
+#if FBA_ROTATOR_AVX2
+    case Kernel::AVX2:
+      return processAddAvx2;
+#endif
+#if FBA_ROTATOR_NEON
+    case Kernel::NEON:
+      return processAddNeon;
+#endif
+    default:
+      return processAddScalar;
+  }
+}
+
+bool AmbisonicRotator::setKernel(Kernel kernel) {
+  if (!isKernelSupported(kernel)) {
+    return false;
+  }
+  kernel_ = getKernelFunction(kernel);
+  return true;
+}
+
+void AmbisonicRotator::computeRotationMatrix(TBQuat rotation, int order, float* matrix) {
+  std::memset(matrix, 0, sizeof(float) * kMaxChannels * kMaxChannels);
+  matrix[0] = 1.f;
+  if (order < 1) {
+    return;
+  }
+
+  // The 3x3 rotation in ambiX axes: column j is the rotated ambiX basis vector j, taken through
+  // engine coordinates (x = right, y = up, z = forward) and back
+  static const TBVector kAmbixAxes[3] = {
+      TBVector(0.f, 0.f, 1.f), TBVector(-1.f, 0.f, 0.f), TBVector(0.f, 1.f, 0.f)};
+  double rotated[3][3];
+  for (int j = 0; j < 3; ++j) {
+    const TBVector v = TBQuat::rotateVectorByQuat(rotation, kAmbixAxes[j]);
+    float x, y, z;
+    SphericalHarmonics::engineToAmbix(v, x, y, z);
+    rotated[0][j] = x;
+    rotated[1][j] = y;
+    rotated[2][j] = z;
+  }
+
+  // First order: ACN 1, 2, 3 (m = -1, 0, 1) are y, z, x
+  static const int kAxisForM[3] = {1, 2, 0};
+  Bands bands;
+  bands.r[0][0][0] = 1.0;
+  for (int m = -1; m <= 1; ++m) {
+    for (int n = -1; n <= 1; ++n) {
+      bands.r[1][m + 1][n + 1] = rotated[kAxisForM[m + 1]][kAxisForM[n + 1]];
+    }
+  }
+
+  for (int l = 2; l <= order; ++l) {
+    for (int m = -l; m <= l; ++m) {
+      const int absM = std::abs(m);
+      const double d = m == 0 ? 1.0 : 0.0;
+      for (int n = -l; n <= l; ++n) {
+        const double denominator =
+            std::abs(n) < l ? static_cast<double>((l + n) * (l - n)) : (2.0 * l) * (2.0 * l - 1);
+        const double cu = std::sqrt((l + m) * (l - m) / denominator);
+        const double cv = 0.5 * (1.0 - 2.0 * d) *
+            std::sqrt((1.0 + d) * (l + absM - 1) * (l + absM) / denominator);
+        const double cw = -0.5 * std::sqrt((l - absM - 1) * (l - absM) / denominator) * (1.0 - d);
+        double value = 0.0;
+        if (cu != 0.0) {
+          value += cu * bands.u(l, m, n);
+        }
+        if (cv != 0.0) {
+          value += cv * bands.v(l, m, n);
+        }
+        if (cw != 0.0) {
+          value += cw * bands.w(l, m, n);
+        }
+        bands.r[l][m + l][n + l] = value;
+      }
+    }
+  }
+
+  for (int l = 1; l <= order; ++l) {
+    for (int m = -l; m <= l; ++m) {
+      for (int n = -l; n <= l; ++n) {
+        const int i = l * l + l + m;
+        const int j = l * l + l + n;
+        matrix[i * kMaxChannels + j] = static_cast<float>(bands.get(l, m, n));
+      }
+    }
+  }
+}
+
+void AmbisonicRotator::computeMatrix(
+    TBQuat rotation,
+    int order,
+    float* matrix,
+    DirectionalGain gain,
+    const void* userData) {
+  const auto& quadrature = getQuadrature();
+  const int numChannels = SphericalHarmonics::getNumChannels(order);
+  double accumulator[kMaxChannels * kMaxChannels] = {0.0};
+
+  for (int s = 0; s < SphericalHarmonics::Quadrature::kNumPoints; ++s) {
+    const float x = quadrature.x[s];
+    const float y = quadrature.y[s];
+    const float z = quadrature.z[s];
+
+    float source[kMaxChannels];
+    SphericalHarmonics::evaluate(x, y, z, order, source);
+
+    // ambiX (front, left, up) -> engine (right, up, forward), rotate, and back
+    const TBVector rotated = TBQuat::rotateVectorByQuat(rotation, TBVector(-y, z, x));
+    float destination[kMaxChannels];
+    SphericalHarmonics::evaluateEngine(rotated, order, destination);
+
+    const double weight = quadrature.weight[s] * (gain ? gain(x, y, z, userData) : 1.f);
+    for (int i = 0; i < numChannels; ++i) {
+      const double wi = weight * destination[i];
+      for (int j = 0; j < numChannels; ++j) {
+        accumulator[i * kMaxChannels + j] += wi * source[j];
+      }
+    }
+  }
+
+  for (int i = 0; i < kMaxChannels; ++i) {
+    for (int j = 0; j < kMaxChannels; ++j) {
+      float value = 0.f;
+      if (i < numChannels && j < numChannels) {
+        // SN3D harmonics of degree l have a mean square of 1 / (2l + 1) over the sphere
+        const int l = SphericalHarmonics::getOrderForChannel(j);
+        value = static_cast<float>(accumulator[i * kMaxChannels + j] * (2 * l + 1));
+        if (std::abs(value) < 1.e-6f) {
+          value = 0.f;
+        }
+      }
+      matrix[i * kMaxChannels + j] = value;
+    }
+  }
+}
+
+void AmbisonicRotator::setMatrix(const float* matrix, bool blockDiagonal) {
+  if (!hasMatrix_) {
+    std::memcpy(current_, matrix, sizeof(current_));
+    std::memcpy(target_, matrix, sizeof(target_));
+    hasMatrix_ = true;
+    needsInterpolation_ = false;
+  } else if (std::memcmp(target_, matrix, sizeof(target_)) != 0) {
+    std::memcpy(target_, matrix, sizeof(target_));
+    needsInterpolation_ = true;
+  }
+  blockDiagonal_ = blockDiagonal;
+}
+
+void AmbisonicRotator::processAdd(
+    const float* const* input,
+    float* const* output,
+    int numChannels,
+    int numFrames) {
+  if (!hasMatrix_ || numFrames <= 0) {
+    return;
+  }
+
+  const float increment = 1.f / static_cast<float>(numFrames);
+  for (int i = 0; i < numChannels; ++i) {
+    int first = 0;
+    int last = numChannels;
+    if (blockDiagonal_) {
+      const int l = SphericalHarmonics::getOrderForChannel(i);
+      first = l * l;
+      last = std::min(numChannels, (l + 1) * (l + 1));
+    }
+
+    // Gather the non-zero coefficients of the row, so the kernel reads each output once
+    const float* inputs[kMaxChannels];
+    float start[kMaxChannels];
+    float delta[kMaxChannels];
+    int numInputs = 0;
+    for (int j = first; j < last; ++j) {
+      const float end = target_[i * kMaxChannels + j];
+      const float begin = needsInterpolation_ ? current_[i * kMaxChannels + j] : end;
+      if (begin == 0.f && end == 0.f) {
+        continue;
+      }
+      inputs[numInputs] = input[j];
+      start[numInputs] = begin;
+      delta[numInputs] = (end - begin) * increment;
+      numInputs++;
+    }
+    if (numInputs > 0) {
+      kernel_(output[i], inputs, start, delta, numInputs, numFrames);
+    }
+  }
+
+  if (needsInterpolation_) {
+    std::memcpy(current_, target_, sizeof(current_));
+    needsInterpolation_ = false;
+  }
+}
+
+void AmbisonicRotator::reset() {
+  hasMatrix_ = false;
+  needsInterpolation_ = false;
+}
+} // namespace TBE
@@ -0,0 +1,108 @@
+#ifndef FBA_AMBISONICROTATOR_H
+#define FBA_AMBISONICROTATOR_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include "SphericalHarmonics.h"
+#include "TBE_Quat.hh"
+
+namespace TBE {
+/// Applies a spherical harmonic transformation matrix (rotation, optionally combined with a
+/// directional gain such as focus) to a block of ambiX audio. When the matrix changes between
+/// blocks, the coefficients are linearly interpolated across the block to avoid zipper noise.
+/// Blocks are processed by an SSE, AVX2 or NEON kernel picked at runtime, with a scalar fallback.
+class AmbisonicRotator {
+ public:
+  static const int kMaxChannels = SphericalHarmonics::kMaxChannels;
+
+  /// Implementations of processAdd()
+  enum class Kernel {
+    SCALAR, /// Portable reference
+    SSE, /// 4 frames at a time, x86
+    AVX2, /// 8 frames at a time with FMA, x86 CPUs that support it
+    NEON, /// 4 frames at a time, ARM
+  };
+
+  /// Directional gain applied in the source frame, before rotation
+  /// @param x, y, z Unit direction in ambiX axes
+  /// @param userData User data passed to computeMatrix
+  typedef float (*DirectionalGain)(float x, float y, float z, const void* userData);
+
+  AmbisonicRotator();
+
+  /// @return The fastest kernel the CPU supports
+  static Kernel getBestKernel();
+
+  /// @return True if the kernel was compiled in and the CPU supports it
+  static bool isKernelSupported(Kernel kernel);
+
+  /// Use a specific kernel, e.g. the scalar reference for comparison. Defaults to getBestKernel().
+  /// @return False if the kernel isn't supported, in which case the current one is kept
+  bool setKernel(Kernel kernel);
+
+  /// Compute the rotation matrix for an ambisonic order with the Ivanic-Ruedenberg recursion: the
+  /// first order block is the 3x3 rotation matrix and each higher order block is built from the
+  /// one below it. Much cheaper than computeMatrix(), which projects onto a quadrature, and
+  /// exactly block diagonal.
+  /// @param rotation Rotation in engine coordinates
+  /// @param order Ambisonic order, between 0 and SphericalHarmonics::kMaxOrder
+  /// @param matrix kMaxChannels x kMaxChannels output, row major (row = output channel)
+  static void computeRotationMatrix(TBQuat rotation, int order, float* matrix);
+
+  /// Compute the transformation matrix for an ambisonic order. A plane wave from direction d is
+  /// mapped to a plane wave from rotation * d, scaled by gain(d). Without a gain the matrix is the
+  /// exact rotation matrix and is block diagonal per order.
+  /// @param rotation Rotation in engine coordinates
+  /// @param order Ambisonic order, between 0 and SphericalHarmonics::kMaxOrder
+  /// @param matrix kMaxChannels x kMaxChannels output, row major (row = output channel)
+  /// @param gain Optional directional gain
+  /// @param userData User data for gain
+  static void computeMatrix(
+      TBQuat rotation,
+      int order,
+      float* matrix,
+      DirectionalGain gain = nullptr,
+      const void* userData = nullptr);
+
+  /// Set the matrix to use for the next block. The first matrix set after reset() is used without
+  /// interpolation.
+  /// @param matrix kMaxChannels x kMaxChannels matrix, row major
+  /// @param blockDiagonal True if the matrix only mixes channels of the same order
+  void setMatrix(const float* matrix, bool blockDiagonal);
+
+  /// Transform a block and add the result to the output
+  /// @param input Planar input channels
+  /// @param output Planar output channels (must not alias the input)
+  /// @param numChannels Number of ACN channels in the input and output
+  /// @param numFrames Number of frames in the block
+  void processAdd(const float* const* input, float* const* output, int numChannels, int numFrames);
+
+  /// Forget the previous matrix so that the next one is applied without interpolation
+  void reset();
+
+ private:
+  /// Adds sum_j (start[j] + delta[j] * (n + 1)) * inputs[j][n] to output[n]
+  typedef void (*KernelFunction)(
+      float* output,
+      const float* const* inputs,
+      const float* start,
+      const float* delta,
+      int numInputs,
+      int numFrames);
+
+  static KernelFunction getKernelFunction(Kernel kernel);
+
+  KernelFunction kernel_;
+  float current_[kMaxChannels * kMaxChannels];
+  float target_[kMaxChannels * kMaxChannels];
+  bool blockDiagonal_{true};
+  bool needsInterpolation_{false};
+  bool hasMatrix_{false};
+};
+} // namespace TBE
+
+#endif // FBA_AMBISONICROTATOR_H
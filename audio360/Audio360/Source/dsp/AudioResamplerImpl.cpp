@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "AudioResamplerImpl.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace TBE {
+static const int kNumPhases = 256;
+static const int kOptimalHalfTaps = 8;
+static const double kPi = 3.14159265358979323846;
+
+AudioResamplerImpl::AudioResamplerImpl(
+    unsigned numChannels,
+    float inputSampleRate,
+    float outputSampleRate,
+    size_t maxBufferSizeSamples,
+    Quality quality)
+    : numChannels_(numChannels),
+      inputSampleRate_(inputSampleRate),
+      outputSampleRate_(outputSampleRate),
+      quality_(quality),
+      ratio_(static_cast<double>(outputSampleRate) / inputSampleRate),
+      halfTaps_(quality == Quality::OPTIMAL ? kOptimalHalfTaps : 1) {
+  pending_.reserve((maxBufferSizeSamples * 2 + 2 * halfTaps_) * numChannels_);
+  buildKernel();
+  reset();
+}
+
+void AudioResamplerImpl::buildKernel() {
+  if (quality_ != Quality::OPTIMAL) {
+    return;
+  }
+
+  const int numTaps = 2 * halfTaps_;
+  // Lower the cut-off when downsampling to avoid aliasing. A little headroom below Nyquist keeps
+  // the transition band of the short kernel out of the audible aliasing region.
+  const double cutoff = std::min(1.0, ratio_) * 0.97;
+  kernel_.resize((kNumPhases + 1) * numTaps);
+
+  for (int phase = 0; phase <= kNumPhases; ++phase) {
+    const double fraction = static_cast<double>(phase) / kNumPhases;
+    float* row = &kernel_[phase * numTaps];
+    double sum = 0.0;
+    for (int tap = 0; tap < numTaps; ++tap) {
+      const double x = (tap - (halfTaps_ - 1)) - fraction;
+      const double phase = kPi * cutoff * x;
+      const double sinc = (std::abs(x) < 1.e-9) ? 1.0 : std::sin(phase) / phase;
+      const double w = (x + halfTaps_) / (2.0 * halfTaps_);
+      const double window = 0.42 - 0.5 * std::cos(2.0 * kPi * w) + 0.08 * std::cos(4.0 * kPi * w);
+      const double value = (w <= 0.0 || w >= 1.0) ? 0.0 : sinc * window;
+      row[tap] = static_cast<float>(value);
+      sum += value;
+    }
+    // Normalise each phase for unity gain at DC
+    for (int tap = 0; tap < numTaps; ++tap) {
+      row[tap] = static_cast<float>(row[tap] / sum);
+    }
+  }
+}
+
+inline void AudioResamplerImpl::interpolate(double position, float* out) const {
+  const size_t base = static_cast<size_t>(position);
+  const double fraction = position - static_cast<double>(base);
+
+  if (quality_ != Quality::OPTIMAL) {
+    const float* a = &pending_[base * numChannels_];
+    const float* b = a + numChannels_;
+    const float f = static_cast<float>(fraction);
+    for (unsigned ch = 0; ch < numChannels_; ++ch) {
+      out[ch] = a[ch] + f * (b[ch] - a[ch]);
+    }
+    return;
+  }
+
+  // Interpolate between the two nearest precomputed phases
+  const double phasePos = fraction * kNumPhases;
+  const int phase = std::min(static_cast<int>(phasePos), kNumPhases - 1);
+  const float phaseFrac = static_cast<float>(phasePos - phase);
+  const int numTaps = 2 * halfTaps_;
+  const float* rowA = &kernel_[phase * numTaps];
+  const float* rowB = rowA + numTaps;
+  const float* frames = &pending_[(base - (halfTaps_ - 1)) * numChannels_];
+
+  for (unsigned ch = 0; ch < numChannels_; ++ch) {
+    out[ch] = 0.f;
+  }
+  for (int tap = 0; tap < numTaps; ++tap) {
+    const float coeff = rowA[tap] + phaseFrac * (rowB[tap] - rowA[tap]);
+    const float* frame = frames + tap * numChannels_;
+    for (unsigned ch = 0; ch < numChannels_; ++ch) {
+      out[ch] += coeff * frame[ch];
+    }
+  }
+}
+
+size_t AudioResamplerImpl::process(
+    const float* input,
+    size_t totalInputSamples,
+    float* output,
+    size_t totalOutputSamples,
+    bool endOfStream) {
+  if (numChannels_ == 0) {
+    return 0;
+  }
+
+  const size_t numInputFrames = input ? totalInputSamples / numChannels_ : 0;
+  if (numInputFrames > 0) {
+    pending_.resize((numPendingFrames_ + numInputFrames) * numChannels_);
+    std::memcpy(
+        &pending_[numPendingFrames_ * numChannels_],
+        input,
+        numInputFrames * numChannels_ * sizeof(float));
+    numPendingFrames_ += numInputFrames;
+  }
+
+  if (endOfStream && !flushed_) {
+    // Pad with silence so that the interpolator can reach the last input frame
+    pending_.resize((numPendingFrames_ + halfTaps_) * numChannels_, 0.f);
+    numPendingFrames_ += halfTaps_;
+    flushed_ = true;
+  }
+
+  const size_t maxOutputFrames = totalOutputSamples / numChannels_;
+  const double step = 1.0 / ratio_;
+  size_t numOutputFrames = 0;
+
+  while (numOutputFrames < maxOutputFrames &&
+         static_cast<size_t>(position_) + halfTaps_ < numPendingFrames_) {
+    interpolate(position_, output + numOutputFrames * numChannels_);
+    position_ += step;
+    numOutputFrames++;
+  }
+
+  // Drop the frames that will never be used again, keeping the history the kernel needs
+  const double firstNeeded = std::floor(position_) - (halfTaps_ - 1);
+  if (firstNeeded > 0.0) {
+    const size_t drop = std::min(numPendingFrames_, static_cast<size_t>(firstNeeded));
+    std::memmove(
+        pending_.data(),
+        pending_.data() + drop * numChannels_,
+        (numPendingFrames_ - drop) * numChannels_ * sizeof(float));
+    numPendingFrames_ -= drop;
+    pending_.resize(numPendingFrames_ * numChannels_);
+    position_ -= static_cast<double>(drop);
+  }
+
+  return numOutputFrames * numChannels_;
+}
+
+int AudioResamplerImpl::getNumChannels() const {
+  return static_cast<int>(numChannels_);
+}
+
+float AudioResamplerImpl::getInputSampleRate() const {
+  return inputSampleRate_;
+}
+
+float AudioResamplerImpl::getOutputSampleRate() const {
+  return outputSampleRate_;
+}
+
+AudioResampler::Quality AudioResamplerImpl::getQuality() const {
+  return quality_;
+}
+
+void AudioResamplerImpl::setRatio(double resamplingRatio) {
+  if (resamplingRatio <= 0.0) {
+    return;
+  }
+
+  const double previousCutoff = std::min(1.0, ratio_);
+  ratio_ = resamplingRatio;
+  if (std::abs(std::min(1.0, ratio_) - previousCutoff) > 0.01) {
+    buildKernel();
+  }
+}
+
+double AudioResamplerImpl::getRatio() const {
+  return ratio_;
+}
+
+void AudioResamplerImpl::reset() {
+  // Start with enough silent history for the first output to line up with the first input frame
+  numPendingFrames_ = static_cast<size_t>(halfTaps_ - 1);
+  pending_.assign(numPendingFrames_ * numChannels_, 0.f);
+  position_ = static_cast<double>(halfTaps_ - 1);
+  flushed_ = false;
+}
+
+size_t AudioResamplerImpl::getNumPendingFrames() const {
+  return numPendingFrames_;
+}
+} // namespace TBE
+
+TBE::EngineError TBE_CreateAudioResampler(
+    TBE::AudioResampler*& resampler,
+    unsigned numChannels,
+    float inputSampleRate,
+    float outputSampleRate,
+    size_t maxBufferSizeSamples,
+    TBE::AudioResampler::Quality quality) {
+  if (resampler) {
+    return TBE::EngineError::INVALID_PARAM;
+  }
+  if (numChannels == 0) {
+    return TBE::EngineError::INVALID_CHANNEL_COUNT;
+  }
+  if (inputSampleRate <= 0.f || outputSampleRate <= 0.f) {
+    return TBE::EngineError::INVALID_SAMPLE_RATE;
+  }
+
+  resampler = new TBE::AudioResamplerImpl(
+      numChannels, inputSampleRate, outputSampleRate, maxBufferSizeSamples, quality);
+  return TBE::EngineError::OK;
+}
@@ -0,0 +1,64 @@
+#ifndef FBA_AUDIORESAMPLERIMPL_H
+#define FBA_AUDIORESAMPLERIMPL_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <vector>
+#include "TBE_AudioResampler.h"
+
+namespace TBE {
+/// Streaming sample rate converter for interleaved audio.
+/// Quality::FAST uses linear interpolation. Quality::OPTIMAL uses a 16 tap Blackman windowed sinc
+/// interpolator read from a precomputed polyphase table, with the cut-off lowered when
+/// downsampling. Input that cannot be converted yet (because the output buffer is full or the
+/// interpolator needs look-ahead) is kept internally until the next call.
+class AudioResamplerImpl : public AudioResampler {
+ public:
+  AudioResamplerImpl(
+      unsigned numChannels,
+      float inputSampleRate,
+      float outputSampleRate,
+      size_t maxBufferSizeSamples,
+      Quality quality);
+
+  size_t process(
+      const float* input,
+      size_t totalInputSamples,
+      float* output,
+      size_t totalOutputSamples,
+      bool endOfStream) override;
+
+  int getNumChannels() const override;
+  float getInputSampleRate() const override;
+  float getOutputSampleRate() const override;
+  Quality getQuality() const override;
+  void setRatio(double resamplingRatio) override;
+  double getRatio() const override;
+  void reset() override;
+
+  /// @return The number of input frames currently held internally
+  size_t getNumPendingFrames() const;
+
+ private:
+  void buildKernel();
+  inline void interpolate(double position, float* out) const;
+
+  const unsigned numChannels_;
+  const float inputSampleRate_;
+  const float outputSampleRate_;
+  const Quality quality_;
+  double ratio_;
+  int halfTaps_;
+  std::vector<float> kernel_; // kNumPhases + 1 rows of 2 * halfTaps_ coefficients
+  std::vector<float> pending_; // Interleaved input frames, starting at frame 0
+  size_t numPendingFrames_{0};
+  double position_{0.0}; // Read position in frames, relative to pending_
+  bool flushed_{false};
+};
+} // namespace TBE
+
+#endif // FBA_AUDIORESAMPLERIMPL_H
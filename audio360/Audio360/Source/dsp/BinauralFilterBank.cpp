@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "BinauralFilterBank.h"
+#include <algorithm>
+#include <cmath>
+#include "HeadModelHrtf.h"
+
+namespace TBE {
+static const float kPi = 3.14159265358979323846f;
+
+const int BinauralFilters::kMaxInterpolated;
+
+bool BinauralFilters::isInterpolated() const {
+  return false;
+}
+
+int BinauralFilters::getInterpolation(
+    const TBVector& direction,
+    int* left,
+    int* right,
+    float* weights) const {
+  getIndices(direction, left[0], right[0]);
+  weights[0] = 1.f;
+  return 1;
+}
+
+float BinauralFilters::getDelay(int) const {
+  return 0.f;
+}
+
+float BinauralFilters::getMaxDelay() const {
+  return 0.f;
+}
+
+int BinauralFilterBank::getBlockSizeFor(int bufferSize) {
+  return PartitionedConvolver::getBlockSizeFor(bufferSize, kMaxBlockSize);
+}
+
+BinauralFilterBank::BinauralFilterBank(const HeadModelHrtf& hrtf, int blockSize)
+    : blockSize_(blockSize) {
+  std::vector<float> left(hrtf.getLength());
+  std::vector<float> right(hrtf.getLength());
+  filters_.reserve(kNumFilters);
+  for (int i = 0; i < kNumFilters; ++i) {
+    // Lateral angles from -90 (left) to +90 (right) degrees, in the horizontal plane
+    const float angle = (static_cast<float>(i) - (kNumFilters - 1) / 2) * kPi / 180.f;
+    hrtf.compute(TBVector(std::sin(angle), 0.f, std::cos(angle)), left.data(), right.data());
+    filters_.emplace_back(new PartitionedFilter(right.data(), hrtf.getLength(), blockSize));
+  }
+}
+
+int BinauralFilterBank::getBlockSize() const {
+  return blockSize_;
+}
+
+int BinauralFilterBank::getNumPartitions() const {
+  return filters_.front()->getNumPartitions();
+}
+
+void BinauralFilterBank::getIndices(const TBVector& direction, int& left, int& right) const {
+  const float norm = TBVector::magnitude(direction);
+  const float x = norm > TBE_SMALL_NUMBER ? direction.x / norm : 0.f;
+  const float degrees = std::asin(std::max(-1.f, std::min(1.f, x))) * 180.f / kPi;
+  right = static_cast<int>(std::lround(degrees)) + (kNumFilters - 1) / 2;
+  right = std::max(0, std::min(kNumFilters - 1, right));
+  left = kNumFilters - 1 - right;
+}
+
+const PartitionedFilter& BinauralFilterBank::getFilter(int index) const {
+  return *filters_[index];
+}
+
+BinauralPanner::BinauralPanner(const BinauralFilters& bank, float crossfadeThresholdDegrees)
+    : bank_(bank),
+      interpolated_(bank.isInterpolated()),
+      crossfadeThreshold_(std::cos(std::max(0.f, crossfadeThresholdDegrees) * kPi / 180.f)),
+      convolver_(bank.getBlockSize(), bank.getNumPartitions()) {
+  ear_.assign(bank.getBlockSize(), 0.f);
+  previous_.assign(bank.getBlockSize(), 0.f);
+  if (interpolated_) {
+    // Room for a block and the longest delay, with the three samples before it for the
+    // interpolation
+    const size_t needed = static_cast<size_t>(bank.getBlockSize()) +
+        static_cast<size_t>(std::ceil(bank.getMaxDelay())) + 3;
+    size_t size = 1;
+    while (size < needed) {
+      size *= 2;
+    }
+    for (int side = 0; side < 2; ++side) {
+      mixed_[side].reset(new PartitionedFilter(bank.getBlockSize(), bank.getNumPartitions()));
+      nextMixed_[side].reset(new PartitionedFilter(bank.getBlockSize(), bank.getNumPartitions()));
+      delayLines_[side].assign(size, 0.f);
+    }
+    magnitude_.assign(static_cast<size_t>(bank.getBlockSize()) + 1, 0.f);
+    fft_.reset(new Fft(2 * bank.getBlockSize()));
+    time_.assign(2 * static_cast<size_t>(bank.getBlockSize()), 0.f);
+  }
+  delays_[0] = 0.f;
+  delays_[1] = 0.f;
+}
+
+bool BinauralPanner::processAdd(
+    const float* input,
+    const TBVector& direction,
+    float* left,
+    float* right,
+    int numFrames) {
+  if (interpolated_) {
+    return processInterpolated(input, direction, left, right, numFrames);
+  }
+  int targetLeft = 0;
+  int targetRight = 0;
+  bank_.getIndices(direction, targetLeft, targetRight);
+  const int blockSize = bank_.getBlockSize();
+  const float step = 1.f / static_cast<float>(blockSize);
+
+  bool crossfaded = false;
+  for (int offset = 0; offset + blockSize <= numFrames; offset += blockSize) {
+    convolver_.pushInput(input + offset);
+    const int current[2] = {left_, right_};
+    const int target[2] = {targetLeft, targetRight};
+    float* const outputs[2] = {left + offset, right + offset};
+    for (int side = 0; side < 2; ++side) {
+      float* out = outputs[side];
+      convolver_.process(bank_.getFilter(target[side]), ear_.data());
+      if (current[side] < 0 || current[side] == target[side]) {
+        for (int n = 0; n < blockSize; ++n) {
+          out[n] += ear_[n];
+        }
+        continue;
+      }
+      convolver_.process(bank_.getFilter(current[side]), previous_.data());
+      for (int n = 0; n < blockSize; ++n) {
+        const float fade = static_cast<float>(n + 1) * step;
+        out[n] += previous_[n] + (ear_[n] - previous_[n]) * fade;
+      }
+      crossfaded = true;
+    }
+    left_ = targetLeft;
+    right_ = targetRight;
+  }
+  return crossfaded;
+}
+
+bool BinauralPanner::processInterpolated(
+    const float* input,
+    const TBVector& direction,
+    float* left,
+    float* right,
+    int numFrames) {
+  TBVector unit = direction;
+  TBVector::normalise(unit);
+  if (TBVector::magnitude(unit) < 0.5f) {
+    unit = TBVector::forward();
+  }
+  int indices[2][BinauralFilters::kMaxInterpolated];
+  float weights[BinauralFilters::kMaxInterpolated];
+  const int count = bank_.getInterpolation(unit, indices[0], indices[1], weights);
+  float targetDelays[2] = {0.f, 0.f};
+  for (int side = 0; side < 2; ++side) {
+    for (int i = 0; i < count; ++i) {
+      targetDelays[side] += weights[i] * bank_.getDelay(indices[side][i]);
+    }
+  }
+
+  // Mix new filters on the first block if the direction has moved far enough
+  const bool remix =
+      !hasMixed_ || TBVector::DotProduct(unit, mixedDirection_) < crossfadeThreshold_;
+  if (remix) {
+    for (int side = 0; side < 2; ++side) {
+      mixFilters(indices[side], weights, count, *nextMixed_[side]);
+    }
+    mixedDirection_ = unit;
+  }
+  if (!hasMixed_) {
+    // Nothing to crossfade from, or to ramp the delays from
+    delays_[0] = targetDelays[0];
+    delays_[1] = targetDelays[1];
+  }
+
+  const int blockSize = bank_.getBlockSize();
+  const float step = 1.f / static_cast<float>(blockSize);
+  const float frameStep = 1.f / static_cast<float>(std::max(1, numFrames));
+  const size_t mask = delayLines_[0].size() - 1;
+  const bool crossfaded = remix && hasMixed_;
+  for (int offset = 0; offset + blockSize <= numFrames; offset += blockSize) {
+    convolver_.pushInput(input + offset);
+    const bool fade = crossfaded && offset == 0;
+    float* const outputs[2] = {left + offset, right + offset};
+    for (int side = 0; side < 2; ++side) {
+      if (remix && offset == 0) {
+        std::swap(mixed_[side], nextMixed_[side]);
+      }
+      convolver_.process(*mixed_[side], ear_.data());
+      if (fade) {
+        convolver_.process(*nextMixed_[side], previous_.data());
+        for (int n = 0; n < blockSize; ++n) {
+          const float gain = static_cast<float>(n + 1) * step;
+          ear_[n] = previous_[n] + (ear_[n] - previous_[n]) * gain;
+        }
+      }
+
+      // Fractional delay, ramped across the whole call, with third order Lagrange interpolation
+      // on the three samples before the delayed position and the one after it, so that delays
+      // down to 0 only read samples already written
+      std::vector<float>& line = delayLines_[side];
+      for (int n = 0; n < blockSize; ++n) {
+        line[(delayWrite_ + n) & mask] = ear_[n];
+      }
+      const float start = delays_[side];
+      const float delta = (targetDelays[side] - start) * frameStep;
+      float* out = outputs[side];
+      for (int n = 0; n < blockSize; ++n) {
+        const float delay = std::max(0.f, start + delta * static_cast<float>(offset + n + 1));
+        const int whole = static_cast<int>(delay);
+        // Position past the sample before the delayed one, in (0, 1]
+        const float t = static_cast<float>(whole) - delay + 1.f;
+        const size_t index = (delayWrite_ + n - static_cast<size_t>(whole) - 1) & mask;
+        const float xm2 = line[(index - 2) & mask];
+        const float xm1 = line[(index - 1) & mask];
+        const float x0 = line[index];
+        const float x1 = line[(index + 1) & mask];
+        const float a = t * (t - 1.f);
+        const float b = (t + 2.f) * (t + 1.f);
+        out[n] += (b * t * x1 - a * (t + 1.f) * xm2) * (1.f / 6.f) +
+            (a * (t + 2.f) * xm1 - b * (t - 1.f) * x0) * 0.5f;
+      }
+    }
+    delayWrite_ = (delayWrite_ + blockSize) & mask;
+  }
+  delays_[0] = targetDelays[0];
+  delays_[1] = targetDelays[1];
+  hasMixed_ = true;
+  return crossfaded;
+}
+
+void BinauralPanner::mixFilters(
+    const int* indices,
+    const float* weights,
+    int count,
+    PartitionedFilter& output) {
+  const int numBins = output.getNumBins();
+  for (int p = 0; p < output.getNumPartitions(); ++p) {
+    float* outRe = output.getReal(p);
+    float* outIm = output.getImag(p);
+    if (count == 1) {
+      std::copy(bank_.getFilter(indices[0]).getReal(p),
+                bank_.getFilter(indices[0]).getReal(p) + numBins,
+                outRe);
+      std::copy(bank_.getFilter(indices[0]).getImag(p),
+                bank_.getFilter(indices[0]).getImag(p) + numBins,
+                outIm);
+      continue;
+    }
+    std::fill(outRe, outRe + numBins, 0.f);
+    std::fill(outIm, outIm + numBins, 0.f);
+    float* magnitude = magnitude_.data();
+    std::fill(magnitude, magnitude + numBins, 0.f);
+    for (int i = 0; i < count; ++i) {
+      const float* re = bank_.getFilter(indices[i]).getReal(p);
+      const float* im = bank_.getFilter(indices[i]).getImag(p);
+      const float weight = weights[i];
+      for (int k = 0; k < numBins; ++k) {
+        outRe[k] += weight * re[k];
+        outIm[k] += weight * im[k];
+        magnitude[k] += weight * std::sqrt(re[k] * re[k] + im[k] * im[k]);
+      }
+    }
+    // The weighted sum's phase with the interpolated magnitude, so that filters out of phase at a
+    // frequency don't cancel there
+    for (int k = 0; k < numBins; ++k) {
+      const float sum = std::sqrt(outRe[k] * outRe[k] + outIm[k] * outIm[k]);
+      if (sum > 1e-20f) {
+        const float scale = magnitude[k] / sum;
+        outRe[k] *= scale;
+        outIm[k] *= scale;
+      } else {
+        outRe[k] = magnitude[k];
+        outIm[k] = 0.f;
+      }
+    }
+
+    // Changing the magnitudes spreads the partition over the whole FFT, which would wrap around
+    // in the convolution: cut it back to one block
+    const int blockSize = output.getBlockSize();
+    const float scale = 1.f / static_cast<float>(fft_->getSize());
+    fft_->inverse(outRe, outIm, time_.data());
+    for (int n = 0; n < blockSize; ++n) {
+      time_[n] *= scale;
+    }
+    std::fill(time_.begin() + blockSize, time_.end(), 0.f);
+    fft_->forward(time_.data(), outRe, outIm);
+  }
+}
+
+void BinauralPanner::reset() {
+  convolver_.reset();
+  left_ = -1;
+  right_ = -1;
+  hasMixed_ = false;
+  for (auto& line : delayLines_) {
+    std::fill(line.begin(), line.end(), 0.f);
+  }
+}
+} // namespace TBE
@@ -0,0 +1,154 @@
+#ifndef FBA_BINAURALFILTERBANK_H
+#define FBA_BINAURALFILTERBANK_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "PartitionedConvolver.h"
+#include "TBE_Vector.hh"
+
+namespace TBE {
+class HeadModelHrtf;
+
+/// Partitioned HRIRs shared by every BinauralPanner, one filter per ear and direction
+class BinauralFilters {
+ public:
+  /// Most filters getInterpolation() returns for each ear
+  static const int kMaxInterpolated = 3;
+
+  virtual ~BinauralFilters() {}
+
+  virtual int getBlockSize() const = 0;
+
+  /// @return The number of partitions of the longest filter
+  virtual int getNumPartitions() const = 0;
+
+  /// Look up the filter of each ear for a direction in the listener's frame
+  virtual void getIndices(const TBVector& direction, int& left, int& right) const = 0;
+
+  virtual const PartitionedFilter& getFilter(int index) const = 0;
+
+  /// @return True if the filters have their delay removed and getInterpolation() can return more
+  /// than one filter per ear
+  virtual bool isInterpolated() const;
+
+  /// Find the filters to interpolate for a direction in the listener's frame. By default, the
+  /// filters of getIndices().
+  /// @param left, right Receive the filters of each ear, kMaxInterpolated at most
+  /// @param weights Receive the weight of each pair of filters, summing to 1
+  /// @return The number of pairs of filters
+  virtual int getInterpolation(const TBVector& direction, int* left, int* right, float* weights)
+      const;
+
+  /// @return The delay removed from a filter, in samples
+  virtual float getDelay(int index) const;
+
+  /// @return The longest delay removed from a filter, in samples
+  virtual float getMaxDelay() const;
+};
+
+/// HRIRs for direct binaural rendering, partitioned and transformed once per engine and shared by
+/// every object. The head model only depends on the lateral angle (the angle between the direction
+/// and the median plane), so one filter is kept per degree of lateral angle: the right ear uses the
+/// filter of the direction's lateral angle and the left ear the filter of the mirrored angle.
+class BinauralFilterBank : public BinauralFilters {
+ public:
+  static const int kNumFilters = 181;
+
+  /// Largest partition size picked by getBlockSizeFor()
+  static const int kMaxBlockSize = 256;
+
+  /// @return The partition size for a buffer size, or 0 if binaural rendering isn't possible
+  static int getBlockSizeFor(int bufferSize);
+
+  /// @param hrtf Head model the HRIRs are generated from
+  /// @param blockSize Partition size, a power of two
+  BinauralFilterBank(const HeadModelHrtf& hrtf, int blockSize);
+
+  int getBlockSize() const override;
+
+  int getNumPartitions() const override;
+
+  void getIndices(const TBVector& direction, int& left, int& right) const override;
+
+  const PartitionedFilter& getFilter(int index) const override;
+
+ private:
+  const int blockSize_;
+  std::vector<std::unique_ptr<PartitionedFilter>> filters_;
+};
+
+/// Renders a mono source binaurally through shared BinauralFilters. Both ears share the input's
+/// delay line. When the direction moves to another filter, the old and new filters both run for
+/// one partition and are crossfaded.
+///
+/// With interpolated filters (BinauralFilters::isInterpolated()), each ear is convolved with its
+/// own mix of the filters of the nearest measurements, then delayed by the mix of their delays
+/// through a fractional delay line. The delays follow the direction every block, ramped across it.
+/// The filters are only mixed again, and crossfaded, once the direction has moved by the
+/// crossfade threshold since they were last mixed, so that slowly moving sources mostly run one
+/// convolution per ear.
+class BinauralPanner {
+ public:
+  /// @param bank Shared filters, which must outlive the panner
+  /// @param crossfadeThresholdDegrees Angle the direction moves by before interpolated filters
+  /// are mixed again
+  explicit BinauralPanner(const BinauralFilters& bank, float crossfadeThresholdDegrees = 0.f);
+
+  /// Render a block and add it to the outputs
+  /// @param input Mono input
+  /// @param direction Direction of the source in the listener's frame
+  /// @param left Left output, accumulated
+  /// @param right Right output, accumulated
+  /// @param numFrames Number of frames, a multiple of the bank's block size
+  /// @return True if two filters were crossfaded
+  bool processAdd(
+      const float* input,
+      const TBVector& direction,
+      float* left,
+      float* right,
+      int numFrames);
+
+  /// Clear the input history
+  void reset();
+
+ private:
+  bool processInterpolated(
+      const float* input,
+      const TBVector& direction,
+      float* left,
+      float* right,
+      int numFrames);
+
+  /// Mix the bank's filters with interpolated magnitudes and the phase of their weighted sum
+  void mixFilters(const int* indices, const float* weights, int count, PartitionedFilter& output);
+
+  const BinauralFilters& bank_;
+  const bool interpolated_;
+  const float crossfadeThreshold_; // Cosine of the angle
+  PartitionedConvolver convolver_;
+  int left_{-1}; // Current filter of each ear, -1 before the first block
+  int right_{-1};
+  std::vector<float> ear_;
+  std::vector<float> previous_;
+
+  // Interpolated filters
+  std::unique_ptr<PartitionedFilter> mixed_[2]; // Current filter of each ear
+  std::unique_ptr<PartitionedFilter> nextMixed_[2];
+  std::vector<float> magnitude_; // Interpolated magnitude of one partition
+  std::unique_ptr<Fft> fft_;
+  std::vector<float> time_;
+  TBVector mixedDirection_; // Unit direction the current filters were mixed for
+  bool hasMixed_{false};
+  std::vector<float> delayLines_[2]; // Convolved output of each ear, a power of two long
+  size_t delayWrite_{0};
+  float delays_[2]; // Delay of each ear at the end of the last block, in samples
+};
+} // namespace TBE
+
+#endif // FBA_BINAURALFILTERBANK_H
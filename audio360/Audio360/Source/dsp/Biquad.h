@@ -0,0 +1,115 @@
+#ifndef FBA_BIQUAD_H
+#define FBA_BIQUAD_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+namespace TBE {
+/// Second order IIR filter in transposed direct form II, with coefficient designs from the RBJ
+/// audio EQ cookbook.
+class Biquad {
+ public:
+  enum class Type { LOW_PASS, HIGH_PASS, BAND_PASS, HIGH_SHELF };
+
+  /// Design the filter. Coefficients can be changed while processing; the state is kept.
+  /// @param type Filter type
+  /// @param sampleRate Sample rate in Hz
+  /// @param frequency Cut-off or centre frequency in Hz
+  /// @param q Quality factor
+  /// @param gainDb Gain in dB, only used by shelving filters
+  void design(Type type, float sampleRate, float frequency, float q, float gainDb = 0.f) {
+    const double fc = std::max(1.0, std::min(static_cast<double>(frequency), 0.49 * sampleRate));
+    const double w0 = 2.0 * 3.14159265358979323846 * fc / sampleRate;
+    const double cosW0 = std::cos(w0);
+    const double alpha = std::sin(w0) / (2.0 * std::max(0.01, static_cast<double>(q)));
+    double b0, b1, b2, a0, a1, a2;
+
+    switch (type) {
+      case Type::LOW_PASS:
+        b0 = (1.0 - cosW0) / 2.0;
+        b1 = 1.0 - cosW0;
+        b2 = b0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cosW0;
+        a2 = 1.0 - alpha;
+        break;
+      case Type::HIGH_PASS:
+        b0 = (1.0 + cosW0) / 2.0;
+        b1 = -(1.0 + cosW0);
+        b2 = b0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cosW0;
+        a2 = 1.0 - alpha;
+        break;
+      case Type::BAND_PASS:
+        b0 = alpha;
+        b1 = 0.0;
+        b2 = -alpha;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cosW0;
+        a2 = 1.0 - alpha;
+        break;
+      case Type::HIGH_SHELF:
+      default: {
+        const double a = std::pow(10.0, gainDb / 40.0);
+        const double sqrtA2Alpha = 2.0 * std::sqrt(a) * alpha;
+        b0 = a * ((a + 1.0) + (a - 1.0) * cosW0 + sqrtA2Alpha);
+        b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cosW0);
+        b2 = a * ((a + 1.0) + (a - 1.0) * cosW0 - sqrtA2Alpha);
+        a0 = (a + 1.0) - (a - 1.0) * cosW0 + sqrtA2Alpha;
+        a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cosW0);
+        a2 = (a + 1.0) - (a - 1.0) * cosW0 - sqrtA2Alpha;
+        break;
+      }
+    }
+    setCoefficients(b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0);
+  }
+
+  /// Set normalised coefficients directly (a0 = 1)
+  void setCoefficients(double b0, double b1, double b2, double a1, double a2) {
+    b0_ = static_cast<float>(b0);
+    b1_ = static_cast<float>(b1);
+    b2_ = static_cast<float>(b2);
+    a1_ = static_cast<float>(a1);
+    a2_ = static_cast<float>(a2);
+  }
+
+  /// Filter a block in place
+  void process(float* samples, int numFrames) {
+    float z1 = z1_;
+    float z2 = z2_;
+    for (int n = 0; n < numFrames; ++n) {
+      const float in = samples[n];
+      const float out = b0_ * in + z1;
+      z1 = b1_ * in - a1_ * out + z2;
+      z2 = b2_ * in - a2_ * out;
+      samples[n] = out;
+    }
+    // Flush denormals
+    z1_ = std::abs(z1) < 1.e-20f ? 0.f : z1;
+    z2_ = std::abs(z2) < 1.e-20f ? 0.f : z2;
+  }
+
+  void reset() {
+    z1_ = 0.f;
+    z2_ = 0.f;
+  }
+
+ private:
+  float b0_{1.f};
+  float b1_{0.f};
+  float b2_{0.f};
+  float a1_{0.f};
+  float a2_{0.f};
+  float z1_{0.f};
+  float z2_{0.f};
+};
+} // namespace TBE
+
+#endif // FBA_BIQUAD_H
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "ConvolutionReverb.h"
+#include <algorithm>
+#include <cstring>
+
+namespace TBE {
+ConvolutionReverb::ConvolutionReverb(
+    const float* left,
+    const float* right,
+    int length,
+    int blockSize,
+    bool realtime)
+    : length_(length),
+      blockSize_(blockSize),
+      tailBlockSize_(blockSize * kTailBlocks),
+      head_(blockSize, std::min(2 * kTailBlocks, (length + blockSize - 1) / blockSize)) {
+  // The tail starts two tail blocks in: one to collect its input and one to convolve it
+  const int headLength = std::min(length, 2 * tailBlockSize_);
+  headLeft_.reset(new PartitionedFilter(left, headLength, blockSize));
+  headRight_.reset(new PartitionedFilter(right, headLength, blockSize));
+  ear_.assign(blockSize, 0.f);
+
+  const int tailLength = length - headLength;
+  if (tailLength <= 0) {
+    return;
+  }
+  tailLeft_.reset(new PartitionedFilter(left + headLength, tailLength, tailBlockSize_));
+  tailRight_.reset(new PartitionedFilter(right + headLength, tailLength, tailBlockSize_));
+  tail_.reset(new PartitionedConvolver(tailBlockSize_, tailLeft_->getNumPartitions()));
+  tailInput_.assign(tailBlockSize_, 0.f);
+  tailJob_.assign(tailBlockSize_, 0.f);
+  for (auto& buffer : tailOutput_) {
+    for (auto& ear : buffer) {
+      ear.assign(tailBlockSize_, 0.f);
+    }
+  }
+  if (realtime) {
+    silence_.assign(tailBlockSize_, 0.f);
+    thread_ = std::thread(&ConvolutionReverb::run, this);
+  }
+}
+
+ConvolutionReverb::~ConvolutionReverb() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      quit_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+}
+
+int ConvolutionReverb::getLength() const {
+  return length_;
+}
+
+size_t ConvolutionReverb::takeNumLateTailBlocks() {
+  const size_t numLate = numLateTailBlocks_;
+  numLateTailBlocks_ = 0;
+  return numLate;
+}
+
+void ConvolutionReverb::processAdd(
+    const float* input,
+    float* left,
+    float* right,
+    int numFrames,
+    float wetGain) {
+  for (int offset = 0; offset + blockSize_ <= numFrames; offset += blockSize_) {
+    processBlock(input + offset, left + offset, right + offset, wetGain);
+  }
+}
+
+void ConvolutionReverb::processBlock(
+    const float* input,
+    float* left,
+    float* right,
+    float wetGain) {
+  head_.pushInput(input);
+  head_.process(*headLeft_, ear_.data());
+  for (int n = 0; n < blockSize_; ++n) {
+    left[n] += ear_[n] * wetGain;
+  }
+  head_.process(*headRight_, ear_.data());
+  for (int n = 0; n < blockSize_; ++n) {
+    right[n] += ear_[n] * wetGain;
+  }
+
+  if (!tail_) {
+    return;
+  }
+  if (readValid_) {
+    const float* tailLeft = tailOutput_[readBuffer_][0].data() + readFrames_;
+    const float* tailRight = tailOutput_[readBuffer_][1].data() + readFrames_;
+    for (int n = 0; n < blockSize_; ++n) {
+      left[n] += tailLeft[n] * wetGain;
+      right[n] += tailRight[n] * wetGain;
+    }
+  }
+  readFrames_ += blockSize_;
+  std::memcpy(&tailInput_[tailInputFrames_], input, blockSize_ * sizeof(float));
+  tailInputFrames_ += blockSize_;
+  if (tailInputFrames_ < tailBlockSize_) {
+    return;
+  }
+  submitTailBlock();
+  readFrames_ = 0;
+  tailInputFrames_ = 0;
+}
+
+void ConvolutionReverb::submitTailBlock() {
+  // The output of a tail block is played one tail block after its input is complete, as if it had
+  // been convolved on the background thread in the meantime
+  if (!thread_.joinable()) {
+    readBuffer_ = writeBuffer_;
+    readValid_ = true;
+    writeBuffer_ = 1 - readBuffer_;
+    tail_->pushInput(tailInput_.data());
+    tail_->process(*tailLeft_, tailOutput_[writeBuffer_][0].data());
+    tail_->process(*tailRight_, tailOutput_[writeBuffer_][1].data());
+    return;
+  }
+
+  // The previous tail block must be convolved by now. If it isn't, its output and this block's
+  // input are dropped rather than waited for. The thread pushes silence in place of the dropped
+  // input, so that the blocks after it are convolved with the right part of the response.
+  std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+  if (!lock.owns_lock() || pending_) {
+    numLateTailBlocks_++;
+    numDroppedInputs_++;
+    submitted_ = false;
+    readValid_ = false;
+    return;
+  }
+  // After a drop, the last output is from a block that was due earlier
+  readValid_ = submitted_;
+  readBuffer_ = writeBuffer_;
+  tailJob_.swap(tailInput_);
+  numSilentInputs_ = numDroppedInputs_;
+  numDroppedInputs_ = 0;
+  writeBuffer_ = 1 - readBuffer_;
+  pending_ = true;
+  submitted_ = true;
+  lock.unlock();
+  wake_.notify_one();
+}
+
+void ConvolutionReverb::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_.wait(lock, [this]() { return pending_ || quit_; });
+    if (quit_) {
+      return;
+    }
+    std::vector<float>* output = tailOutput_[writeBuffer_];
+    // Beyond the length of the response, more silence changes nothing
+    const size_t numSilentInputs =
+        std::min<size_t>(numSilentInputs_, static_cast<size_t>(tailLeft_->getNumPartitions()));
+    lock.unlock();
+
+    for (size_t i = 0; i < numSilentInputs; ++i) {
+      tail_->pushInput(silence_.data());
+    }
+    tail_->pushInput(tailJob_.data());
+    tail_->process(*tailLeft_, output[0].data());
+    tail_->process(*tailRight_, output[1].data());
+
+    lock.lock();
+    pending_ = false;
+  }
+}
+} // namespace TBE
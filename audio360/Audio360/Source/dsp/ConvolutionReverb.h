@@ -0,0 +1,110 @@
+#ifndef FBA_CONVOLUTIONREVERB_H
+#define FBA_CONVOLUTIONREVERB_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PartitionedConvolver.h"
+
+namespace TBE {
+/// Convolution with a long stereo (binaural) room response, mono in and wet-only stereo out.
+/// The response is split non-uniformly: the head, 2 * kTailBlocks blocks long, is convolved on the
+/// calling thread in small partitions of one block, and the rest in partitions of kTailBlocks
+/// blocks. In realtime, the tail is convolved on a background thread: a tail block is handed to
+/// the thread as soon as its input is complete and its output is only needed one tail block later,
+/// so the audio thread's cost stays close to that of the head alone. processAdd() never waits for
+/// the thread. If its output is late, that tail block is dropped and counted, and the tail is
+/// silent until the thread has caught up. Offline, there is no deadline to miss, so the tail is
+/// convolved on the calling thread and the output is always the exact convolution.
+class ConvolutionReverb {
+ public:
+  /// Tail partition size, in head blocks
+  static const int kTailBlocks = 32;
+
+  /// Largest head partition size, which sets the length of the head
+  static const int kMaxBlockSize = 256;
+
+  /// @param left Left ear impulse response
+  /// @param right Right ear impulse response
+  /// @param length Number of taps of each response
+  /// @param blockSize Head partition size, a power of two
+  /// @param realtime Convolve the tail on a background thread rather than the calling thread
+  ConvolutionReverb(
+      const float* left,
+      const float* right,
+      int length,
+      int blockSize,
+      bool realtime);
+  ~ConvolutionReverb();
+
+  /// @return The number of taps of the response
+  int getLength() const;
+
+  /// Process a block and add the wet signal to the outputs
+  /// @param input Mono input
+  /// @param left Left output, accumulated
+  /// @param right Right output, accumulated
+  /// @param numFrames Number of frames, a multiple of the block size
+  /// @param wetGain Gain applied to the wet signal
+  void processAdd(const float* input, float* left, float* right, int numFrames, float wetGain);
+
+  /// Calling thread only
+  /// @return The number of tail blocks played as silence because the background thread was late,
+  /// since the last call
+  size_t takeNumLateTailBlocks();
+
+ private:
+  /// One head block: convolve the head and add the tail output computed earlier
+  void processBlock(const float* input, float* left, float* right, float wetGain);
+
+  /// A tail block of input is complete: convolve it, or hand it to the background thread
+  void submitTailBlock();
+
+  /// Background thread: convolve submitted tail blocks
+  void run();
+
+  const int length_;
+  const int blockSize_;
+  const int tailBlockSize_;
+
+  PartitionedConvolver head_;
+  std::unique_ptr<PartitionedFilter> headLeft_;
+  std::unique_ptr<PartitionedFilter> headRight_;
+  std::vector<float> ear_;
+
+  // Tail, empty if the response fits in the head
+  std::unique_ptr<PartitionedConvolver> tail_;
+  std::unique_ptr<PartitionedFilter> tailLeft_;
+  std::unique_ptr<PartitionedFilter> tailRight_;
+  std::vector<float> tailInput_; // Filled by the audio thread, one tail block
+  int tailInputFrames_{0};
+  std::vector<float> tailJob_; // Input handed to the thread
+  std::vector<float> tailOutput_[2][2]; // [buffer][ear], written by the thread
+  int readBuffer_{0}; // tailOutput_ being played
+  int readFrames_{0};
+  bool readValid_{false}; // The tail block being played was convolved on time
+  bool submitted_{false}; // The last tail block of input was handed to the thread, not dropped
+  size_t numDroppedInputs_{0}; // Tail blocks of input dropped since the last one handed over
+  size_t numLateTailBlocks_{0};
+  std::vector<float> silence_;
+
+  // Background thread, only used in realtime
+  std::mutex mutex_; // The calling thread only ever try-locks
+  std::condition_variable wake_;
+  bool pending_{false}; // A job is submitted and not finished yet
+  size_t numSilentInputs_{0}; // Blocks of silence the thread pushes before the job's input
+  bool quit_{false};
+  int writeBuffer_{0};
+  std::thread thread_;
+};
+} // namespace TBE
+
+#endif // FBA_CONVOLUTIONREVERB_H
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "DirectionIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace TBE {
+const int DirectionIndex::kMaxNeighbours;
+
+namespace {
+float getCoordinate(const TBVector& vector, int axis) {
+  return axis == 0 ? vector.x : (axis == 1 ? vector.y : vector.z);
+}
+
+float getSquaredDistance(const TBVector& a, const TBVector& b) {
+  const float x = a.x - b.x;
+  const float y = a.y - b.y;
+  const float z = a.z - b.z;
+  return x * x + y * y + z * z;
+}
+} // namespace
+
+DirectionIndex::DirectionIndex(const std::vector<TBVector>& directions) {
+  directions_.reserve(directions.size());
+  nodes_.reserve(directions.size());
+  for (size_t i = 0; i < directions.size(); ++i) {
+    directions_.push_back(normalised(directions[i]));
+    nodes_.push_back({directions_.back(), static_cast<int>(i), 0});
+  }
+  build(0, static_cast<int>(nodes_.size()));
+}
+
+int DirectionIndex::getSize() const {
+  return static_cast<int>(directions_.size());
+}
+
+const TBVector& DirectionIndex::getDirection(int index) const {
+  return directions_[index];
+}
+
+int DirectionIndex::findNearest(const TBVector& direction) const {
+  int index = -1;
+  findNearest(direction, 1, &index, nullptr);
+  return index;
+}
+
+int DirectionIndex::findNearest(const Aed& aed) const {
+  return findNearest(TBVector::getVectorFromAziEle(aed.azimuth, aed.elevation));
+}
+
+int DirectionIndex::findNearest(
+    const TBVector& direction,
+    int count,
+    int* indices,
+    float* distances) const {
+  Neighbours found;
+  found.capacity = std::max(0, std::min(count, kMaxNeighbours));
+  if (found.capacity == 0) {
+    return 0;
+  }
+  search(normalised(direction), 0, static_cast<int>(nodes_.size()), found);
+  for (int i = 0; i < found.count; ++i) {
+    indices[i] = nodes_[found.nodes[i]].index;
+    if (distances) {
+      distances[i] = std::sqrt(found.squaredDistances[i]);
+    }
+  }
+  return found.count;
+}
+
+void DirectionIndex::Neighbours::insert(int node, float squaredDistance) {
+  if (count == capacity && squaredDistance >= squaredDistances[count - 1]) {
+    return;
+  }
+  int i = count < capacity ? count++ : count - 1;
+  for (; i > 0 && squaredDistances[i - 1] > squaredDistance; --i) {
+    nodes[i] = nodes[i - 1];
+    squaredDistances[i] = squaredDistances[i - 1];
+  }
+  nodes[i] = node;
+  squaredDistances[i] = squaredDistance;
+}
+
+float DirectionIndex::Neighbours::getWorst() const {
+  return count < capacity ? std::numeric_limits<float>::max() : squaredDistances[count - 1];
+}
+
+void DirectionIndex::build(int begin, int end) {
+  if (end - begin < 1) {
+    return;
+  }
+  // Split on the axis along which the range is the most spread out
+  TBVector lowest = nodes_[begin].direction;
+  TBVector highest = lowest;
+  for (int i = begin + 1; i < end; ++i) {
+    const TBVector& d = nodes_[i].direction;
+    lowest = TBVector(std::min(lowest.x, d.x), std::min(lowest.y, d.y), std::min(lowest.z, d.z));
+    highest =
+        TBVector(std::max(highest.x, d.x), std::max(highest.y, d.y), std::max(highest.z, d.z));
+  }
+  const TBVector spread = highest - lowest;
+  const int axis =
+      spread.x >= spread.y && spread.x >= spread.z ? 0 : (spread.y >= spread.z ? 1 : 2);
+
+  const int middle = begin + (end - begin) / 2;
+  std::nth_element(
+      nodes_.begin() + begin,
+      nodes_.begin() + middle,
+      nodes_.begin() + end,
+      [axis](const Node& a, const Node& b) {
+        return getCoordinate(a.direction, axis) < getCoordinate(b.direction, axis);
+      });
+  nodes_[middle].axis = axis;
+  build(begin, middle);
+  build(middle + 1, end);
+}
+
+void DirectionIndex::search(
+    const TBVector& direction,
+    int begin,
+    int end,
+    Neighbours& found) const {
+  if (end - begin < 1) {
+    return;
+  }
+  const int middle = begin + (end - begin) / 2;
+  const Node& node = nodes_[middle];
+  found.insert(middle, getSquaredDistance(direction, node.direction));
+
+  // Nearer side of the splitting plane first, then the other side if it can hold anything closer
+  const float offset =
+      getCoordinate(direction, node.axis) - getCoordinate(node.direction, node.axis);
+  if (offset < 0.f) {
+    search(direction, begin, middle, found);
+    if (offset * offset < found.getWorst()) {
+      search(direction, middle + 1, end, found);
+    }
+  } else {
+    search(direction, middle + 1, end, found);
+    if (offset * offset < found.getWorst()) {
+      search(direction, begin, middle, found);
+    }
+  }
+}
+
+TBVector DirectionIndex::normalised(const TBVector& direction) {
+  TBVector unit = direction;
+  TBVector::normalise(unit);
+  return TBVector::magnitude(unit) > 0.5f ? unit : TBVector(0.f, 0.f, 1.f);
+}
+} // namespace TBE
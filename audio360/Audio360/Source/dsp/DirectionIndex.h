@@ -0,0 +1,76 @@
+#ifndef FBA_DIRECTIONINDEX_H
+#define FBA_DIRECTIONINDEX_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <vector>
+#include "TBE_Vector.hh"
+
+namespace TBE {
+/// Nearest neighbour search over a set of directions, e.g. the measurement directions of an HRTF.
+/// The directions are normalised and kept in a k-d tree, so that the distance between two of them
+/// is the chord through the unit sphere, which orders them like the angle between them does.
+/// Lookups visit O(log n) nodes for directions spread over the sphere.
+class DirectionIndex {
+ public:
+  /// Largest number of neighbours findNearest() can return
+  static const int kMaxNeighbours = 8;
+
+  DirectionIndex() = default;
+
+  /// @param directions Directions, normalised by the index. Zero vectors are treated as forward.
+  explicit DirectionIndex(const std::vector<TBVector>& directions);
+
+  /// @return The number of directions
+  int getSize() const;
+
+  /// @return A direction as given to the constructor, normalised
+  const TBVector& getDirection(int index) const;
+
+  /// @return The index of the direction closest to a direction, -1 if the index is empty
+  int findNearest(const TBVector& direction) const;
+
+  /// @return The index of the direction closest to an azimuth and elevation (the distance is
+  /// ignored), -1 if the index is empty
+  int findNearest(const Aed& aed) const;
+
+  /// Find the directions closest to a direction, nearest first
+  /// @param count Number of neighbours wanted, at most kMaxNeighbours
+  /// @param indices Receives the indices of the neighbours
+  /// @param distances Receives the chord distance to each neighbour, can be nullptr
+  /// @return The number of neighbours found, count unless the index has fewer directions
+  int findNearest(const TBVector& direction, int count, int* indices, float* distances) const;
+
+ private:
+  /// Directions sorted so that each range of the tree has its splitting node in the middle
+  struct Node {
+    TBVector direction;
+    int index; /// Index in the constructor's directions
+    int axis; /// 0, 1 or 2 for x, y or z
+  };
+
+  /// Neighbours found so far, nearest first
+  struct Neighbours {
+    int count{0};
+    int capacity{0};
+    int nodes[kMaxNeighbours];
+    float squaredDistances[kMaxNeighbours];
+
+    void insert(int node, float squaredDistance);
+    float getWorst() const;
+  };
+
+  void build(int begin, int end);
+  void search(const TBVector& direction, int begin, int end, Neighbours& found) const;
+  static TBVector normalised(const TBVector& direction);
+
+  std::vector<Node> nodes_;
+  std::vector<TBVector> directions_;
+};
+} // namespace TBE
+
+#endif // FBA_DIRECTIONINDEX_H
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "Fft.h"
+#include <cmath>
+
+namespace TBE {
+static const double kPi = 3.14159265358979323846;
+
+Fft::Fft(int size) : size_(size), half_(size / 2) {
+  int numBits = 0;
+  while ((1 << numBits) < half_) {
+    numBits++;
+  }
+  bitReverse_.resize(half_);
+  for (int i = 0; i < half_; ++i) {
+    int reversed = 0;
+    for (int b = 0; b < numBits; ++b) {
+      reversed |= ((i >> b) & 1) << (numBits - 1 - b);
+    }
+    bitReverse_[i] = reversed;
+  }
+  cos_.resize(half_ / 2);
+  sin_.resize(half_ / 2);
+  for (int k = 0; k < half_ / 2; ++k) {
+    cos_[k] = static_cast<float>(std::cos(2.0 * kPi * k / half_));
+    sin_[k] = static_cast<float>(std::sin(2.0 * kPi * k / half_));
+  }
+  splitCos_.resize(half_ + 1);
+  splitSin_.resize(half_ + 1);
+  for (int k = 0; k <= half_; ++k) {
+    splitCos_[k] = static_cast<float>(std::cos(2.0 * kPi * k / size_));
+    splitSin_[k] = static_cast<float>(std::sin(2.0 * kPi * k / size_));
+  }
+  workRe_.resize(half_);
+  workIm_.resize(half_);
+}
+
+int Fft::getSize() const {
+  return size_;
+}
+
+int Fft::getNumBins() const {
+  return half_ + 1;
+}
+
+void Fft::transform(float sign) {
+  float* re = workRe_.data();
+  float* im = workIm_.data();
+  for (int span = 1, stride = half_ / 2; span < half_; span *= 2, stride /= 2) {
+    for (int start = 0; start < half_; start += 2 * span) {
+      float* aRe = re + start;
+      float* aIm = im + start;
+      float* bRe = aRe + span;
+      float* bIm = aIm + span;
+      for (int k = 0; k < span; ++k) {
+        const float wRe = cos_[k * stride];
+        const float wIm = sign * sin_[k * stride];
+        const float tRe = bRe[k] * wRe - bIm[k] * wIm;
+        const float tIm = bRe[k] * wIm + bIm[k] * wRe;
+        bRe[k] = aRe[k] - tRe;
+        bIm[k] = aIm[k] - tIm;
+        aRe[k] += tRe;
+        aIm[k] += tIm;
+      }
+    }
+  }
+}
+
+void Fft::forward(const float* input, float* re, float* im) {
+  // Pack even samples in the real part and odd samples in the imaginary part
+  for (int n = 0; n < half_; ++n) {
+    const int r = bitReverse_[n];
+    workRe_[r] = input[2 * n];
+    workIm_[r] = input[2 * n + 1];
+  }
+  transform(-1.f);
+
+  // X[k] = E[k] + e^(-2 pi i k / N) O[k], with E and O recovered from Z[k] and conj(Z[N/2 - k])
+  re[0] = workRe_[0] + workIm_[0];
+  im[0] = 0.f;
+  re[half_] = workRe_[0] - workIm_[0];
+  im[half_] = 0.f;
+  for (int k = 1; k < half_; ++k) {
+    const float zRe = workRe_[k];
+    const float zIm = workIm_[k];
+    const float cRe = workRe_[half_ - k];
+    const float cIm = -workIm_[half_ - k];
+    const float eRe = 0.5f * (zRe + cRe);
+    const float eIm = 0.5f * (zIm + cIm);
+    // O = (Z - conj(Z[N/2 - k])) / 2i
+    const float oRe = 0.5f * (zIm - cIm);
+    const float oIm = -0.5f * (zRe - cRe);
+    const float wRe = splitCos_[k];
+    const float wIm = -splitSin_[k];
+    re[k] = eRe + oRe * wRe - oIm * wIm;
+    im[k] = eIm + oRe * wIm + oIm * wRe;
+  }
+}
+
+void Fft::inverse(const float* re, const float* im, float* output) {
+  // Undo the split: Z[k] = E[k] + i O[k], with E = (X[k] + conj(X[N/2 - k])) and
+  // O = (X[k] - conj(X[N/2 - k])) e^(2 pi i k / N), both unscaled
+  for (int k = 0; k < half_; ++k) {
+    const float xRe = re[k];
+    const float xIm = im[k];
+    const float cRe = re[half_ - k];
+    const float cIm = -im[half_ - k];
+    const float eRe = xRe + cRe;
+    const float eIm = xIm + cIm;
+    const float dRe = xRe - cRe;
+    const float dIm = xIm - cIm;
+    const float wRe = splitCos_[k];
+    const float wIm = splitSin_[k];
+    const float oRe = dRe * wRe - dIm * wIm;
+    const float oIm = dRe * wIm + dIm * wRe;
+    const int r = bitReverse_[k];
+    workRe_[r] = eRe - oIm;
+    workIm_[r] = eIm + oRe;
+  }
+  transform(1.f);
+  for (int n = 0; n < half_; ++n) {
+    output[2 * n] = workRe_[n];
+    output[2 * n + 1] = workIm_[n];
+  }
+}
+} // namespace TBE
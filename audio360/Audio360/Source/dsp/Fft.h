@@ -0,0 +1,56 @@
+#ifndef FBA_FFT_H
+#define FBA_FFT_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <vector>
+
+namespace TBE {
+/// Real FFT of a power of two size. The transform runs as a complex FFT of half the size on the
+/// even/odd samples, followed by a split step. Spectra are stored in split form: size / 2 + 1 real
+/// parts and as many imaginary parts, DC first. Tables are built in the constructor; forward() and
+/// inverse() don't allocate.
+class Fft {
+ public:
+  /// @param size Power of two, at least 4
+  explicit Fft(int size);
+
+  /// @return The transform size
+  int getSize() const;
+
+  /// @return The number of bins of a spectrum, size / 2 + 1
+  int getNumBins() const;
+
+  /// Forward transform
+  /// @param input getSize() samples
+  /// @param re getNumBins() real parts, overwritten
+  /// @param im getNumBins() imaginary parts, overwritten
+  void forward(const float* input, float* re, float* im);
+
+  /// Inverse transform, unscaled: inverse(forward(x)) is x * getSize()
+  /// @param re getNumBins() real parts
+  /// @param im getNumBins() imaginary parts
+  /// @param output getSize() samples, overwritten
+  void inverse(const float* re, const float* im, float* output);
+
+ private:
+  /// In place complex FFT of size_ / 2 points on workRe_/workIm_, in bit reversed order on input
+  void transform(float sign);
+
+  const int size_;
+  const int half_;
+  std::vector<int> bitReverse_;
+  std::vector<float> cos_; // Complex FFT twiddles, half_ / 2 of them
+  std::vector<float> sin_;
+  std::vector<float> splitCos_; // Real split twiddles, half_ + 1 of them
+  std::vector<float> splitSin_;
+  std::vector<float> workRe_;
+  std::vector<float> workIm_;
+};
+} // namespace TBE
+
+#endif // FBA_FFT_H
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "HeadModelHrtf.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace TBE {
+static const double kPi = 3.14159265358979323846;
+static const double kSpeedOfSound = 343.0;
+static const int kSincHalfWidth = 8;
+/// Head shadow parameters from Brown and Duda: minimum alpha and the angle at which it occurs
+static const double kAlphaMin = 0.1;
+static const double kThetaMinDegrees = 150.0;
+
+HeadModelHrtf::HeadModelHrtf(float sampleRate, float headRadius)
+    : sampleRate_(sampleRate), headRadius_(headRadius) {
+  // 128 taps at 48 kHz hold the largest interaural delay plus the shadow filter's decay
+  length_ = std::max(64, static_cast<int>(std::ceil(128.0 * sampleRate / 48000.0 / 16.0)) * 16);
+}
+
+int HeadModelHrtf::getLength() const {
+  return length_;
+}
+
+void HeadModelHrtf::compute(const TBVector& direction, float* left, float* right) const {
+  const float norm = std::sqrt(
+      direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+  const float x = norm > TBE_SMALL_NUMBER ? direction.x / norm : 0.f;
+  // The ears lie on the x axis: left at -x, right at +x
+  computeEar(-x, left);
+  computeEar(x, right);
+}
+
+void HeadModelHrtf::computeEar(float cosIncidence, float* hrir) const {
+  const double theta = std::acos(std::max(-1.0, std::min(1.0, static_cast<double>(cosIncidence))));
+  const double headDelay = headRadius_ / kSpeedOfSound;
+
+  // Woodworth delay relative to the centre of the head, offset to be non-negative
+  double delay = (theta < kPi / 2.0) ? -headDelay * std::cos(theta)
+                                     : headDelay * (theta - kPi / 2.0);
+  delay += headDelay;
+  const double delaySamples = delay * sampleRate_ + kSincHalfWidth;
+
+  // Fractional delay: Hann windowed sinc centred on the delay
+  std::vector<double> impulse(length_, 0.0);
+  const int centre = static_cast<int>(std::floor(delaySamples));
+  for (int n = centre - kSincHalfWidth + 1; n <= centre + kSincHalfWidth; ++n) {
+    if (n < 0 || n >= length_) {
+      continue;
+    }
+    const double t = n - delaySamples;
+    const double sinc = std::abs(t) < 1.e-9 ? 1.0 : std::sin(kPi * t) / (kPi * t);
+    const double window = 0.5 + 0.5 * std::cos(kPi * t / kSincHalfWidth);
+    impulse[n] = sinc * window;
+  }
+
+  // Head shadow H(s) = (alpha * s + beta) / (s + beta), with beta = 2c / a, discretised with the
+  // bilinear transform
+  const double alpha = 1.0 + kAlphaMin / 2.0 +
+      (1.0 - kAlphaMin / 2.0) * std::cos(theta / (kThetaMinDegrees * kPi / 180.0) * kPi);
+  const double beta = 2.0 * kSpeedOfSound / headRadius_;
+  const double k = 2.0 * sampleRate_;
+  const double a0 = beta + k;
+  const double b0 = (beta + alpha * k) / a0;
+  const double b1 = (beta - alpha * k) / a0;
+  const double a1 = (beta - k) / a0;
+
+  double previousIn = 0.0;
+  double previousOut = 0.0;
+  for (int n = 0; n < length_; ++n) {
+    const double out = b0 * impulse[n] + b1 * previousIn - a1 * previousOut;
+    previousIn = impulse[n];
+    previousOut = out;
+    hrir[n] = static_cast<float>(out);
+  }
+
+  // Fade out the tail of the truncated filter
+  const int fadeLength = std::min(16, length_ / 4);
+  for (int n = 0; n < fadeLength; ++n) {
+    hrir[length_ - 1 - n] *= static_cast<float>(n) / fadeLength;
+  }
+}
+} // namespace TBE
@@ -0,0 +1,42 @@
+#ifndef FBA_HEADMODELHRTF_H
+#define FBA_HEADMODELHRTF_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include "TBE_Vector.hh"
+
+namespace TBE {
+/// Parametric HRTF of a rigid spherical head (Brown and Duda, 1998). Each ear gets a Woodworth
+/// interaural time delay, implemented as a windowed-sinc fractional delay, followed by a one-pole
+/// one-zero head shadow filter whose high frequency gain depends on the angle of incidence.
+/// Used to generate HRIRs for directions on demand, so no measured dataset needs to ship with the
+/// engine.
+class HeadModelHrtf {
+ public:
+  /// @param sampleRate Sample rate in Hz
+  /// @param headRadius Radius of the head in metres
+  explicit HeadModelHrtf(float sampleRate, float headRadius = 0.0875f);
+
+  /// @return The number of taps of each generated HRIR
+  int getLength() const;
+
+  /// Generate the HRIR pair for a direction
+  /// @param direction Unit direction in engine coordinates (x = right, y = up, z = forward)
+  /// @param left getLength() taps for the left ear
+  /// @param right getLength() taps for the right ear
+  void compute(const TBVector& direction, float* left, float* right) const;
+
+ private:
+  void computeEar(float cosIncidence, float* hrir) const;
+
+  const float sampleRate_;
+  const float headRadius_;
+  int length_;
+};
+} // namespace TBE
+
+#endif // FBA_HEADMODELHRTF_H
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "LoudnessMeter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace TBE {
+static const float kMinusInfinity = -INFINITY;
+static const double kAbsoluteGate = -70.0;
+static const double kRelativeGate = -10.0;
+static const double kHistogramMin = -70.0;
+static const double kHistogramStep = 0.1;
+
+static inline double energyToLufs(double energy) {
+  return energy > 0.0 ? -0.691 + 10.0 * std::log10(energy) : -INFINITY;
+}
+
+LoudnessMeter::LoudnessMeter(float sampleRate)
+    : stepLength_(std::max(1, static_cast<int>(sampleRate / 10.f))) {
+  // K-weighting: head related pre-filter followed by the RLB high-pass (ITU-R BS.1770)
+  for (int ch = 0; ch < 2; ++ch) {
+    shelf_[ch].design(Biquad::Type::HIGH_SHELF, sampleRate, 1681.97f, 0.7072f, 3.9998f);
+    highPass_[ch].design(Biquad::Type::HIGH_PASS, sampleRate, 38.135f, 0.5003f);
+  }
+
+  // Polyphase Hann-windowed sinc interpolator for true peak
+  interpolator_.resize(kOversampling * kTapsPerPhase);
+  const double pi = 3.14159265358979323846;
+  const int length = kOversampling * kTapsPerPhase;
+  for (int phase = 0; phase < kOversampling; ++phase) {
+    for (int tap = 0; tap < kTapsPerPhase; ++tap) {
+      const int n = tap * kOversampling + phase;
+      const double t = (n - length / 2.0) / kOversampling;
+      const double sinc = std::abs(t) < 1.e-9 ? 1.0 : std::sin(pi * t) / (pi * t);
+      const double window = 0.5 - 0.5 * std::cos(2.0 * pi * (n + 0.5) / length);
+      interpolator_[phase * kTapsPerPhase + tap] = static_cast<float>(sinc * window);
+    }
+  }
+  weighted_.resize(4096);
+  resetState();
+}
+
+void LoudnessMeter::resetState() {
+  for (int ch = 0; ch < 2; ++ch) {
+    shelf_[ch].reset();
+    highPass_[ch].reset();
+  }
+  std::memset(history_, 0, sizeof(history_));
+  std::memset(stepEnergies_, 0, sizeof(stepEnergies_));
+  std::memset(histogramCount_, 0, sizeof(histogramCount_));
+  std::memset(histogramEnergy_, 0, sizeof(histogramEnergy_));
+  stepEnergy_ = 0.0;
+  stepFrames_ = 0;
+  stepIndex_ = 0;
+  numSteps_ = 0;
+  peak_ = 0.f;
+  integrated_.store(kMinusInfinity);
+  shortTerm_.store(kMinusInfinity);
+  momentary_.store(kMinusInfinity);
+  truePeak_.store(kMinusInfinity);
+}
+
+void LoudnessMeter::reset() {
+  resetRequested_.store(true);
+}
+
+LoudnessStatistics LoudnessMeter::getStatistics() const {
+  LoudnessStatistics stats;
+  stats.integrated = integrated_.load();
+  stats.shortTerm = shortTerm_.load();
+  stats.momentary = momentary_.load();
+  stats.truePeak = truePeak_.load();
+  return stats;
+}
+
+float LoudnessMeter::measureTruePeak(const float* samples, int numFrames, float* history) {
+  float peak = 0.f;
+  for (int n = 0; n < numFrames; ++n) {
+    std::memmove(history + 1, history, (kTapsPerPhase - 1) * sizeof(float));
+    history[0] = samples[n];
+    for (int phase = 0; phase < kOversampling; ++phase) {
+      const float* coefficients = &interpolator_[phase * kTapsPerPhase];
+      float sum = 0.f;
+      for (int tap = 0; tap < kTapsPerPhase; ++tap) {
+        sum += coefficients[tap] * history[tap];
+      }
+      peak = std::max(peak, std::abs(sum));
+    }
+  }
+  return peak;
+}
+
+void LoudnessMeter::process(const float* left, const float* right, int numFrames) {
+  if (resetRequested_.exchange(false)) {
+    resetState();
+  }
+
+  const float* inputs[2] = {left, right};
+  int offset = 0;
+  while (offset < numFrames) {
+    const int chunk = std::min(
+        {numFrames - offset, stepLength_ - stepFrames_, static_cast<int>(weighted_.size())});
+    for (int ch = 0; ch < 2; ++ch) {
+      const float* in = inputs[ch] + offset;
+      peak_ = std::max(peak_, measureTruePeak(in, chunk, history_[ch]));
+
+      std::memcpy(weighted_.data(), in, chunk * sizeof(float));
+      shelf_[ch].process(weighted_.data(), chunk);
+      highPass_[ch].process(weighted_.data(), chunk);
+      double energy = 0.0;
+      for (int n = 0; n < chunk; ++n) {
+        energy += static_cast<double>(weighted_[n]) * weighted_[n];
+      }
+      stepEnergy_ += energy;
+    }
+
+    stepFrames_ += chunk;
+    offset += chunk;
+    if (stepFrames_ == stepLength_) {
+      endStep();
+    }
+  }
+  truePeak_.store(peak_ > 0.f ? static_cast<float>(20.0 * std::log10(peak_)) : kMinusInfinity);
+}
+
+void LoudnessMeter::endStep() {
+  stepEnergies_[stepIndex_] = stepEnergy_ / stepLength_;
+  stepIndex_ = (stepIndex_ + 1) % kNumStepsShortTerm;
+  numSteps_++;
+  stepEnergy_ = 0.0;
+  stepFrames_ = 0;
+
+  double momentary = 0.0;
+  double shortTerm = 0.0;
+  for (int i = 0; i < kNumStepsShortTerm; ++i) {
+    const int age = (stepIndex_ - 1 - i + kNumStepsShortTerm) % kNumStepsShortTerm;
+    shortTerm += stepEnergies_[age];
+    if (i < 4) {
+      momentary += stepEnergies_[age];
+    }
+  }
+
+  if (numSteps_ >= 4) {
+    // Gating blocks of 400 ms with 75% overlap
+    const double blockEnergy = momentary / 4.0;
+    const double blockLoudness = energyToLufs(blockEnergy);
+    momentary_.store(static_cast<float>(blockLoudness));
+    if (blockLoudness > kAbsoluteGate) {
+      const int bin = std::min(
+          kNumHistogramBins - 1,
+          static_cast<int>((blockLoudness - kHistogramMin) / kHistogramStep));
+      histogramCount_[bin]++;
+      histogramEnergy_[bin] += blockEnergy;
+      updateIntegrated();
+    }
+  }
+  if (numSteps_ >= kNumStepsShortTerm) {
+    shortTerm_.store(static_cast<float>(energyToLufs(shortTerm / kNumStepsShortTerm)));
+  }
+}
+
+void LoudnessMeter::updateIntegrated() {
+  double energy = 0.0;
+  uint64_t count = 0;
+  for (int bin = 0; bin < kNumHistogramBins; ++bin) {
+    energy += histogramEnergy_[bin];
+    count += histogramCount_[bin];
+  }
+  if (count == 0) {
+    return;
+  }
+
+  const double relativeGate = energyToLufs(energy / count) + kRelativeGate;
+  const int firstBin = std::max(
+      0, static_cast<int>(std::ceil((relativeGate - kHistogramMin) / kHistogramStep)));
+  energy = 0.0;
+  count = 0;
+  for (int bin = firstBin; bin < kNumHistogramBins; ++bin) {
+    energy += histogramEnergy_[bin];
+    count += histogramCount_[bin];
+  }
+  if (count > 0) {
+    integrated_.store(static_cast<float>(energyToLufs(energy / count)));
+  }
+}
+} // namespace TBE
@@ -0,0 +1,71 @@
+#ifndef FBA_LOUDNESSMETER_H
+#define FBA_LOUDNESSMETER_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include "Biquad.h"
+#include "TBE_AudioEngineDefinitions.h"
+
+namespace TBE {
+/// Stereo loudness meter following EBU R128 / ITU-R BS.1770-4: K-weighting, momentary (400 ms),
+/// short-term (3 s) and gated integrated loudness, plus true peak measured with 4x oversampling.
+/// process() runs on the audio thread without allocating; getStatistics() and reset() can be
+/// called from any thread.
+class LoudnessMeter {
+ public:
+  explicit LoudnessMeter(float sampleRate);
+
+  /// Measure a block
+  /// @param left Left channel
+  /// @param right Right channel
+  /// @param numFrames Number of frames
+  void process(const float* left, const float* right, int numFrames);
+
+  /// @return The latest measurements
+  LoudnessStatistics getStatistics() const;
+
+  /// Clear all measurements. The reset happens on the next call to process().
+  void reset();
+
+ private:
+  static const int kNumStepsShortTerm = 30; // 3 s in 100 ms steps
+  static const int kNumHistogramBins = 1000; // 0.1 LU bins from -70 to +30 LUFS
+  static const int kOversampling = 4;
+  static const int kTapsPerPhase = 12;
+
+  void resetState();
+  void endStep();
+  float measureTruePeak(const float* samples, int numFrames, float* history);
+  void updateIntegrated();
+
+  const int stepLength_; // 100 ms
+  Biquad shelf_[2];
+  Biquad highPass_[2];
+  std::vector<float> weighted_;
+  std::vector<float> interpolator_; // kOversampling x kTapsPerPhase polyphase coefficients
+  float history_[2][kTapsPerPhase];
+
+  double stepEnergy_{0.0};
+  int stepFrames_{0};
+  double stepEnergies_[kNumStepsShortTerm];
+  int stepIndex_{0};
+  int numSteps_{0};
+  uint32_t histogramCount_[kNumHistogramBins];
+  double histogramEnergy_[kNumHistogramBins];
+  float peak_{0.f};
+
+  std::atomic<bool> resetRequested_{false};
+  std::atomic<float> integrated_;
+  std::atomic<float> shortTerm_;
+  std::atomic<float> momentary_;
+  std::atomic<float> truePeak_;
+};
+} // namespace TBE
+
+#endif // FBA_LOUDNESSMETER_H
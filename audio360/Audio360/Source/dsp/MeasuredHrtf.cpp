@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "MeasuredHrtf.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "TBE_AudioFormatDecoder.h"
+
+namespace TBE {
+namespace {
+const char kCacheMagic[8] = {'F', 'B', 'A', 'H', 'R', 'T', 'F', '1'};
+const uint32_t kCacheVersion = 2;
+
+/// Start of a cache file, followed by the delay of every filter, then the spectra of each
+/// measurement's left then right filter, every partition's real parts then imaginary parts.
+/// Native byte order: a cache written on a machine of the other endianness fails the version
+/// check and is recomputed.
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t blockSize;
+  uint32_t numMeasurements;
+  uint32_t numPartitions;
+  float sampleRate;
+  uint32_t removeDelays;
+  uint64_t sourceHash;
+};
+
+/// Samples per channel decoded at a time
+const int kDecodeBlockSize = 1024;
+
+/// An HRIR starts at its first sample within 20 dB of its peak...
+const float kOnsetThreshold = 0.1f;
+/// ...and keeps a few samples before it when its delay is removed, for the rise of the onset
+const int kOnsetMargin = 4;
+
+/// Chord distance within which a direction is on a measurement
+const float kMinDistance = 1e-6f;
+
+uint64_t hash(const std::string& key) {
+  // FNV-1a
+  uint64_t value = 14695981039346656037ull;
+  for (const char c : key) {
+    value = (value ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  }
+  return value;
+}
+
+bool isAbsolute(const std::string& path) {
+  return (!path.empty() && (path[0] == '/' || path[0] == '\\')) ||
+      (path.size() > 1 && path[1] == ':');
+}
+
+std::string trim(const std::string& text) {
+  const size_t begin = text.find_first_not_of(" \t\r");
+  if (begin == std::string::npos) {
+    return std::string();
+  }
+  return text.substr(begin, text.find_last_not_of(" \t\r") + 1 - begin);
+}
+} // namespace
+
+EngineError MeasuredHrtf::load(
+    const char* manifestPath,
+    const char* cachePath,
+    float sampleRate,
+    int blockSize,
+    bool removeDelays,
+    std::unique_ptr<MeasuredHrtf>& hrtf) {
+  if (!manifestPath || blockSize <= 0) {
+    return EngineError::INVALID_PARAM;
+  }
+  std::string manifest;
+  std::vector<Measurement> measurements;
+  EngineError error = readManifest(manifestPath, manifest, measurements);
+  if (error != EngineError::OK) {
+    return error;
+  }
+  uint64_t sourceHash = 0;
+  error = getSourceHash(manifest, measurements, sampleRate, blockSize, removeDelays, sourceHash);
+  if (error != EngineError::OK) {
+    return error;
+  }
+
+  std::vector<TBVector> directions;
+  directions.reserve(measurements.size());
+  for (const Measurement& measurement : measurements) {
+    directions.push_back(TBVector::getVectorFromAziEle(measurement.azimuth, measurement.elevation));
+  }
+  std::unique_ptr<MeasuredHrtf> loaded(new MeasuredHrtf(blockSize, removeDelays, directions));
+  if (!cachePath || !loaded->readCache(cachePath, sourceHash, sampleRate)) {
+    error = loaded->decode(measurements, sampleRate);
+    if (error != EngineError::OK) {
+      return error;
+    }
+    if (cachePath) {
+      loaded->writeCache(cachePath, sourceHash, sampleRate);
+    }
+  }
+  hrtf = std::move(loaded);
+  return EngineError::OK;
+}
+
+MeasuredHrtf::MeasuredHrtf(
+    int blockSize,
+    bool removeDelays,
+    const std::vector<TBVector>& directions)
+    : blockSize_(blockSize), removeDelays_(removeDelays), directions_(directions) {}
+
+int MeasuredHrtf::getBlockSize() const {
+  return blockSize_;
+}
+
+int MeasuredHrtf::getNumPartitions() const {
+  return numPartitions_;
+}
+
+void MeasuredHrtf::getIndices(const TBVector& direction, int& left, int& right) const {
+  const int measurement = directions_.findNearest(direction);
+  left = 2 * measurement;
+  right = left + 1;
+}
+
+const PartitionedFilter& MeasuredHrtf::getFilter(int index) const {
+  return *filters_[index];
+}
+
+bool MeasuredHrtf::isInterpolated() const {
+  return removeDelays_;
+}
+
+int MeasuredHrtf::getInterpolation(
+    const TBVector& direction,
+    int* left,
+    int* right,
+    float* weights) const {
+  if (!removeDelays_) {
+    return BinauralFilters::getInterpolation(direction, left, right, weights);
+  }
+  // Inverse distance weights, less the inverse distance of the next nearest measurement: a
+  // measurement's weight falls to 0 as it is replaced by the next one, so the weights are
+  // continuous as the direction moves
+  int measurements[kMaxInterpolated + 1];
+  float distances[kMaxInterpolated + 1];
+  const int numFound =
+      directions_.findNearest(direction, kMaxInterpolated + 1, measurements, distances);
+  const int count = std::min(numFound, static_cast<int>(kMaxInterpolated));
+  float total = 0.f;
+  if (distances[0] > kMinDistance) {
+    const float furthest = numFound > count ? 1.f / distances[count] : 0.f;
+    for (int i = 0; i < count; ++i) {
+      weights[i] = 1.f / distances[i] - furthest;
+      total += weights[i];
+    }
+  }
+  if (total <= 0.f) {
+    // On a measurement, or as far from the next one as from the others
+    weights[0] = 1.f;
+    total = 1.f;
+    std::fill(weights + 1, weights + count, 0.f);
+  }
+  for (int i = 0; i < count; ++i) {
+    left[i] = 2 * measurements[i];
+    right[i] = left[i] + 1;
+    weights[i] /= total;
+  }
+  return count;
+}
+
+float MeasuredHrtf::getDelay(int index) const {
+  return delays_[index];
+}
+
+float MeasuredHrtf::getMaxDelay() const {
+  return delays_.empty() ? 0.f : *std::max_element(delays_.begin(), delays_.end());
+}
+
+int MeasuredHrtf::getNumMeasurements() const {
+  return directions_.getSize();
+}
+
+const DirectionIndex& MeasuredHrtf::getDirections() const {
+  return directions_;
+}
+
+bool MeasuredHrtf::isFromCache() const {
+  return fromCache_;
+}
+
+EngineError MeasuredHrtf::readManifest(
+    const char* manifestPath,
+    std::string& text,
+    std::vector<Measurement>& measurements) {
+  FILE* file = std::fopen(manifestPath, "rb");
+  if (!file) {
+    return EngineError::ERROR_OPENING_FILE;
+  }
+  char buffer[4096];
+  size_t numRead = 0;
+  while ((numRead = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    text.append(buffer, numRead);
+  }
+  const bool failed = std::ferror(file) != 0;
+  std::fclose(file);
+  if (failed) {
+    return EngineError::ERROR_OPENING_FILE;
+  }
+
+  const std::string path(manifestPath);
+  const size_t separator = path.find_last_of("/\\");
+  const std::string directory =
+      separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+  size_t begin = 0;
+  while (begin < text.size()) {
+    size_t end = text.find('\n', begin);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    const std::string line = trim(text.substr(begin, end - begin));
+    begin = end + 1;
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    // The path is the rest of the line, so it may contain spaces
+    Measurement measurement;
+    int pathStart = 0;
+    if (std::sscanf(
+            line.c_str(), "%f %f %n", &measurement.azimuth, &measurement.elevation, &pathStart) <
+            2 ||
+        pathStart <= 0 || static_cast<size_t>(pathStart) >= line.size()) {
+      return EngineError::INVALID_PARAM;
+    }
+    measurement.path = line.substr(static_cast<size_t>(pathStart));
+    if (!isAbsolute(measurement.path)) {
+      measurement.path = directory + measurement.path;
+    }
+    measurements.push_back(measurement);
+  }
+  return measurements.empty() ? EngineError::INVALID_PARAM : EngineError::OK;
+}
+
+EngineError MeasuredHrtf::getSourceHash(
+    const std::string& manifest,
+    const std::vector<Measurement>& measurements,
+    float sampleRate,
+    int blockSize,
+    bool removeDelays,
+    uint64_t& sourceHash) {
+  std::string key = manifest + '|' + std::to_string(sampleRate) + '|' +
+      std::to_string(blockSize) + '|' + (removeDelays ? "delays removed" : "delays kept");
+  for (const Measurement& measurement : measurements) {
+    struct stat info;
+    if (stat(measurement.path.c_str(), &info) != 0) {
+      return EngineError::ERROR_OPENING_FILE;
+    }
+    key += '|' + measurement.path + '|' + std::to_string(info.st_size) + '|' +
+        std::to_string(info.st_mtime);
+  }
+  sourceHash = hash(key);
+  return EngineError::OK;
+}
+
+EngineError MeasuredHrtf::decode(const std::vector<Measurement>& measurements, float sampleRate) {
+  // Every HRIR is zero padded to the longest one, so that all the filters have as many partitions
+  std::vector<std::vector<float>> hrirs(2 * measurements.size());
+  size_t length = 1;
+  std::vector<float> interleaved(2 * kDecodeBlockSize);
+  for (size_t m = 0; m < measurements.size(); ++m) {
+    AudioFormatDecoder* decoder = nullptr;
+    EngineError error = TBE_CreateAudioFormatDecoder(
+        decoder, measurements[m].path.c_str(), kDecodeBlockSize, sampleRate);
+    if (error != EngineError::OK) {
+      return error;
+    }
+    if (decoder->getNumOfChannels() != 2) {
+      delete decoder;
+      return EngineError::INVALID_CHANNEL_COUNT;
+    }
+    std::vector<float>& left = hrirs[2 * m];
+    std::vector<float>& right = hrirs[2 * m + 1];
+    while (!decoder->endOfStream() && !decoder->decoderError()) {
+      const size_t numSamples =
+          decoder->decode(interleaved.data(), static_cast<int32_t>(interleaved.size()));
+      if (numSamples == 0) {
+        break;
+      }
+      for (size_t i = 0; i + 1 < numSamples; i += 2) {
+        left.push_back(interleaved[i]);
+        right.push_back(interleaved[i + 1]);
+      }
+    }
+    error = decoder->decoderError() ? EngineError::DECODER_FAIL : EngineError::OK;
+    delete decoder;
+    if (error != EngineError::OK) {
+      return error;
+    }
+  }
+
+  delays_.assign(hrirs.size(), 0.f);
+  for (size_t i = 0; i < hrirs.size(); ++i) {
+    std::vector<float>& hrir = hrirs[i];
+    if (removeDelays_ && !hrir.empty()) {
+      float peak = 0.f;
+      for (const float sample : hrir) {
+        peak = std::max(peak, std::abs(sample));
+      }
+      size_t onset = 0;
+      while (onset < hrir.size() && std::abs(hrir[onset]) < kOnsetThreshold * peak) {
+        ++onset;
+      }
+      const size_t delay = onset > kOnsetMargin ? onset - kOnsetMargin : 0;
+      hrir.erase(hrir.begin(), hrir.begin() + delay);
+      delays_[i] = static_cast<float>(delay);
+    }
+    length = std::max(length, hrir.size());
+  }
+
+  filters_.clear();
+  filters_.reserve(hrirs.size());
+  for (std::vector<float>& hrir : hrirs) {
+    hrir.resize(length, 0.f);
+    filters_.emplace_back(
+        new PartitionedFilter(hrir.data(), static_cast<int>(length), blockSize_));
+  }
+  numPartitions_ = filters_.front()->getNumPartitions();
+  fromCache_ = false;
+  return EngineError::OK;
+}
+
+bool MeasuredHrtf::readCache(const char* path, uint64_t sourceHash, float sampleRate) {
+  FILE* file = std::fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+  CacheHeader header;
+  const size_t numMeasurements = static_cast<size_t>(directions_.getSize());
+  bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+      std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) == 0 &&
+      header.version == kCacheVersion && header.blockSize == static_cast<uint32_t>(blockSize_) &&
+      header.numMeasurements == numMeasurements && header.numPartitions > 0 &&
+      header.sampleRate == sampleRate && header.removeDelays == (removeDelays_ ? 1u : 0u) &&
+      header.sourceHash == sourceHash;
+
+  std::vector<float> delays(2 * numMeasurements);
+  std::vector<std::unique_ptr<PartitionedFilter>> filters;
+  valid = valid && std::fread(delays.data(), sizeof(float), delays.size(), file) == delays.size();
+  if (valid) {
+    const size_t size = static_cast<size_t>(header.numPartitions) * (blockSize_ + 1);
+    std::vector<float> re(size);
+    std::vector<float> im(size);
+    filters.reserve(2 * numMeasurements);
+    for (size_t i = 0; valid && i < 2 * numMeasurements; ++i) {
+      valid = std::fread(re.data(), sizeof(float), size, file) == size &&
+          std::fread(im.data(), sizeof(float), size, file) == size;
+      if (valid) {
+        filters.emplace_back(new PartitionedFilter(
+            blockSize_, static_cast<int>(header.numPartitions), re.data(), im.data()));
+      }
+    }
+    // Nothing may follow the spectra
+    valid = valid && std::fgetc(file) == EOF;
+  }
+  std::fclose(file);
+  if (!valid) {
+    return false;
+  }
+  filters_.swap(filters);
+  delays_.swap(delays);
+  numPartitions_ = static_cast<int>(header.numPartitions);
+  fromCache_ = true;
+  return true;
+}
+
+void MeasuredHrtf::writeCache(const char* path, uint64_t sourceHash, float sampleRate) const {
+  CacheHeader header;
+  std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+  header.version = kCacheVersion;
+  header.blockSize = static_cast<uint32_t>(blockSize_);
+  header.numMeasurements = static_cast<uint32_t>(directions_.getSize());
+  header.numPartitions = static_cast<uint32_t>(numPartitions_);
+  header.sampleRate = sampleRate;
+  header.removeDelays = removeDelays_ ? 1 : 0;
+  header.sourceHash = sourceHash;
+
+  // Written next to the cache and renamed over it, so that engines created at the same time never
+  // read a partial file
+  const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+  const std::string temporary = std::string(path) + '.' +
+      std::to_string(hash(std::to_string(now) + '|' +
+                          std::to_string(reinterpret_cast<uintptr_t>(this)))) +
+      ".tmp";
+  FILE* file = std::fopen(temporary.c_str(), "wb");
+  if (!file) {
+    return;
+  }
+  bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+      std::fwrite(delays_.data(), sizeof(float), delays_.size(), file) == delays_.size();
+  const size_t size = static_cast<size_t>(numPartitions_) * (blockSize_ + 1);
+  for (size_t i = 0; written && i < filters_.size(); ++i) {
+    written = std::fwrite(filters_[i]->getReal(0), sizeof(float), size, file) == size &&
+        std::fwrite(filters_[i]->getImag(0), sizeof(float), size, file) == size;
+  }
+  written = std::fclose(file) == 0 && written;
+  // rename() doesn't replace an existing file on every platform
+  if (!written ||
+      (std::rename(temporary.c_str(), path) != 0 &&
+       (std::remove(path) != 0 || std::rename(temporary.c_str(), path) != 0))) {
+    std::remove(temporary.c_str());
+  }
+}
+} // namespace TBE
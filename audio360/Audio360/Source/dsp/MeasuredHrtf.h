@@ -0,0 +1,116 @@
+#ifndef FBA_MEASUREDHRTF_H
+#define FBA_MEASUREDHRTF_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "BinauralFilterBank.h"
+#include "DirectionIndex.h"
+#include "TBE_AudioEngineDefinitions.h"
+
+namespace TBE {
+/// A measured HRTF dataset for direct binaural rendering, read from the manifest described by
+/// HrtfSettings. Every HRIR is resampled to the engine's rate, partitioned and transformed when
+/// the dataset is loaded, and the measurement directions go into a DirectionIndex, so that looking
+/// up the filters of a direction is a nearest neighbour search rather than a scan.
+///
+/// With their delays removed, every HRIR starts just before its onset and the delays are kept
+/// apart, so that the HRIRs of neighbouring measurements can be interpolated without comb
+/// filtering and the interaural time delay interpolated on its own.
+///
+/// The spectra can be cached in a binary file, written after they are computed and read back
+/// instead of decoding and transforming the HRIRs when the manifest, the HRIR files (their size and
+/// modification time), the sample rate, the partition size and the removal of delays haven't
+/// changed.
+class MeasuredHrtf : public BinauralFilters {
+ public:
+  /// Read a dataset, from the cache if it is up to date
+  /// @param manifestPath Manifest listing the measurements
+  /// @param cachePath Cache file, nullptr for none. Failing to write it isn't an error.
+  /// @param sampleRate Sample rate of the engine in Hz
+  /// @param blockSize Partition size, a power of two
+  /// @param removeDelays Remove the onset delay of every HRIR, for getInterpolation()
+  /// @param hrtf Receives the dataset
+  /// @return EngineError::ERROR_OPENING_FILE if the manifest or an HRIR can't be read,
+  /// EngineError::INVALID_PARAM if the manifest is empty or malformed,
+  /// EngineError::INVALID_CHANNEL_COUNT if an HRIR isn't stereo, or the HRIR decoder's error
+  static EngineError load(
+      const char* manifestPath,
+      const char* cachePath,
+      float sampleRate,
+      int blockSize,
+      bool removeDelays,
+      std::unique_ptr<MeasuredHrtf>& hrtf);
+
+  int getBlockSize() const override;
+
+  int getNumPartitions() const override;
+
+  /// The filters of the measurement nearest to a direction: 2 * m for the left ear and 2 * m + 1
+  /// for the right ear of measurement m
+  void getIndices(const TBVector& direction, int& left, int& right) const override;
+
+  const PartitionedFilter& getFilter(int index) const override;
+
+  bool isInterpolated() const override;
+
+  /// The three nearest measurements, weighted by their inverse distance less that of the fourth
+  /// nearest, if the delays were removed. Otherwise the nearest measurement.
+  int getInterpolation(const TBVector& direction, int* left, int* right, float* weights)
+      const override;
+
+  float getDelay(int index) const override;
+
+  float getMaxDelay() const override;
+
+  int getNumMeasurements() const;
+
+  /// @return The measurement directions, indexed like the measurements
+  const DirectionIndex& getDirections() const;
+
+  /// @return True if the last load() read the spectra from the cache
+  bool isFromCache() const;
+
+ private:
+  /// One line of the manifest
+  struct Measurement {
+    float azimuth;
+    float elevation;
+    std::string path; /// Resolved against the manifest's directory
+  };
+
+  MeasuredHrtf(int blockSize, bool removeDelays, const std::vector<TBVector>& directions);
+
+  static EngineError readManifest(
+      const char* manifestPath,
+      std::string& text,
+      std::vector<Measurement>& measurements);
+  static EngineError getSourceHash(
+      const std::string& manifest,
+      const std::vector<Measurement>& measurements,
+      float sampleRate,
+      int blockSize,
+      bool removeDelays,
+      uint64_t& sourceHash);
+  EngineError decode(const std::vector<Measurement>& measurements, float sampleRate);
+  bool readCache(const char* path, uint64_t sourceHash, float sampleRate);
+  void writeCache(const char* path, uint64_t sourceHash, float sampleRate) const;
+
+  const int blockSize_;
+  const bool removeDelays_;
+  int numPartitions_{0};
+  DirectionIndex directions_;
+  std::vector<std::unique_ptr<PartitionedFilter>> filters_; // Left and right of each measurement
+  std::vector<float> delays_; // Of each filter, in samples
+  bool fromCache_{false};
+};
+} // namespace TBE
+
+#endif // FBA_MEASUREDHRTF_H
@@ -0,0 +1,61 @@
+#ifndef FBA_ONEPOLE_H
+#define FBA_ONEPOLE_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+namespace TBE {
+/// One pole low pass filter, cheap enough to run per object for directivity and distance effects
+class OnePoleLowPass {
+ public:
+  /// Set the cut-off frequency. Can be changed while processing; the state is kept.
+  /// @param frequency Cut-off frequency in Hz. At or above half the sample rate the filter is
+  /// bypassed.
+  /// @param sampleRate Sample rate in Hz
+  void setCutoff(float frequency, float sampleRate) {
+    if (frequency >= 0.5f * sampleRate) {
+      pole_ = 0.f;
+      return;
+    }
+    const float fc = std::max(1.f, frequency);
+    pole_ = std::exp(-2.f * 3.14159265358979f * fc / sampleRate);
+  }
+
+  /// @return True if the filter currently passes everything through
+  bool isBypassed() const {
+    return pole_ == 0.f;
+  }
+
+  /// Filter a block in place
+  void process(float* samples, int numFrames) {
+    if (isBypassed()) {
+      state_ = numFrames > 0 ? samples[numFrames - 1] : state_;
+      return;
+    }
+    const float gain = 1.f - pole_;
+    float state = state_;
+    for (int n = 0; n < numFrames; ++n) {
+      state = gain * samples[n] + pole_ * state;
+      samples[n] = state;
+    }
+    // Flush denormals
+    state_ = std::abs(state) < 1e-15f ? 0.f : state;
+  }
+
+  void reset() {
+    state_ = 0.f;
+  }
+
+ private:
+  float pole_{0.f};
+  float state_{0.f};
+};
+} // namespace TBE
+
+#endif // FBA_ONEPOLE_H
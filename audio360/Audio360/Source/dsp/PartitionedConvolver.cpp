@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "PartitionedConvolver.h"
+#include <algorithm>
+#include <cstring>
+
+namespace TBE {
+PartitionedFilter::PartitionedFilter(const float* impulseResponse, int length, int blockSize)
+    : blockSize_(blockSize), numBins_(blockSize + 1) {
+  numPartitions_ = std::max(1, (length + blockSize - 1) / blockSize);
+  re_.assign(static_cast<size_t>(numPartitions_) * numBins_, 0.f);
+  im_.assign(static_cast<size_t>(numPartitions_) * numBins_, 0.f);
+
+  // Each partition is zero padded to two blocks. The 1 / N of the inverse FFT is applied here
+  // once, rather than to every output block.
+  Fft fft(2 * blockSize);
+  const float scale = 1.f / static_cast<float>(fft.getSize());
+  std::vector<float> padded(fft.getSize());
+  for (int p = 0; p < numPartitions_; ++p) {
+    std::fill(padded.begin(), padded.end(), 0.f);
+    const int start = p * blockSize;
+    const int count = std::min(blockSize, length - start);
+    for (int i = 0; i < count; ++i) {
+      padded[i] = impulseResponse[start + i] * scale;
+    }
+    const size_t offset = static_cast<size_t>(p) * numBins_;
+    fft.forward(padded.data(), &re_[offset], &im_[offset]);
+  }
+}
+
+PartitionedFilter::PartitionedFilter(
+    int blockSize,
+    int numPartitions,
+    const float* re,
+    const float* im)
+    : blockSize_(blockSize), numBins_(blockSize + 1), numPartitions_(numPartitions) {
+  const size_t size = static_cast<size_t>(numPartitions_) * numBins_;
+  re_.assign(re, re + size);
+  im_.assign(im, im + size);
+}
+
+PartitionedFilter::PartitionedFilter(int blockSize, int numPartitions)
+    : blockSize_(blockSize), numBins_(blockSize + 1), numPartitions_(std::max(1, numPartitions)) {
+  re_.assign(static_cast<size_t>(numPartitions_) * numBins_, 0.f);
+  im_.assign(static_cast<size_t>(numPartitions_) * numBins_, 0.f);
+}
+
+int PartitionedFilter::getBlockSize() const {
+  return blockSize_;
+}
+
+int PartitionedFilter::getNumPartitions() const {
+  return numPartitions_;
+}
+
+int PartitionedFilter::getNumBins() const {
+  return numBins_;
+}
+
+const float* PartitionedFilter::getReal(int partition) const {
+  return &re_[static_cast<size_t>(partition) * numBins_];
+}
+
+const float* PartitionedFilter::getImag(int partition) const {
+  return &im_[static_cast<size_t>(partition) * numBins_];
+}
+
+float* PartitionedFilter::getReal(int partition) {
+  return &re_[static_cast<size_t>(partition) * numBins_];
+}
+
+float* PartitionedFilter::getImag(int partition) {
+  return &im_[static_cast<size_t>(partition) * numBins_];
+}
+
+int PartitionedConvolver::getBlockSizeFor(int bufferSize, int maxBlockSize) {
+  int blockSize = maxBlockSize;
+  while (blockSize >= kMinBlockSize && bufferSize % blockSize != 0) {
+    blockSize /= 2;
+  }
+  return blockSize >= kMinBlockSize ? blockSize : 0;
+}
+
+PartitionedConvolver::PartitionedConvolver(int blockSize, int maxPartitions)
+    : blockSize_(blockSize),
+      numBins_(blockSize + 1),
+      numPartitions_(std::max(1, maxPartitions)),
+      fft_(2 * blockSize) {
+  input_.assign(2 * static_cast<size_t>(blockSize), 0.f);
+  fdlRe_.assign(static_cast<size_t>(numPartitions_) * numBins_, 0.f);
+  fdlIm_.assign(static_cast<size_t>(numPartitions_) * numBins_, 0.f);
+  accRe_.assign(numBins_, 0.f);
+  accIm_.assign(numBins_, 0.f);
+  time_.assign(2 * static_cast<size_t>(blockSize), 0.f);
+}
+
+int PartitionedConvolver::getBlockSize() const {
+  return blockSize_;
+}
+
+void PartitionedConvolver::pushInput(const float* input) {
+  std::memmove(input_.data(), input_.data() + blockSize_, blockSize_ * sizeof(float));
+  std::memcpy(input_.data() + blockSize_, input, blockSize_ * sizeof(float));
+  head_ = head_ == 0 ? numPartitions_ - 1 : head_ - 1;
+  const size_t offset = static_cast<size_t>(head_) * numBins_;
+  fft_.forward(input_.data(), &fdlRe_[offset], &fdlIm_[offset]);
+}
+
+void PartitionedConvolver::process(const PartitionedFilter& filter, float* output) {
+  float* accRe = accRe_.data();
+  float* accIm = accIm_.data();
+  std::fill(accRe, accRe + numBins_, 0.f);
+  std::fill(accIm, accIm + numBins_, 0.f);
+  accumulate(filter, accRe, accIm);
+
+  // Overlap-save: the first block of the circular convolution is aliased, the second is valid
+  fft_.inverse(accRe, accIm, time_.data());
+  std::memcpy(output, time_.data() + blockSize_, blockSize_ * sizeof(float));
+}
+
+void PartitionedConvolver::accumulate(const PartitionedFilter& filter, float* re, float* im) const {
+  // Partition p of the filter meets the input from p blocks ago
+  const int numPartitions = std::min(numPartitions_, filter.getNumPartitions());
+  for (int p = 0; p < numPartitions; ++p) {
+    int slot = head_ + p;
+    slot -= slot >= numPartitions_ ? numPartitions_ : 0;
+    const float* xRe = &fdlRe_[static_cast<size_t>(slot) * numBins_];
+    const float* xIm = &fdlIm_[static_cast<size_t>(slot) * numBins_];
+    const float* hRe = filter.getReal(p);
+    const float* hIm = filter.getImag(p);
+    for (int k = 0; k < numBins_; ++k) {
+      re[k] += xRe[k] * hRe[k] - xIm[k] * hIm[k];
+      im[k] += xRe[k] * hIm[k] + xIm[k] * hRe[k];
+    }
+  }
+}
+
+void PartitionedConvolver::reset() {
+  std::fill(input_.begin(), input_.end(), 0.f);
+  std::fill(fdlRe_.begin(), fdlRe_.end(), 0.f);
+  std::fill(fdlIm_.begin(), fdlIm_.end(), 0.f);
+  head_ = 0;
+}
+} // namespace TBE
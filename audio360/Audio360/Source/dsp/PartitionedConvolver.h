@@ -0,0 +1,107 @@
+#ifndef FBA_PARTITIONEDCONVOLVER_H
+#define FBA_PARTITIONEDCONVOLVER_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <vector>
+#include "Fft.h"
+
+namespace TBE {
+/// An impulse response cut into partitions of one block each, transformed once for use by any
+/// number of PartitionedConvolvers with the same block size. Immutable after construction, except
+/// for filters built empty, whose owner writes their spectra directly.
+class PartitionedFilter {
+ public:
+  /// @param impulseResponse Filter taps
+  /// @param length Number of taps
+  /// @param blockSize Partition size, a power of two
+  PartitionedFilter(const float* impulseResponse, int length, int blockSize);
+
+  /// Wrap spectra computed earlier by another PartitionedFilter, e.g. read back from a cache
+  /// @param blockSize Partition size, a power of two
+  /// @param numPartitions Number of partitions
+  /// @param re, im numPartitions x getNumBins() split spectra, as returned by getReal(0) and
+  /// getImag(0)
+  PartitionedFilter(int blockSize, int numPartitions, const float* re, const float* im);
+
+  /// A silent filter, for spectra written through getReal() and getImag(), e.g. interpolated
+  PartitionedFilter(int blockSize, int numPartitions);
+
+  int getBlockSize() const;
+  int getNumPartitions() const;
+  int getNumBins() const;
+
+  /// @return The split spectrum of a partition, scaled by the inverse FFT normalisation. The
+  /// partitions are contiguous.
+  const float* getReal(int partition) const;
+  const float* getImag(int partition) const;
+  float* getReal(int partition);
+  float* getImag(int partition);
+
+ private:
+  const int blockSize_;
+  const int numBins_;
+  int numPartitions_;
+  std::vector<float> re_; // numPartitions_ x numBins_
+  std::vector<float> im_;
+};
+
+/// Uniformly partitioned overlap-save convolution. Every block of input is transformed once and
+/// kept in a frequency-domain delay line (FDL), so convolving it with several filters (both ears,
+/// or the old and new filter of a crossfade) costs one complex multiply-add per partition and one
+/// inverse FFT each. The cost per block is fixed by the block size and the number of partitions,
+/// and there is no latency beyond the block itself.
+class PartitionedConvolver {
+ public:
+  static const int kMinBlockSize = 16;
+
+  /// @return The largest power of two block size up to maxBlockSize that divides the buffer size,
+  /// so that buffers are convolved without added latency, or 0 if it is smaller than kMinBlockSize
+  static int getBlockSizeFor(int bufferSize, int maxBlockSize);
+
+  /// @param blockSize Samples per block, a power of two
+  /// @param maxPartitions Longest filter, in partitions, that process() will be given
+  PartitionedConvolver(int blockSize, int maxPartitions);
+
+  int getBlockSize() const;
+
+  /// Transform one block of input and push it into the delay line
+  /// @param input getBlockSize() samples
+  void pushInput(const float* input);
+
+  /// Convolve the delay line with a filter. Partitions beyond maxPartitions are ignored.
+  /// @param filter A filter with the same block size
+  /// @param output getBlockSize() samples, overwritten
+  void process(const PartitionedFilter& filter, float* output);
+
+  /// Convolve the delay line with a filter and add the product to a spectrum, so that the
+  /// convolutions of several inputs can share one inverse FFT. Partitions beyond maxPartitions are
+  /// ignored.
+  /// @param filter A filter with the same block size
+  /// @param re, im getBlockSize() + 1 bins, accumulated. The inverse FFT of their sum is the
+  /// overlap-save output: its second block.
+  void accumulate(const PartitionedFilter& filter, float* re, float* im) const;
+
+  /// Clear the input history
+  void reset();
+
+ private:
+  const int blockSize_;
+  const int numBins_;
+  const int numPartitions_;
+  Fft fft_;
+  int head_{0}; // Slot of the newest spectrum in the delay line
+  std::vector<float> input_; // The last two blocks of input
+  std::vector<float> fdlRe_; // numPartitions_ x numBins_
+  std::vector<float> fdlIm_;
+  std::vector<float> accRe_;
+  std::vector<float> accIm_;
+  std::vector<float> time_;
+};
+} // namespace TBE
+
+#endif // FBA_PARTITIONEDCONVOLVER_H
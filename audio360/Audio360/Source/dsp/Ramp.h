@@ -0,0 +1,120 @@
+#ifndef FBA_RAMP_H
+#define FBA_RAMP_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include "utils/SpscQueue.h"
+
+namespace TBE {
+/// A linearly ramped parameter (typically a gain) that is set from a control thread and read by the
+/// audio thread once per block. Targets are handed over through a lock-free queue, so the audio
+/// thread never blocks.
+class LinearRamp {
+ public:
+  explicit LinearRamp(float initialValue = 1.f) : value_(initialValue), target_(initialValue) {
+    lastTarget_.store(initialValue);
+  }
+
+  /// Control thread: ramp to a new value
+  /// @param value Target value
+  /// @param rampSamples Ramp duration in samples, 0 to jump
+  /// @param forcePrevious Complete any ramp in progress before starting this one
+  void setTarget(float value, int rampSamples, bool forcePrevious = false) {
+    lastTarget_.store(value, std::memory_order_relaxed);
+    messages_.push({value, 0.f, std::max(0, rampSamples), forcePrevious, false});
+  }
+
+  /// Control thread: jump to startValue and ramp to endValue
+  void fade(float startValue, float endValue, int rampSamples) {
+    lastTarget_.store(endValue, std::memory_order_relaxed);
+    messages_.push({endValue, startValue, std::max(0, rampSamples), false, true});
+  }
+
+  /// @return The last target set, from any thread
+  float getTarget() const {
+    return lastTarget_.load(std::memory_order_relaxed);
+  }
+
+  /// Audio thread: advance the ramp by one block
+  /// @param numFrames Block size
+  /// @param start Value at the start of the block
+  /// @param end Value at the end of the block
+  void process(int numFrames, float& start, float& end) {
+    Message message;
+    while (messages_.pop(message)) {
+      if (message.hasStart) {
+        value_ = message.start;
+      } else if (message.forcePrevious) {
+        value_ = target_;
+      }
+      target_ = message.target;
+      remaining_ = message.rampSamples;
+      if (remaining_ == 0) {
+        value_ = target_;
+      } else {
+        step_ = (target_ - value_) / static_cast<float>(remaining_);
+      }
+    }
+
+    start = value_;
+    if (remaining_ > numFrames) {
+      value_ += step_ * static_cast<float>(numFrames);
+      remaining_ -= numFrames;
+    } else {
+      value_ = target_;
+      remaining_ = 0;
+    }
+    end = value_;
+  }
+
+  /// Audio thread: true if the value will not change in the next block without a new target
+  bool isSteady() const {
+    return remaining_ == 0 && messages_.empty();
+  }
+
+  /// Audio thread: current value
+  float getValue() const {
+    return value_;
+  }
+
+  /// Multiply a block by a gain ramp from start to end
+  static void applyGain(float* samples, int numFrames, float start, float end) {
+    if (start == end) {
+      if (start != 1.f) {
+        for (int n = 0; n < numFrames; ++n) {
+          samples[n] *= start;
+        }
+      }
+      return;
+    }
+    const float delta = (end - start) / static_cast<float>(std::max(1, numFrames));
+    for (int n = 0; n < numFrames; ++n) {
+      samples[n] *= start + delta * static_cast<float>(n + 1);
+    }
+  }
+
+ private:
+  struct Message {
+    float target;
+    float start;
+    int rampSamples;
+    bool forcePrevious;
+    bool hasStart;
+  };
+
+  SpscQueue<Message, 16> messages_;
+  std::atomic<float> lastTarget_;
+  float value_;
+  float target_;
+  float step_{0.f};
+  int remaining_{0};
+};
+} // namespace TBE
+
+#endif // FBA_RAMP_H
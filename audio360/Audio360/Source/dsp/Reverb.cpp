@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "Reverb.h"
+#include <algorithm>
+
+namespace TBE {
+/// Delay line lengths in samples at 44.1 kHz
+static const int kCombTunings[] = {1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617};
+static const int kAllpassTunings[] = {556, 441, 341, 225};
+static const int kStereoSpread = 23;
+static const float kInputGain = 0.015f;
+static const float kScaleRoom = 0.28f;
+static const float kOffsetRoom = 0.7f;
+static const float kScaleDamp = 0.4f;
+
+Reverb::Reverb(float sampleRate) {
+  const float scale = sampleRate / 44100.f;
+  for (int ch = 0; ch < 2; ++ch) {
+    const int spread = ch * kStereoSpread;
+    for (int i = 0; i < kNumCombs; ++i) {
+      const auto length = static_cast<size_t>((kCombTunings[i] + spread) * scale);
+      combs_[ch][i].buffer.assign(std::max<size_t>(length, 1), 0.f);
+    }
+    for (int i = 0; i < kNumAllpasses; ++i) {
+      const auto length = static_cast<size_t>((kAllpassTunings[i] + spread) * scale);
+      allpasses_[ch][i].buffer.assign(std::max<size_t>(length, 1), 0.f);
+    }
+  }
+  setRoomSize(0.5f);
+  setDamping(0.5f);
+  setWidth(1.f);
+}
+
+void Reverb::setRoomSize(float roomSize) {
+  feedback_ = std::max(0.f, std::min(1.f, roomSize)) * kScaleRoom + kOffsetRoom;
+}
+
+void Reverb::setDamping(float damping) {
+  damp_ = std::max(0.f, std::min(1.f, damping)) * kScaleDamp;
+}
+
+void Reverb::setWidth(float width) {
+  width_ = std::max(0.f, std::min(1.f, width));
+}
+
+void Reverb::processAdd(
+    const float* input,
+    float* left,
+    float* right,
+    int numFrames,
+    float wetGain) {
+  const float damp1 = damp_;
+  const float damp2 = 1.f - damp_;
+  const float wet1 = wetGain * (width_ * 0.5f + 0.5f);
+  const float wet2 = wetGain * ((1.f - width_) * 0.5f);
+
+  for (int n = 0; n < numFrames; ++n) {
+    const float in = input[n] * kInputGain;
+    float out[2] = {0.f, 0.f};
+    for (int ch = 0; ch < 2; ++ch) {
+      for (int i = 0; i < kNumCombs; ++i) {
+        out[ch] += combs_[ch][i].process(in, feedback_, damp1, damp2);
+      }
+      for (int i = 0; i < kNumAllpasses; ++i) {
+        out[ch] = allpasses_[ch][i].process(out[ch]);
+      }
+    }
+    left[n] += out[0] * wet1 + out[1] * wet2;
+    right[n] += out[1] * wet1 + out[0] * wet2;
+  }
+}
+
+void Reverb::reset() {
+  for (int ch = 0; ch < 2; ++ch) {
+    for (auto& comb : combs_[ch]) {
+      std::fill(comb.buffer.begin(), comb.buffer.end(), 0.f);
+      comb.store = 0.f;
+    }
+    for (auto& allpass : allpasses_[ch]) {
+      std::fill(allpass.buffer.begin(), allpass.buffer.end(), 0.f);
+    }
+  }
+}
+} // namespace TBE
@@ -0,0 +1,81 @@
+#ifndef FBA_REVERB_H
+#define FBA_REVERB_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace TBE {
+/// Schroeder-Moorer reverb in the Freeverb topology: eight parallel low-pass feedback comb filters
+/// followed by four series allpass filters per channel, with the right channel's delay lines
+/// slightly detuned for decorrelation. Mono in, wet-only stereo out.
+class Reverb {
+ public:
+  explicit Reverb(float sampleRate);
+
+  /// @param roomSize Between 0 and 1
+  void setRoomSize(float roomSize);
+  /// @param damping Between 0 and 1
+  void setDamping(float damping);
+  /// @param width Between 0 and 1
+  void setWidth(float width);
+
+  /// Process a block and add the wet signal to the outputs
+  /// @param input Mono input
+  /// @param left Left output, accumulated
+  /// @param right Right output, accumulated
+  /// @param numFrames Number of frames
+  /// @param wetGain Gain applied to the wet signal
+  void processAdd(const float* input, float* left, float* right, int numFrames, float wetGain);
+
+  /// Clear all delay lines
+  void reset();
+
+ private:
+  static const int kNumCombs = 8;
+  static const int kNumAllpasses = 4;
+
+  struct Comb {
+    std::vector<float> buffer;
+    size_t index{0};
+    float store{0.f};
+
+    inline float process(float input, float feedback, float damp1, float damp2) {
+      const float output = buffer[index];
+      store = output * damp2 + store * damp1;
+      buffer[index] = input + store * feedback;
+      if (++index >= buffer.size()) {
+        index = 0;
+      }
+      return output;
+    }
+  };
+
+  struct Allpass {
+    std::vector<float> buffer;
+    size_t index{0};
+
+    inline float process(float input) {
+      const float delayed = buffer[index];
+      buffer[index] = input + delayed * 0.5f;
+      if (++index >= buffer.size()) {
+        index = 0;
+      }
+      return delayed - input;
+    }
+  };
+
+  Comb combs_[2][kNumCombs];
+  Allpass allpasses_[2][kNumAllpasses];
+  float feedback_{0.84f};
+  float damp_{0.2f};
+  float width_{1.f};
+};
+} // namespace TBE
+
+#endif // FBA_REVERB_H
@@ -0,0 +1,143 @@
+#ifndef FBA_SPHERICALHARMONICS_H
+#define FBA_SPHERICALHARMONICS_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <cmath>
+#include "TBE_Vector.hh"
+
+namespace TBE {
+/// Real spherical harmonics in the ambiX convention: ACN channel ordering, SN3D normalisation and
+/// an x = front, y = left, z = up coordinate system.
+namespace SphericalHarmonics {
+static const int kMaxOrder = 3;
+static const int kMaxChannels = (kMaxOrder + 1) * (kMaxOrder + 1);
+
+/// @return The number of ACN channels for an ambisonic order
+inline int getNumChannels(int order) {
+  return (order + 1) * (order + 1);
+}
+
+/// @return The order (degree l) of an ACN channel
+inline int getOrderForChannel(int acn) {
+  return static_cast<int>(std::sqrt(static_cast<float>(acn)));
+}
+
+/// @return True if the channel is symmetric about the median (left/right) plane, i.e. it has no
+/// odd powers of the ambiX y axis. Antisymmetric channels contribute with opposite sign to the two
+/// ears of a symmetric head.
+inline bool isLeftRightSymmetric(int acn) {
+  // Degree l, index m: channels with m < 0 are sin(|m| phi) terms and flip sign under y -> -y
+  const int l = getOrderForChannel(acn);
+  return acn - l * l - l >= 0;
+}
+
+/// Convert an engine direction (x = right, y = up, z = forward) to ambiX axes.
+inline void engineToAmbix(const TBVector& v, float& ax, float& ay, float& az) {
+  ax = v.z;
+  ay = -v.x;
+  az = v.y;
+}
+
+/// Evaluate the SN3D spherical harmonics for a unit direction in ambiX axes.
+/// @param x Front component
+/// @param y Left component
+/// @param z Up component
+/// @param order Ambisonic order, between 0 and kMaxOrder
+/// @param out At least getNumChannels(order) values
+inline void evaluate(float x, float y, float z, int order, float* out) {
+  static const float kSqrt3 = 1.7320508075688772f;
+  static const float kSqrt15 = 3.8729833462074170f;
+  static const float kSqrt5_8 = 0.7905694150420949f;
+  static const float kSqrt3_8 = 0.6123724356957945f;
+
+  out[0] = 1.f;
+  if (order < 1) {
+    return;
+  }
+  out[1] = y;
+  out[2] = z;
+  out[3] = x;
+  if (order < 2) {
+    return;
+  }
+  const float x2 = x * x;
+  const float y2 = y * y;
+  const float z2 = z * z;
+  out[4] = kSqrt3 * x * y;
+  out[5] = kSqrt3 * y * z;
+  out[6] = 0.5f * (3.f * z2 - 1.f);
+  out[7] = kSqrt3 * x * z;
+  out[8] = 0.5f * kSqrt3 * (x2 - y2);
+  if (order < 3) {
+    return;
+  }
+  out[9] = kSqrt5_8 * y * (3.f * x2 - y2);
+  out[10] = kSqrt15 * x * y * z;
+  out[11] = kSqrt3_8 * y * (5.f * z2 - 1.f);
+  out[12] = 0.5f * z * (5.f * z2 - 3.f);
+  out[13] = kSqrt3_8 * x * (5.f * z2 - 1.f);
+  out[14] = 0.5f * kSqrt15 * z * (x2 - y2);
+  out[15] = kSqrt5_8 * x * (x2 - 3.f * y2);
+}
+
+/// Evaluate the SN3D spherical harmonics for a unit direction in engine coordinates
+inline void evaluateEngine(const TBVector& direction, int order, float* out) {
+  float x, y, z;
+  engineToAmbix(direction, x, y, z);
+  evaluate(x, y, z, order, out);
+}
+
+/// Max-rE weight for each order, normalised so that the weight of order 0 is 1. Applied to the
+/// decoder to narrow the energy spread of a plane wave.
+/// @param maxOrder The order of the decoder
+/// @param weights kMaxOrder + 1 values, one per order
+inline void getMaxReWeights(int maxOrder, float* weights) {
+  const double theta = 137.9 * 3.14159265358979323846 / 180.0 / (maxOrder + 1.51);
+  const double c = std::cos(theta);
+  // Legendre polynomials P_l(cos(theta))
+  double p[kMaxOrder + 1] = {1.0, c, 0.5 * (3.0 * c * c - 1.0), 0.5 * (5.0 * c * c * c - 3.0 * c)};
+  for (int l = 0; l <= kMaxOrder; ++l) {
+    weights[l] = (l <= maxOrder) ? static_cast<float>(p[l]) : 0.f;
+  }
+}
+
+/// A spherical quadrature: 4 Gauss-Legendre nodes in elevation and 8 equally spaced azimuths.
+/// Integrates polynomials up to degree 7 exactly, which covers products of two third order
+/// harmonics. Weights sum to 1.
+struct Quadrature {
+  static const int kNumPoints = 32;
+  float x[kNumPoints]; /// ambiX front
+  float y[kNumPoints]; /// ambiX left
+  float z[kNumPoints]; /// ambiX up
+  float weight[kNumPoints];
+
+  Quadrature() {
+    static const double kNodes[4] = {
+        -0.8611363115940526, -0.3399810435848563, 0.3399810435848563, 0.8611363115940526};
+    static const double kWeights[4] = {
+        0.3478548451374538, 0.6521451548625461, 0.6521451548625461, 0.3478548451374538};
+    int point = 0;
+    for (int e = 0; e < 4; ++e) {
+      const double sinEle = kNodes[e];
+      const double cosEle = std::sqrt(1.0 - sinEle * sinEle);
+      for (int a = 0; a < 8; ++a) {
+        // Offset alternate rings by half a step for a more even spread
+        const double azi = (a + 0.5 * (e & 1)) * 2.0 * 3.14159265358979323846 / 8.0;
+        x[point] = static_cast<float>(cosEle * std::cos(azi));
+        y[point] = static_cast<float>(cosEle * std::sin(azi));
+        z[point] = static_cast<float>(sinEle);
+        weight[point] = static_cast<float>(kWeights[e] / 2.0 / 8.0);
+        point++;
+      }
+    }
+  }
+};
+} // namespace SphericalHarmonics
+} // namespace TBE
+
+#endif // FBA_SPHERICALHARMONICS_H
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "TBE_AudioEngine.h"
+#include "TBE_AudioEngine_C.h"
+#include "TBE_AudioObject.h"
+
+namespace {
+TBE::ChannelMap toChannelMap(TBEChannelMap map) {
+  switch (map) {
+    case CHANNEL_MAP_AMBIX_4:
+      return TBE::ChannelMap::AMBIX_4;
+    case CHANNEL_MAP_AMBIX_9:
+      return TBE::ChannelMap::AMBIX_9;
+    case CHANNEL_MAP_AMBIX_16:
+      return TBE::ChannelMap::AMBIX_16;
+    case CHANNEL_MAP_MONO:
+      return TBE::ChannelMap::MONO;
+    case CHANNEL_MAP_STEREO:
+      return TBE::ChannelMap::STEREO;
+    case CHANNEL_MAP_UNKNOWN:
+      return TBE::ChannelMap::UNKNOWN;
+    default:
+      return TBE::ChannelMap::INVALID;
+  }
+}
+
+TBEPlayState toPlayState(TBE::PlayState state) {
+  switch (state) {
+    case TBE::PlayState::PLAYING:
+      return TBEPlayState::PLAY_STATE_PLAYING;
+    case TBE::PlayState::PAUSED:
+      return TBEPlayState::PLAY_STATE_PAUSED;
+    case TBE::PlayState::STOPPED:
+      return TBEPlayState::PLAY_STATE_STOPPED;
+    default:
+      return TBEPlayState::PLAY_STATE_INVALID;
+  }
+}
+
+TBE::AudioObject* asObject(TBEAudioObject object) {
+  return static_cast<TBE::AudioObject*>(object);
+}
+} // namespace
+
+int TBEAudioEngine_createAudioObject(TBEAudioEngine engine, TBEAudioObject* object) {
+  if (!engine || !object) {
+    return static_cast<int>(TBE::EngineError::INVALID_PARAM);
+  }
+  TBE::AudioObject* created = nullptr;
+  const TBE::EngineError error = static_cast<TBE::AudioEngine*>(engine)->createAudioObject(created);
+  *object = created;
+  return static_cast<int>(error);
+}
+
+void TBEAudioEngine_destroyAudioObject(TBEAudioEngine engine, TBEAudioObject* object) {
+  if (!engine || !object) {
+    return;
+  }
+  TBE::AudioObject* audioObject = asObject(*object);
+  static_cast<TBE::AudioEngine*>(engine)->destroyAudioObject(audioObject);
+  *object = nullptr;
+}
+
+int TBEAudioObject_setAudioBufferCallback(
+    TBEAudioObject object,
+    TBEAudioObjectCallback callback,
+    size_t numChannels,
+    TBEChannelMap map,
+    void* userData) {
+  if (!object) {
+    return static_cast<int>(TBE::EngineError::INVALID_PARAM);
+  }
+  return static_cast<int>(
+      asObject(object)->setAudioBufferCallback(callback, numChannels, toChannelMap(map), userData));
+}
+
+void TBEAudioObject_close(TBEAudioObject object) {
+  if (object) {
+    asObject(object)->close();
+  }
+}
+
+int TBEAudioObject_play(TBEAudioObject object) {
+  if (!object) {
+    return static_cast<int>(TBE::EngineError::INVALID_PARAM);
+  }
+  return static_cast<int>(asObject(object)->play());
+}
+
+int TBEAudioObject_pause(TBEAudioObject object) {
+  if (!object) {
+    return static_cast<int>(TBE::EngineError::INVALID_PARAM);
+  }
+  return static_cast<int>(asObject(object)->pause());
+}
+
+TBEPlayState TBEAudioObject_getPlayState(TBEAudioObject object) {
+  return object ? toPlayState(asObject(object)->getPlayState()) : TBEPlayState::PLAY_STATE_INVALID;
+}
+
+int TBEAudioObject_setPosition(TBEAudioObject object, float x, float y, float z) {
+  if (!object) {
+    return static_cast<int>(TBE::EngineError::INVALID_PARAM);
+  }
+  return static_cast<int>(asObject(object)->setPosition(TBE::TBVector(x, y, z)));
+}
+
+void TBEAudioObject_getPosition(TBEAudioObject object, float* x, float* y, float* z) {
+  if (!object || !x || !y || !z) {
+    return;
+  }
+  const TBE::TBVector position = asObject(object)->getPosition();
+  *x = position.x;
+  *y = position.y;
+  *z = position.z;
+}
+
+void TBEAudioObject_shouldSpatialize(TBEAudioObject object, bool shouldSpatialize) {
+  if (object) {
+    asObject(object)->shouldSpatialise(shouldSpatialize);
+  }
+}
+
+bool TBEAudioObject_isSpatialized(TBEAudioObject object) {
+  return object && asObject(object)->isSpatialised();
+}
+
+void TBEAudioObject_setVolume(
+    TBEAudioObject object,
+    float linearGain,
+    float rampTimeMs,
+    bool forcePreviousRamp) {
+  if (object) {
+    asObject(object)->setVolume(linearGain, rampTimeMs, forcePreviousRamp);
+  }
+}
+
+float TBEAudioObject_getVolume(TBEAudioObject object) {
+  return object ? asObject(object)->getVolume() : 0.f;
+}
@@ -0,0 +1,1180 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "AudioEngineImpl.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "VoiceManagerImpl.h"
+#include "dsp/MeasuredHrtf.h"
+#include "io/AudioAssetManagerImpl.h"
+#include "utils/ThreadScheduling.h"
+#include "utils/Timer.h"
+
+namespace TBE {
+namespace {
+/// Used when the settings leave the sample rate or buffer size to the engine
+const float kDefaultSampleRate = 48000.f;
+const int32_t kDefaultBufferSize = 1024;
+const int32_t kMaxBufferSize = 16384;
+const int32_t kMaxMixerThreads = 64;
+
+const int kAmbisonicOrder = SphericalHarmonics::kMaxOrder;
+const unsigned int kMaxOutputBuffers = 12;
+
+/// Ramp used when muting, and when no ramp is requested, to avoid clicks
+const float kMinRampMs = 5.f;
+
+const double kTwoPi = 6.283185307179586;
+const float kDegreesToRadians = 0.017453292519943295f;
+
+float resolveSampleRate(const AudioSettings& settings) {
+  return settings.sampleRate > 0.f ? settings.sampleRate : kDefaultSampleRate;
+}
+
+int resolveBufferSize(const AudioSettings& settings) {
+  return settings.bufferSize > 0 ? settings.bufferSize : kDefaultBufferSize;
+}
+
+size_t resolveNumMixerThreads(const EngineInitSettings& settings) {
+  return settings.threadScheduling.numMixerThreads > 0
+      ? static_cast<size_t>(settings.threadScheduling.numMixerThreads)
+      : settings.experimental.fbaNumThreads;
+}
+} // namespace
+
+EngineError AudioEngineImpl::validateSettings(const EngineInitSettings& settings) {
+  const AudioSettings& audio = settings.audioSettings;
+  if (audio.deviceType != AudioDeviceType::DISABLED) {
+    // There is no audio device backend in this build: the mix must be pulled with getAudioMix()
+    return EngineError::NO_AUDIO_DEVICE;
+  }
+  if (audio.sampleRate < 0.f || std::isnan(audio.sampleRate)) {
+    return EngineError::INVALID_SAMPLE_RATE;
+  }
+  if (audio.bufferSize < 0 || audio.bufferSize > kMaxBufferSize) {
+    return EngineError::INVALID_BUFFER_SIZE;
+  }
+  const MemorySettings& memory = settings.memorySettings;
+  if (memory.spatDecoderQueuePoolSize < 0 || memory.spatDecoderFilePoolSize < 0 ||
+      memory.audioObjectPoolSize < 0 || memory.spatQueueSizePerChannel <= 0) {
+    return EngineError::INVALID_PARAM;
+  }
+  const ThreadSchedulingSettings& threads = settings.threadScheduling;
+  if (threads.numMixerThreads < 0 || threads.numMixerThreads > kMaxMixerThreads ||
+      validateThreadScheduling(threads.decoderThread) != EngineError::OK ||
+      validateThreadScheduling(threads.mixerThreads) != EngineError::OK) {
+    return EngineError::INVALID_PARAM;
+  }
+  const HrtfSettings& hrtf = settings.hrtf;
+  if ((hrtf.interpolation != HrtfInterpolation::NEAREST &&
+       hrtf.interpolation != HrtfInterpolation::INTERPOLATED) ||
+      !(hrtf.crossfadeThresholdDegrees >= 0.f && hrtf.crossfadeThresholdDegrees <= 180.f)) {
+    return EngineError::INVALID_PARAM;
+  }
+  if ((hrtf.rendering != BinauralRendering::PER_OBJECT &&
+       hrtf.rendering != BinauralRendering::AMBISONIC &&
+       hrtf.rendering != BinauralRendering::AUTOMATIC) ||
+      (hrtf.ambisonicFormat != ChannelMap::AMBIX_4 && hrtf.ambisonicFormat != ChannelMap::AMBIX_9 &&
+       hrtf.ambisonicFormat != ChannelMap::AMBIX_16)) {
+    return EngineError::INVALID_PARAM;
+  }
+  return EngineError::OK;
+}
+
+AudioEngineImpl::AudioEngineImpl(const EngineInitSettings& settings)
+    : sampleRate_(resolveSampleRate(settings.audioSettings)),
+      bufferSize_(resolveBufferSize(settings.audioSettings)),
+      deviceType_(settings.audioSettings.deviceType),
+      memorySettings_(settings.memorySettings),
+      buses_(sampleRate_),
+      mixer_(
+          resolveNumMixerThreads(settings),
+          static_cast<size_t>(std::max(0, settings.memorySettings.audioObjectPoolSize)),
+          bufferSize_,
+          &tracer_),
+      hrtf_(sampleRate_),
+      binauralDecoder_(hrtf_, bufferSize_, kAmbisonicOrder),
+      reverb_(sampleRate_),
+      loudness_(sampleRate_),
+      ambisonic_(SphericalHarmonics::kMaxChannels, static_cast<size_t>(bufferSize_)),
+      headlocked_(2, static_cast<size_t>(bufferSize_)),
+      mix_(2, static_cast<size_t>(bufferSize_)),
+      reverbSend_(static_cast<size_t>(bufferSize_), 0.f),
+      interleaved_(static_cast<size_t>(bufferSize_) * 2, 0.f),
+      masterVolume_(1.f),
+      masterMute_(1.f) {
+  if (settings.memorySettings.audioAssetManager) {
+    assetManager_ = settings.memorySettings.audioAssetManager;
+  } else {
+    assetManager_ = new AudioAssetManagerImpl();
+    ownsAssetManager_ = true;
+  }
+
+  // A measured HRTF replaces the head model's filters, and failing to load it fails the engine
+  EngineError hrtfError = EngineError::OK;
+  const int binauralBlockSize = BinauralFilterBank::getBlockSizeFor(bufferSize_);
+  if (settings.hrtf.manifestPath) {
+    std::unique_ptr<MeasuredHrtf> measured;
+    hrtfError = binauralBlockSize > 0
+        ? MeasuredHrtf::load(
+              settings.hrtf.manifestPath,
+              settings.hrtf.cachePath,
+              sampleRate_,
+              binauralBlockSize,
+              settings.hrtf.interpolation == HrtfInterpolation::INTERPOLATED,
+              measured)
+        : EngineError::NOT_SUPPORTED;
+    binauralFilters_ = std::move(measured);
+  } else if (binauralBlockSize > 0) {
+    binauralFilters_.reset(new BinauralFilterBank(hrtf_, binauralBlockSize));
+  }
+
+  // Objects rendered binaurally can share an ambisonic bus instead of convolving on their own
+  binauralRendering_ = settings.hrtf.rendering;
+  ambisonicObjectThreshold_ = settings.hrtf.ambisonicObjectThreshold;
+  if (binauralFilters_ && binauralRendering_ != BinauralRendering::PER_OBJECT) {
+    const int numChannels = getNumChannelsForMap(settings.hrtf.ambisonicFormat);
+    const int order = static_cast<int>(std::lround(std::sqrt(numChannels))) - 1;
+    ambisonicHrtf_.reset(new AmbisonicHrtfDecoder(*binauralFilters_, order));
+    binauralAmbisonic_.resize(
+        static_cast<size_t>(ambisonicHrtf_->getNumChannels()), static_cast<size_t>(bufferSize_));
+  }
+
+  if (settings.threads.useDecoderThread) {
+    decoderThread_.reset(new DecoderThread(&tracer_));
+    decoderThread_->start();
+  }
+
+  context_.sampleRate = sampleRate_;
+  context_.bufferSize = bufferSize_;
+  context_.queueSizePerChannel = settings.memorySettings.spatQueueSizePerChannel;
+  context_.decodeInAudioCallback = !settings.threads.useDecoderThread;
+  context_.offline = deviceType_ == AudioDeviceType::DISABLED;
+  context_.decoderThread = decoderThread_.get();
+  context_.assetManager = assetManager_;
+  context_.graphMutex = &graphMutex_;
+  context_.binauralFilters = binauralFilters_.get();
+  context_.binauralCrossfadeThreshold = settings.hrtf.crossfadeThresholdDegrees;
+  context_.binauralRendering = binauralRendering_;
+  context_.binauralAmbisonicOrder = ambisonicHrtf_ ? ambisonicHrtf_->getOrder() : 0;
+  context_.tracer = &tracer_;
+
+  voiceManager_.reset(new VoiceManagerImpl(
+      *this,
+      &tracer_,
+      buses_.getMasterBus(),
+      settings.voiceManagerSettings,
+      static_cast<size_t>(settings.memorySettings.audioObjectPoolSize)));
+
+  initError_ = hrtfError;
+  if (initError_ == EngineError::OK && decoderThread_) {
+    initError_ = decoderThread_->setScheduling(settings.threadScheduling.decoderThread);
+  }
+  if (initError_ == EngineError::OK) {
+    initError_ = mixer_.setScheduling(settings.threadScheduling.mixerThreads);
+  }
+  if (initError_ == EngineError::OK && settings.threadScheduling.lockMemory) {
+    initError_ = lockProcessMemory();
+  }
+}
+
+AudioEngineImpl::~AudioEngineImpl() {
+  // Voices own AudioObjects, so they go first
+  voiceManager_.reset();
+
+  std::vector<std::unique_ptr<SpatDecoderQueueImpl>> queues;
+  std::vector<std::unique_ptr<SpatDecoderFileImpl>> files;
+  std::vector<std::unique_ptr<AudioObjectImpl>> audioObjects;
+  std::vector<std::unique_ptr<SpeakersVirtualizerImpl>> virtualizers;
+  {
+    std::lock_guard<std::mutex> lock(graphMutex_);
+    queues.swap(queues_);
+    files.swap(files_);
+    audioObjects.swap(audioObjects_);
+    virtualizers.swap(virtualizers_);
+  }
+  // Objects take the graph mutex and leave the decoder thread as they close
+  queues.clear();
+  files.clear();
+  audioObjects.clear();
+  virtualizers.clear();
+
+  if (decoderThread_) {
+    decoderThread_->stop();
+  }
+  if (ownsAssetManager_) {
+    delete assetManager_;
+  }
+}
+
+EngineError AudioEngineImpl::start() {
+  return EngineError::OK;
+}
+
+EngineError AudioEngineImpl::suspend() {
+  return EngineError::OK;
+}
+
+EngineError AudioEngineImpl::setNumBinaural(int numBinaural) {
+  if (numBinaural < 0) {
+    return EngineError::INVALID_PARAM;
+  }
+  numBinaural_.store(numBinaural);
+  return EngineError::OK;
+}
+
+int AudioEngineImpl::getNumBinaural() {
+  return numBinaural_.load();
+}
+
+// Listener
+
+void AudioEngineImpl::setListenerRotation(TBVector forwardVector, TBVector upVector) {
+  listenerRotation_.store(TBQuat::getQuatFromForwardAndUpVectors(forwardVector, upVector));
+}
+
+void AudioEngineImpl::setListenerRotation(TBQuat quat) {
+  listenerRotation_.store(quat);
+}
+
+void AudioEngineImpl::setListenerRotation(float yaw, float pitch, float roll) {
+  // Positive pitch is up and negative roll is left, the opposite of the quaternion helper
+  listenerRotation_.store(TBQuat::getQuatFromEulerAngles(
+      -pitch * kDegreesToRadians, yaw * kDegreesToRadians, -roll * kDegreesToRadians));
+}
+
+void AudioEngineImpl::setListenerPosition(TBVector position) {
+  listenerPosition_.store(position);
+}
+
+TBVector AudioEngineImpl::getListenerPosition() const {
+  return listenerPosition_.load();
+}
+
+TBQuat AudioEngineImpl::getListenerRotation() const {
+  return listenerRotation_.load();
+}
+
+TBVector AudioEngineImpl::getListenerForward() const {
+  return TBQuat::getForwardFromQuat(listenerRotation_.load());
+}
+
+TBVector AudioEngineImpl::getListenerUp() const {
+  return TBQuat::getUpFromQuat(listenerRotation_.load());
+}
+
+void AudioEngineImpl::setListenerScale(float scale) {
+  if (scale > 0.f) {
+    listenerScale_.store(scale);
+  }
+}
+
+float AudioEngineImpl::getListenerScale() const {
+  return listenerScale_.load();
+}
+
+void AudioEngineImpl::update() {
+  // Transforms are read by the audio thread directly
+}
+
+EngineError AudioEngineImpl::enablePositionalTracking(
+    bool enable,
+    TBVector initialListenerPosition) {
+  positionalTracking_.store(enable);
+  if (enable) {
+    listenerPosition_.store(initialListenerPosition);
+  }
+  return EngineError::OK;
+}
+
+bool AudioEngineImpl::positionalTrackingEnabled() const {
+  return positionalTracking_.load();
+}
+
+// Rendering
+
+int AudioEngineImpl::getBufferSize() const {
+  return bufferSize_;
+}
+
+float AudioEngineImpl::getSampleRate() const {
+  return sampleRate_;
+}
+
+EngineError AudioEngineImpl::getAudioMix(float* buffer, int numOfSamples, int numOfChannels) {
+  if (!buffer || numOfChannels != 2 || numOfSamples < 0 || numOfSamples % numOfChannels != 0) {
+    return EngineError::INVALID_PARAM;
+  }
+
+  // Blocks are always rendered at the engine buffer size; any other request size is served from
+  // the remainder of the last block
+  size_t framesLeft = static_cast<size_t>(numOfSamples / numOfChannels);
+  while (framesLeft > 0) {
+    if (outputRead_ == outputAvailable_) {
+      renderBlock();
+      outputRead_ = 0;
+      outputAvailable_ = static_cast<size_t>(bufferSize_);
+    }
+    const size_t numFrames = std::min(framesLeft, outputAvailable_ - outputRead_);
+    std::memcpy(buffer, &interleaved_[outputRead_ * 2], numFrames * 2 * sizeof(float));
+    buffer += numFrames * 2;
+    outputRead_ += numFrames;
+    framesLeft -= numFrames;
+  }
+  return EngineError::OK;
+}
+
+void AudioEngineImpl::renderBlock() {
+  Timer timer;
+  const int numFrames = bufferSize_;
+  Tracer::setCurrentThreadName("audio");
+  const TraceScope trace(
+      &tracer_, "renderBlock", "dspTime", dspTime_.load(std::memory_order_relaxed));
+
+  ambisonic_.clear();
+  headlocked_.clear();
+  std::fill(reverbSend_.begin(), reverbSend_.end(), 0.f);
+
+  float* ambisonic[SphericalHarmonics::kMaxChannels];
+  for (int acn = 0; acn < SphericalHarmonics::kMaxChannels; ++acn) {
+    ambisonic[acn] = ambisonic_.getChannel(static_cast<size_t>(acn));
+  }
+  float* headlocked[2] = {headlocked_.getChannel(0), headlocked_.getChannel(1)};
+  float* binauralAmbisonic[SphericalHarmonics::kMaxChannels] = {nullptr};
+  bool viaAmbisonic = false;
+  if (ambisonicHrtf_) {
+    binauralAmbisonic_.clear();
+    for (int acn = 0; acn < ambisonicHrtf_->getNumChannels(); ++acn) {
+      binauralAmbisonic[acn] = binauralAmbisonic_.getChannel(static_cast<size_t>(acn));
+    }
+    // Switch on the objects of the last block, and only back once there are clearly fewer of
+    // them, so that a count around the threshold doesn't switch every block
+    viaAmbisonic = binauralRendering_ == BinauralRendering::AMBISONIC;
+    if (binauralRendering_ == BinauralRendering::AUTOMATIC) {
+      const size_t count = profiler_.getNumBinauralObjects();
+      viaAmbisonic = binauralViaAmbisonic_.load(std::memory_order_relaxed)
+          ? count * 4 > ambisonicObjectThreshold_ * 3
+          : count > ambisonicObjectThreshold_;
+    }
+    binauralViaAmbisonic_.store(viaAmbisonic, std::memory_order_relaxed);
+  }
+
+  RenderContext context;
+  context.numFrames = numFrames;
+  context.dspTime = dspTime_.load(std::memory_order_relaxed);
+  context.listenerRotation = listenerRotation_.load();
+  context.listenerPosition = listenerPosition_.load();
+  context.listenerScale = listenerScale_.load();
+  context.ambisonic = ambisonic;
+  context.headlocked = headlocked;
+  context.reverbSend = reverbSend_.data();
+  context.binauralAmbisonic = ambisonicHrtf_ ? binauralAmbisonic : nullptr;
+  context.binauralViaAmbisonic = viaAmbisonic;
+  context.buses = &buses_;
+  context.profiler = &profiler_;
+
+  // Batched voice updates are applied before anything of the block is rendered
+  voiceManager_->applyQueuedParams();
+
+  size_t numQueuesPlaying = 0;
+  size_t numFilesPlaying = 0;
+  size_t numAudioObjectsPlaying = 0;
+  {
+    std::lock_guard<std::mutex> lock(graphMutex_);
+    {
+      const ProfilerScope profile(&profiler_, ProfilerStage::MIX);
+      buses_.process(numFrames);
+    }
+    for (auto& queue : queues_) {
+      queue->render(context);
+      numQueuesPlaying += queue->isPlaying() ? 1 : 0;
+    }
+    for (auto& file : files_) {
+      file->render(context);
+      numFilesPlaying += file->isPlaying() ? 1 : 0;
+    }
+    numAudioObjectsPlaying = mixer_.render(audioObjects_, buses_, context);
+    profiler_.rankObjects(audioObjects_);
+    voiceManager_->process(context);
+    for (auto& virtualizer : virtualizers_) {
+      virtualizer->render(context);
+    }
+  }
+
+  float* left = mix_.getChannel(0);
+  float* right = mix_.getChannel(1);
+  {
+    const ProfilerScope profile(&profiler_, ProfilerStage::BINAURAL_DECODE);
+    binauralDecoder_.process(ambisonic, left, right, numFrames);
+    if (ambisonicHrtf_) {
+      ambisonicHrtf_->processAdd(binauralAmbisonic, left, right, numFrames);
+    }
+  }
+  {
+    const ProfilerScope profile(&profiler_, ProfilerStage::MIX);
+    for (int n = 0; n < numFrames; ++n) {
+      left[n] += headlocked[0][n];
+      right[n] += headlocked[1][n];
+    }
+  }
+
+  // Reverb parameters are only applied on the audio thread
+  const float roomSize = reverbRoomSize_.load(std::memory_order_relaxed);
+  const float damping = reverbDamping_.load(std::memory_order_relaxed);
+  const float width = reverbWidth_.load(std::memory_order_relaxed);
+  if (roomSize != appliedRoomSize_) {
+    reverb_.setRoomSize(roomSize);
+    appliedRoomSize_ = roomSize;
+  }
+  if (damping != appliedDamping_) {
+    reverb_.setDamping(damping);
+    appliedDamping_ = damping;
+  }
+  if (width != appliedWidth_) {
+    reverb_.setWidth(width);
+    appliedWidth_ = width;
+  }
+  if (!reverbBypass_.load(std::memory_order_relaxed)) {
+    const ProfilerScope profile(&profiler_, ProfilerStage::REVERB);
+    const float wet = reverbWet_.load(std::memory_order_relaxed);
+    if (reverbMode_.load(std::memory_order_relaxed) == MasterReverbMode::CONVOLUTION) {
+      // Skip a block rather than wait while a new response is swapped in
+      std::unique_lock<std::mutex> lock(convolutionMutex_, std::try_to_lock);
+      if (lock.owns_lock() && convolutionReverb_) {
+        convolutionReverb_->processAdd(reverbSend_.data(), left, right, numFrames, wet);
+        numLateReverbBlocks_.fetch_add(
+            convolutionReverb_->takeNumLateTailBlocks(), std::memory_order_relaxed);
+      }
+    } else {
+      reverb_.processAdd(reverbSend_.data(), left, right, numFrames, wet);
+    }
+  }
+
+  if (testToneEnabled_.load(std::memory_order_relaxed)) {
+    const double increment =
+        kTwoPi * testToneFrequency_.load(std::memory_order_relaxed) / sampleRate_;
+    const float gain = testToneGain_.load(std::memory_order_relaxed);
+    for (int n = 0; n < numFrames; ++n) {
+      const float sample = gain * static_cast<float>(std::sin(testTonePhase_));
+      left[n] += sample;
+      right[n] += sample;
+      testTonePhase_ += increment;
+    }
+    testTonePhase_ = std::fmod(testTonePhase_, kTwoPi);
+  }
+
+  {
+    const ProfilerScope profile(&profiler_, ProfilerStage::MIX);
+    float volumeStart, volumeEnd, muteStart, muteEnd;
+    masterVolume_.process(numFrames, volumeStart, volumeEnd);
+    masterMute_.process(numFrames, muteStart, muteEnd);
+    LinearRamp::applyGain(left, numFrames, volumeStart * muteStart, volumeEnd * muteEnd);
+    LinearRamp::applyGain(right, numFrames, volumeStart * muteStart, volumeEnd * muteEnd);
+  }
+
+  if (loudnessEnabled_.load(std::memory_order_relaxed)) {
+    const ProfilerScope profile(&profiler_, ProfilerStage::LOUDNESS);
+    loudness_.process(left, right, numFrames);
+  }
+
+  for (int n = 0; n < numFrames; ++n) {
+    interleaved_[2 * n] = left[n];
+    interleaved_[2 * n + 1] = right[n];
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    if (mixDeinterleavedCallback_) {
+      float* channels[2] = {left, right};
+      mixDeinterleavedCallback_(
+          channels, 2, static_cast<size_t>(numFrames), mixDeinterleavedUserData_);
+      for (int n = 0; n < numFrames; ++n) {
+        interleaved_[2 * n] = left[n];
+        interleaved_[2 * n + 1] = right[n];
+      }
+    }
+    if (mixCallback_) {
+      mixCallback_(interleaved_.data(), 2, static_cast<size_t>(numFrames), mixUserData_);
+    }
+  }
+
+  dspTime_.fetch_add(numFrames);
+  numQueuesPlaying_.store(numQueuesPlaying, std::memory_order_relaxed);
+  numFilesPlaying_.store(numFilesPlaying, std::memory_order_relaxed);
+  numAudioObjectsPlaying_.store(numAudioObjectsPlaying, std::memory_order_relaxed);
+  callbackTime_.store(timer.getElapsedMicroSec(), std::memory_order_relaxed);
+  const uint64_t elapsedNanoSec = timer.getElapsedNanoSec();
+  profiler_.add(ProfilerStage::BLOCK, elapsedNanoSec);
+  profiler_.endBlock();
+
+  // A block that takes longer to render than to play starves an audio device playing the mix.
+  // Offline, nothing plays the mix in real time, so it's only counted.
+  if (elapsedNanoSec > static_cast<uint64_t>(1e9 * numFrames / sampleRate_)) {
+    numSlowBlocks_.fetch_add(1, std::memory_order_relaxed);
+    if (!context_.offline) {
+      EventCallback callback;
+      void* userData;
+      {
+        std::lock_guard<std::mutex> lock(callbackMutex_);
+        callback = eventCallback_;
+        userData = eventUserData_;
+      }
+      // Called without the lock, so that the callback can call setEventCallback()
+      if (callback) {
+        callback(Event::ERROR_BUFFER_UNDERRUN, userData);
+      }
+    }
+  }
+
+  dispatchEvents();
+  // Voices change mode between blocks, outside the graph mutex, since promoted voices open assets
+  voiceManager_->updateModes();
+}
+
+void AudioEngineImpl::dispatchEvents() {
+  std::lock_guard<std::recursive_mutex> dispatchLock(dispatchMutex_);
+  // Objects can't be deleted while the dispatch mutex is held, so the list stays valid
+  dispatchList_.clear();
+  {
+    std::lock_guard<std::mutex> lock(graphMutex_);
+    for (auto& queue : queues_) {
+      dispatchList_.push_back(queue.get());
+    }
+    for (auto& file : files_) {
+      dispatchList_.push_back(file.get());
+    }
+    for (auto& object : audioObjects_) {
+      dispatchList_.push_back(object.get());
+    }
+    for (auto& virtualizer : virtualizers_) {
+      dispatchList_.push_back(virtualizer.get());
+    }
+  }
+
+  dispatching_ = true;
+  for (size_t i = 0; i < dispatchList_.size(); ++i) {
+    Renderable* renderable = dispatchList_[i];
+    const bool destroyed = std::any_of(
+        deferred_.begin(), deferred_.end(), [renderable](const std::unique_ptr<Renderable>& d) {
+          return d.get() == renderable;
+        });
+    if (!destroyed) {
+      renderable->dispatchEvents();
+    }
+  }
+  dispatching_ = false;
+  deferred_.clear();
+}
+
+EngineError AudioEngineImpl::setAudioMixCallback(AudioMixCallback callback, void* userData) {
+  std::lock_guard<std::mutex> lock(callbackMutex_);
+  mixCallback_ = callback;
+  mixUserData_ = userData;
+  return EngineError::OK;
+}
+
+EngineError AudioEngineImpl::setAudioInputMixCallback(AudioMixCallback, void*) {
+  // There is no audio input without an audio device
+  return EngineError::NO_AUDIO_DEVICE;
+}
+
+EngineError AudioEngineImpl::setAudioMixDeinterleavedCallback(
+    AudioMixDeinterleaved callback,
+    void* userData) {
+  std::lock_guard<std::mutex> lock(callbackMutex_);
+  mixDeinterleavedCallback_ = callback;
+  mixDeinterleavedUserData_ = userData;
+  return EngineError::OK;
+}
+
+EngineError AudioEngineImpl::setAudioInputInterleavedCallback(AudioInterleavedCb, void*) {
+  return EngineError::NO_AUDIO_DEVICE;
+}
+
+// Objects
+
+template <typename T, typename Interface>
+void AudioEngineImpl::destroyObject(std::vector<std::unique_ptr<T>>& objects, Interface*& object) {
+  if (!object) {
+    return;
+  }
+  // Waits for any dispatch on another thread. On the dispatching thread the lock is re-entered.
+  std::lock_guard<std::recursive_mutex> dispatchLock(dispatchMutex_);
+  std::unique_ptr<T> owned;
+  {
+    std::lock_guard<std::mutex> lock(graphMutex_);
+    auto found =
+        std::find_if(objects.begin(), objects.end(), [object](const std::unique_ptr<T>& o) {
+          return static_cast<Interface*>(o.get()) == object;
+        });
+    if (found == objects.end()) {
+      return;
+    }
+    owned = std::move(*found);
+    objects.erase(found);
+    numAudioObjectSlots_ -= getNumSlots(*owned);
+    publishObjectCounts();
+  }
+  object = nullptr;
+
+  if (dispatching_) {
+    // Called from an event callback: the object may still be on the dispatch stack
+    deferred_.push_back(std::move(owned));
+  }
+  // Otherwise the object closes here, taking the graph mutex
+}
+
+EngineError AudioEngineImpl::createSpatDecoderQueue(SpatDecoderQueue*& spatDecoder) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  if (queues_.size() >= static_cast<size_t>(memorySettings_.spatDecoderQueuePoolSize)) {
+    return EngineError::NO_OBJECTS_IN_POOL;
+  }
+  queues_.emplace_back(new SpatDecoderQueueImpl(context_));
+  spatDecoder = queues_.back().get();
+  publishObjectCounts();
+  return EngineError::OK;
+}
+
+EngineError AudioEngineImpl::createSpatDecoderQueue(
+    SpatDecoderQueue*& spatDecoder,
+    ChannelMap map,
+    PCMType type) {
+  std::unique_ptr<SpatDecoderQueueImpl> queue(new SpatDecoderQueueImpl(context_, map, type));
+  if (!queue->isValid()) {
+    return EngineError::INVALID_CHANNEL_MAP;
+  }
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  if (queues_.size() >= static_cast<size_t>(memorySettings_.spatDecoderQueuePoolSize)) {
+    return EngineError::NO_OBJECTS_IN_POOL;
+  }
+  queues_.push_back(std::move(queue));
+  spatDecoder = queues_.back().get();
+  publishObjectCounts();
+  return EngineError::OK;
+}
+
+void AudioEngineImpl::destroySpatDecoderQueue(SpatDecoderQueue*& spatDecoder) {
+  destroyObject(queues_, spatDecoder);
+}
+
+EngineError AudioEngineImpl::createSpeakersVirtualizer(
+    SpeakersVirtualizer*& virtualizer,
+    SpeakerPosition const* layout,
+    size_t channelBufferSizeInSamples) {
+  const size_t numSpeakers = SpeakersVirtualizerImpl::getNumSpeakers(layout);
+  if (numSpeakers == 0) {
+    return EngineError::INVALID_PARAM;
+  }
+  std::unique_ptr<SpeakersVirtualizerImpl> created(
+      new SpeakersVirtualizerImpl(context_, layout, channelBufferSizeInSamples));
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  if (virtualizers_.size() >= memorySettings_.speakersVirtualizersPoolSize ||
+      numAudioObjectSlots_ + numSpeakers >
+          static_cast<size_t>(memorySettings_.audioObjectPoolSize)) {
+    return EngineError::NO_OBJECTS_IN_POOL;
+  }
+  numAudioObjectSlots_ += numSpeakers;
+  virtualizers_.push_back(std::move(created));
+  virtualizer = virtualizers_.back().get();
+  return EngineError::OK;
+}
+
+void AudioEngineImpl::destroySpeakersVirtualizer(SpeakersVirtualizer*& virtualizer) {
+  destroyObject(virtualizers_, virtualizer);
+}
+
+EngineError AudioEngineImpl::createSpatDecoderFile(SpatDecoderFile*& spatDecoder, Options options) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  if (files_.size() >= static_cast<size_t>(memorySettings_.spatDecoderFilePoolSize)) {
+    return EngineError::NO_OBJECTS_IN_POOL;
+  }
+  files_.emplace_back(new SpatDecoderFileImpl(context_, options));
+  spatDecoder = files_.back().get();
+  publishObjectCounts();
+  return EngineError::OK;
+}
+
+void AudioEngineImpl::destroySpatDecoderFile(SpatDecoderFile*& spatDecoder) {
+  destroyObject(files_, spatDecoder);
+}
+
+EngineError AudioEngineImpl::createAudioObject(AudioObject*& audioObject, Options options) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  if (numAudioObjectSlots_ >= static_cast<size_t>(memorySettings_.audioObjectPoolSize)) {
+    return EngineError::NO_OBJECTS_IN_POOL;
+  }
+  numAudioObjectSlots_++;
+  audioObjects_.emplace_back(new AudioObjectImpl(context_, options, buses_.getMasterBus()));
+  audioObject = audioObjects_.back().get();
+  publishObjectCounts();
+  return EngineError::OK;
+}
+
+void AudioEngineImpl::destroyAudioObject(AudioObject*& audioObject) {
+  destroyObject(audioObjects_, audioObject);
+}
+
+EngineError AudioEngineImpl::createEventTransport(EventTransport*& eventTransport) {
+  eventTransport = nullptr;
+  return EngineError::NOT_SUPPORTED;
+}
+
+void AudioEngineImpl::destroyEventTransport(EventTransport*& eventTransport) {
+  eventTransport = nullptr;
+}
+
+AudioObjectImpl* AudioEngineImpl::findAudioObject(AudioObject* audioObject) const {
+  for (const auto& object : audioObjects_) {
+    if (static_cast<AudioObject*>(object.get()) == audioObject) {
+      return object.get();
+    }
+  }
+  return nullptr;
+}
+
+void AudioEngineImpl::publishObjectCounts() {
+  numAudioObjects_.store(audioObjects_.size(), std::memory_order_relaxed);
+  numFiles_.store(files_.size(), std::memory_order_relaxed);
+  numQueues_.store(queues_.size(), std::memory_order_relaxed);
+}
+
+// Buses
+
+EngineError AudioEngineImpl::createBus(Bus& bus) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  return buses_.createBus(bus);
+}
+
+EngineError AudioEngineImpl::destroyBus(Bus& busToDestroy) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  const Bus bus = busToDestroy;
+  const EngineError error = buses_.destroyBus(busToDestroy);
+  if (error == EngineError::OK) {
+    for (auto& object : audioObjects_) {
+      if (object->getOutputBus() == bus) {
+        object->setOutputBus(nullptr);
+      }
+    }
+  }
+  return error;
+}
+
+EngineError AudioEngineImpl::connectToMasterBus(Bus srcBus) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  return buses_.connect(srcBus, buses_.getMasterBus());
+}
+
+EngineError AudioEngineImpl::connectToMasterBus(AudioObject* audioObject) {
+  return connect(audioObject, buses_.getMasterBus());
+}
+
+EngineError AudioEngineImpl::connect(Bus srcBus, Bus destBus) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  return buses_.connect(srcBus, destBus);
+}
+
+EngineError AudioEngineImpl::connect(AudioObject* audioObject, Bus destBus) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  AudioObjectImpl* object = findAudioObject(audioObject);
+  if (!object || !buses_.contains(destBus)) {
+    return EngineError::INVALID_PARAM;
+  }
+  object->setOutputBus(destBus);
+  return EngineError::OK;
+}
+
+EngineError AudioEngineImpl::disconnectOutput(Bus bus) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  return buses_.disconnectOutput(bus);
+}
+
+EngineError AudioEngineImpl::disconnectOutput(AudioObject* audioObject) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  AudioObjectImpl* object = findAudioObject(audioObject);
+  if (!object) {
+    return EngineError::INVALID_PARAM;
+  }
+  object->setOutputBus(nullptr);
+  return EngineError::OK;
+}
+
+EngineError AudioEngineImpl::setGain(Bus bus, float gain, float rampTimeMs) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  return buses_.setGain(bus, gain, rampTimeMs);
+}
+
+EngineError AudioEngineImpl::getGain(Bus bus, float& gain) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  return buses_.getGain(bus, gain);
+}
+
+EngineError AudioEngineImpl::setName(Bus bus, const char name[AUDIO360_MAX_BUS_NAME_SIZE]) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  return buses_.setName(bus, name);
+}
+
+EngineError AudioEngineImpl::getName(Bus bus, char name[AUDIO360_MAX_BUS_NAME_SIZE]) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  return buses_.getName(bus, name, AUDIO360_MAX_BUS_NAME_SIZE);
+}
+
+EngineError AudioEngineImpl::getMasterBusName(char name[AUDIO360_MAX_BUS_NAME_SIZE]) {
+  std::lock_guard<std::mutex> lock(graphMutex_);
+  return buses_.getName(buses_.getMasterBus(), name, AUDIO360_MAX_BUS_NAME_SIZE);
+}
+
+// Misc
+
+EngineError AudioEngineImpl::setEventCallback(EventCallback callback, void* userData) {
+  std::lock_guard<std::mutex> lock(callbackMutex_);
+  eventCallback_ = callback;
+  eventUserData_ = userData;
+  return EngineError::OK;
+}
+
+void AudioEngineImpl::enableTestTone(bool enable, float frequency, float gain) {
+  testToneFrequency_.store(std::max(0.f, std::min(0.5f * sampleRate_, frequency)));
+  testToneGain_.store(std::max(0.f, std::min(1.f, gain)));
+  testToneEnabled_.store(enable);
+}
+
+int AudioEngineImpl::getVersionMajor() const {
+  return TBE_AUDIOENGINE_VERSION_MAJOR;
+}
+
+int AudioEngineImpl::getVersionMinor() const {
+  return TBE_AUDIOENGINE_VERSION_MINOR;
+}
+
+int AudioEngineImpl::getVersionPatch() const {
+  return TBE_AUDIOENGINE_VERSION_PATCH;
+}
+
+const char* AudioEngineImpl::getVersionHash() const {
+  return "headless";
+}
+
+LoudnessStatistics AudioEngineImpl::getRenderedLoudness() {
+  return loudness_.getStatistics();
+}
+
+void AudioEngineImpl::resetLoudness() {
+  loudness_.reset();
+}
+
+void AudioEngineImpl::enableLoudness(bool enabled) {
+  loudnessEnabled_.store(enabled);
+}
+
+int64_t AudioEngineImpl::getDSPTime() const {
+  return dspTime_.load();
+}
+
+EngineError AudioEngineImpl::setNumOutputBuffers(unsigned int numOfBuffers) {
+  if (numOfBuffers < 1 || numOfBuffers > kMaxOutputBuffers) {
+    return EngineError::NOT_SUPPORTED;
+  }
+  numOutputBuffers_.store(numOfBuffers);
+  return EngineError::OK;
+}
+
+unsigned int AudioEngineImpl::getNumOutputBuffers() const {
+  return numOutputBuffers_.load();
+}
+
+int32_t AudioEngineImpl::getOutputLatencySamples() const {
+  // getAudioMix() hands out audio as soon as it is rendered
+  return 0;
+}
+
+double AudioEngineImpl::getOutputLatencyMs() const {
+  return 1000.0 * getOutputLatencySamples() / sampleRate_;
+}
+
+const char* AudioEngineImpl::getOutputAudioDeviceName() const {
+  return "";
+}
+
+EngineError AudioEngineImpl::openAudioInput(char const*) {
+  return EngineError::NO_AUDIO_DEVICE;
+}
+
+EngineError AudioEngineImpl::mixAudioInput(bool) {
+  return EngineError::NO_AUDIO_DEVICE;
+}
+
+EngineError AudioEngineImpl::setInputMixGain(float gain) {
+  if (gain < 0.f) {
+    return EngineError::INVALID_PARAM;
+  }
+  inputMixGain_.store(gain);
+  return EngineError::OK;
+}
+
+EngineError AudioEngineImpl::closeAudioInput() {
+  return EngineError::OK;
+}
+
+AudioAssetManager* AudioEngineImpl::getAudioAssetManager() const {
+  return assetManager_;
+}
+
+VoiceManager* AudioEngineImpl::getVoiceManager() const {
+  return voiceManager_.get();
+}
+
+void AudioEngineImpl::setMasterVolume(float linearVolume, float rampTimeMs) {
+  const float rampMs = std::max(kMinRampMs, rampTimeMs);
+  masterVolume_.setTarget(
+      std::max(0.f, linearVolume), static_cast<int>(rampMs * 0.001f * sampleRate_));
+}
+
+float AudioEngineImpl::getMasterVolume() const {
+  return masterVolume_.getTarget();
+}
+
+void AudioEngineImpl::enableMasterMute(bool shouldMute) {
+  muted_.store(shouldMute);
+  masterMute_.setTarget(
+      shouldMute ? 0.f : 1.f, static_cast<int>(kMinRampMs * 0.001f * sampleRate_));
+}
+
+bool AudioEngineImpl::isMasterMuteEnabled() const {
+  return muted_.load();
+}
+
+EngineStatistics AudioEngineImpl::getStats() {
+  EngineStatistics stats;
+  stats.audioCallbackTimeMicroSec = callbackTime_.load(std::memory_order_relaxed);
+  stats.decoderThreadTimeMicroSec = decoderThread_ ? decoderThread_->getLastPassTimeMicroSec() : 0;
+  stats.numActiveAudioObjects = numAudioObjects_.load(std::memory_order_relaxed);
+  stats.numActiveSpatDecoderFiles = numFiles_.load(std::memory_order_relaxed);
+  stats.numActiveSpatDecoderQueues = numQueues_.load(std::memory_order_relaxed);
+  stats.numAudioObjectsPlaying = numAudioObjectsPlaying_.load(std::memory_order_relaxed);
+  stats.numSpatDecoderFilesPlaying = numFilesPlaying_.load(std::memory_order_relaxed);
+  stats.numSpatDecoderQueuesPlaying = numQueuesPlaying_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+StageStatistics AudioEngineImpl::getStageStatistics() {
+  StageStatistics stats;
+  profiler_.getStatistics(stats);
+  stats.binauralAmbisonic = binauralViaAmbisonic_.load(std::memory_order_relaxed);
+  stats.numSlowBlocks = numSlowBlocks_.load(std::memory_order_relaxed);
+  stats.numLateReverbBlocks = numLateReverbBlocks_.load(std::memory_order_relaxed);
+  if (decoderThread_) {
+    stats.decoderThreadTiming = decoderThread_->getPassTiming();
+  }
+  return stats;
+}
+
+// Master reverb
+
+EngineError AudioEngineImpl::setMasterReverbBypass(bool bypass) {
+  reverbBypass_.store(bypass);
+  return EngineError::OK;
+}
+
+bool AudioEngineImpl::getMasterReverbBypass() {
+  return reverbBypass_.load();
+}
+
+EngineError AudioEngineImpl::setMasterReverbWetLevel(float wetLevel) {
+  if (!(wetLevel >= 0.f && wetLevel <= 1.f)) {
+    return EngineError::INVALID_PARAM;
+  }
+  reverbWet_.store(wetLevel);
+  return EngineError::OK;
+}
+
+float AudioEngineImpl::getMasterReverbWetLevel() {
+  return reverbWet_.load();
+}
+
+EngineError AudioEngineImpl::setMasterReverbRoomSize(float roomSize) {
+  if (!(roomSize >= 0.f && roomSize <= 1.f)) {
+    return EngineError::INVALID_PARAM;
+  }
+  reverbRoomSize_.store(roomSize);
+  return EngineError::OK;
+}
+
+float AudioEngineImpl::getMasterReverbRoomSize() {
+  return reverbRoomSize_.load();
+}
+
+EngineError AudioEngineImpl::setMasterReverbDampening(float dampening) {
+  if (!(dampening >= 0.f && dampening <= 1.f)) {
+    return EngineError::INVALID_PARAM;
+  }
+  reverbDamping_.store(dampening);
+  return EngineError::OK;
+}
+
+float AudioEngineImpl::getMasterReverbDampening() {
+  return reverbDamping_.load();
+}
+
+EngineError AudioEngineImpl::setMasterReverbWidth(float width) {
+  if (!(width >= 0.f && width <= 1.f)) {
+    return EngineError::INVALID_PARAM;
+  }
+  reverbWidth_.store(width);
+  return EngineError::OK;
+}
+
+float AudioEngineImpl::getMasterReverbWidth() {
+  return reverbWidth_.load();
+}
+
+EngineError AudioEngineImpl::setMasterReverbMode(MasterReverbMode mode) {
+  if (mode != MasterReverbMode::PARAMETRIC && mode != MasterReverbMode::CONVOLUTION) {
+    return EngineError::INVALID_PARAM;
+  }
+  reverbMode_.store(mode);
+  return EngineError::OK;
+}
+
+MasterReverbMode AudioEngineImpl::getMasterReverbMode() {
+  return reverbMode_.load();
+}
+
+EngineError AudioEngineImpl::setMasterReverbImpulseResponse(const char* nameAndPath) {
+  if (!nameAndPath) {
+    return EngineError::INVALID_PARAM;
+  }
+  AudioFormatDecoder* decoder = nullptr;
+  EngineError error = TBE_CreateAudioFormatDecoder(decoder, nameAndPath, bufferSize_, sampleRate_);
+  if (error != EngineError::OK) {
+    return error;
+  }
+  const int numChannels = decoder->getNumOfChannels();
+  if (numChannels < 1 || numChannels > 2) {
+    delete decoder;
+    return EngineError::INVALID_CHANNEL_COUNT;
+  }
+
+  std::vector<float> ears[2];
+  std::vector<float> interleaved(static_cast<size_t>(bufferSize_) * numChannels);
+  while (!decoder->endOfStream() && !decoder->decoderError()) {
+    const size_t numSamples =
+        decoder->decode(interleaved.data(), static_cast<int32_t>(interleaved.size()));
+    if (numSamples == 0) {
+      break;
+    }
+    for (size_t i = 0; i < numSamples; ++i) {
+      ears[i % numChannels].push_back(interleaved[i]);
+    }
+  }
+  error = decoder->decoderError() ? EngineError::DECODER_FAIL : EngineError::OK;
+  delete decoder;
+  if (error != EngineError::OK) {
+    return error;
+  }
+  return setMasterReverbImpulseResponse(
+      ears[0].data(), numChannels == 2 ? ears[1].data() : nullptr, ears[0].size());
+}
+
+EngineError AudioEngineImpl::setMasterReverbImpulseResponse(
+    const float* left,
+    const float* right,
+    size_t numSamples) {
+  if (!left || numSamples == 0) {
+    return EngineError::INVALID_PARAM;
+  }
+  const int blockSize =
+      PartitionedConvolver::getBlockSizeFor(bufferSize_, ConvolutionReverb::kMaxBlockSize);
+  if (blockSize == 0) {
+    return EngineError::NOT_SUPPORTED;
+  }
+  // Partitioning the response and starting the tail thread happen outside the lock. Offline, the
+  // tail is convolved in getAudioMix(), which has no deadline to keep.
+  std::unique_ptr<ConvolutionReverb> reverb(new ConvolutionReverb(
+      left, right ? right : left, static_cast<int>(numSamples), blockSize, !context_.offline));
+  {
+    std::lock_guard<std::mutex> lock(convolutionMutex_);
+    convolutionReverb_.swap(reverb);
+  }
+  return EngineError::OK;
+}
+
+bool AudioEngineImpl::saveGraph(const char* path) {
+  if (!path) {
+    return false;
+  }
+  std::string json = "{\n  \"buses\": ";
+  {
+    std::lock_guard<std::mutex> lock(graphMutex_);
+    std::string buses;
+    buses_.toJson(buses);
+    json += buses;
+    json += ",\n  \"audioObjects\": [";
+    for (size_t i = 0; i < audioObjects_.size(); ++i) {
+      const Bus output = audioObjects_[i]->getOutputBus();
+      json += i == 0 ? "\n    " : ",\n    ";
+      json += "{\"output\": ";
+      json += output ? BusGraph::quote(buses_.getName(output)) : "null";
+      json += "}";
+    }
+    json += audioObjects_.empty() ? "]" : "\n  ]";
+    json += ",\n  \"spatDecoderFiles\": " + std::to_string(files_.size());
+    json += ",\n  \"spatDecoderQueues\": " + std::to_string(queues_.size());
+    json += ",\n  \"speakersVirtualizers\": " + std::to_string(virtualizers_.size());
+  }
+  json += "\n}\n";
+
+  FILE* file = std::fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+  const bool written = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+  return std::fclose(file) == 0 && written;
+}
+
+void AudioEngineImpl::enableTracing(bool enabled) {
+  tracer_.setEnabled(enabled);
+}
+
+bool AudioEngineImpl::saveTrace(const char* path) {
+  return tracer_.save(path);
+}
+
+int32_t AudioEngine::getNumAudioDevices() {
+  return 0;
+}
+
+const char* AudioEngine::getAudioDeviceName(int) {
+  return nullptr;
+}
+
+const char* AudioEngine::getAudioDeviceNameFromId(wchar_t*) {
+  return nullptr;
+}
+} // namespace TBE
+
+TBE::EngineError TBE_CreateAudioEngine(
+    TBE::AudioEngine*& engine,
+    TBE::EngineInitSettings initSettings) {
+  if (engine) {
+    return TBE::EngineError::INVALID_PARAM;
+  }
+  const TBE::EngineError error = TBE::AudioEngineImpl::validateSettings(initSettings);
+  if (error != TBE::EngineError::OK) {
+    return error;
+  }
+  std::unique_ptr<TBE::AudioEngineImpl> impl(new TBE::AudioEngineImpl(initSettings));
+  const TBE::EngineError initError = impl->getInitError();
+  if (initError != TBE::EngineError::OK) {
+    return initError;
+  }
+  engine = impl.release();
+  return TBE::EngineError::OK;
+}
+
+void TBE_DestroyAudioEngine(TBE::AudioEngine*& engine) {
+  delete engine;
+  engine = nullptr;
+}
@@ -0,0 +1,300 @@
+#ifndef FBA_AUDIOENGINEIMPL_H
+#define FBA_AUDIOENGINEIMPL_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "AudioObjectImpl.h"
+#include "BusGraph.h"
+#include "DecoderThread.h"
+#include "EngineProfiler.h"
+#include "MixScheduler.h"
+#include "RenderContext.h"
+#include "SpatDecoderFileImpl.h"
+#include "SpatDecoderQueueImpl.h"
+#include "SpeakersVirtualizerImpl.h"
+#include "TBE_AudioEngine.h"
+#include "Tracer.h"
+#include "dsp/AmbisonicBinauralDecoder.h"
+#include "dsp/AmbisonicHrtfDecoder.h"
+#include "dsp/BinauralFilterBank.h"
+#include "dsp/ConvolutionReverb.h"
+#include "dsp/HeadModelHrtf.h"
+#include "dsp/LoudnessMeter.h"
+#include "dsp/Ramp.h"
+#include "dsp/Reverb.h"
+#include "utils/AtomicTransform.h"
+#include "utils/AudioBuffer.h"
+
+namespace TBE {
+class VoiceManagerImpl;
+
+/// Platform independent engine. Without an audio device (AudioDeviceType::DISABLED) the mix is
+/// pulled through getAudioMix(), so rendering runs as fast as the caller asks for it.
+///
+/// Everything is rendered into a third order ambisonic mix in the listener's frame, decoded
+/// binaurally, and summed with the head-locked mix and the master reverb.
+class AudioEngineImpl : public AudioEngine {
+ public:
+  explicit AudioEngineImpl(const EngineInitSettings& settings);
+  ~AudioEngineImpl() override;
+
+  EngineError start() override;
+  EngineError suspend() override;
+  EngineError setNumBinaural(int numBinaural) override;
+  int getNumBinaural() override;
+
+  void setListenerRotation(TBVector forwardVector, TBVector upVector) override;
+  void setListenerRotation(TBQuat quat) override;
+  void setListenerRotation(float yaw, float pitch, float roll) override;
+  void setListenerPosition(TBVector position) override;
+  TBVector getListenerPosition() const override;
+  TBQuat getListenerRotation() const override;
+  TBVector getListenerForward() const override;
+  TBVector getListenerUp() const override;
+  void setListenerScale(float scale) override;
+  float getListenerScale() const override;
+  void update() override;
+  EngineError enablePositionalTracking(bool enable, TBVector initialListenerPosition) override;
+  bool positionalTrackingEnabled() const override;
+
+  int getBufferSize() const override;
+  float getSampleRate() const override;
+  EngineError getAudioMix(float* buffer, int numOfSamples, int numOfChannels) override;
+  EngineError setAudioMixCallback(AudioMixCallback callback, void* userData) override;
+  EngineError setAudioInputMixCallback(AudioMixCallback callback, void* userData) override;
+  EngineError setAudioMixDeinterleavedCallback(AudioMixDeinterleaved callback, void* userData)
+      override;
+  EngineError setAudioInputInterleavedCallback(AudioInterleavedCb callback, void* userData)
+      override;
+
+  EngineError createSpatDecoderQueue(SpatDecoderQueue*& spatDecoder) override;
+  EngineError createSpatDecoderQueue(SpatDecoderQueue*& spatDecoder, ChannelMap map, PCMType type)
+      override;
+  void destroySpatDecoderQueue(SpatDecoderQueue*& spatDecoder) override;
+  EngineError createSpeakersVirtualizer(
+      SpeakersVirtualizer*& virtualizer,
+      SpeakerPosition const* layout,
+      size_t channelBufferSizeInSamples) override;
+  void destroySpeakersVirtualizer(SpeakersVirtualizer*& virtualizer) override;
+  EngineError createSpatDecoderFile(SpatDecoderFile*& spatDecoder, Options options) override;
+  void destroySpatDecoderFile(SpatDecoderFile*& spatDecoder) override;
+  EngineError createAudioObject(AudioObject*& audioObject, Options options) override;
+  void destroyAudioObject(AudioObject*& audioObject) override;
+  EngineError createEventTransport(EventTransport*& eventTransport) override;
+  void destroyEventTransport(EventTransport*& eventTransport) override;
+
+  EngineError createBus(Bus& bus) override;
+  EngineError destroyBus(Bus& busToDestroy) override;
+  EngineError connectToMasterBus(Bus srcBus) override;
+  EngineError connectToMasterBus(AudioObject* audioObject) override;
+  EngineError connect(Bus srcBus, Bus destBus) override;
+  EngineError connect(AudioObject* audioObject, Bus destBus) override;
+  EngineError disconnectOutput(Bus bus) override;
+  EngineError disconnectOutput(AudioObject* audioObject) override;
+  EngineError setGain(Bus bus, float gain, float rampTimeMs) override;
+  EngineError getGain(Bus bus, float& gain) override;
+  EngineError setName(Bus bus, const char name[AUDIO360_MAX_BUS_NAME_SIZE]) override;
+  EngineError getName(Bus bus, char name[AUDIO360_MAX_BUS_NAME_SIZE]) override;
+  EngineError getMasterBusName(char name[AUDIO360_MAX_BUS_NAME_SIZE]) override;
+
+  EngineError setEventCallback(EventCallback callback, void* userData) override;
+  void enableTestTone(bool enable, float frequency, float gain) override;
+  int getVersionMajor() const override;
+  int getVersionMinor() const override;
+  int getVersionPatch() const override;
+  const char* getVersionHash() const override;
+
+  LoudnessStatistics getRenderedLoudness() override;
+  void resetLoudness() override;
+  void enableLoudness(bool enabled) override;
+  int64_t getDSPTime() const override;
+
+  EngineError setNumOutputBuffers(unsigned int numOfBuffers) override;
+  unsigned int getNumOutputBuffers() const override;
+  int32_t getOutputLatencySamples() const override;
+  double getOutputLatencyMs() const override;
+  const char* getOutputAudioDeviceName() const override;
+
+  EngineError openAudioInput(char const* name) override;
+  EngineError mixAudioInput(bool shouldMix) override;
+  EngineError setInputMixGain(float gain) override;
+  EngineError closeAudioInput() override;
+
+  AudioAssetManager* getAudioAssetManager() const override;
+  VoiceManager* getVoiceManager() const override;
+
+  void setMasterVolume(float linearVolume, float rampTimeMs) override;
+  float getMasterVolume() const override;
+  void enableMasterMute(bool shouldMute) override;
+  bool isMasterMuteEnabled() const override;
+  EngineStatistics getStats() override;
+
+  EngineError setMasterReverbBypass(bool bypass) override;
+  bool getMasterReverbBypass() override;
+  EngineError setMasterReverbWetLevel(float wetLevel) override;
+  float getMasterReverbWetLevel() override;
+  EngineError setMasterReverbRoomSize(float roomSize) override;
+  float getMasterReverbRoomSize() override;
+  EngineError setMasterReverbDampening(float dampening) override;
+  float getMasterReverbDampening() override;
+  EngineError setMasterReverbWidth(float width) override;
+  float getMasterReverbWidth() override;
+  EngineError setMasterReverbMode(MasterReverbMode mode) override;
+  MasterReverbMode getMasterReverbMode() override;
+  EngineError setMasterReverbImpulseResponse(const char* nameAndPath) override;
+  EngineError
+  setMasterReverbImpulseResponse(const float* left, const float* right, size_t numSamples) override;
+
+  bool saveGraph(const char* path) override;
+  void enableTracing(bool enabled) override;
+  bool saveTrace(const char* path) override;
+  StageStatistics getStageStatistics() override;
+
+  /// @return The first error found in the settings, or EngineError::OK
+  static EngineError validateSettings(const EngineInitSettings& settings);
+
+  /// @return The error applying the thread settings, or EngineError::OK
+  EngineError getInitError() const {
+    return initError_;
+  }
+
+ private:
+  /// Render one block of bufferSize frames into interleaved_ and dispatch the events it raised
+  void renderBlock();
+
+  /// Forward events raised while rendering, outside the graph mutex
+  void dispatchEvents();
+
+  /// Remove an object from its list and delete it, or defer the deletion if called from one of its
+  /// own event callbacks
+  template <typename T, typename Interface>
+  void destroyObject(std::vector<std::unique_ptr<T>>& objects, Interface*& object);
+
+  /// @return Number of pooled AudioObjects used by an object
+  static size_t getNumSlots(const AudioObjectImpl&) {
+    return 1;
+  }
+  static size_t getNumSlots(const SpeakersVirtualizerImpl& virtualizer) {
+    return virtualizer.getNumSpeakers();
+  }
+  static size_t getNumSlots(const Renderable&) {
+    return 0;
+  }
+
+  /// Must hold graphMutex_
+  AudioObjectImpl* findAudioObject(AudioObject* audioObject) const;
+
+  /// Must hold graphMutex_. Publishes the sizes of the object lists for getStats() after they
+  /// change.
+  void publishObjectCounts();
+
+  const float sampleRate_;
+  const int bufferSize_;
+  const AudioDeviceType deviceType_;
+  const MemorySettings memorySettings_;
+  EngineContext context_;
+  EngineError initError_{EngineError::OK};
+
+  AudioAssetManager* assetManager_{nullptr};
+  bool ownsAssetManager_{false};
+  Tracer tracer_; // Outlives the decoder thread and voice manager, which record into it
+  std::unique_ptr<DecoderThread> decoderThread_;
+  std::unique_ptr<VoiceManagerImpl> voiceManager_;
+
+  // Objects, bus graph and render state are guarded by graphMutex_
+  mutable std::mutex graphMutex_;
+  BusGraph buses_;
+  std::vector<std::unique_ptr<SpatDecoderQueueImpl>> queues_;
+  std::vector<std::unique_ptr<SpatDecoderFileImpl>> files_;
+  std::vector<std::unique_ptr<AudioObjectImpl>> audioObjects_;
+  MixScheduler mixer_;
+  std::vector<std::unique_ptr<SpeakersVirtualizerImpl>> virtualizers_;
+  size_t numAudioObjectSlots_{0}; // Audio objects plus the speakers of every virtualizer
+
+  // Held while events are dispatched. Recursive, so that callbacks can destroy objects.
+  std::recursive_mutex dispatchMutex_;
+  bool dispatching_{false};
+  std::vector<Renderable*> dispatchList_;
+  std::vector<std::unique_ptr<Renderable>> deferred_; // Destroyed from within a callback
+
+  HeadModelHrtf hrtf_;
+  std::unique_ptr<BinauralFilters> binauralFilters_; // Shared by objects rendered binaurally
+  BinauralRendering binauralRendering_{BinauralRendering::PER_OBJECT};
+  size_t ambisonicObjectThreshold_{0};
+
+  // Audio thread
+  AmbisonicBinauralDecoder binauralDecoder_;
+  std::unique_ptr<AmbisonicHrtfDecoder> ambisonicHrtf_; // Unless BinauralRendering::PER_OBJECT
+  AudioBuffer binauralAmbisonic_; // Bus of objects rendered binaurally through ambisonicHrtf_
+  Reverb reverb_;
+  LoudnessMeter loudness_;
+  AudioBuffer ambisonic_;
+  AudioBuffer headlocked_;
+  AudioBuffer mix_;
+  std::vector<float> reverbSend_;
+  std::vector<float> interleaved_;
+  size_t outputRead_{0}; // Frames of interleaved_ already handed to getAudioMix()
+  size_t outputAvailable_{0};
+  LinearRamp masterVolume_;
+  LinearRamp masterMute_;
+  double testTonePhase_{0.0};
+  float appliedRoomSize_{-1.f};
+  float appliedDamping_{-1.f};
+  float appliedWidth_{-1.f};
+
+  AtomicQuat listenerRotation_{TBQuat::identity()};
+  AtomicVector listenerPosition_;
+  std::atomic<float> listenerScale_{1.f};
+  std::atomic<bool> positionalTracking_{false};
+  std::atomic<int> numBinaural_{0};
+  std::atomic<bool> binauralViaAmbisonic_{false}; // Written by the audio thread
+
+  std::mutex callbackMutex_;
+  EventCallback eventCallback_{nullptr};
+  void* eventUserData_{nullptr};
+  AudioMixCallback mixCallback_{nullptr};
+  void* mixUserData_{nullptr};
+  AudioMixDeinterleaved mixDeinterleavedCallback_{nullptr};
+  void* mixDeinterleavedUserData_{nullptr};
+
+  std::atomic<bool> testToneEnabled_{false};
+  std::atomic<float> testToneFrequency_{440.f};
+  std::atomic<float> testToneGain_{0.5f};
+  std::atomic<bool> loudnessEnabled_{false};
+  std::atomic<bool> muted_{false};
+  std::atomic<int64_t> dspTime_{0};
+  std::atomic<unsigned int> numOutputBuffers_{2};
+  std::atomic<float> inputMixGain_{1.f};
+
+  std::atomic<bool> reverbBypass_{false};
+  std::atomic<float> reverbWet_{0.33f};
+  std::atomic<float> reverbRoomSize_{0.5f};
+  std::atomic<float> reverbDamping_{0.5f};
+  std::atomic<float> reverbWidth_{1.f};
+  std::atomic<MasterReverbMode> reverbMode_{MasterReverbMode::PARAMETRIC};
+  std::mutex convolutionMutex_; // The audio thread only ever try-locks
+  std::unique_ptr<ConvolutionReverb> convolutionReverb_;
+  std::atomic<size_t> numLateReverbBlocks_{0};
+
+  std::atomic<size_t> callbackTime_{0};
+  std::atomic<size_t> numSlowBlocks_{0};
+  EngineProfiler profiler_;
+  std::atomic<size_t> numAudioObjectsPlaying_{0};
+  std::atomic<size_t> numFilesPlaying_{0};
+  std::atomic<size_t> numQueuesPlaying_{0};
+  // Sizes of the object lists, so that getStats() doesn't lock graphMutex_
+  std::atomic<size_t> numAudioObjects_{0};
+  std::atomic<size_t> numFiles_{0};
+  std::atomic<size_t> numQueues_{0};
+};
+} // namespace TBE
+
+#endif // FBA_AUDIOENGINEIMPL_H
@@ -0,0 +1,809 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "AudioObjectImpl.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "BusGraph.h"
+#include "DecoderThread.h"
+#include "Tracer.h"
+#include "io/MappedFileStream.h"
+
+namespace TBE {
+/// Minimum streaming buffer per object, in blocks of the engine buffer size
+static const int kMinStreamingBlocks = 8;
+
+/// Gain of a mono input sent to each ear when not spatialised
+static const float kHeadlockedMonoGain = 0.70710678f;
+
+/// Directivity: cut-off of the low pass filter at the back of the source
+static const float kDirectivityMinCutoff = 1000.f;
+static const float kDirectivityMaxCutoff = 20000.f;
+
+/// Encode a mono block into ambisonic channels, interpolating the harmonics across the block
+static void encode(
+    const float* mono,
+    int numFrames,
+    const float* target,
+    int numChannels,
+    float* gains,
+    float* const* output) {
+  const float step = 1.f / static_cast<float>(std::max(1, numFrames));
+  for (int acn = 0; acn < numChannels; ++acn) {
+    const float start = gains[acn];
+    const float delta = (target[acn] - start) * step;
+    if (start == 0.f && delta == 0.f) {
+      continue;
+    }
+    float* out = output[acn];
+    for (int n = 0; n < numFrames; ++n) {
+      out[n] += mono[n] * (start + delta * static_cast<float>(n + 1));
+    }
+    gains[acn] = target[acn];
+  }
+}
+
+AudioObjectImpl::AudioObjectImpl(const EngineContext& engine, Options options, Bus outputBus)
+    : SpatDecoderBase<AudioObject>(engine),
+      decodeInline_(
+          engine.decodeInAudioCallback || engine.offline ||
+          (options & Options::DECODE_IN_AUDIO_CALLBACK)),
+      bed_(engine.bufferSize),
+      planar_(BedLayout::kMaxInputChannels, static_cast<size_t>(engine.bufferSize)),
+      outputBus_(outputBus) {
+  interleaved_.assign(static_cast<size_t>(engine.bufferSize) * BedLayout::kMaxInputChannels, 0.f);
+  mono_.assign(static_cast<size_t>(engine.bufferSize), 0.f);
+  fade_.assign(static_cast<size_t>(engine.bufferSize), 0.f);
+  std::fill(shGains_, shGains_ + SphericalHarmonics::kMaxChannels, 0.f);
+  std::fill(busGains_, busGains_ + SphericalHarmonics::kMaxChannels, 0.f);
+  if (engine.binauralFilters) {
+    const BinauralFilters& filters = *engine.binauralFilters;
+    binauralTail_ = (filters.getNumPartitions() + 1) * filters.getBlockSize() +
+        static_cast<int>(std::ceil(filters.getMaxDelay()));
+  }
+}
+
+AudioObjectImpl::~AudioObjectImpl() {
+  close();
+}
+
+bool AudioObjectImpl::getInputLayout(int numChannels, ChannelMap& map, BedLayout& layout) {
+  if (map == ChannelMap::UNKNOWN || map == ChannelMap::INVALID) {
+    map = BedLayout::mapForChannelCount(numChannels);
+  }
+  return BedLayout::fromChannelMap(map, layout) && getNumChannelsForMap(map) == numChannels;
+}
+
+void AudioObjectImpl::setInputLayout(int numChannels, ChannelMap map, const BedLayout& layout) {
+  numChannels_ = numChannels;
+  map_ = map;
+  layout_ = layout;
+  isBed_ = layout.order > 0;
+  bed_.reset();
+  directivityFilter_.reset();
+  hasSpatialState_ = false;
+  initRaised_ = false;
+  transport_.reset();
+}
+
+EngineError AudioObjectImpl::setAudioBufferCallback(
+    BufferCallback callback,
+    size_t numChannels,
+    ChannelMap map,
+    void* userData) {
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  if (!callback) {
+    closeLocked();
+    return EngineError::OK;
+  }
+  BedLayout layout;
+  if (numChannels == 0 || numChannels > static_cast<size_t>(BedLayout::kMaxInputChannels) ||
+      !getInputLayout(static_cast<int>(numChannels), map, layout)) {
+    return EngineError::INVALID_CHANNEL_MAP;
+  }
+
+  closeLocked();
+  std::lock_guard<std::mutex> graphLock(*engine_.graphMutex);
+  callback_ = callback;
+  callbackUserData_ = userData;
+  setInputLayout(static_cast<int>(numChannels), map, layout);
+  return EngineError::OK;
+}
+
+EngineError AudioObjectImpl::open(const char* nameAndPath) {
+  return open(nameAndPath, AssetDescriptor());
+}
+
+EngineError AudioObjectImpl::open(const char* nameAndPath, AssetDescriptor ad) {
+  if (!nameAndPath) {
+    return EngineError::INVALID_PARAM;
+  }
+  IOStream* stream = createReadStream(nameAndPath, ad);
+  if (!stream) {
+    return EngineError::ERROR_OPENING_FILE;
+  }
+  return open(stream, true);
+}
+
+EngineError AudioObjectImpl::open(IOStream* stream, bool shouldOwnStream) {
+  if (!stream) {
+    return EngineError::INVALID_PARAM;
+  }
+  AudioFormatDecoder* decoder = nullptr;
+  const EngineError error = TBE_CreateAudioFormatDecoderFromStream(
+      decoder, stream, shouldOwnStream, engine_.bufferSize, engine_.sampleRate);
+  if (error != EngineError::OK) {
+    return error;
+  }
+  return open(decoder);
+}
+
+EngineError AudioObjectImpl::open(AudioFormatDecoder* decoder) {
+  if (!decoder) {
+    return EngineError::INVALID_PARAM;
+  }
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  return openDecoder(decoder);
+}
+
+EngineError AudioObjectImpl::openDecoder(AudioFormatDecoder* decoder) {
+  const int numChannels = decoder->getNumOfChannels();
+  ChannelMap map = decoder->getChannelMap();
+  BedLayout layout;
+  if (!getInputLayout(numChannels, map, layout)) {
+    delete decoder;
+    return EngineError::INVALID_CHANNEL_MAP;
+  }
+
+  closeLocked();
+
+  const size_t bufferFrames = static_cast<size_t>(std::max(
+      engine_.queueSizePerChannel, engine_.bufferSize * kMinStreamingBlocks));
+  std::unique_ptr<StreamingSource> source(
+      new StreamingSource(decoder, bufferFrames, engine_.bufferSize, engine_.bufferSize));
+  source->setLooping(looping_.load());
+  duration_.store(source->getDurationInFrames());
+  elapsed_.store(0);
+
+  // Without a decoder thread, the buffer is primed here so that the object is ready right away
+  if (decodeInline_) {
+    source->fill();
+  }
+
+  {
+    std::lock_guard<std::mutex> graphLock(*engine_.graphMutex);
+    source_ = std::move(source);
+    setInputLayout(numChannels, map, layout);
+  }
+  if (!decodeInline_ && engine_.decoderThread) {
+    engine_.decoderThread->add(source_.get());
+  }
+  open_.store(true);
+  return EngineError::OK;
+}
+
+void AudioObjectImpl::close() {
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  closeLocked();
+}
+
+void AudioObjectImpl::closeLocked() {
+  // The decoder thread lets go of the source before the audio thread does
+  if (source_ && !decodeInline_ && engine_.decoderThread) {
+    engine_.decoderThread->remove(source_.get());
+  }
+  std::unique_ptr<StreamingSource> source;
+  {
+    std::lock_guard<std::mutex> graphLock(*engine_.graphMutex);
+    source = std::move(source_);
+    callback_ = nullptr;
+    callbackUserData_ = nullptr;
+    numChannels_ = 0;
+    transport_.reset();
+  }
+  open_.store(false);
+  elapsed_.store(0);
+  duration_.store(0);
+}
+
+bool AudioObjectImpl::isOpen() const {
+  return open_.load();
+}
+
+EngineError AudioObjectImpl::seekToSample(size_t timeInSamples) {
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  if (!source_ || timeInSamples > duration_.load()) {
+    return EngineError::FAIL;
+  }
+  source_->seek(timeInSamples);
+  elapsed_.store(timeInSamples);
+  if (!decodeInline_ && engine_.decoderThread) {
+    engine_.decoderThread->notify();
+  }
+  return EngineError::OK;
+}
+
+EngineError AudioObjectImpl::seekToMs(float timeInMs) {
+  if (timeInMs < 0.f) {
+    return EngineError::FAIL;
+  }
+  return seekToSample(static_cast<size_t>(std::round(timeInMs * 0.001 * engine_.sampleRate)));
+}
+
+size_t AudioObjectImpl::getElapsedTimeInSamples() const {
+  return elapsed_.load();
+}
+
+double AudioObjectImpl::getElapsedTimeInMs() const {
+  return static_cast<double>(elapsed_.load()) * 1000.0 / engine_.sampleRate;
+}
+
+size_t AudioObjectImpl::getAssetDurationInSamples() const {
+  return duration_.load();
+}
+
+float AudioObjectImpl::getAssetDurationInMs() const {
+  return static_cast<float>(static_cast<double>(duration_.load()) * 1000.0 / engine_.sampleRate);
+}
+
+void AudioObjectImpl::shouldSpatialise(bool spatialise) {
+  spatialise_.store(spatialise);
+}
+
+bool AudioObjectImpl::isSpatialised() {
+  return spatialise_.load();
+}
+
+void AudioObjectImpl::overrideRanking(bool override) {
+  overrideRanking_.store(override);
+}
+
+EngineError AudioObjectImpl::setSpatialisationType(SpatialisationType spatType) {
+  if (spatType == SpatialisationType::BINAURAL && !engine_.binauralFilters) {
+    return EngineError::NOT_SUPPORTED;
+  }
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  if (spatType == spatType_.load()) {
+    return EngineError::OK;
+  }
+  std::unique_ptr<BinauralPanner> panner;
+  if (spatType == SpatialisationType::BINAURAL && !binaural_ &&
+      engine_.binauralRendering != BinauralRendering::AMBISONIC) {
+    panner.reset(
+        new BinauralPanner(*engine_.binauralFilters, engine_.binauralCrossfadeThreshold));
+  }
+
+  std::lock_guard<std::mutex> graphLock(*engine_.graphMutex);
+  if (panner) {
+    binaural_ = std::move(panner);
+  }
+  // Start the new path from the current gains and a clear history, instead of the old path's state
+  hasSpatialState_ = false;
+  spatType_.store(spatType);
+  return EngineError::OK;
+}
+
+SpatialisationType AudioObjectImpl::getSpatialisationType() const {
+  return spatType_.load();
+}
+
+bool AudioObjectImpl::enableLooping(bool loop) {
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  looping_.store(loop);
+  if (source_) {
+    source_->setLooping(loop);
+  }
+  return !callback_;
+}
+
+bool AudioObjectImpl::loopingEnabled() {
+  return looping_.load();
+}
+
+void AudioObjectImpl::setAttenuationMode(AttenuationMode mode) {
+  std::lock_guard<std::mutex> lock(paramsMutex_);
+  params_.attenuationMode = mode;
+}
+
+AttenuationMode AudioObjectImpl::getAttenuationMode() const {
+  std::lock_guard<std::mutex> lock(paramsMutex_);
+  return params_.attenuationMode;
+}
+
+void AudioObjectImpl::setAttenuationProperties(AttenuationProps props) {
+  props.minimumDistance = std::max(ObjectSpatialStore::kMinDistance, props.minimumDistance);
+  props.maximumDistance = std::max(props.minimumDistance, props.maximumDistance);
+  props.factor = std::max(0.f, props.factor);
+  std::lock_guard<std::mutex> lock(paramsMutex_);
+  params_.attenuation = props;
+}
+
+AttenuationProps AudioObjectImpl::getAttenuationProperties() const {
+  std::lock_guard<std::mutex> lock(paramsMutex_);
+  return params_.attenuation;
+}
+
+void AudioObjectImpl::setDirectionalityEnabled(bool enable) {
+  std::lock_guard<std::mutex> lock(paramsMutex_);
+  params_.directivity = enable;
+}
+
+bool AudioObjectImpl::isDirectionalityEnabled() const {
+  std::lock_guard<std::mutex> lock(paramsMutex_);
+  return params_.directivity;
+}
+
+void AudioObjectImpl::setDirectionalProperties(DirectionalProps props) {
+  props.effectLevel = std::max(0.f, std::min(1.f, props.effectLevel));
+  props.coneArea = std::max(0.f, std::min(359.f, props.coneArea));
+  std::lock_guard<std::mutex> lock(paramsMutex_);
+  params_.directional = props;
+}
+
+DirectionalProps AudioObjectImpl::getDirectionalProperties() const {
+  std::lock_guard<std::mutex> lock(paramsMutex_);
+  return params_.directional;
+}
+
+void AudioObjectImpl::setPitch(float pitch) {
+  pitch_.store(std::max(0.001f, std::min(4.f, pitch)));
+}
+
+float AudioObjectImpl::getPitch() const {
+  return pitch_.load();
+}
+
+AudioObjectImpl::Effect* AudioObjectImpl::findEffect(EffectHandle handle) const {
+  for (const auto& effect : effects_) {
+    if (effect.get() == handle) {
+      return effect.get();
+    }
+  }
+  return nullptr;
+}
+
+void AudioObjectImpl::designEffect(Effect& effect) const {
+  Biquad::Type type = Biquad::Type::LOW_PASS;
+  if (effect.type == EffectType::FILTER_HIGH_PASS) {
+    type = Biquad::Type::HIGH_PASS;
+  } else if (effect.type == EffectType::FILTER_BAND_PASS) {
+    type = Biquad::Type::BAND_PASS;
+  }
+  for (auto& filter : effect.filters) {
+    filter.design(type, engine_.sampleRate, effect.frequency, effect.q, effect.gainDb);
+  }
+}
+
+EffectHandle AudioObjectImpl::createEffect(EffectType type) {
+  if (type == EffectType::INVALID) {
+    return nullptr;
+  }
+  std::unique_ptr<Effect> effect(new Effect());
+  effect->type = type;
+  designEffect(*effect);
+  EffectHandle handle = effect.get();
+  std::lock_guard<std::mutex> lock(effectsMutex_);
+  effects_.push_back(std::move(effect));
+  return handle;
+}
+
+void AudioObjectImpl::destroyEffect(EffectHandle handle) {
+  std::unique_ptr<Effect> removed;
+  std::lock_guard<std::mutex> lock(effectsMutex_);
+  for (auto it = effects_.begin(); it != effects_.end(); ++it) {
+    if (it->get() == handle) {
+      removed = std::move(*it);
+      effects_.erase(it);
+      return;
+    }
+  }
+}
+
+EffectType AudioObjectImpl::getEffectTypeForHandle(EffectHandle handle) {
+  std::lock_guard<std::mutex> lock(effectsMutex_);
+  const Effect* effect = findEffect(handle);
+  return effect ? effect->type : EffectType::INVALID;
+}
+
+EngineError AudioObjectImpl::setEffectType(EffectHandle handle, EffectType type) {
+  if (type == EffectType::INVALID) {
+    return EngineError::INVALID_PARAM;
+  }
+  std::lock_guard<std::mutex> lock(effectsMutex_);
+  Effect* effect = findEffect(handle);
+  if (!effect) {
+    return EngineError::INVALID_PARAM;
+  }
+  effect->type = type;
+  designEffect(*effect);
+  return EngineError::OK;
+}
+
+EngineError AudioObjectImpl::bypassEffect(EffectHandle handle, bool bypass) {
+  std::lock_guard<std::mutex> lock(effectsMutex_);
+  Effect* effect = findEffect(handle);
+  if (!effect) {
+    return EngineError::INVALID_PARAM;
+  }
+  if (effect->bypassed && !bypass) {
+    // Don't resume from a stale state
+    for (auto& filter : effect->filters) {
+      filter.reset();
+    }
+  }
+  effect->bypassed = bypass;
+  return EngineError::OK;
+}
+
+bool AudioObjectImpl::isEffectBypassed(EffectHandle handle) {
+  std::lock_guard<std::mutex> lock(effectsMutex_);
+  const Effect* effect = findEffect(handle);
+  return !effect || effect->bypassed;
+}
+
+EngineError AudioObjectImpl::setEffectParam(EffectHandle handle, EffectParam param, float value) {
+  std::lock_guard<std::mutex> lock(effectsMutex_);
+  Effect* effect = findEffect(handle);
+  if (!effect) {
+    return EngineError::INVALID_PARAM;
+  }
+  switch (param) {
+    case EffectParam::FILTER_CENTER_FRQUENCY:
+      if (value <= 0.f) {
+        return EngineError::INVALID_PARAM;
+      }
+      effect->frequency = value;
+      break;
+    case EffectParam::FILTER_Q:
+      if (value <= 0.f) {
+        return EngineError::INVALID_PARAM;
+      }
+      effect->q = value;
+      break;
+    case EffectParam::FILTER_GAIN:
+      effect->gainDb = value;
+      break;
+    default:
+      return EngineError::INVALID_PARAM;
+  }
+  designEffect(*effect);
+  return EngineError::OK;
+}
+
+float AudioObjectImpl::getEffectParam(EffectHandle handle, EffectParam param) {
+  std::lock_guard<std::mutex> lock(effectsMutex_);
+  const Effect* effect = findEffect(handle);
+  if (!effect) {
+    return 0.f;
+  }
+  switch (param) {
+    case EffectParam::FILTER_CENTER_FRQUENCY:
+      return effect->frequency;
+    case EffectParam::FILTER_Q:
+      return effect->q;
+    case EffectParam::FILTER_GAIN:
+      return effect->gainDb;
+    default:
+      return 0.f;
+  }
+}
+
+size_t AudioObjectImpl::getNumberOfEffects() const {
+  std::lock_guard<std::mutex> lock(effectsMutex_);
+  return effects_.size();
+}
+
+EffectHandle AudioObjectImpl::getEffect(size_t effectIndex) {
+  std::lock_guard<std::mutex> lock(effectsMutex_);
+  return effectIndex < effects_.size() ? effects_[effectIndex].get() : nullptr;
+}
+
+Bus AudioObjectImpl::getOutputBus() {
+  return outputBus_.load();
+}
+
+void AudioObjectImpl::setOutputBus(Bus bus) {
+  outputBus_.store(bus);
+}
+
+const AudioObjectImpl::Params& AudioObjectImpl::getParams() {
+  if (paramsMutex_.try_lock()) {
+    paramsSnapshot_ = params_;
+    paramsMutex_.unlock();
+  }
+  return paramsSnapshot_;
+}
+
+bool AudioObjectImpl::applyEffects(int numFrames) {
+  if (!effectsMutex_.try_lock()) {
+    return false;
+  }
+  bool applied = false;
+  for (auto& effect : effects_) {
+    if (effect->bypassed) {
+      continue;
+    }
+    for (int ch = 0; ch < numChannels_; ++ch) {
+      effect->filters[ch].process(planar_.getChannel(static_cast<size_t>(ch)), numFrames);
+    }
+    applied = true;
+  }
+  effectsMutex_.unlock();
+  return applied;
+}
+
+void AudioObjectImpl::prepare(ObjectSpatialStore& spatial) {
+  spatialIndex_ = kNotPositional;
+  const bool positional = (source_ || callback_) && numChannels_ > 0 && !isBed_ &&
+      map_ != ChannelMap::HEADLOCKED_STEREO && spatialise_.load(std::memory_order_relaxed);
+  if (!positional) {
+    return;
+  }
+  const Params& params = getParams();
+  spatialIndex_ = spatial.add(
+      position_.load(),
+      rotation_.load(),
+      params.attenuationMode,
+      params.attenuation,
+      params.directivity,
+      params.directional);
+}
+
+void AudioObjectImpl::render(const RenderContext& context) {
+  const int numFrames = std::min(context.numFrames, engine_.bufferSize);
+  const Transport::Block block = transport_.process(numFrames, envelope_.data());
+  float volumeStart = 1.f;
+  float volumeEnd = 1.f;
+  volume_.process(numFrames, volumeStart, volumeEnd);
+
+  if (source_) {
+    if (block.rewind) {
+      source_->seek(0);
+    }
+    if (decodeInline_ && source_->needsData()) {
+      const ProfilerScope profile(context.profiler, ProfilerStage::DECODE);
+      const TraceScope trace(engine_.tracer, "AudioObject decode");
+      source_->fill();
+      // A seek only discards the buffered frames once processed, refill rather than play a
+      // block of silence
+      source_->update();
+      if (source_->needsData()) {
+        source_->fill();
+      }
+    }
+    source_->update();
+    if (!initRaised_) {
+      const size_t ready = std::min<size_t>(static_cast<size_t>(numFrames), duration_.load());
+      if (source_->getNumFramesAvailable() >= ready) {
+        initRaised_ = true;
+        raiseEvent(Event::DECODER_INIT);
+      }
+    }
+  }
+
+  const int numChannels = numChannels_;
+  if ((source_ || callback_) && numChannels > 0 && block.numFrames > 0) {
+    // Input
+    float* frames = interleaved_.data();
+    std::memset(frames, 0, static_cast<size_t>(numFrames * numChannels) * sizeof(float));
+    float* audible = frames + block.offset * numChannels;
+    if (source_) {
+      source_->read(audible, block.numFrames, pitch_.load(std::memory_order_relaxed));
+    } else {
+      callback_(
+          audible,
+          static_cast<size_t>(block.numFrames * numChannels),
+          static_cast<size_t>(numChannels),
+          callbackUserData_);
+    }
+    for (int ch = 0; ch < numChannels; ++ch) {
+      float* out = planar_.getChannel(static_cast<size_t>(ch));
+      for (int n = 0; n < numFrames; ++n) {
+        out[n] = frames[n * numChannels + ch];
+      }
+      if (block.applyEnvelope) {
+        for (int n = block.offset; n < block.offset + block.numFrames; ++n) {
+          out[n] *= envelope_[n];
+        }
+      }
+    }
+    const bool effectsApplied = applyEffects(numFrames);
+
+    // Gain: volume, output bus and, for positional sources, attenuation and directivity
+    float busStart = 1.f;
+    float busEnd = 1.f;
+    if (context.buses) {
+      context.buses->getOutputGain(outputBus_.load(std::memory_order_relaxed), busStart, busEnd);
+    }
+    float gainStart = volumeStart * busStart;
+    float gainEnd = volumeEnd * busEnd;
+
+    if (isBed_) {
+      if (effectsApplied || block.applyEnvelope) {
+        for (int ch = 0; ch < numChannels; ++ch) {
+          const float* in = planar_.getChannel(static_cast<size_t>(ch));
+          for (int n = 0; n < numFrames; ++n) {
+            frames[n * numChannels + ch] = in[n];
+          }
+        }
+      }
+      bed_.render(
+          frames,
+          numChannels,
+          layout_,
+          rotation_.load(),
+          getFocus(),
+          gainStart,
+          gainEnd,
+          getReverbSend(),
+          context);
+    } else {
+      // Decided by prepare(), in case a control thread changes it in between
+      const bool spatialise = spatialIndex_ != kNotPositional && context.spatial;
+      float* mono = planar_.getChannel(0);
+      if (numChannels == 2 && spatialise) {
+        const float* left = planar_.getChannel(0);
+        const float* right = planar_.getChannel(1);
+        mono = mono_.data();
+        for (int n = 0; n < numFrames; ++n) {
+          mono[n] = 0.5f * (left[n] + right[n]);
+        }
+      }
+
+      if (!spatialise) {
+        hasSpatialState_ = false;
+        const float delta = (gainEnd - gainStart) / static_cast<float>(std::max(1, numFrames));
+        const float headlockedGain = numChannels == 1 ? kHeadlockedMonoGain : 1.f;
+        for (int side = 0; side < 2; ++side) {
+          const float* in = planar_.getChannel(numChannels == 1 ? 0 : static_cast<size_t>(side));
+          float* out = context.headlocked[side];
+          for (int n = 0; n < numFrames; ++n) {
+            out[n] += in[n] * headlockedGain * (gainStart + delta * static_cast<float>(n + 1));
+          }
+        }
+        const float send = getReverbSend();
+        if (send > 0.f) {
+          for (int n = 0; n < numFrames; ++n) {
+            const float sample = numChannels == 1
+                ? mono[n]
+                : 0.5f * (planar_.getChannel(0)[n] + planar_.getChannel(1)[n]);
+            context.reverbSend[n] +=
+                sample * send * (gainStart + delta * static_cast<float>(n + 1));
+          }
+        }
+      } else {
+        const ObjectSpatialStore::Result result = context.spatial->getResult(spatialIndex_);
+        const float distance = result.distance;
+        const float attenuation = result.attenuation;
+        float directivityGain = 1.f;
+        float cutoff = engine_.sampleRate;
+        if (result.outsideCone) {
+          directivityGain = ObjectSpatialStore::getDirectivityGain(result.directivity);
+          cutoff = kDirectivityMaxCutoff *
+              std::pow(kDirectivityMinCutoff / kDirectivityMaxCutoff, result.directivity);
+        }
+        directivityFilter_.setCutoff(cutoff, engine_.sampleRate);
+        directivityFilter_.process(mono, numFrames);
+
+        // Objects rendered binaurally all take the path the engine picked for the block
+        const bool binaural = spatType_.load() == SpatialisationType::BINAURAL &&
+            (binaural_ || context.binauralViaAmbisonic);
+        const bool viaBus = binaural && context.binauralViaAmbisonic;
+
+        // Direction in the listener's frame
+        const TBVector& direction = result.direction;
+        float target[SphericalHarmonics::kMaxChannels] = {0.f};
+        float busTarget[SphericalHarmonics::kMaxChannels] = {0.f};
+        if (distance > ObjectSpatialStore::kMinDistance) {
+          if (!binaural) {
+            SphericalHarmonics::evaluateEngine(direction, SphericalHarmonics::kMaxOrder, target);
+          } else if (viaBus) {
+            SphericalHarmonics::evaluateEngine(
+                direction, engine_.binauralAmbisonicOrder, busTarget);
+          }
+        } else {
+          target[0] = 1.f;
+          busTarget[0] = viaBus ? 1.f : 0.f;
+        }
+        if (!hasSpatialState_) {
+          std::copy(target, target + SphericalHarmonics::kMaxChannels, shGains_);
+          std::copy(busTarget, busTarget + SphericalHarmonics::kMaxChannels, busGains_);
+          attenuation_ = attenuation;
+          directivityGain_ = directivityGain;
+          if (binaural_) {
+            binaural_->reset();
+          }
+          viaBus_ = viaBus;
+          tailFrames_ = 0;
+          hasSpatialState_ = true;
+        }
+        gainStart *= attenuation_ * directivityGain_;
+        gainEnd *= attenuation * directivityGain;
+        attenuation_ = attenuation;
+        directivityGain_ = directivityGain;
+
+        LinearRamp::applyGain(mono, numFrames, gainStart, gainEnd);
+        const float send = getReverbSend();
+        if (send > 0.f) {
+          for (int n = 0; n < numFrames; ++n) {
+            context.reverbSend[n] += mono[n] * send;
+          }
+        }
+
+        if (binaural) {
+          bool crossfaded = false;
+          if (binaural_ && (!viaBus || !viaBus_ || tailFrames_ > 0)) {
+            // When the engine switches paths, the panner fades in or out over the block while the
+            // bus gains ramp the other way. Faded out, it is given silence until its tail has
+            // played, which also leaves its history silent for when it comes back.
+            const float* input = mono;
+            if (viaBus != viaBus_) {
+              const float start = viaBus ? 1.f : 0.f;
+              std::copy(mono, mono + numFrames, fade_.begin());
+              LinearRamp::applyGain(fade_.data(), numFrames, start, 1.f - start);
+              input = fade_.data();
+              tailFrames_ = viaBus ? binauralTail_ : 0;
+            } else if (viaBus) {
+              std::fill(fade_.begin(), fade_.begin() + numFrames, 0.f);
+              input = fade_.data();
+              tailFrames_ -= numFrames;
+            }
+            const ProfilerScope profile(context.profiler, ProfilerStage::BINAURAL_CONVOLUTION);
+            crossfaded = binaural_->processAdd(
+                input, direction, context.headlocked[0], context.headlocked[1], numFrames);
+          }
+          if (context.binauralAmbisonic) {
+            encode(
+                mono,
+                numFrames,
+                busTarget,
+                SphericalHarmonics::getNumChannels(engine_.binauralAmbisonicOrder),
+                busGains_,
+                context.binauralAmbisonic);
+          }
+          viaBus_ = viaBus;
+          if (context.profiler) {
+            context.profiler->countBinauralObject(crossfaded);
+          }
+        } else {
+          encode(
+              mono,
+              numFrames,
+              target,
+              SphericalHarmonics::kMaxChannels,
+              shGains_,
+              context.ambisonic);
+        }
+      }
+    }
+  }
+
+  if (source_) {
+    elapsed_.store(source_->getPosition());
+    const uint32_t events = source_->takeEvents();
+    if (events & StreamingSource::EVENT_LOOPED) {
+      raiseEvent(Event::LOOPED);
+    }
+    if (events & StreamingSource::EVENT_END_OF_STREAM) {
+      transport_.stopNow();
+      source_->seek(0);
+      raiseEvent(Event::END_OF_STREAM);
+      raiseEvent(Event::PLAY_STATE_CHANGED);
+    }
+    if (events & StreamingSource::EVENT_STARVED) {
+      traceInstant(engine_.tracer, "AudioObject underrun", "dspTime", context.dspTime);
+      raiseEvent(Event::ERROR_QUEUE_STARVATION);
+    }
+    if (events & StreamingSource::EVENT_DECODER_ERROR) {
+      transport_.stopNow();
+      raiseEvent(Event::ERROR_DECODER_FAIL);
+      raiseEvent(Event::PLAY_STATE_CHANGED);
+    }
+  }
+  if (block.stateChanged) {
+    raiseEvent(Event::PLAY_STATE_CHANGED);
+  }
+}
+} // namespace TBE
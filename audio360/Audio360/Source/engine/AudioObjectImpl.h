@@ -0,0 +1,199 @@
+#ifndef FBA_AUDIOOBJECTIMPL_H
+#define FBA_AUDIOOBJECTIMPL_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "BedRenderer.h"
+#include "EngineProfiler.h"
+#include "ObjectSpatialStore.h"
+#include "SpatDecoderBase.h"
+#include "StreamingSource.h"
+#include "TBE_AudioObject.h"
+#include "dsp/BinauralFilterBank.h"
+#include "dsp/Biquad.h"
+#include "dsp/OnePole.h"
+#include "dsp/SphericalHarmonics.h"
+#include "utils/AudioBuffer.h"
+
+namespace TBE {
+/// A positional sound source. Mono and stereo inputs are encoded as a third order plane wave from
+/// the direction of the object relative to the listener, with distance attenuation, directivity and
+/// insert effects, or convolved with HRIRs directly when the spatialisation type is BINAURAL.
+/// Ambisonic inputs are rendered as a bed, rotated by the object's rotation.
+class AudioObjectImpl : public SpatDecoderBase<AudioObject> {
+ public:
+  /// @param outputBus Bus the object is routed to on creation
+  AudioObjectImpl(const EngineContext& engine, Options options, Bus outputBus);
+  ~AudioObjectImpl() override;
+
+  EngineError setAudioBufferCallback(
+      BufferCallback callback,
+      size_t numChannels,
+      ChannelMap map,
+      void* userData) override;
+  EngineError open(const char* nameAndPath) override;
+  EngineError open(const char* nameAndPath, AssetDescriptor ad) override;
+  EngineError open(IOStream* stream, bool shouldOwnStream) override;
+  EngineError open(AudioFormatDecoder* decoder) override;
+  void close() override;
+  bool isOpen() const override;
+
+  EngineError seekToSample(size_t timeInSamples) override;
+  EngineError seekToMs(float timeInMs) override;
+  size_t getElapsedTimeInSamples() const override;
+  double getElapsedTimeInMs() const override;
+  size_t getAssetDurationInSamples() const override;
+  float getAssetDurationInMs() const override;
+
+  void shouldSpatialise(bool spatialise) override;
+  bool isSpatialised() override;
+  void overrideRanking(bool override) override;
+  EngineError setSpatialisationType(SpatialisationType spatType) override;
+  SpatialisationType getSpatialisationType() const override;
+
+  bool enableLooping(bool loop) override;
+  bool loopingEnabled() override;
+
+  void setAttenuationMode(AttenuationMode mode) override;
+  AttenuationMode getAttenuationMode() const override;
+  void setAttenuationProperties(AttenuationProps props) override;
+  AttenuationProps getAttenuationProperties() const override;
+  void setDirectionalityEnabled(bool enable) override;
+  bool isDirectionalityEnabled() const override;
+  void setDirectionalProperties(DirectionalProps props) override;
+  DirectionalProps getDirectionalProperties() const override;
+  void setPitch(float pitch) override;
+  float getPitch() const override;
+
+  EffectHandle createEffect(EffectType type) override;
+  void destroyEffect(EffectHandle handle) override;
+  EffectType getEffectTypeForHandle(EffectHandle handle) override;
+  EngineError setEffectType(EffectHandle handle, EffectType type) override;
+  EngineError bypassEffect(EffectHandle handle, bool bypass) override;
+  bool isEffectBypassed(EffectHandle handle) override;
+  EngineError setEffectParam(EffectHandle handle, EffectParam param, float value) override;
+  float getEffectParam(EffectHandle handle, EffectParam param) override;
+  size_t getNumberOfEffects() const override;
+  EffectHandle getEffect(size_t effectIndex) override;
+  Bus getOutputBus() override;
+
+  /// Engine: route the object to a bus, or nullptr to disconnect it. The graph mutex must be held.
+  void setOutputBus(Bus bus);
+
+  /// Audio thread: time spent rendering this object, recorded by the engine
+  RenderCost& getRenderCost() {
+    return renderCost_;
+  }
+
+  // Renderable
+  void render(const RenderContext& context) override;
+
+  /// Audio thread, with the graph mutex held, before render(): add the object to the spatial
+  /// parameters of the block if it is rendered as a positional source
+  void prepare(ObjectSpatialStore& spatial);
+
+ private:
+  static const size_t kNotPositional = SIZE_MAX;
+
+  struct Params {
+    AttenuationMode attenuationMode{AttenuationMode::LOGARITHMIC};
+    AttenuationProps attenuation;
+    bool directivity{false};
+    DirectionalProps directional;
+  };
+
+  struct Effect {
+    EffectType type{EffectType::FILTER_LOW_PASS};
+    bool bypassed{true};
+    float frequency{1000.f};
+    float q{0.7071f};
+    float gainDb{0.f};
+    Biquad filters[BedLayout::kMaxInputChannels];
+  };
+
+  /// Take ownership of an opened decoder and start streaming it. Must hold controlMutex_.
+  EngineError openDecoder(AudioFormatDecoder* decoder);
+
+  /// Release the current source and callback. Must hold controlMutex_.
+  void closeLocked();
+
+  /// Work out how an input is rendered
+  /// @return False if the format isn't supported
+  static bool getInputLayout(int numChannels, ChannelMap& map, BedLayout& layout);
+
+  /// Apply the input format. Must hold the graph mutex.
+  void setInputLayout(int numChannels, ChannelMap map, const BedLayout& layout);
+
+  /// Must hold effectsMutex_
+  Effect* findEffect(EffectHandle handle) const;
+  void designEffect(Effect& effect) const;
+
+  /// Audio thread: a copy of the parameters, kept if a control thread is updating them
+  const Params& getParams();
+
+  /// Audio thread: run the insert effects on planar_
+  /// @return False if the effects were not run
+  bool applyEffects(int numFrames);
+
+  const bool decodeInline_;
+  mutable std::mutex controlMutex_; // Serialises open/close against control calls
+  std::unique_ptr<StreamingSource> source_; // Swapped with the graph mutex held
+  BufferCallback callback_{nullptr}; // Swapped with the graph mutex held
+  void* callbackUserData_{nullptr};
+
+  // Input format, changed with the graph mutex held
+  int numChannels_{0};
+  ChannelMap map_{ChannelMap::UNKNOWN};
+  BedLayout layout_;
+  bool isBed_{false};
+
+  // Audio thread state
+  BedRenderer bed_;
+  std::vector<float> interleaved_;
+  AudioBuffer planar_;
+  std::vector<float> mono_;
+  std::vector<float> fade_; // Input of the panner while switching to or from the binaural bus
+  float shGains_[SphericalHarmonics::kMaxChannels];
+  float busGains_[SphericalHarmonics::kMaxChannels]; // Into RenderContext::binauralAmbisonic
+  // Set with controlMutex_ and the graph mutex held, never with BinauralRendering::AMBISONIC
+  std::unique_ptr<BinauralPanner> binaural_;
+  bool viaBus_{false}; // Rendered binaurally through the binaural ambisonic bus last block
+  int binauralTail_{0}; // Frames a panner faded out to the bus still plays
+  int tailFrames_{0}; // Of the panner's tail left to play
+  size_t spatialIndex_{kNotPositional}; // In the ObjectSpatialStore of the block
+  float attenuation_{1.f};
+  float directivityGain_{1.f};
+  bool hasSpatialState_{false};
+  OnePoleLowPass directivityFilter_;
+  bool initRaised_{false};
+
+  mutable std::mutex paramsMutex_;
+  Params params_;
+  Params paramsSnapshot_;
+
+  mutable std::mutex effectsMutex_; // The audio thread only ever try-locks
+  std::vector<std::unique_ptr<Effect>> effects_;
+
+  std::atomic<bool> open_{false};
+  std::atomic<bool> looping_{false};
+  std::atomic<size_t> elapsed_{0};
+  std::atomic<size_t> duration_{0};
+  std::atomic<bool> spatialise_{true};
+  std::atomic<bool> overrideRanking_{false};
+  std::atomic<SpatialisationType> spatType_{SpatialisationType::AMBISONICS};
+  std::atomic<float> pitch_{1.f};
+  std::atomic<Bus> outputBus_;
+  RenderCost renderCost_;
+};
+} // namespace TBE
+
+#endif // FBA_AUDIOOBJECTIMPL_H
@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "BedRenderer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "EngineProfiler.h"
+
+namespace TBE {
+static const float kPi = 3.14159265358979323846f;
+
+bool BedLayout::fromChannelMap(ChannelMap map, BedLayout& layout) {
+  layout = BedLayout();
+  std::fill(layout.acn, layout.acn + kMaxInputChannels, -1);
+
+  auto setAmbisonic = [&layout](int firstInput, int firstAcn, int count) {
+    for (int i = 0; i < count; ++i) {
+      layout.acn[firstInput + i] = firstAcn + i;
+    }
+    const int lastAcn = firstAcn + count - 1;
+    layout.order = std::max(layout.order, SphericalHarmonics::getOrderForChannel(lastAcn));
+  };
+
+  // TBE hybrid channels are carried in ACN order over the first and second order harmonics
+  switch (map) {
+    case ChannelMap::TBE_8_2:
+      setAmbisonic(0, 0, 8);
+      layout.headlockedLeft = 8;
+      layout.headlockedRight = 9;
+      return true;
+    case ChannelMap::TBE_8:
+      setAmbisonic(0, 0, 8);
+      return true;
+    case ChannelMap::TBE_6_2:
+      setAmbisonic(0, 0, 6);
+      layout.headlockedLeft = 6;
+      layout.headlockedRight = 7;
+      return true;
+    case ChannelMap::TBE_6:
+      setAmbisonic(0, 0, 6);
+      return true;
+    case ChannelMap::TBE_4_2:
+      setAmbisonic(0, 0, 4);
+      layout.headlockedLeft = 4;
+      layout.headlockedRight = 5;
+      return true;
+    case ChannelMap::TBE_4:
+      setAmbisonic(0, 0, 4);
+      return true;
+    case ChannelMap::TBE_8_PAIR0:
+    case ChannelMap::TBE_8_PAIR1:
+    case ChannelMap::TBE_8_PAIR2:
+    case ChannelMap::TBE_8_PAIR3:
+      setAmbisonic(
+          0, 2 * (static_cast<int>(map) - static_cast<int>(ChannelMap::TBE_8_PAIR0)), 2);
+      return true;
+    case ChannelMap::TBE_CHANNEL0:
+    case ChannelMap::TBE_CHANNEL1:
+    case ChannelMap::TBE_CHANNEL2:
+    case ChannelMap::TBE_CHANNEL3:
+    case ChannelMap::TBE_CHANNEL4:
+    case ChannelMap::TBE_CHANNEL5:
+    case ChannelMap::TBE_CHANNEL6:
+    case ChannelMap::TBE_CHANNEL7:
+      setAmbisonic(0, static_cast<int>(map) - static_cast<int>(ChannelMap::TBE_CHANNEL0), 1);
+      return true;
+    case ChannelMap::HEADLOCKED_STEREO:
+    case ChannelMap::STEREO:
+      layout.headlockedLeft = 0;
+      layout.headlockedRight = 1;
+      return true;
+    case ChannelMap::HEADLOCKED_CHANNEL0:
+      layout.headlockedLeft = 0;
+      return true;
+    case ChannelMap::HEADLOCKED_CHANNEL1:
+      layout.headlockedRight = 0;
+      return true;
+    case ChannelMap::MONO:
+      layout.headlockedLeft = 0;
+      layout.headlockedRight = 0;
+      layout.headlockedGain = 0.70710678f;
+      return true;
+    case ChannelMap::AMBIX_4:
+    case ChannelMap::AMBIX_4_2:
+    case ChannelMap::AMBIX_9:
+    case ChannelMap::AMBIX_9_2:
+    case ChannelMap::AMBIX_16:
+    case ChannelMap::AMBIX_16_2: {
+      const bool hasHeadlocked = map == ChannelMap::AMBIX_4_2 || map == ChannelMap::AMBIX_9_2 ||
+          map == ChannelMap::AMBIX_16_2;
+      const int numAmbisonic = getNumChannelsForMap(map) - (hasHeadlocked ? 2 : 0);
+      setAmbisonic(0, 0, numAmbisonic);
+      if (hasHeadlocked) {
+        layout.headlockedLeft = numAmbisonic;
+        layout.headlockedRight = numAmbisonic + 1;
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+ChannelMap BedLayout::mapForChannelCount(int numChannels) {
+  switch (numChannels) {
+    case 1:
+      return ChannelMap::MONO;
+    case 2:
+      return ChannelMap::STEREO;
+    case 4:
+      return ChannelMap::AMBIX_4;
+    case 6:
+      return ChannelMap::AMBIX_4_2;
+    case 8:
+      return ChannelMap::TBE_8;
+    case 9:
+      return ChannelMap::AMBIX_9;
+    case 10:
+      return ChannelMap::TBE_8_2;
+    case 11:
+      return ChannelMap::AMBIX_9_2;
+    case 16:
+      return ChannelMap::AMBIX_16;
+    case 18:
+      return ChannelMap::AMBIX_16_2;
+    default:
+      return ChannelMap::INVALID;
+  }
+}
+
+namespace {
+struct FocusGain {
+  float x, y, z; // Focus direction in the bed frame, ambiX axes
+  float halfWidth; // Radians
+  float offLevel; // Linear gain outside the focus area
+};
+
+float focusGain(float x, float y, float z, const void* userData) {
+  const auto* focus = static_cast<const FocusGain*>(userData);
+  const float cosAngle = std::max(-1.f, std::min(1.f, x * focus->x + y * focus->y + z * focus->z));
+  const float angle = std::acos(cosAngle);
+  if (angle >= focus->halfWidth) {
+    return focus->offLevel;
+  }
+  // Cosine bump from 1 at the centre to offLevel at the edge of the focus area
+  const float bump = 0.5f + 0.5f * std::cos(kPi * angle / focus->halfWidth);
+  return focus->offLevel + (1.f - focus->offLevel) * bump;
+}
+
+bool sameQuat(const TBQuat& a, const TBQuat& b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+}
+
+bool sameFocus(const FocusSettings& a, const FocusSettings& b) {
+  if (a.enabled != b.enabled) {
+    return false;
+  }
+  return !a.enabled ||
+      (a.followListener == b.followListener && a.offFocusLevelDb == b.offFocusLevelDb &&
+       a.widthDegrees == b.widthDegrees && sameQuat(a.orientation, b.orientation));
+}
+} // namespace
+
+BedRenderer::BedRenderer(int maxBufferSize)
+    : scratch_(AmbisonicRotator::kMaxChannels, static_cast<size_t>(maxBufferSize)) {}
+
+void BedRenderer::reset() {
+  rotator_.reset();
+  hasMatrix_ = false;
+}
+
+void BedRenderer::updateMatrix(
+    int order,
+    TBQuat listenerRotation,
+    TBQuat bedRotation,
+    const FocusSettings& focus) {
+  if (hasMatrix_ && order == lastOrder_ && sameQuat(listenerRotation, lastRotation_) &&
+      sameQuat(bedRotation, lastBedRotation_) && sameFocus(focus, lastFocus_)) {
+    return;
+  }
+
+  // Bed frame -> listener frame
+  TBQuat listenerInverse = listenerRotation;
+  listenerInverse.x = -listenerInverse.x;
+  listenerInverse.y = -listenerInverse.y;
+  listenerInverse.z = -listenerInverse.z;
+  const TBQuat rotation = listenerInverse * bedRotation;
+
+  const bool useFocus = focus.enabled && focus.offFocusLevelDb < 0.f;
+  if (useFocus) {
+    // The focus direction follows the listener's gaze or is fixed in the world
+    const TBVector worldFocus = focus.followListener
+        ? TBQuat::getForwardFromQuat(listenerRotation)
+        : TBQuat::getForwardFromQuat(focus.orientation);
+    TBQuat bedInverse = bedRotation;
+    bedInverse.x = -bedInverse.x;
+    bedInverse.y = -bedInverse.y;
+    bedInverse.z = -bedInverse.z;
+    const TBVector bedFocus = TBQuat::rotateVectorByQuat(bedInverse, worldFocus);
+
+    FocusGain gain;
+    SphericalHarmonics::engineToAmbix(bedFocus, gain.x, gain.y, gain.z);
+    const float norm = std::sqrt(gain.x * gain.x + gain.y * gain.y + gain.z * gain.z);
+    if (norm > 0.f) {
+      gain.x /= norm;
+      gain.y /= norm;
+      gain.z /= norm;
+    }
+    gain.halfWidth = 0.5f * std::max(40.f, std::min(120.f, focus.widthDegrees)) * kPi / 180.f;
+    gain.offLevel = std::pow(10.f, std::max(-24.f, focus.offFocusLevelDb) / 20.f);
+    AmbisonicRotator::computeMatrix(rotation, order, matrix_, focusGain, &gain);
+  } else {
+    AmbisonicRotator::computeRotationMatrix(rotation, order, matrix_);
+  }
+  rotator_.setMatrix(matrix_, !useFocus);
+
+  hasMatrix_ = true;
+  lastOrder_ = order;
+  lastRotation_ = listenerRotation;
+  lastBedRotation_ = bedRotation;
+  lastFocus_ = focus;
+}
+
+void BedRenderer::render(
+    const float* interleaved,
+    int numChannels,
+    const BedLayout& layout,
+    TBQuat bedRotation,
+    const FocusSettings& focus,
+    float gainStart,
+    float gainEnd,
+    float reverbSend,
+    const RenderContext& context) {
+  const int numFrames = std::min(context.numFrames, static_cast<int>(scratch_.getNumFrames()));
+  const float delta = (gainEnd - gainStart) / static_cast<float>(std::max(1, numFrames));
+  numChannels = std::min(numChannels, static_cast<int>(BedLayout::kMaxInputChannels));
+
+  // Head-locked channels bypass rotation
+  const int headlocked[2] = {layout.headlockedLeft, layout.headlockedRight};
+  for (int side = 0; side < 2; ++side) {
+    const int input = headlocked[side];
+    if (input < 0 || input >= numChannels) {
+      continue;
+    }
+    float* out = context.headlocked[side];
+    const float start = gainStart * layout.headlockedGain;
+    const float step = delta * layout.headlockedGain;
+    for (int n = 0; n < numFrames; ++n) {
+      out[n] += interleaved[n * numChannels + input] * (start + step * static_cast<float>(n + 1));
+    }
+  }
+
+  bool hasAmbisonic = false;
+  for (int ch = 0; ch < numChannels; ++ch) {
+    hasAmbisonic = hasAmbisonic || layout.acn[ch] >= 0;
+  }
+  if (!hasAmbisonic) {
+    return;
+  }
+
+  // Deinterleave the ambisonic channels, applying the gain ramp
+  const int order = std::max(1, layout.order);
+  const int numAcn = SphericalHarmonics::getNumChannels(order);
+  scratch_.clear(static_cast<size_t>(numAcn), static_cast<size_t>(numFrames));
+  for (int ch = 0; ch < numChannels; ++ch) {
+    const int acn = layout.acn[ch];
+    if (acn < 0 || acn >= numAcn) {
+      continue;
+    }
+    float* out = scratch_.getChannel(static_cast<size_t>(acn));
+    for (int n = 0; n < numFrames; ++n) {
+      out[n] = interleaved[n * numChannels + ch] * (gainStart + delta * static_cast<float>(n + 1));
+    }
+  }
+
+  if (reverbSend > 0.f) {
+    const float* omni = scratch_.getChannel(0);
+    for (int n = 0; n < numFrames; ++n) {
+      context.reverbSend[n] += omni[n] * reverbSend;
+    }
+  }
+
+  const ProfilerScope profile(context.profiler, ProfilerStage::ROTATION);
+  updateMatrix(order, context.listenerRotation, bedRotation, focus);
+  const float* inputs[AmbisonicRotator::kMaxChannels];
+  for (int ch = 0; ch < numAcn; ++ch) {
+    inputs[ch] = scratch_.getChannel(static_cast<size_t>(ch));
+  }
+  rotator_.processAdd(inputs, context.ambisonic, numAcn, numFrames);
+}
+} // namespace TBE
@@ -0,0 +1,89 @@
+#ifndef FBA_BEDRENDERER_H
+#define FBA_BEDRENDERER_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include "RenderContext.h"
+#include "dsp/AmbisonicRotator.h"
+#include "utils/AudioBuffer.h"
+
+namespace TBE {
+/// How the channels of a spatial audio format map onto the engine's mixes
+struct BedLayout {
+  static const int kMaxInputChannels = 18;
+
+  int order{0}; /// Ambisonic order needed to hold the ambisonic channels
+  int acn[kMaxInputChannels]; /// ACN channel for each input channel, or -1
+  int headlockedLeft{-1}; /// Input channel sent to the left head-locked output, or -1
+  int headlockedRight{-1}; /// Input channel sent to the right head-locked output, or -1
+  float headlockedGain{1.f};
+
+  /// Fill in the layout for a channel map
+  /// @return False if the map has no spatial meaning (UNKNOWN, INVALID)
+  static bool fromChannelMap(ChannelMap map, BedLayout& layout);
+
+  /// Guess the channel map of an asset without metadata from its number of channels. Mono and
+  /// stereo are head-locked, 8 and 10 channels are TBE, everything else is ambiX.
+  /// @return The map, or INVALID if no map has that number of channels
+  static ChannelMap mapForChannelCount(int numChannels);
+};
+
+/// Focus settings of a bed
+struct FocusSettings {
+  bool enabled{false};
+  bool followListener{false};
+  float offFocusLevelDb{0.f}; /// Between -24 and 0
+  float widthDegrees{90.f}; /// Between 40 and 120
+  TBQuat orientation = TBQuat::identity();
+};
+
+/// Renders a spatial audio bed (TBE or ambiX, with optional head-locked channels) into the listener
+/// frame: the sound field is rotated by the listener and bed orientations and, when focus is
+/// enabled, weighted by a cosine bump around the focus direction.
+class BedRenderer {
+ public:
+  explicit BedRenderer(int maxBufferSize);
+
+  /// Render a block
+  /// @param interleaved Input frames
+  /// @param numChannels Number of interleaved input channels
+  /// @param layout Channel layout of the input
+  /// @param bedRotation Orientation of the bed in the world
+  /// @param focus Focus settings
+  /// @param gainStart Gain at the start of the block
+  /// @param gainEnd Gain at the end of the block
+  /// @param reverbSend Gain of the send to the master reverb, 0 to skip
+  /// @param context Render context, numFrames frames are rendered
+  void render(
+      const float* interleaved,
+      int numChannels,
+      const BedLayout& layout,
+      TBQuat bedRotation,
+      const FocusSettings& focus,
+      float gainStart,
+      float gainEnd,
+      float reverbSend,
+      const RenderContext& context);
+
+  /// Reset the rotation interpolation, e.g. when playback restarts
+  void reset();
+
+ private:
+  void updateMatrix(int order, TBQuat rotation, TBQuat bedRotation, const FocusSettings& focus);
+
+  AudioBuffer scratch_;
+  AmbisonicRotator rotator_;
+  float matrix_[AmbisonicRotator::kMaxChannels * AmbisonicRotator::kMaxChannels];
+  bool hasMatrix_{false};
+  int lastOrder_{-1};
+  TBQuat lastRotation_ = TBQuat::identity();
+  TBQuat lastBedRotation_ = TBQuat::identity();
+  FocusSettings lastFocus_;
+};
+} // namespace TBE
+
+#endif // FBA_BEDRENDERER_H
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "BusGraph.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace TBE {
+/// Ramp applied when a gain change doesn't specify one, to avoid clicks
+static const float kMinRampMs = 5.f;
+
+BusGraph::BusGraph(float sampleRate) : sampleRate_(sampleRate) {
+  nodes_.emplace_back(new Node());
+  nodes_.back()->name = "master";
+}
+
+Bus BusGraph::getMasterBus() const {
+  return nodes_.front().get();
+}
+
+BusGraph::Node* BusGraph::find(Bus bus) const {
+  for (const auto& node : nodes_) {
+    if (node.get() == bus) {
+      return node.get();
+    }
+  }
+  return nullptr;
+}
+
+bool BusGraph::contains(Bus bus) const {
+  return bus && find(bus) != nullptr;
+}
+
+EngineError BusGraph::createBus(Bus& bus) {
+  std::unique_ptr<Node> node(new Node());
+  node->name = "bus" + std::to_string(nextId_++);
+  bus = node.get();
+  nodes_.push_back(std::move(node));
+  updateOrder();
+  return EngineError::OK;
+}
+
+EngineError BusGraph::destroyBus(Bus& bus) {
+  Node* node = find(bus);
+  if (!node || node == getMasterBus()) {
+    return EngineError::INVALID_PARAM;
+  }
+  for (auto& other : nodes_) {
+    if (other->output == node) {
+      other->output = nullptr;
+    }
+  }
+  nodes_.erase(std::find_if(nodes_.begin(), nodes_.end(), [node](const std::unique_ptr<Node>& n) {
+    return n.get() == node;
+  }));
+  bus = nullptr;
+  updateOrder();
+  return EngineError::OK;
+}
+
+EngineError BusGraph::connect(Bus srcBus, Bus destBus) {
+  Node* src = find(srcBus);
+  Node* dest = find(destBus);
+  if (!src || !dest || src == getMasterBus()) {
+    return EngineError::INVALID_PARAM;
+  }
+  // Reject cycles: src must not be downstream of dest
+  for (Node* node = dest; node; node = node->output) {
+    if (node == src) {
+      return EngineError::INVALID_PARAM;
+    }
+  }
+  src->output = dest;
+  updateOrder();
+  return EngineError::OK;
+}
+
+EngineError BusGraph::disconnectOutput(Bus bus) {
+  Node* node = find(bus);
+  if (!node || node == getMasterBus()) {
+    return EngineError::INVALID_PARAM;
+  }
+  node->output = nullptr;
+  updateOrder();
+  return EngineError::OK;
+}
+
+EngineError BusGraph::setGain(Bus bus, float gain, float rampTimeMs) {
+  Node* node = find(bus);
+  if (!node || gain < 0.f || rampTimeMs < 0.f) {
+    return EngineError::INVALID_PARAM;
+  }
+  const float rampMs = std::max(rampTimeMs, kMinRampMs);
+  node->gain.setTarget(gain, static_cast<int>(rampMs * 0.001f * sampleRate_));
+  return EngineError::OK;
+}
+
+EngineError BusGraph::getGain(Bus bus, float& gain) const {
+  const Node* node = find(bus);
+  if (!node) {
+    return EngineError::INVALID_PARAM;
+  }
+  gain = node->gain.getTarget();
+  return EngineError::OK;
+}
+
+EngineError BusGraph::setName(Bus bus, const char* name) {
+  Node* node = find(bus);
+  if (!node || !name) {
+    return EngineError::INVALID_PARAM;
+  }
+  node->name.assign(name, strnlen(name, AudioEngine::AUDIO360_MAX_BUS_NAME_SIZE - 1));
+  return EngineError::OK;
+}
+
+EngineError BusGraph::getName(Bus bus, char* name, size_t size) const {
+  const Node* node = find(bus);
+  if (!node || !name || size == 0) {
+    return EngineError::INVALID_PARAM;
+  }
+  const size_t length = std::min(node->name.size(), size - 1);
+  std::memcpy(name, node->name.data(), length);
+  name[length] = '\0';
+  return EngineError::OK;
+}
+
+std::string BusGraph::getName(Bus bus) const {
+  const Node* node = find(bus);
+  return node ? node->name : std::string();
+}
+
+void BusGraph::updateOrder() {
+  size_t next = 0;
+  std::vector<Node*> stack;
+  // Roots are walked in creation order, starting with the master bus
+  for (auto& root : nodes_) {
+    if (root->output) {
+      continue;
+    }
+    stack.push_back(root.get());
+    while (!stack.empty()) {
+      Node* node = stack.back();
+      stack.pop_back();
+      node->order = next++;
+      // Pushed in reverse so that inputs are numbered in creation order
+      for (auto input = nodes_.rbegin(); input != nodes_.rend(); ++input) {
+        if ((*input)->output == node) {
+          stack.push_back(input->get());
+        }
+      }
+    }
+  }
+}
+
+void BusGraph::process(int numFrames) {
+  for (auto& node : nodes_) {
+    node->gain.process(numFrames, node->gainStart, node->gainEnd);
+  }
+  const Node* master = nodes_.front().get();
+  for (auto& node : nodes_) {
+    float start = 1.f;
+    float end = 1.f;
+    const Node* current = node.get();
+    // Chains can't be longer than the number of buses since cycles are rejected
+    for (size_t depth = 0; current && depth < nodes_.size(); ++depth) {
+      start *= current->gainStart;
+      end *= current->gainEnd;
+      if (current == master) {
+        break;
+      }
+      current = current->output;
+    }
+    const bool connected = current == master;
+    node->outputStart = connected ? start : 0.f;
+    node->outputEnd = connected ? end : 0.f;
+  }
+}
+
+void BusGraph::getOutputGain(Bus bus, float& start, float& end) const {
+  const Node* node = static_cast<const Node*>(bus);
+  start = node ? node->outputStart : 0.f;
+  end = node ? node->outputEnd : 0.f;
+}
+
+void BusGraph::toJson(std::string& json) const {
+  json += "[";
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    const Node* node = nodes_[i].get();
+    json += i == 0 ? "\n" : ",\n";
+    json += "    {\"name\": " + quote(node->name) + ", \"gain\": ";
+    json += std::to_string(node->gain.getTarget());
+    json += ", \"output\": ";
+    json += node->output ? quote(node->output->name) : std::string("null");
+    json += "}";
+  }
+  json += "\n  ]";
+}
+
+std::string BusGraph::quote(const std::string& text) {
+  std::string quoted = "\"";
+  for (const char c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      quoted += escaped;
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+} // namespace TBE
@@ -0,0 +1,96 @@
+#ifndef FBA_BUSGRAPH_H
+#define FBA_BUSGRAPH_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "TBE_AudioEngine.h"
+#include "dsp/Ramp.h"
+
+namespace TBE {
+/// Gain-only routing graph. Every bus has a ramped gain and an output bus; the gain applied to an
+/// object is the product of the gains along the chain from its output bus to the master bus. A bus
+/// that isn't connected to the master bus, directly or indirectly, is silent.
+///
+/// Structural changes (create, destroy, connect, names) and process() must be serialised by the
+/// caller, which the engine does with its graph mutex. Gain targets are lock-free.
+class BusGraph {
+ public:
+  explicit BusGraph(float sampleRate);
+
+  Bus getMasterBus() const;
+
+  /// @return True if the bus exists
+  bool contains(Bus bus) const;
+
+  EngineError createBus(Bus& bus);
+
+  /// Destroy a bus. Buses connected to it are disconnected. The master bus can't be destroyed.
+  EngineError destroyBus(Bus& bus);
+
+  /// Route srcBus into destBus
+  /// @return EngineError::INVALID_PARAM if a bus doesn't exist or the connection creates a cycle
+  EngineError connect(Bus srcBus, Bus destBus);
+
+  EngineError disconnectOutput(Bus bus);
+
+  EngineError setGain(Bus bus, float gain, float rampTimeMs);
+  EngineError getGain(Bus bus, float& gain) const;
+  EngineError setName(Bus bus, const char* name);
+  EngineError getName(Bus bus, char* name, size_t size) const;
+
+  /// @return The name of a bus, or an empty string
+  std::string getName(Bus bus) const;
+
+  /// Audio thread: advance the gain ramps by one block
+  void process(int numFrames);
+
+  /// Position of a bus in a depth-first walk from the master bus: the buses feeding into a bus,
+  /// directly or not, have the positions right after it. Buses that aren't connected to the master
+  /// bus come after the others.
+  /// @param bus The bus, or nullptr for a disconnected object, which comes last
+  size_t getOrder(Bus bus) const {
+    return bus ? static_cast<const Node*>(bus)->order : nodes_.size();
+  }
+
+  /// Audio thread: gain ramp over the last processed block from a bus to the output, including
+  /// the master bus
+  /// @param bus The bus, or nullptr for a disconnected object
+  void getOutputGain(Bus bus, float& start, float& end) const;
+
+  /// Append the graph as a JSON array of buses to a string
+  void toJson(std::string& json) const;
+
+  /// @return A string as a quoted and escaped JSON string
+  static std::string quote(const std::string& text);
+
+ private:
+  struct Node {
+    std::string name;
+    Node* output{nullptr};
+    LinearRamp gain{1.f};
+    float gainStart{1.f};
+    float gainEnd{1.f};
+    float outputStart{1.f}; // Product of the gains along the chain to the output
+    float outputEnd{1.f};
+    size_t order{0}; // See getOrder()
+  };
+
+  Node* find(Bus bus) const;
+
+  /// Number the buses for getOrder(), after every structural change
+  void updateOrder();
+
+  const float sampleRate_;
+  std::vector<std::unique_ptr<Node>> nodes_; // The first node is the master bus
+  int nextId_{1};
+};
+} // namespace TBE
+
+#endif // FBA_BUSGRAPH_H
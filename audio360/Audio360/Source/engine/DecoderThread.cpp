@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "DecoderThread.h"
+#include <algorithm>
+#include <chrono>
+#include "StreamingSource.h"
+#include "Tracer.h"
+#include "utils/ThreadScheduling.h"
+#include "utils/Timer.h"
+
+namespace TBE {
+/// Upper bound on how long the thread sleeps when nobody notifies it
+static const auto kPollInterval = std::chrono::milliseconds(5);
+
+/// Chunks decoded per source before moving on to the next one, so that one large buffer cannot
+/// starve the others
+static const int kChunksPerSource = 4;
+
+DecoderThread::DecoderThread(Tracer* tracer) : tracer_(tracer) {}
+
+DecoderThread::~DecoderThread() {
+  stop();
+}
+
+void DecoderThread::start() {
+  std::lock_guard<std::mutex> lock(decoderMutex_);
+  if (running_) {
+    return;
+  }
+  running_ = true;
+  thread_ = std::thread(&DecoderThread::run, this);
+}
+
+void DecoderThread::stop() {
+  {
+    std::lock_guard<std::mutex> lock(decoderMutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  wakeUp_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+EngineError DecoderThread::setScheduling(const ThreadScheduling& scheduling) {
+  std::lock_guard<std::mutex> lock(decoderMutex_);
+  if (!running_) {
+    return EngineError::NOT_INITIALISED;
+  }
+  return applyThreadScheduling(thread_, scheduling);
+}
+
+void DecoderThread::add(StreamingSource* source) {
+  {
+    std::lock_guard<std::mutex> lock(decoderMutex_);
+    if (std::find(sources_.begin(), sources_.end(), source) == sources_.end()) {
+      sources_.push_back(source);
+    }
+    notified_ = true;
+  }
+  wakeUp_.notify_one();
+}
+
+void DecoderThread::remove(StreamingSource* source) {
+  std::lock_guard<std::mutex> lock(decoderMutex_);
+  sources_.erase(std::remove(sources_.begin(), sources_.end(), source), sources_.end());
+}
+
+void DecoderThread::notify() {
+  {
+    std::lock_guard<std::mutex> lock(decoderMutex_);
+    notified_ = true;
+  }
+  wakeUp_.notify_one();
+}
+
+size_t DecoderThread::getLastPassTimeMicroSec() const {
+  return lastPassTime_.load(std::memory_order_relaxed);
+}
+
+StageTiming DecoderThread::getPassTiming() const {
+  return passTimes_.summarise();
+}
+
+void DecoderThread::run() {
+  Tracer::setCurrentThreadName("decoder");
+  std::unique_lock<std::mutex> lock(decoderMutex_);
+  while (running_) {
+    Timer timer;
+    bool decoded = false;
+    bool busy = true;
+    while (busy && running_) {
+      busy = false;
+      for (size_t i = 0; i < sources_.size(); ++i) {
+        StreamingSource* source = sources_[i];
+        if (source->needsData()) {
+          const TraceScope trace(tracer_, "decode", "source", static_cast<int64_t>(i));
+          decoded = true;
+          busy = source->fill(kChunksPerSource) || busy;
+        }
+      }
+      if (busy) {
+        // Let add/remove through between passes
+        lock.unlock();
+        std::this_thread::yield();
+        lock.lock();
+      }
+    }
+    lastPassTime_.store(timer.getElapsedMicroSec(), std::memory_order_relaxed);
+    if (decoded) {
+      passTimes_.record(timer.getElapsedNanoSec());
+    }
+
+    wakeUp_.wait_for(lock, kPollInterval, [this] { return notified_ || !running_; });
+    notified_ = false;
+  }
+}
+} // namespace TBE
@@ -0,0 +1,66 @@
+#ifndef FBA_DECODERTHREAD_H
+#define FBA_DECODERTHREAD_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "TBE_AudioEngineDefinitions.h"
+#include "utils/TimingWindow.h"
+
+namespace TBE {
+class StreamingSource;
+class Tracer;
+
+/// Background thread that keeps the streaming buffers of all open sources full
+class DecoderThread {
+ public:
+  /// @param tracer Records each decode job, or nullptr
+  explicit DecoderThread(Tracer* tracer = nullptr);
+  ~DecoderThread();
+
+  void start();
+  void stop();
+
+  /// Apply a scheduling policy, priority and CPU affinity to the thread, which must be started
+  /// @return Relevant error or EngineError::OK
+  EngineError setScheduling(const ThreadScheduling& scheduling);
+
+  /// Add a source to service. The source must stay valid until removed.
+  void add(StreamingSource* source);
+
+  /// Remove a source. Blocks until the thread is no longer using it.
+  void remove(StreamingSource* source);
+
+  /// Wake the thread up, e.g. after a seek or when the audio thread has consumed data
+  void notify();
+
+  /// @return The time spent decoding in the last pass, in microseconds
+  size_t getLastPassTimeMicroSec() const;
+
+  /// @return The time spent in the last passes that decoded anything
+  StageTiming getPassTiming() const;
+
+ private:
+  void run();
+
+  Tracer* const tracer_;
+  std::thread thread_;
+  std::mutex decoderMutex_; // Guards sources_; held while a pass is decoding
+  std::condition_variable wakeUp_;
+  std::vector<StreamingSource*> sources_;
+  bool running_{false};
+  bool notified_{false};
+  std::atomic<size_t> lastPassTime_{0};
+  TimingWindow passTimes_;
+};
+} // namespace TBE
+
+#endif // FBA_DECODERTHREAD_H
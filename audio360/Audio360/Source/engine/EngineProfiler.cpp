@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "EngineProfiler.h"
+#include <thread>
+#include "AudioObjectImpl.h"
+
+namespace TBE {
+const size_t StageStatistics::kTimingWindow;
+const size_t StageStatistics::kMaxObjectCosts;
+const size_t EngineProfiler::kNumStages;
+
+void RenderCost::record(uint64_t nanoSec) {
+  ++numRecorded_;
+  const uint64_t window = std::min<uint64_t>(numRecorded_, StageStatistics::kTimingWindow);
+  mean_ += (static_cast<float>(nanoSec) - mean_) / static_cast<float>(window);
+  max_ = std::max(max_, nanoSec);
+  if (++numBlocks_ == StageStatistics::kTimingWindow) {
+    previousMax_ = max_;
+    max_ = 0;
+    numBlocks_ = 0;
+  }
+}
+
+EngineProfiler::EngineProfiler() {
+  for (auto& time : blockTime_) {
+    time.store(0);
+  }
+  for (size_t i = 0; i < StageStatistics::kMaxObjectCosts; ++i) {
+    costObjects_[i].store(nullptr);
+    costMeans_[i].store(0.f);
+    costMaxima_[i].store(0.f);
+  }
+}
+
+void EngineProfiler::rankObjects(const std::vector<std::unique_ptr<AudioObjectImpl>>& objects) {
+  // Insertion into the few most expensive so far, most expensive first
+  AudioObjectCost costs[StageStatistics::kMaxObjectCosts];
+  size_t numCosts = 0;
+  for (const auto& object : objects) {
+    const RenderCost& cost = object->getRenderCost();
+    const float mean = cost.getMeanNanoSec() * 1e-3f;
+    if (numCosts == StageStatistics::kMaxObjectCosts && mean <= costs[numCosts - 1].meanMicroSec) {
+      continue;
+    }
+    size_t i = std::min(numCosts, StageStatistics::kMaxObjectCosts - 1);
+    for (; i > 0 && costs[i - 1].meanMicroSec < mean; --i) {
+      costs[i] = costs[i - 1];
+    }
+    costs[i].object = object.get();
+    costs[i].meanMicroSec = mean;
+    costs[i].maxMicroSec = static_cast<float>(cost.getMaxNanoSec()) * 1e-3f;
+    numCosts = std::min(numCosts + 1, StageStatistics::kMaxObjectCosts);
+  }
+  publishCosts(costs, numCosts);
+}
+
+void EngineProfiler::publishCosts(const AudioObjectCost* costs, size_t numCosts) {
+  const uint32_t sequence = costSequence_.load(std::memory_order_relaxed);
+  costSequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = 0; i < numCosts; ++i) {
+    costObjects_[i].store(costs[i].object, std::memory_order_relaxed);
+    costMeans_[i].store(costs[i].meanMicroSec, std::memory_order_relaxed);
+    costMaxima_[i].store(costs[i].maxMicroSec, std::memory_order_relaxed);
+  }
+  numCosts_.store(numCosts, std::memory_order_relaxed);
+  costSequence_.store(sequence + 2, std::memory_order_release);
+}
+
+void EngineProfiler::endBlock() {
+  for (size_t stage = 0; stage < kNumStages; ++stage) {
+    windows_[stage].record(blockTime_[stage].exchange(0, std::memory_order_relaxed));
+  }
+
+  const uint32_t objects = binauralObjects_.exchange(0, std::memory_order_relaxed);
+  const uint32_t crossfades = binauralCrossfades_.exchange(0, std::memory_order_relaxed);
+  objectTotal_ = objectTotal_ + objects - objectHistory_[historyIndex_];
+  crossfadeTotal_ = crossfadeTotal_ + crossfades - crossfadeHistory_[historyIndex_];
+  objectHistory_[historyIndex_] = objects;
+  crossfadeHistory_[historyIndex_] = crossfades;
+  historyIndex_ = (historyIndex_ + 1) % StageStatistics::kTimingWindow;
+  lastBinauralObjects_.store(objects, std::memory_order_relaxed);
+  crossfadeFraction_.store(
+      objectTotal_ > 0 ? static_cast<float>(crossfadeTotal_) / static_cast<float>(objectTotal_)
+                       : 0.f,
+      std::memory_order_relaxed);
+}
+
+void EngineProfiler::getStatistics(StageStatistics& stats) const {
+  StageTiming* const timings[kNumStages] = {
+      &stats.callbackTiming,
+      &stats.decodeTiming,
+      &stats.binauralConvolutionTiming,
+      &stats.rotationTiming,
+      &stats.binauralDecodeTiming,
+      &stats.reverbTiming,
+      &stats.loudnessTiming,
+      &stats.mixTiming,
+  };
+  for (size_t stage = 0; stage < kNumStages; ++stage) {
+    *timings[stage] = windows_[stage].summarise();
+  }
+  stats.numBinauralObjects = lastBinauralObjects_.load(std::memory_order_relaxed);
+  stats.binauralCrossfadeFraction = crossfadeFraction_.load(std::memory_order_relaxed);
+
+  for (;;) {
+    const uint32_t sequence = costSequence_.load(std::memory_order_acquire);
+    if (sequence & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    stats.numObjectCosts = numCosts_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < stats.numObjectCosts; ++i) {
+      stats.objectCosts[i].object = costObjects_[i].load(std::memory_order_relaxed);
+      stats.objectCosts[i].meanMicroSec = costMeans_[i].load(std::memory_order_relaxed);
+      stats.objectCosts[i].maxMicroSec = costMaxima_[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (costSequence_.load(std::memory_order_relaxed) == sequence) {
+      return;
+    }
+  }
+}
+} // namespace TBE
@@ -0,0 +1,144 @@
+#ifndef FBA_ENGINEPROFILER_H
+#define FBA_ENGINEPROFILER_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "TBE_AudioEngineDefinitions.h"
+#include "utils/Timer.h"
+#include "utils/TimingWindow.h"
+
+namespace TBE {
+class AudioObjectImpl;
+
+/// Stages of a block timed for StageStatistics
+enum class ProfilerStage {
+  BLOCK = 0,
+  DECODE,
+  BINAURAL_CONVOLUTION,
+  ROTATION,
+  BINAURAL_DECODE,
+  REVERB,
+  LOUDNESS,
+  MIX,
+  NUM_STAGES,
+};
+
+/// Time spent rendering one object, kept by the audio thread
+class RenderCost {
+ public:
+  /// Audio thread: record the time spent on a block
+  void record(uint64_t nanoSec);
+
+  float getMeanNanoSec() const {
+    return mean_;
+  }
+
+  uint64_t getMaxNanoSec() const {
+    return std::max(max_, previousMax_);
+  }
+
+ private:
+  float mean_{0.f}; // Moving average, a cumulative one until a window has been recorded
+  uint64_t numRecorded_{0};
+  uint64_t max_{0}; // Over the current window
+  uint64_t previousMax_{0}; // Over the last complete window
+  size_t numBlocks_{0}; // In the current window
+};
+
+/// Times the stages of every block. Stages add their time to the block from the audio thread,
+/// or from threads rendering for it, with relaxed atomics. At the end of the block the totals go
+/// into a TimingWindow per stage, and the most expensive objects are ranked and published through
+/// a sequence lock. Nothing locks, so it stays on in production: the cost is two clock reads per
+/// timed scope and per object.
+class EngineProfiler {
+ public:
+  static const size_t kNumStages = static_cast<size_t>(ProfilerStage::NUM_STAGES);
+
+  EngineProfiler();
+
+  /// Audio thread, or a thread rendering for it: add time to a stage of the current block
+  void add(ProfilerStage stage, uint64_t nanoSec) {
+    blockTime_[static_cast<size_t>(stage)].fetch_add(nanoSec, std::memory_order_relaxed);
+  }
+
+  /// Audio thread, or a thread rendering for it: count an object rendered binaurally in the
+  /// current block
+  /// @param crossfaded True if the object crossfaded between two HRIRs
+  void countBinauralObject(bool crossfaded) {
+    binauralObjects_.fetch_add(1, std::memory_order_relaxed);
+    if (crossfaded) {
+      binauralCrossfades_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  /// Any thread: the number of objects rendered binaurally in the last closed block
+  size_t getNumBinauralObjects() const {
+    return lastBinauralObjects_.load(std::memory_order_relaxed);
+  }
+
+  /// Audio thread, with the graph mutex held: publish the most expensive objects
+  void rankObjects(const std::vector<std::unique_ptr<AudioObjectImpl>>& objects);
+
+  /// Audio thread: close the current block, recording the time of every stage and the binaural
+  /// objects
+  void endBlock();
+
+  /// Any thread: fill in the stage timings and object costs
+  void getStatistics(StageStatistics& stats) const;
+
+ private:
+  void publishCosts(const AudioObjectCost* costs, size_t numCosts);
+
+  std::atomic<uint64_t> blockTime_[kNumStages];
+  TimingWindow windows_[kNumStages];
+
+  // Binaural objects and crossfades of the current block, then of each of the last
+  // kTimingWindow blocks, written by the audio thread only
+  std::atomic<uint32_t> binauralObjects_{0};
+  std::atomic<uint32_t> binauralCrossfades_{0};
+  uint32_t objectHistory_[StageStatistics::kTimingWindow] = {};
+  uint32_t crossfadeHistory_[StageStatistics::kTimingWindow] = {};
+  size_t historyIndex_{0};
+  uint64_t objectTotal_{0};
+  uint64_t crossfadeTotal_{0};
+  std::atomic<size_t> lastBinauralObjects_{0};
+  std::atomic<float> crossfadeFraction_{0.f};
+
+  // Sequence lock: odd while the published costs are being written
+  std::atomic<uint32_t> costSequence_{0};
+  std::atomic<size_t> numCosts_{0};
+  std::atomic<AudioObject*> costObjects_[StageStatistics::kMaxObjectCosts];
+  std::atomic<float> costMeans_[StageStatistics::kMaxObjectCosts];
+  std::atomic<float> costMaxima_[StageStatistics::kMaxObjectCosts];
+};
+
+/// Adds the time spent in its scope to a stage of the current block, if there is a profiler
+class ProfilerScope {
+ public:
+  ProfilerScope(EngineProfiler* profiler, ProfilerStage stage)
+      : profiler_(profiler), stage_(stage) {}
+
+  ~ProfilerScope() {
+    if (profiler_) {
+      profiler_->add(stage_, timer_.getElapsedNanoSec());
+    }
+  }
+
+ private:
+  EngineProfiler* const profiler_;
+  const ProfilerStage stage_;
+  const Timer timer_;
+};
+} // namespace TBE
+
+#endif // FBA_ENGINEPROFILER_H
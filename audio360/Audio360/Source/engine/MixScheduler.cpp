@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "MixScheduler.h"
+#include <algorithm>
+#include "EngineProfiler.h"
+#include "Tracer.h"
+#include "utils/Timer.h"
+
+namespace TBE {
+static const size_t kNumAmbisonicChannels = static_cast<size_t>(SphericalHarmonics::kMaxChannels);
+static const size_t kFirstBinauralAmbisonicChannel = kNumAmbisonicChannels + 3;
+
+const size_t MixScheduler::kObjectsPerGroup;
+const size_t MixScheduler::kNumMixChannels;
+
+MixScheduler::MixScheduler(size_t numThreads, size_t maxObjects, int bufferSize, Tracer* tracer)
+    : bufferSize_(bufferSize),
+      tracer_(tracer),
+      spatial_(maxObjects),
+      pool_(numThreads, [] { Tracer::setCurrentThreadName("mixer"); }) {
+  keys_.reserve(maxObjects);
+  order_.reserve(maxObjects);
+  const size_t maxGroups =
+      std::max<size_t>(1, (maxObjects + kObjectsPerGroup - 1) / kObjectsPerGroup);
+  numPlaying_.resize(maxGroups, 0);
+  for (size_t group = 1; group < maxGroups; ++group) {
+    std::unique_ptr<GroupMix> mix(new GroupMix());
+    mix->channels.resize(kNumMixChannels, static_cast<size_t>(bufferSize_));
+    groupMixes_.push_back(std::move(mix));
+  }
+}
+
+size_t MixScheduler::render(
+    const std::vector<std::unique_ptr<AudioObjectImpl>>& objects,
+    const BusGraph& buses,
+    const RenderContext& context) {
+  if (objects.empty()) {
+    return 0;
+  }
+
+  // Objects of a subtree end up next to each other, in creation order
+  keys_.clear();
+  for (size_t i = 0; i < objects.size(); ++i) {
+    keys_.emplace_back(buses.getOrder(objects[i]->getOutputBus()), i);
+  }
+  std::sort(keys_.begin(), keys_.end());
+  order_.clear();
+  for (const auto& key : keys_) {
+    order_.push_back(objects[key.second].get());
+  }
+
+  numGroups_ = (order_.size() + kObjectsPerGroup - 1) / kObjectsPerGroup;
+  if (numGroups_ > numPlaying_.size()) {
+    // More objects than expected: allocate rather than change how they are mixed
+    numPlaying_.resize(numGroups_, 0);
+    while (groupMixes_.size() + 1 < numGroups_) {
+      std::unique_ptr<GroupMix> mix(new GroupMix());
+      mix->channels.resize(kNumMixChannels, static_cast<size_t>(bufferSize_));
+      groupMixes_.push_back(std::move(mix));
+    }
+  }
+  context_ = &context;
+
+  {
+    const TraceScope trace(tracer_, "spatial state");
+    spatial_.clear();
+    for (AudioObjectImpl* object : order_) {
+      object->prepare(spatial_);
+    }
+    spatial_.compute(context.listenerRotation, context.listenerPosition, context.listenerScale);
+  }
+
+  pool_.run(numGroups_, &MixScheduler::renderGroup, this);
+  if (numGroups_ > 1) {
+    const ProfilerScope profile(context.profiler, ProfilerStage::MIX);
+    pool_.run(kNumMixChannels, &MixScheduler::mixChannel, this);
+  }
+
+  size_t numPlaying = 0;
+  for (size_t group = 0; group < numGroups_; ++group) {
+    numPlaying += numPlaying_[group];
+  }
+  return numPlaying;
+}
+
+void MixScheduler::renderGroup(size_t group, void* userData) {
+  auto* self = static_cast<MixScheduler*>(userData);
+  const TraceScope trace(self->tracer_, "mix group", "group", static_cast<int64_t>(group));
+
+  RenderContext context = *self->context_;
+  context.spatial = &self->spatial_;
+  if (group > 0) {
+    GroupMix& mix = *self->groupMixes_[group - 1];
+    mix.channels.clear();
+    for (size_t acn = 0; acn < kNumAmbisonicChannels; ++acn) {
+      mix.ambisonic[acn] = mix.channels.getChannel(acn);
+    }
+    mix.headlocked[0] = mix.channels.getChannel(kNumAmbisonicChannels);
+    mix.headlocked[1] = mix.channels.getChannel(kNumAmbisonicChannels + 1);
+    context.ambisonic = mix.ambisonic;
+    context.headlocked = mix.headlocked;
+    context.reverbSend = mix.channels.getChannel(kNumAmbisonicChannels + 2);
+    if (context.binauralAmbisonic) {
+      for (size_t acn = 0; acn < kNumAmbisonicChannels; ++acn) {
+        mix.binauralAmbisonic[acn] = mix.channels.getChannel(kFirstBinauralAmbisonicChannel + acn);
+      }
+      context.binauralAmbisonic = mix.binauralAmbisonic;
+    }
+  }
+
+  const size_t begin = group * kObjectsPerGroup;
+  const size_t end = std::min(begin + kObjectsPerGroup, self->order_.size());
+  size_t numPlaying = 0;
+  for (size_t i = begin; i < end; ++i) {
+    AudioObjectImpl* object = self->order_[i];
+    const Timer objectTimer;
+    object->render(context);
+    object->getRenderCost().record(objectTimer.getElapsedNanoSec());
+    numPlaying += object->isPlaying() ? 1 : 0;
+  }
+  self->numPlaying_[group] = numPlaying;
+}
+
+void MixScheduler::mixChannel(size_t channel, void* userData) {
+  auto* self = static_cast<MixScheduler*>(userData);
+  float* out = getMixChannel(*self->context_, channel);
+  if (!out) {
+    return;
+  }
+  const size_t numFrames = static_cast<size_t>(self->context_->numFrames);
+  for (size_t group = 1; group < self->numGroups_; ++group) {
+    const float* in = self->groupMixes_[group - 1]->channels.getChannel(channel);
+    for (size_t n = 0; n < numFrames; ++n) {
+      out[n] += in[n];
+    }
+  }
+}
+
+float* MixScheduler::getMixChannel(const RenderContext& context, size_t channel) {
+  if (channel < kNumAmbisonicChannels) {
+    return context.ambisonic[channel];
+  }
+  if (channel < kNumAmbisonicChannels + 2) {
+    return context.headlocked[channel - kNumAmbisonicChannels];
+  }
+  if (channel < kFirstBinauralAmbisonicChannel) {
+    return context.reverbSend;
+  }
+  return context.binauralAmbisonic
+      ? context.binauralAmbisonic[channel - kFirstBinauralAmbisonicChannel]
+      : nullptr;
+}
+} // namespace TBE
@@ -0,0 +1,98 @@
+#ifndef FBA_MIXSCHEDULER_H
+#define FBA_MIXSCHEDULER_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "AudioObjectImpl.h"
+#include "BusGraph.h"
+#include "ObjectSpatialStore.h"
+#include "RenderContext.h"
+#include "dsp/SphericalHarmonics.h"
+#include "utils/AudioBuffer.h"
+#include "utils/WorkStealingPool.h"
+
+namespace TBE {
+class Tracer;
+
+/// Renders the AudioObjects of a block, on a WorkStealingPool if there is more than one thread.
+///
+/// Objects are sorted by the position of their output bus in the bus graph, so that the objects
+/// of a bus subtree are rendered next to each other, and cut into groups of kObjectsPerGroup. The
+/// first group is rendered straight into the mix, every other group into its own mix buffers,
+/// which are then added to the mix in group order. The groups and the order of every addition only
+/// depend on the objects and the bus graph, never on the number of threads or on which thread
+/// rendered what, so parallel mixes are bit-identical to serial ones.
+///
+/// Before the groups are rendered, the positional objects add their spatial parameters to an
+/// ObjectSpatialStore, whose distances, directions and gains are computed for all of them at once.
+class MixScheduler {
+ public:
+  /// Objects rendered by a task. Blocks with fewer objects are mixed exactly as before groups.
+  static const size_t kObjectsPerGroup = 16;
+
+  /// @param numThreads Threads rendering objects, including the audio thread. 0 or 1 renders on
+  /// the audio thread only.
+  /// @param maxObjects Number of objects that can exist, so that no group is allocated later
+  /// @param tracer Records every group, or nullptr
+  MixScheduler(size_t numThreads, size_t maxObjects, int bufferSize, Tracer* tracer);
+
+  size_t getNumThreads() const {
+    return pool_.getNumThreads();
+  }
+
+  /// Apply a scheduling policy, priority and CPU affinity to the mixer threads
+  /// @return Relevant error or EngineError::OK
+  EngineError setScheduling(const ThreadScheduling& scheduling) {
+    return pool_.setScheduling(scheduling);
+  }
+
+  /// Audio thread, with the graph mutex held: render every object into the mix of a block
+  /// @return Number of objects playing
+  size_t render(
+      const std::vector<std::unique_ptr<AudioObjectImpl>>& objects,
+      const BusGraph& buses,
+      const RenderContext& context);
+
+ private:
+  /// Mix channels: the ambisonic mix, the head-locked mix, the reverb send and the binaural
+  /// ambisonic bus
+  static const size_t kNumMixChannels = 2 * SphericalHarmonics::kMaxChannels + 3;
+
+  /// Mix buffers of a group rendered beside the mix
+  struct GroupMix {
+    AudioBuffer channels;
+    float* ambisonic[SphericalHarmonics::kMaxChannels];
+    float* headlocked[2];
+    float* binauralAmbisonic[SphericalHarmonics::kMaxChannels];
+  };
+
+  static void renderGroup(size_t group, void* userData);
+  static void mixChannel(size_t channel, void* userData);
+
+  /// @return Mix channel of a context, see kNumMixChannels, or nullptr if the context has no
+  /// binaural ambisonic bus
+  static float* getMixChannel(const RenderContext& context, size_t channel);
+
+  const int bufferSize_;
+  Tracer* const tracer_;
+  std::vector<std::pair<size_t, size_t>> keys_; // Bus order and index of each object
+  std::vector<AudioObjectImpl*> order_;
+  std::vector<std::unique_ptr<GroupMix>> groupMixes_; // For every group but the first
+  std::vector<size_t> numPlaying_; // Per group
+  ObjectSpatialStore spatial_;
+  size_t numGroups_{0};
+  const RenderContext* context_{nullptr}; // Of the block being rendered
+  WorkStealingPool pool_;
+};
+} // namespace TBE
+
+#endif // FBA_MIXSCHEDULER_H
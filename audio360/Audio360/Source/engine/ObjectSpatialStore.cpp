@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "ObjectSpatialStore.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FBA_SPATIAL_SSE 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+// Square roots and divisions are only vectorised on AArch64
+#define FBA_SPATIAL_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace TBE {
+/// Attenuation of a directional source right behind it
+static const float kDirectivityMaxAttenuation = 0.5f;
+
+static const float kPi = 3.14159265358979323846f;
+
+const float ObjectSpatialStore::kMinDistance = 1e-4f;
+
+namespace {
+/// Everything the geometry of a source depends on besides its own position and rotation
+struct Listener {
+  float x;
+  float y;
+  float z;
+  float invScale;
+  TBVector columns[3]; // Of the matrix taking engine directions into the listener's frame
+};
+
+/// Computes the geometry of one source, and of the sources left over by the vector kernels
+void computeGeometryScalar(
+    const Listener& listener,
+    float positionX,
+    float positionY,
+    float positionZ,
+    float qx,
+    float qy,
+    float qz,
+    float qw,
+    float& distance,
+    float& directionX,
+    float& directionY,
+    float& directionZ,
+    float& cosAngle) {
+  const float x = (positionX - listener.x) * listener.invScale;
+  const float y = (positionY - listener.y) * listener.invScale;
+  const float z = (positionZ - listener.z) * listener.invScale;
+  distance = std::sqrt(x * x + y * y + z * z);
+  const float invDistance = distance > ObjectSpatialStore::kMinDistance ? 1.f / distance : 0.f;
+  const float ux = x * invDistance;
+  const float uy = y * invDistance;
+  const float uz = z * invDistance;
+
+  // The listener is at -u from the source
+  const float forwardX = 2.f * (qx * qz + qw * qy);
+  const float forwardY = 2.f * (qy * qz - qw * qx);
+  const float forwardZ = 1.f - 2.f * (qx * qx + qy * qy);
+  cosAngle = std::max(-1.f, std::min(1.f, -(forwardX * ux + forwardY * uy + forwardZ * uz)));
+
+  const TBVector* columns = listener.columns;
+  if (invDistance > 0.f) {
+    directionX = columns[0].x * ux + columns[1].x * uy + columns[2].x * uz;
+    directionY = columns[0].y * ux + columns[1].y * uy + columns[2].y * uz;
+    directionZ = columns[0].z * ux + columns[1].z * uy + columns[2].z * uz;
+  } else {
+    directionX = 0.f;
+    directionY = 0.f;
+    directionZ = 1.f;
+  }
+}
+
+#if FBA_SPATIAL_SSE
+/// The same as computeGeometryScalar(), for four sources
+inline void computeGeometrySse(
+    const Listener& listener,
+    const float* positionX,
+    const float* positionY,
+    const float* positionZ,
+    const float* rotationX,
+    const float* rotationY,
+    const float* rotationZ,
+    const float* rotationW,
+    float* distance,
+    float* directionX,
+    float* directionY,
+    float* directionZ,
+    float* cosAngle) {
+  const __m128 invScale = _mm_set1_ps(listener.invScale);
+  const __m128 x =
+      _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(positionX), _mm_set1_ps(listener.x)), invScale);
+  const __m128 y =
+      _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(positionY), _mm_set1_ps(listener.y)), invScale);
+  const __m128 z =
+      _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(positionZ), _mm_set1_ps(listener.z)), invScale);
+  const __m128 d = _mm_sqrt_ps(
+      _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+  _mm_storeu_ps(distance, d);
+  // All ones where the source is at the listener. 1 / 0 is masked out.
+  const __m128 atListener = _mm_cmple_ps(d, _mm_set1_ps(ObjectSpatialStore::kMinDistance));
+  const __m128 invDistance = _mm_andnot_ps(atListener, _mm_div_ps(_mm_set1_ps(1.f), d));
+  const __m128 ux = _mm_mul_ps(x, invDistance);
+  const __m128 uy = _mm_mul_ps(y, invDistance);
+  const __m128 uz = _mm_mul_ps(z, invDistance);
+
+  const __m128 qx = _mm_loadu_ps(rotationX);
+  const __m128 qy = _mm_loadu_ps(rotationY);
+  const __m128 qz = _mm_loadu_ps(rotationZ);
+  const __m128 qw = _mm_loadu_ps(rotationW);
+  const __m128 two = _mm_set1_ps(2.f);
+  const __m128 forwardX = _mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(qx, qz), _mm_mul_ps(qw, qy)));
+  const __m128 forwardY = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(qy, qz), _mm_mul_ps(qw, qx)));
+  const __m128 forwardZ = _mm_sub_ps(
+      _mm_set1_ps(1.f), _mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy))));
+  const __m128 dot = _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(forwardX, ux), _mm_mul_ps(forwardY, uy)), _mm_mul_ps(forwardZ, uz));
+  _mm_storeu_ps(
+      cosAngle,
+      _mm_max_ps(
+          _mm_set1_ps(-1.f), _mm_min_ps(_mm_set1_ps(1.f), _mm_sub_ps(_mm_setzero_ps(), dot))));
+
+  // Sources at the listener have a zero u, so only z needs fixing up
+  const TBVector* columns = listener.columns;
+  const auto rotate = [&](float cx, float cy, float cz) {
+    return _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(cx), ux), _mm_mul_ps(_mm_set1_ps(cy), uy)),
+        _mm_mul_ps(_mm_set1_ps(cz), uz));
+  };
+  _mm_storeu_ps(directionX, rotate(columns[0].x, columns[1].x, columns[2].x));
+  _mm_storeu_ps(directionY, rotate(columns[0].y, columns[1].y, columns[2].y));
+  _mm_storeu_ps(
+      directionZ,
+      _mm_or_ps(
+          _mm_and_ps(atListener, _mm_set1_ps(1.f)),
+          _mm_andnot_ps(atListener, rotate(columns[0].z, columns[1].z, columns[2].z))));
+}
+#endif
+
+#if FBA_SPATIAL_NEON
+/// The same as computeGeometryScalar(), for four sources
+inline void computeGeometryNeon(
+    const Listener& listener,
+    const float* positionX,
+    const float* positionY,
+    const float* positionZ,
+    const float* rotationX,
+    const float* rotationY,
+    const float* rotationZ,
+    const float* rotationW,
+    float* distance,
+    float* directionX,
+    float* directionY,
+    float* directionZ,
+    float* cosAngle) {
+  const float32x4_t invScale = vdupq_n_f32(listener.invScale);
+  const float32x4_t x =
+      vmulq_f32(vsubq_f32(vld1q_f32(positionX), vdupq_n_f32(listener.x)), invScale);
+  const float32x4_t y =
+      vmulq_f32(vsubq_f32(vld1q_f32(positionY), vdupq_n_f32(listener.y)), invScale);
+  const float32x4_t z =
+      vmulq_f32(vsubq_f32(vld1q_f32(positionZ), vdupq_n_f32(listener.z)), invScale);
+  const float32x4_t d =
+      vsqrtq_f32(vaddq_f32(vaddq_f32(vmulq_f32(x, x), vmulq_f32(y, y)), vmulq_f32(z, z)));
+  vst1q_f32(distance, d);
+  const uint32x4_t atListener = vcleq_f32(d, vdupq_n_f32(ObjectSpatialStore::kMinDistance));
+  const float32x4_t invDistance =
+      vbslq_f32(atListener, vdupq_n_f32(0.f), vdivq_f32(vdupq_n_f32(1.f), d));
+  const float32x4_t ux = vmulq_f32(x, invDistance);
+  const float32x4_t uy = vmulq_f32(y, invDistance);
+  const float32x4_t uz = vmulq_f32(z, invDistance);
+
+  const float32x4_t qx = vld1q_f32(rotationX);
+  const float32x4_t qy = vld1q_f32(rotationY);
+  const float32x4_t qz = vld1q_f32(rotationZ);
+  const float32x4_t qw = vld1q_f32(rotationW);
+  const float32x4_t two = vdupq_n_f32(2.f);
+  const float32x4_t forwardX = vmulq_f32(two, vaddq_f32(vmulq_f32(qx, qz), vmulq_f32(qw, qy)));
+  const float32x4_t forwardY = vmulq_f32(two, vsubq_f32(vmulq_f32(qy, qz), vmulq_f32(qw, qx)));
+  const float32x4_t forwardZ = vsubq_f32(
+      vdupq_n_f32(1.f), vmulq_f32(two, vaddq_f32(vmulq_f32(qx, qx), vmulq_f32(qy, qy))));
+  const float32x4_t dot = vaddq_f32(
+      vaddq_f32(vmulq_f32(forwardX, ux), vmulq_f32(forwardY, uy)), vmulq_f32(forwardZ, uz));
+  vst1q_f32(cosAngle, vmaxq_f32(vdupq_n_f32(-1.f), vminq_f32(vdupq_n_f32(1.f), vnegq_f32(dot))));
+
+  const TBVector* columns = listener.columns;
+  const auto rotate = [&](float cx, float cy, float cz) {
+    return vaddq_f32(vaddq_f32(vmulq_n_f32(ux, cx), vmulq_n_f32(uy, cy)), vmulq_n_f32(uz, cz));
+  };
+  vst1q_f32(directionX, rotate(columns[0].x, columns[1].x, columns[2].x));
+  vst1q_f32(directionY, rotate(columns[0].y, columns[1].y, columns[2].y));
+  vst1q_f32(
+      directionZ,
+      vbslq_f32(atListener, vdupq_n_f32(1.f), rotate(columns[0].z, columns[1].z, columns[2].z)));
+}
+#endif
+} // namespace
+
+ObjectSpatialStore::ObjectSpatialStore(size_t capacity) {
+  resize(std::max<size_t>(1, capacity));
+}
+
+void ObjectSpatialStore::resize(size_t capacity) {
+  for (auto* array : {&positionX_,
+                      &positionY_,
+                      &positionZ_,
+                      &rotationX_,
+                      &rotationY_,
+                      &rotationZ_,
+                      &rotationW_,
+                      &minDistance_,
+                      &maxDistance_,
+                      &factor_,
+                      &effectLevel_,
+                      &halfCone_,
+                      &distance_,
+                      &directionX_,
+                      &directionY_,
+                      &directionZ_,
+                      &attenuation_,
+                      &cosAngle_,
+                      &directivity_}) {
+    array->resize(capacity);
+  }
+  for (auto* array : {&mode_, &maxDistanceMute_, &directional_, &outsideCone_}) {
+    array->resize(capacity);
+  }
+}
+
+void ObjectSpatialStore::clear() {
+  numSources_ = 0;
+}
+
+size_t ObjectSpatialStore::add(
+    const TBVector& position,
+    const TBQuat& rotation,
+    AttenuationMode mode,
+    const AttenuationProps& attenuation,
+    bool directivity,
+    const DirectionalProps& directional) {
+  if (numSources_ == positionX_.size()) {
+    // More sources than expected: allocate rather than drop any
+    resize(2 * numSources_);
+  }
+  const size_t index = numSources_++;
+  positionX_[index] = position.x;
+  positionY_[index] = position.y;
+  positionZ_[index] = position.z;
+  rotationX_[index] = rotation.x;
+  rotationY_[index] = rotation.y;
+  rotationZ_[index] = rotation.z;
+  rotationW_[index] = rotation.w;
+  mode_[index] = static_cast<int32_t>(mode);
+  minDistance_[index] = attenuation.minimumDistance;
+  maxDistance_[index] = attenuation.maximumDistance;
+  factor_[index] = attenuation.factor;
+  maxDistanceMute_[index] = attenuation.maxDistanceMute ? 1 : 0;
+  directional_[index] = directivity ? 1 : 0;
+  effectLevel_[index] = directional.effectLevel;
+  halfCone_[index] = 0.5f * directional.coneArea;
+  return index;
+}
+
+void ObjectSpatialStore::computeGeometry(
+    const TBQuat& listenerRotation,
+    const TBVector& listenerPosition,
+    float scale) {
+  Listener listener;
+  listener.x = listenerPosition.x;
+  listener.y = listenerPosition.y;
+  listener.z = listenerPosition.z;
+  listener.invScale = 1.f / std::max(1e-6f, scale);
+  listener.columns[0] = TBQuat::antiRotateVectorByQuat(listenerRotation, TBVector(1.f, 0.f, 0.f));
+  listener.columns[1] = TBQuat::antiRotateVectorByQuat(listenerRotation, TBVector(0.f, 1.f, 0.f));
+  listener.columns[2] = TBQuat::antiRotateVectorByQuat(listenerRotation, TBVector::forward());
+
+  size_t i = 0;
+#if FBA_SPATIAL_SSE || FBA_SPATIAL_NEON
+  for (; i + 4 <= numSources_; i += 4) {
+#if FBA_SPATIAL_SSE
+    computeGeometrySse(
+#else
+    computeGeometryNeon(
+#endif
+        listener,
+        &positionX_[i],
+        &positionY_[i],
+        &positionZ_[i],
+        &rotationX_[i],
+        &rotationY_[i],
+        &rotationZ_[i],
+        &rotationW_[i],
+        &distance_[i],
+        &directionX_[i],
+        &directionY_[i],
+        &directionZ_[i],
+        &cosAngle_[i]);
+  }
+#endif
+  for (; i < numSources_; ++i) {
+    computeGeometryScalar(
+        listener,
+        positionX_[i],
+        positionY_[i],
+        positionZ_[i],
+        rotationX_[i],
+        rotationY_[i],
+        rotationZ_[i],
+        rotationW_[i],
+        distance_[i],
+        directionX_[i],
+        directionY_[i],
+        directionZ_[i],
+        cosAngle_[i]);
+  }
+}
+
+void ObjectSpatialStore::compute(
+    const TBQuat& listenerRotation,
+    const TBVector& listenerPosition,
+    float scale) {
+  computeGeometry(listenerRotation, listenerPosition, scale);
+
+  // Attenuation curves, only evaluating the curve each source uses
+  const int32_t logarithmic = static_cast<int32_t>(AttenuationMode::LOGARITHMIC);
+  const int32_t linear = static_cast<int32_t>(AttenuationMode::LINEAR);
+  for (size_t i = 0; i < numSources_; ++i) {
+    const float d = distance_[i];
+    const float minDistance = minDistance_[i];
+    const float maxDistance = maxDistance_[i];
+    float gain = 1.f;
+    if (mode_[i] == logarithmic) {
+      const float clamped = std::max(minDistance, std::min(maxDistance, d));
+      gain = maxDistanceMute_[i] != 0 && d >= maxDistance
+          ? 0.f
+          : std::pow(minDistance / clamped, factor_[i]);
+    } else if (mode_[i] == linear) {
+      gain = d <= minDistance
+          ? 1.f
+          : (d >= maxDistance ? 0.f : 1.f - (d - minDistance) / (maxDistance - minDistance));
+    }
+    attenuation_[i] = gain;
+  }
+
+  // Cone angles, only for directional sources away from the listener
+  for (size_t i = 0; i < numSources_; ++i) {
+    outsideCone_[i] = 0;
+    directivity_[i] = 0.f;
+    if (directional_[i] == 0 || distance_[i] <= kMinDistance) {
+      continue;
+    }
+    const float angle = std::acos(cosAngle_[i]) * (180.f / kPi);
+    const float halfCone = halfCone_[i];
+    if (angle > halfCone) {
+      outsideCone_[i] = 1;
+      directivity_[i] =
+          effectLevel_[i] * std::min(1.f, (angle - halfCone) / std::max(1.f, 180.f - halfCone));
+    }
+  }
+}
+
+ObjectSpatialStore::Result ObjectSpatialStore::getResult(size_t index) const {
+  Result result;
+  result.distance = distance_[index];
+  result.direction = TBVector(directionX_[index], directionY_[index], directionZ_[index]);
+  result.attenuation = attenuation_[index];
+  result.outsideCone = outsideCone_[index] != 0;
+  result.directivity = directivity_[index];
+  return result;
+}
+
+float ObjectSpatialStore::getDirectivityGain(float directivity) {
+  return 1.f - kDirectivityMaxAttenuation * directivity;
+}
+} // namespace TBE
@@ -0,0 +1,109 @@
+#ifndef FBA_OBJECTSPATIALSTORE_H
+#define FBA_OBJECTSPATIALSTORE_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "TBE_AudioEngineDefinitions.h"
+#include "TBE_Quat.hh"
+#include "TBE_Vector.hh"
+
+namespace TBE {
+/// Spatial parameters of the positional sources of a block, kept as a structure of arrays: one
+/// contiguous array per coordinate, quaternion component and attenuation or directivity property.
+/// compute() then derives the distance, direction and gains of every source in passes over those
+/// arrays rather than source by source: the geometry four sources at a time with SSE or NEON, then
+/// the attenuation curve and cone angle only for the sources that use them. Used by the mixer for
+/// AudioObjects and by the VoiceManager to score voices, so both compute the same gains.
+class ObjectSpatialStore {
+ public:
+  /// Sources closer than this to the listener have no direction and are omnidirectional
+  static const float kMinDistance;
+
+  /// Everything compute() derives for a source
+  struct Result {
+    float distance{0.f}; /// From the listener, in listener scaled units
+    TBVector direction = TBVector::forward(); /// Unit direction in the listener's frame
+    float attenuation{1.f}; /// Distance attenuation gain. CUSTOM is 1.
+    bool outsideCone{false}; /// The listener is outside the cone of a directional source
+    float directivity{0.f}; /// Angle outside the cone scaled by the effect level, up to 1
+  };
+
+  /// @param capacity Number of sources that can be added before any allocation
+  explicit ObjectSpatialStore(size_t capacity);
+
+  /// Remove every source
+  void clear();
+
+  /// Add a source
+  /// @param rotation Normalised rotation, only used if directivity is true
+  /// @return Index of the source, for getResult()
+  size_t add(
+      const TBVector& position,
+      const TBQuat& rotation,
+      AttenuationMode mode,
+      const AttenuationProps& attenuation,
+      bool directivity,
+      const DirectionalProps& directional);
+
+  size_t size() const {
+    return numSources_;
+  }
+
+  /// Compute the results of every source for a listener
+  void compute(const TBQuat& listenerRotation, const TBVector& listenerPosition, float scale);
+
+  /// @return Results of a source, once computed
+  Result getResult(size_t index) const;
+
+  /// @return Gain of the directivity of a source, from Result::directivity
+  static float getDirectivityGain(float directivity);
+
+ private:
+  /// Size every array for a number of sources
+  void resize(size_t capacity);
+
+  /// Distance, unit direction in the listener's frame and cosine of the cone angle of every source
+  void computeGeometry(
+      const TBQuat& listenerRotation,
+      const TBVector& listenerPosition,
+      float scale);
+
+  size_t numSources_{0};
+
+  // Inputs
+  std::vector<float> positionX_;
+  std::vector<float> positionY_;
+  std::vector<float> positionZ_;
+  std::vector<float> rotationX_;
+  std::vector<float> rotationY_;
+  std::vector<float> rotationZ_;
+  std::vector<float> rotationW_;
+  std::vector<int32_t> mode_; /// AttenuationMode
+  std::vector<float> minDistance_;
+  std::vector<float> maxDistance_;
+  std::vector<float> factor_;
+  std::vector<int32_t> maxDistanceMute_;
+  std::vector<int32_t> directional_;
+  std::vector<float> effectLevel_;
+  std::vector<float> halfCone_; /// In degrees
+
+  // Results
+  std::vector<float> distance_;
+  std::vector<float> directionX_;
+  std::vector<float> directionY_;
+  std::vector<float> directionZ_;
+  std::vector<float> attenuation_;
+  std::vector<float> cosAngle_; /// Between the source's forward vector and the listener
+  std::vector<int32_t> outsideCone_;
+  std::vector<float> directivity_;
+};
+} // namespace TBE
+
+#endif // FBA_OBJECTSPATIALSTORE_H
@@ -0,0 +1,76 @@
+#ifndef FBA_RENDERCONTEXT_H
+#define FBA_RENDERCONTEXT_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <mutex>
+#include "TBE_AudioEngineDefinitions.h"
+#include "TBE_Quat.hh"
+#include "TBE_Vector.hh"
+
+namespace TBE {
+class BinauralFilters;
+class BusGraph;
+class DecoderThread;
+class EngineProfiler;
+class ObjectSpatialStore;
+class Tracer;
+
+/// Engine-wide state shared with every object at creation time
+struct EngineContext {
+  float sampleRate{48000.f};
+  int bufferSize{1024};
+  int queueSizePerChannel{4096};
+  bool decodeInAudioCallback{false}; /// ThreadSettings::useDecoderThread is false
+  bool offline{false}; /// No audio device: getAudioMix() drives rendering
+  DecoderThread* decoderThread{nullptr};
+  AudioAssetManager* assetManager{nullptr};
+  std::mutex* graphMutex{nullptr}; /// Held by the audio thread while rendering a block
+  /// HRIRs for objects rendered binaurally, or nullptr if the buffer size doesn't allow it
+  const BinauralFilters* binauralFilters{nullptr};
+  float binauralCrossfadeThreshold{0.f}; /// HrtfSettings::crossfadeThresholdDegrees
+  BinauralRendering binauralRendering{BinauralRendering::PER_OBJECT}; /// HrtfSettings::rendering
+  int binauralAmbisonicOrder{0}; /// Order of RenderContext::binauralAmbisonic, 0 without the bus
+  Tracer* tracer{nullptr}; /// Records events while AudioEngine::enableTracing() is on
+};
+
+/// Everything an object needs to render one block. Mix buffers are accumulated into.
+struct RenderContext {
+  int numFrames{0};
+  int64_t dspTime{0}; /// AudioEngine::getDSPTime() at the start of the block
+  TBQuat listenerRotation = TBQuat::identity();
+  TBVector listenerPosition;
+  float listenerScale{1.f};
+  float* const* ambisonic{nullptr}; /// Third order ambiX mix in the listener's frame
+  float* const* headlocked{nullptr}; /// Head-locked stereo mix, and objects rendered binaurally
+  float* reverbSend{nullptr}; /// Mono send to the master reverb
+  /// ambiX mix in the listener's frame of objects rendered binaurally through spherical harmonic
+  /// domain HRIRs, or nullptr with BinauralRendering::PER_OBJECT
+  float* const* binauralAmbisonic{nullptr};
+  bool binauralViaAmbisonic{false}; /// Objects rendered binaurally go into binauralAmbisonic
+  const BusGraph* buses{nullptr};
+  EngineProfiler* profiler{nullptr}; /// Stage timings of the block
+  const ObjectSpatialStore* spatial{nullptr}; /// Distances and gains of the objects of the block
+};
+
+/// Implemented by every object the engine renders
+class Renderable {
+ public:
+  virtual ~Renderable() {}
+
+  /// Audio thread, with the graph mutex held: render a block into the context's mixes
+  virtual void render(const RenderContext& context) = 0;
+
+  /// Audio thread, after the graph mutex is released: forward events raised by render()
+  virtual void dispatchEvents() = 0;
+
+  /// @return True if the object is currently playing
+  virtual bool isPlaying() const = 0;
+};
+} // namespace TBE
+
+#endif // FBA_RENDERCONTEXT_H
@@ -0,0 +1,169 @@
+#ifndef FBA_SPATDECODERBASE_H
+#define FBA_SPATDECODERBASE_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include "BedRenderer.h"
+#include "TransportControlBase.h"
+#include "utils/AtomicTransform.h"
+
+namespace TBE {
+/// Implements the parts of SpatDecoderInterface shared by SpatDecoderFile, SpatDecoderQueue and
+/// AudioObject: transform, focus and reverb send.
+template <typename Interface>
+class SpatDecoderBase : public TransportControlBase<Interface> {
+ public:
+  explicit SpatDecoderBase(const EngineContext& engine) : TransportControlBase<Interface>(engine) {}
+
+  ~SpatDecoderBase() override {}
+
+  // Object3D
+
+  EngineError setPosition(TBVector position) override {
+    position_.store(position);
+    return EngineError::OK;
+  }
+
+  TBVector getPosition() const override {
+    return position_.load();
+  }
+
+  EngineError setRotation(TBQuat rotation) override {
+    rotation_.store(rotation);
+    return EngineError::OK;
+  }
+
+  EngineError setRotation(TBVector forward, TBVector up) override {
+    rotation_.store(TBQuat::getQuatFromForwardAndUpVectors(forward, up));
+    return EngineError::OK;
+  }
+
+  TBQuat getRotation() const override {
+    return rotation_.load();
+  }
+
+  // SpatDecoderInterface
+
+  void enableFocus(bool enableFocus, bool followListener) override {
+    std::lock_guard<std::mutex> lock(focusMutex_);
+    focus_.enabled = enableFocus;
+    focus_.followListener = followListener;
+  }
+
+  void setFocusProperties(float offFocusLevel, float focusWidth) override {
+    // 1 is no focus, 0 is the maximum attenuation of 24 dB
+    const float level = std::max(0.f, std::min(1.f, offFocusLevel));
+    std::lock_guard<std::mutex> lock(focusMutex_);
+    focus_.offFocusLevelDb = (level - 1.f) * 24.f;
+    focus_.widthDegrees = std::max(40.f, std::min(120.f, focusWidth));
+  }
+
+  void setOffFocusLeveldB(float offFocusLevelDB) override {
+    std::lock_guard<std::mutex> lock(focusMutex_);
+    focus_.offFocusLevelDb = std::max(-24.f, std::min(0.f, offFocusLevelDB));
+  }
+
+  void setFocusWidthDegrees(float focusWidthDegrees) override {
+    std::lock_guard<std::mutex> lock(focusMutex_);
+    focus_.widthDegrees = std::max(40.f, std::min(120.f, focusWidthDegrees));
+  }
+
+  void setFocusOrientationQuat(TBQuat focusQuat) override {
+    std::lock_guard<std::mutex> lock(focusMutex_);
+    focus_.orientation = focusQuat;
+  }
+
+  EngineError bypassReverbSend(bool bypass) override {
+    reverbBypass_.store(bypass);
+    return EngineError::OK;
+  }
+
+  bool isReverbSendBypassed() override {
+    return reverbBypass_.load();
+  }
+
+  EngineError setReverbSendLevel(float level) override {
+    if (level < 0.f) {
+      return EngineError::INVALID_PARAM;
+    }
+    reverbLevel_.store(level);
+    return EngineError::OK;
+  }
+
+  float getReverbSendLevel() override {
+    return reverbLevel_.load();
+  }
+
+  // Effect inserts need the FBA graph, which is not part of this implementation
+
+  EngineError addEffectInsert(EffectIndex, EffectType) override {
+    return EngineError::NOT_SUPPORTED;
+  }
+
+  EngineError removeEffectInsert(EffectIndex) override {
+    return EngineError::NOT_SUPPORTED;
+  }
+
+  EngineError bypassEffectInsert(EffectIndex, bool) override {
+    return EngineError::NOT_SUPPORTED;
+  }
+
+  EngineError setEffectInsertParam(EffectIndex, EffectParam, float) override {
+    return EngineError::NOT_SUPPORTED;
+  }
+
+  float getEffectInsertParam(EffectIndex, EffectParam) override {
+    return 0.f;
+  }
+
+  bool isEffectInsertActive(EffectIndex) override {
+    return false;
+  }
+
+  bool isEffectInsertBypassed(EffectIndex) override {
+    return true;
+  }
+
+  EffectType getEffectType(EffectIndex) override {
+    return EffectType::INVALID;
+  }
+
+ protected:
+  /// Audio thread: snapshot of the focus settings. Keeps the previous settings if a control thread
+  /// is updating them.
+  const FocusSettings& getFocus() {
+    if (focusMutex_.try_lock()) {
+      focusSnapshot_ = focus_;
+      focusMutex_.unlock();
+    }
+    return focusSnapshot_;
+  }
+
+  /// Audio thread: effective reverb send level
+  float getReverbSend() const {
+    if (reverbBypass_.load(std::memory_order_relaxed)) {
+      return 0.f;
+    }
+    return reverbLevel_.load(std::memory_order_relaxed);
+  }
+
+  AtomicVector position_;
+  AtomicQuat rotation_;
+
+ private:
+  std::mutex focusMutex_;
+  FocusSettings focus_;
+  FocusSettings focusSnapshot_;
+  std::atomic<bool> reverbBypass_{false};
+  std::atomic<float> reverbLevel_{1.f};
+};
+} // namespace TBE
+
+#endif // FBA_SPATDECODERBASE_H
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "SpatDecoderFileImpl.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "DecoderThread.h"
+#include "EngineProfiler.h"
+#include "Tracer.h"
+#include "io/MappedFileStream.h"
+
+namespace TBE {
+/// Minimum streaming buffer per file, in blocks of the engine buffer size
+static const int kMinStreamingBlocks = 8;
+
+SpatDecoderFileImpl::SpatDecoderFileImpl(const EngineContext& engine, Options options)
+    : SpatDecoderBase<SpatDecoderFile>(engine),
+      decodeInline_(
+          engine.decodeInAudioCallback || engine.offline ||
+          (options & Options::DECODE_IN_AUDIO_CALLBACK)),
+      bed_(engine.bufferSize) {}
+
+SpatDecoderFileImpl::~SpatDecoderFileImpl() {
+  close();
+}
+
+EngineError SpatDecoderFileImpl::open(const char* nameAndPath, ChannelMap map) {
+  return open(nameAndPath, AssetDescriptor(), map);
+}
+
+EngineError
+SpatDecoderFileImpl::open(IOStream* streams[2], bool shouldOwnStreams, ChannelMap map) {
+  if (!streams || !streams[0]) {
+    return EngineError::INVALID_PARAM;
+  }
+  // Only the first stream is needed: seeks are handled by the streaming buffer
+  if (shouldOwnStreams && streams[1] && streams[1] != streams[0]) {
+    delete streams[1];
+  }
+
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  AudioFormatDecoder* decoder = nullptr;
+  const EngineError error = TBE_CreateAudioFormatDecoderFromStream(
+      decoder, streams[0], shouldOwnStreams, engine_.bufferSize, engine_.sampleRate);
+  if (error != EngineError::OK) {
+    return error;
+  }
+  return openDecoder(decoder, map);
+}
+
+EngineError
+SpatDecoderFileImpl::open(const char* nameAndPath, AssetDescriptor ad, ChannelMap map) {
+  if (!nameAndPath) {
+    return EngineError::INVALID_PARAM;
+  }
+  IOStream* stream = createReadStream(nameAndPath, ad);
+  if (!stream) {
+    return EngineError::ERROR_OPENING_FILE;
+  }
+
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  AudioFormatDecoder* decoder = nullptr;
+  const EngineError error = TBE_CreateAudioFormatDecoderFromStream(
+      decoder, stream, true, engine_.bufferSize, engine_.sampleRate);
+  if (error != EngineError::OK) {
+    return error;
+  }
+  return openDecoder(decoder, map);
+}
+
+EngineError SpatDecoderFileImpl::openDecoder(AudioFormatDecoder* decoder, ChannelMap map) {
+  const int numChannels = decoder->getNumOfChannels();
+  if (map == ChannelMap::UNKNOWN) {
+    map = decoder->getChannelMap();
+  }
+  if (map == ChannelMap::UNKNOWN || map == ChannelMap::INVALID) {
+    map = BedLayout::mapForChannelCount(numChannels);
+  }
+  BedLayout layout;
+  if (!BedLayout::fromChannelMap(map, layout) || getNumChannelsForMap(map) != numChannels) {
+    delete decoder;
+    return EngineError::INVALID_CHANNEL_MAP;
+  }
+
+  closeLocked();
+
+  const size_t bufferFrames = static_cast<size_t>(std::max(
+      engine_.queueSizePerChannel, engine_.bufferSize * kMinStreamingBlocks));
+  std::unique_ptr<StreamingSource> source(
+      new StreamingSource(decoder, bufferFrames, engine_.bufferSize, engine_.bufferSize));
+  source->setLooping(looping_.load());
+  duration_.store(source->getDurationInFrames());
+  elapsed_.store(0);
+  lastResyncMs_ = -1.0;
+
+  // Without a decoder thread, the buffer is primed here so that the file is ready right away
+  if (decodeInline_) {
+    source->fill();
+  }
+
+  {
+    std::lock_guard<std::mutex> graphLock(*engine_.graphMutex);
+    source_ = std::move(source);
+    layout_ = layout;
+    numChannels_ = numChannels;
+    interleaved_.assign(static_cast<size_t>(engine_.bufferSize * numChannels), 0.f);
+    bed_.reset();
+    transport_.reset();
+    initRaised_ = false;
+  }
+  if (!decodeInline_ && engine_.decoderThread) {
+    engine_.decoderThread->add(source_.get());
+  }
+  open_.store(true);
+  return EngineError::OK;
+}
+
+void SpatDecoderFileImpl::close() {
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  closeLocked();
+}
+
+void SpatDecoderFileImpl::closeLocked() {
+  if (!source_) {
+    return;
+  }
+  // The decoder thread lets go of the source before the audio thread does
+  if (!decodeInline_ && engine_.decoderThread) {
+    engine_.decoderThread->remove(source_.get());
+  }
+  std::unique_ptr<StreamingSource> source;
+  {
+    std::lock_guard<std::mutex> graphLock(*engine_.graphMutex);
+    source = std::move(source_);
+    transport_.reset();
+  }
+  open_.store(false);
+  elapsed_.store(0);
+  duration_.store(0);
+}
+
+bool SpatDecoderFileImpl::isOpen() const {
+  return open_.load();
+}
+
+EngineError SpatDecoderFileImpl::seekToSample(size_t timeInSamples) {
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  if (!source_ || timeInSamples > duration_.load()) {
+    return EngineError::FAIL;
+  }
+  source_->seek(timeInSamples);
+  elapsed_.store(timeInSamples);
+  if (!decodeInline_ && engine_.decoderThread) {
+    engine_.decoderThread->notify();
+  }
+  return EngineError::OK;
+}
+
+EngineError SpatDecoderFileImpl::seekToMs(float timeInMs) {
+  if (timeInMs < 0.f) {
+    return EngineError::FAIL;
+  }
+  return seekToSample(static_cast<size_t>(std::round(timeInMs * 0.001 * engine_.sampleRate)));
+}
+
+size_t SpatDecoderFileImpl::getElapsedTimeInSamples() const {
+  return elapsed_.load();
+}
+
+double SpatDecoderFileImpl::getElapsedTimeInMs() const {
+  return static_cast<double>(elapsed_.load()) * 1000.0 / engine_.sampleRate;
+}
+
+size_t SpatDecoderFileImpl::getAssetDurationInSamples() const {
+  return duration_.load();
+}
+
+float SpatDecoderFileImpl::getAssetDurationInMs() const {
+  return static_cast<float>(static_cast<double>(duration_.load()) * 1000.0 / engine_.sampleRate);
+}
+
+void SpatDecoderFileImpl::setSyncMode(SyncMode syncMode) {
+  syncMode_.store(syncMode);
+}
+
+SyncMode SpatDecoderFileImpl::getSyncMode() const {
+  return syncMode_.load();
+}
+
+void SpatDecoderFileImpl::setExternalClockInMs(double externalClockInMs) {
+  if (syncMode_.load() != SyncMode::EXTERNAL || externalClockInMs < 0.0) {
+    return;
+  }
+  const double drift = std::abs(getElapsedTimeInMs() - externalClockInMs);
+  {
+    std::lock_guard<std::mutex> lock(controlMutex_);
+    const bool freewheeling = lastResyncMs_ >= 0.0 &&
+        std::abs(externalClockInMs - lastResyncMs_) < freewheelMs_.load();
+    if (drift <= resyncThresholdMs_.load() || freewheeling) {
+      return;
+    }
+    lastResyncMs_ = externalClockInMs;
+  }
+  seekToMs(static_cast<float>(externalClockInMs));
+}
+
+void SpatDecoderFileImpl::setFreewheelTimeInMs(double freewheelInMs) {
+  freewheelMs_.store(std::max(0.0, freewheelInMs));
+}
+
+double SpatDecoderFileImpl::getFreewheelTimeInMs() {
+  return freewheelMs_.load();
+}
+
+void SpatDecoderFileImpl::setResyncThresholdMs(double resyncThresholdMs) {
+  resyncThresholdMs_.store(std::max(0.0, resyncThresholdMs));
+}
+
+double SpatDecoderFileImpl::getResyncThresholdMs() const {
+  return resyncThresholdMs_.load();
+}
+
+void SpatDecoderFileImpl::applyVolumeFade(
+    float startLinearGain,
+    float endLinearGain,
+    float fadeDurationMs) {
+  volume_.fade(
+      std::max(0.f, startLinearGain), std::max(0.f, endLinearGain), msToSamples(fadeDurationMs));
+}
+
+void SpatDecoderFileImpl::enableLooping(bool shouldLoop) {
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  looping_.store(shouldLoop);
+  if (source_) {
+    source_->setLooping(shouldLoop);
+  }
+}
+
+bool SpatDecoderFileImpl::loopingEnabled() const {
+  return looping_.load();
+}
+
+EngineError
+SpatDecoderFileImpl::requestTransport(Transport::Command command, float delayMs, float fadeMs) {
+  if (!open_.load()) {
+    return EngineError::NOT_INITIALISED;
+  }
+  return transport_.request(command, delayMs, fadeMs);
+}
+
+void SpatDecoderFileImpl::render(const RenderContext& context) {
+  if (!source_) {
+    return;
+  }
+  const int numFrames = std::min(context.numFrames, engine_.bufferSize);
+  const Transport::Block block = transport_.process(numFrames, envelope_.data());
+  if (block.rewind) {
+    source_->seek(0);
+  }
+  float volumeStart = 1.f;
+  float volumeEnd = 1.f;
+  volume_.process(numFrames, volumeStart, volumeEnd);
+
+  // Seeks are applied by the producer, so they also go through here when paused
+  if (decodeInline_ && source_->needsData()) {
+    const ProfilerScope profile(context.profiler, ProfilerStage::DECODE);
+    const TraceScope trace(engine_.tracer, "SpatDecoderFile decode");
+    source_->fill();
+  }
+  source_->update();
+
+  if (!initRaised_) {
+    const size_t ready = std::min<size_t>(static_cast<size_t>(numFrames), duration_.load());
+    if (source_->getNumFramesAvailable() >= ready) {
+      initRaised_ = true;
+      raiseEvent(Event::DECODER_INIT);
+    }
+  }
+
+  if (block.numFrames > 0) {
+    float* frames = interleaved_.data();
+    std::memset(frames, 0, static_cast<size_t>(numFrames * numChannels_) * sizeof(float));
+    source_->read(frames + block.offset * numChannels_, block.numFrames);
+    if (block.applyEnvelope) {
+      for (int n = block.offset; n < block.offset + block.numFrames; ++n) {
+        float* frame = frames + n * numChannels_;
+        for (int ch = 0; ch < numChannels_; ++ch) {
+          frame[ch] *= envelope_[n];
+        }
+      }
+    }
+    bed_.render(
+        frames,
+        numChannels_,
+        layout_,
+        rotation_.load(),
+        getFocus(),
+        volumeStart,
+        volumeEnd,
+        getReverbSend(),
+        context);
+  }
+  elapsed_.store(source_->getPosition());
+
+  const uint32_t events = source_->takeEvents();
+  if (events & StreamingSource::EVENT_LOOPED) {
+    raiseEvent(Event::LOOPED);
+  }
+  if (events & StreamingSource::EVENT_END_OF_STREAM) {
+    transport_.stopNow();
+    source_->seek(0);
+    raiseEvent(Event::END_OF_STREAM);
+    raiseEvent(Event::PLAY_STATE_CHANGED);
+  }
+  if (events & StreamingSource::EVENT_STARVED) {
+    traceInstant(engine_.tracer, "SpatDecoderFile underrun", "dspTime", context.dspTime);
+    raiseEvent(Event::ERROR_QUEUE_STARVATION);
+  }
+  if (events & StreamingSource::EVENT_DECODER_ERROR) {
+    transport_.stopNow();
+    raiseEvent(Event::ERROR_DECODER_FAIL);
+    raiseEvent(Event::PLAY_STATE_CHANGED);
+  }
+  if (block.stateChanged) {
+    raiseEvent(Event::PLAY_STATE_CHANGED);
+  }
+}
+} // namespace TBE
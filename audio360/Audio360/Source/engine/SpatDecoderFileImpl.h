@@ -0,0 +1,89 @@
+#ifndef FBA_SPATDECODERFILEIMPL_H
+#define FBA_SPATDECODERFILEIMPL_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "BedRenderer.h"
+#include "SpatDecoderBase.h"
+#include "StreamingSource.h"
+
+namespace TBE {
+/// Plays a spatial audio file (TBE, ambiX or head-locked stereo) streamed from disk, memory or an
+/// IOStream.
+class SpatDecoderFileImpl : public SpatDecoderBase<SpatDecoderFile> {
+ public:
+  SpatDecoderFileImpl(const EngineContext& engine, Options options);
+  ~SpatDecoderFileImpl() override;
+
+  EngineError open(const char* nameAndPath, ChannelMap map = ChannelMap::UNKNOWN) override;
+  EngineError open(
+      IOStream* streams[2],
+      bool shouldOwnStreams,
+      ChannelMap map = ChannelMap::UNKNOWN) override;
+  EngineError open(
+      const char* nameAndPath,
+      AssetDescriptor ad,
+      ChannelMap map = ChannelMap::UNKNOWN) override;
+  void close() override;
+  bool isOpen() const override;
+
+  EngineError seekToSample(size_t timeInSamples) override;
+  EngineError seekToMs(float timeInMs) override;
+  size_t getElapsedTimeInSamples() const override;
+  double getElapsedTimeInMs() const override;
+  size_t getAssetDurationInSamples() const override;
+  float getAssetDurationInMs() const override;
+
+  void setSyncMode(SyncMode syncMode) override;
+  SyncMode getSyncMode() const override;
+  void setExternalClockInMs(double externalClockInMs) override;
+  void setFreewheelTimeInMs(double freewheelInMs) override;
+  double getFreewheelTimeInMs() override;
+  void setResyncThresholdMs(double resyncThresholdMs) override;
+  double getResyncThresholdMs() const override;
+
+  void applyVolumeFade(float startLinearGain, float endLinearGain, float fadeDurationMs) override;
+  void enableLooping(bool shouldLoop) override;
+  bool loopingEnabled() const override;
+
+  // Renderable
+  void render(const RenderContext& context) override;
+
+ private:
+  EngineError requestTransport(Transport::Command command, float delayMs, float fadeMs) override;
+
+  /// Take ownership of an opened decoder and start streaming it. Must hold controlMutex_.
+  EngineError openDecoder(AudioFormatDecoder* decoder, ChannelMap map);
+
+  /// Release the current source. Must hold controlMutex_.
+  void closeLocked();
+
+  const bool decodeInline_;
+  mutable std::mutex controlMutex_; // Serialises open/close against control calls
+  std::unique_ptr<StreamingSource> source_; // Swapped with the graph mutex held
+  BedLayout layout_;
+  int numChannels_{0};
+  BedRenderer bed_;
+  std::vector<float> interleaved_;
+  bool initRaised_{false};
+
+  std::atomic<bool> open_{false};
+  std::atomic<bool> looping_{false};
+  std::atomic<size_t> elapsed_{0};
+  std::atomic<size_t> duration_{0};
+  std::atomic<SyncMode> syncMode_{SyncMode::INTERNAL};
+  std::atomic<double> freewheelMs_{1000.0};
+  std::atomic<double> resyncThresholdMs_{200.0};
+  double lastResyncMs_{-1.0}; // Guarded by controlMutex_
+};
+} // namespace TBE
+
+#endif // FBA_SPATDECODERFILEIMPL_H
@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "SpatDecoderQueueImpl.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "Tracer.h"
+
+namespace TBE {
+SpatDecoderQueueImpl::SubQueue::SubQueue(
+    ChannelMap channelMap,
+    int queueSizePerChannel,
+    int bufferSize)
+    : map(channelMap), numChannels(getNumChannelsForMap(channelMap)), bed(bufferSize) {
+  BedLayout::fromChannelMap(map, layout);
+  ring.allocate(static_cast<size_t>(queueSizePerChannel) * numChannels);
+}
+
+SpatDecoderQueueImpl::SpatDecoderQueueImpl(const EngineContext& engine)
+    : SpatDecoderBase<SpatDecoderQueue>(engine) {
+  addQueue(ChannelMap::TBE_8_2);
+  addQueue(ChannelMap::TBE_8);
+  addQueue(ChannelMap::HEADLOCKED_STEREO);
+}
+
+SpatDecoderQueueImpl::SpatDecoderQueueImpl(const EngineContext& engine, ChannelMap map, PCMType)
+    : SpatDecoderBase<SpatDecoderQueue>(engine) {
+  BedLayout layout;
+  if (BedLayout::fromChannelMap(map, layout) && getNumChannelsForMap(map) > 0) {
+    addQueue(map);
+  }
+}
+
+void SpatDecoderQueueImpl::addQueue(ChannelMap map) {
+  queues_.emplace_back(new SubQueue(map, engine_.queueSizePerChannel, engine_.bufferSize));
+  const size_t samples = static_cast<size_t>(engine_.bufferSize * queues_.back()->numChannels);
+  interleaved_.resize(std::max(interleaved_.size(), samples), 0.f);
+}
+
+bool SpatDecoderQueueImpl::isValid() const {
+  return !queues_.empty();
+}
+
+SpatDecoderQueueImpl::SubQueue* SpatDecoderQueueImpl::findQueue(ChannelMap map) const {
+  for (const auto& queue : queues_) {
+    if (queue->map == map) {
+      return queue.get();
+    }
+  }
+  return nullptr;
+}
+
+int32_t SpatDecoderQueueImpl::getFreeSpaceInQueue(ChannelMap channelMap) const {
+  const SubQueue* queue = findQueue(channelMap);
+  return queue ? static_cast<int32_t>(queue->ring.getFreeSpace()) : 0;
+}
+
+int32_t SpatDecoderQueueImpl::getQueueSize(ChannelMap channelMap) const {
+  const SubQueue* queue = findQueue(channelMap);
+  return queue ? static_cast<int32_t>(queue->ring.getCapacity()) : 0;
+}
+
+int32_t SpatDecoderQueueImpl::enqueueData(
+    const float* interleavedBuffer,
+    int32_t numTotalSamples,
+    ChannelMap channelMap) {
+  SubQueue* queue = findQueue(channelMap);
+  if (!queue || !interleavedBuffer || numTotalSamples <= 0) {
+    return 0;
+  }
+  // Only whole frames are queued
+  const size_t numChannels = static_cast<size_t>(queue->numChannels);
+  return static_cast<int32_t>(
+      queue->ring.write(interleavedBuffer, static_cast<size_t>(numTotalSamples), numChannels));
+}
+
+int32_t SpatDecoderQueueImpl::enqueueData(
+    const int16_t* interleavedBuffer,
+    int32_t numTotalSamples,
+    ChannelMap channelMap) {
+  SubQueue* queue = findQueue(channelMap);
+  if (!queue || !interleavedBuffer || numTotalSamples <= 0) {
+    return 0;
+  }
+  // Convert straight into the queue. The whole region is reserved at once, so that it stays
+  // contiguous while other producers enqueue.
+  const SampleRingBuffer::Reservation reservation = queue->ring.reserve(
+      static_cast<size_t>(numTotalSamples), static_cast<size_t>(queue->numChannels));
+  for (size_t i = 0; i < reservation.firstSize; ++i) {
+    reservation.first[i] = static_cast<float>(interleavedBuffer[i]) * (1.f / 32768.f);
+  }
+  const int16_t* second = interleavedBuffer + reservation.firstSize;
+  for (size_t i = 0; i < reservation.secondSize; ++i) {
+    reservation.second[i] = static_cast<float>(second[i]) * (1.f / 32768.f);
+  }
+  queue->ring.commit(reservation);
+  return static_cast<int32_t>(reservation.numSamples);
+}
+
+QueueWriteRegion SpatDecoderQueueImpl::reserveWrite(
+    int32_t numTotalSamples,
+    ChannelMap channelMap) {
+  QueueWriteRegion region;
+  region.channelMap = channelMap;
+  SubQueue* queue = findQueue(channelMap);
+  if (!queue || numTotalSamples <= 0) {
+    return region;
+  }
+  const SampleRingBuffer::Reservation reservation = queue->ring.reserve(
+      static_cast<size_t>(numTotalSamples), static_cast<size_t>(queue->numChannels));
+  region.first = reservation.first;
+  region.firstSize = static_cast<int32_t>(reservation.firstSize);
+  region.second = reservation.second;
+  region.secondSize = static_cast<int32_t>(reservation.secondSize);
+  region.numTotalSamples = static_cast<int32_t>(reservation.numSamples);
+  region.position = reservation.position;
+  return region;
+}
+
+int32_t SpatDecoderQueueImpl::commitWrite(
+    const QueueWriteRegion& region,
+    int32_t numTotalSamples,
+    int32_t timeoutMs) {
+  SubQueue* queue = findQueue(region.channelMap);
+  if (!queue || region.numTotalSamples <= 0) {
+    return 0;
+  }
+  SampleRingBuffer::Reservation reservation;
+  reservation.position = region.position;
+  reservation.numSamples = static_cast<size_t>(region.numTotalSamples);
+  reservation.first = region.first;
+  reservation.firstSize = static_cast<size_t>(region.firstSize);
+  reservation.second = region.second;
+  reservation.secondSize = static_cast<size_t>(region.secondSize);
+
+  // Partial frames are dropped, as in enqueueData()
+  const int32_t written = std::max(0, std::min(numTotalSamples, region.numTotalSamples));
+  const size_t numSamples = static_cast<size_t>(written - written % queue->numChannels);
+  if (timeoutMs < 0) {
+    queue->ring.commit(reservation, numSamples);
+  } else if (!queue->ring.commit(reservation, numSamples, std::chrono::milliseconds(timeoutMs))) {
+    return -1;
+  }
+  return static_cast<int32_t>(numSamples);
+}
+
+int32_t SpatDecoderQueueImpl::enqueueSilence(int32_t numTotalSamples, ChannelMap channelMap) {
+  SubQueue* queue = findQueue(channelMap);
+  if (!queue || numTotalSamples <= 0) {
+    return 0;
+  }
+  const size_t numChannels = static_cast<size_t>(queue->numChannels);
+  return static_cast<int32_t>(
+      queue->ring.write(nullptr, static_cast<size_t>(numTotalSamples), numChannels));
+}
+
+EngineError SpatDecoderQueueImpl::waitForFreeSpace(
+    int32_t numTotalSamples,
+    ChannelMap channelMap,
+    int32_t timeoutMs) {
+  SubQueue* queue = findQueue(channelMap);
+  if (!queue || numTotalSamples < 0 ||
+      static_cast<size_t>(numTotalSamples) > queue->ring.getCapacity()) {
+    return EngineError::INVALID_PARAM;
+  }
+  return queue->space.wait(queue->ring, static_cast<size_t>(numTotalSamples), timeoutMs)
+      ? EngineError::OK
+      : EngineError::QUEUE_FULL;
+}
+
+int SpatDecoderQueueImpl::getFreeSpaceEventFD(ChannelMap channelMap) {
+  SubQueue* queue = findQueue(channelMap);
+  return queue ? queue->space.getEventFD() : -1;
+}
+
+void SpatDecoderQueueImpl::flushQueue() {
+  // The audio thread owns the read side: it drops everything written so far on its next block
+  for (auto& queue : queues_) {
+    queue->flushPosition.store(queue->ring.getWritePosition());
+    queue->flushRequested.store(true);
+  }
+  endOfStream_.store(false);
+}
+
+uint64_t SpatDecoderQueueImpl::getNumSamplesDequeuedPerChannel() const {
+  return numDequeued_.load();
+}
+
+QueueStatistics SpatDecoderQueueImpl::getQueueStatistics(ChannelMap channelMap) const {
+  const SubQueue* queue = findQueue(channelMap);
+  if (!queue) {
+    return QueueStatistics();
+  }
+  QueueStatistics statistics = queue->telemetry.getStatistics();
+  statistics.queueSize = queue->ring.getCapacity();
+  statistics.numQueued = queue->ring.getCapacity() - queue->ring.getFreeSpace();
+  return statistics;
+}
+
+void SpatDecoderQueueImpl::resetQueueStatistics() {
+  for (auto& queue : queues_) {
+    queue->telemetry.reset();
+  }
+}
+
+void SpatDecoderQueueImpl::setEndOfStream(bool endOfStream) {
+  endOfStream_.store(endOfStream);
+}
+
+bool SpatDecoderQueueImpl::getEndOfStreamStatus() const {
+  return endOfStream_.load();
+}
+
+void SpatDecoderQueueImpl::render(const RenderContext& context) {
+  const int numFrames = std::min(context.numFrames, engine_.bufferSize);
+  const Transport::Block block = transport_.process(numFrames, envelope_.data());
+  float volumeStart = 1.f;
+  float volumeEnd = 1.f;
+  volume_.process(numFrames, volumeStart, volumeEnd);
+
+  for (auto& queue : queues_) {
+    if (queue->flushRequested.exchange(false)) {
+      queue->ring.discardUntil(queue->flushPosition.load());
+      queue->bed.reset();
+      queue->active = false;
+    }
+  }
+
+  const bool endOfStream = endOfStream_.load();
+  if (!endOfStream) {
+    endRaised_ = false;
+  }
+
+  if (block.numFrames > 0) {
+    bool hasData = false;
+    bool starved = false;
+    size_t dequeued = 0;
+    for (auto& queue : queues_) {
+      const int numChannels = queue->numChannels;
+      const size_t numQueued = queue->ring.getNumAvailable();
+      const size_t available = numQueued / numChannels;
+      // Queues of channel maps that aren't being used don't count until they are fed
+      if (queue->active || available > 0) {
+        queue->telemetry.recordFill(numQueued);
+      }
+      if (available == 0) {
+        if (queue->active && !endOfStream) {
+          queue->telemetry.recordUnderrun(context.dspTime);
+          starved = true;
+        }
+        continue;
+      }
+      hasData = true;
+      // A partial block is only played at the end of the stream, otherwise wait for more data
+      if (available < static_cast<size_t>(block.numFrames) && !endOfStream) {
+        if (queue->active) {
+          queue->telemetry.recordUnderrun(context.dspTime);
+          starved = true;
+        }
+        continue;
+      }
+
+      const size_t count = std::min(available, static_cast<size_t>(block.numFrames));
+      float* frames = interleaved_.data();
+      std::memset(frames, 0, static_cast<size_t>(numFrames * numChannels) * sizeof(float));
+      queue->ring.read(frames + block.offset * numChannels, count * numChannels);
+      queue->active = true;
+      dequeued = std::max(dequeued, count);
+
+      if (block.applyEnvelope) {
+        for (int n = block.offset; n < block.offset + block.numFrames; ++n) {
+          float* frame = frames + n * numChannels;
+          for (int ch = 0; ch < numChannels; ++ch) {
+            frame[ch] *= envelope_[n];
+          }
+        }
+      }
+      queue->bed.render(
+          frames,
+          numChannels,
+          queue->layout,
+          rotation_.load(),
+          getFocus(),
+          volumeStart,
+          volumeEnd,
+          getReverbSend(),
+          context);
+    }
+    numDequeued_.fetch_add(dequeued);
+
+    if (starved) {
+      traceInstant(engine_.tracer, "SpatDecoderQueue underrun", "dspTime", context.dspTime);
+      raiseEvent(Event::ERROR_QUEUE_STARVATION);
+    }
+    if (endOfStream && !hasData && !endRaised_) {
+      endRaised_ = true;
+      raiseEvent(Event::END_OF_STREAM);
+    }
+  }
+
+  for (auto& queue : queues_) {
+    queue->space.notify(queue->ring);
+  }
+
+  if (block.stateChanged) {
+    raiseEvent(Event::PLAY_STATE_CHANGED);
+  }
+}
+} // namespace TBE
@@ -0,0 +1,87 @@
+#ifndef FBA_SPATDECODERQUEUEIMPL_H
+#define FBA_SPATDECODERQUEUEIMPL_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "BedRenderer.h"
+#include "SpatDecoderBase.h"
+#include "utils/FreeSpaceSignal.h"
+#include "utils/QueueTelemetry.h"
+#include "utils/SampleRingBuffer.h"
+
+namespace TBE {
+/// Plays spatial audio enqueued by the client. Each supported channel map has its own lock-free
+/// queue, all of which are mixed together.
+class SpatDecoderQueueImpl : public SpatDecoderBase<SpatDecoderQueue> {
+ public:
+  /// A queue accepting ChannelMap::TBE_8_2, ChannelMap::TBE_8 and ChannelMap::HEADLOCKED_STEREO
+  explicit SpatDecoderQueueImpl(const EngineContext& engine);
+
+  /// A queue accepting a single channel map
+  SpatDecoderQueueImpl(const EngineContext& engine, ChannelMap map, PCMType type);
+
+  /// @return False if the channel map can't be played by a queue
+  bool isValid() const;
+
+  int32_t getFreeSpaceInQueue(ChannelMap channelMap) const override;
+  int32_t getQueueSize(ChannelMap channelMap) const override;
+  int32_t enqueueData(
+      const float* interleavedBuffer,
+      int32_t numTotalSamples,
+      ChannelMap channelMap) override;
+  int32_t enqueueData(
+      const int16_t* interleavedBuffer,
+      int32_t numTotalSamples,
+      ChannelMap channelMap) override;
+  QueueWriteRegion reserveWrite(int32_t numTotalSamples, ChannelMap channelMap) override;
+  int32_t
+  commitWrite(const QueueWriteRegion& region, int32_t numTotalSamples, int32_t timeoutMs) override;
+  int32_t enqueueSilence(int32_t numTotalSamples, ChannelMap channelMap) override;
+  EngineError
+  waitForFreeSpace(int32_t numTotalSamples, ChannelMap channelMap, int32_t timeoutMs) override;
+  int getFreeSpaceEventFD(ChannelMap channelMap) override;
+  void flushQueue() override;
+  uint64_t getNumSamplesDequeuedPerChannel() const override;
+  QueueStatistics getQueueStatistics(ChannelMap channelMap) const override;
+  void resetQueueStatistics() override;
+  void setEndOfStream(bool endOfStream) override;
+  bool getEndOfStreamStatus() const override;
+
+  // Renderable
+  void render(const RenderContext& context) override;
+
+ private:
+  struct SubQueue {
+    SubQueue(ChannelMap channelMap, int queueSizePerChannel, int bufferSize);
+
+    const ChannelMap map;
+    const int numChannels;
+    BedLayout layout;
+    SampleRingBuffer ring;
+    FreeSpaceSignal space; // Fired by the audio thread after dequeueing
+    QueueTelemetry telemetry;
+    BedRenderer bed;
+    std::atomic<bool> flushRequested{false};
+    std::atomic<uint64_t> flushPosition{0};
+    bool active{false}; // Audio thread: data was dequeued since the last flush
+  };
+
+  void addQueue(ChannelMap map);
+  SubQueue* findQueue(ChannelMap map) const;
+
+  std::vector<std::unique_ptr<SubQueue>> queues_;
+  std::vector<float> interleaved_;
+  std::atomic<bool> endOfStream_{false};
+  std::atomic<uint64_t> numDequeued_{0};
+  bool endRaised_{false};
+};
+} // namespace TBE
+
+#endif // FBA_SPATDECODERQUEUEIMPL_H
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "SpeakersVirtualizerImpl.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "Tracer.h"
+
+namespace TBE {
+/// Gain of the LFE channel in each ear
+static const float kLfeGain = 0.5f;
+
+namespace {
+/// Azimuth in degrees of each speaker, positive to the right (ITU-R BS.775 and 7.1 layouts)
+float getSpeakerAzimuth(SpeakerPosition speaker) {
+  switch (speaker) {
+    case SpeakerPosition::LEFT:
+      return -30.f;
+    case SpeakerPosition::RIGHT:
+      return 30.f;
+    case SpeakerPosition::LEFT_SURROUND:
+      return -110.f;
+    case SpeakerPosition::RIGHT_SURROUND:
+      return 110.f;
+    case SpeakerPosition::LEFT_BACK_SURROUND:
+      return -150.f;
+    case SpeakerPosition::RIGHT_BACK_SURROUND:
+      return 150.f;
+    default:
+      return 0.f;
+  }
+}
+} // namespace
+
+SpeakersVirtualizerImpl::SpeakersVirtualizerImpl(
+    const EngineContext& engine,
+    SpeakerPosition const* layout,
+    size_t channelBufferSizeInSamples)
+    : TransportControlBase<SpeakersVirtualizer>(engine) {
+  const size_t numSpeakers = getNumSpeakers(layout);
+  speakers_.assign(layout, layout + numSpeakers);
+
+  gains_.assign(numSpeakers * SphericalHarmonics::kMaxChannels, 0.f);
+  for (size_t i = 0; i < numSpeakers; ++i) {
+    const float azimuth = getSpeakerAzimuth(speakers_[i]) * 3.14159265358979f / 180.f;
+    const TBVector direction(std::sin(azimuth), 0.f, std::cos(azimuth));
+    SphericalHarmonics::evaluateEngine(
+        direction, kOrder, gains_.data() + i * SphericalHarmonics::kMaxChannels);
+  }
+
+  ring_.allocate(std::max<size_t>(channelBufferSizeInSamples, engine.bufferSize) * numSpeakers);
+  interleaved_.assign(static_cast<size_t>(engine.bufferSize) * numSpeakers, 0.f);
+}
+
+size_t SpeakersVirtualizerImpl::getNumSpeakers(SpeakerPosition const* layout) {
+  size_t numSpeakers = 0;
+  while (layout && layout[numSpeakers] != SpeakerPosition::END_ENUM &&
+         numSpeakers < static_cast<size_t>(SpeakerPosition::END_ENUM)) {
+    numSpeakers++;
+  }
+  return numSpeakers;
+}
+
+EngineError SpeakersVirtualizerImpl::checkEnqueue(int32_t numTotalSamples) {
+  if (speakers_.empty()) {
+    return EngineError::FAIL;
+  }
+  {
+    std::lock_guard<std::mutex> lock(threadMutex_);
+    const auto thisThread = std::this_thread::get_id();
+    if (!hasProducerThread_) {
+      producerThread_ = thisThread;
+      hasProducerThread_ = true;
+    } else if (producerThread_ != thisThread) {
+      return EngineError::BAD_THREAD;
+    }
+  }
+  if (numTotalSamples < 0 || numTotalSamples % static_cast<int32_t>(speakers_.size()) != 0) {
+    return EngineError::INVALID_BUFFER_SIZE;
+  }
+  return EngineError::OK;
+}
+
+EngineError SpeakersVirtualizerImpl::enqueueData(
+    const float* interleavedBuffer,
+    int32_t numTotalSamples,
+    int32_t& numEnqueued,
+    bool endOfStream) {
+  numEnqueued = 0;
+  const EngineError error = checkEnqueue(numTotalSamples);
+  if (error != EngineError::OK) {
+    return error;
+  }
+  if (!interleavedBuffer && numTotalSamples > 0) {
+    return EngineError::INVALID_PARAM;
+  }
+
+  numEnqueued = static_cast<int32_t>(
+      ring_.write(interleavedBuffer, static_cast<size_t>(numTotalSamples), speakers_.size()));
+  endOfStream_.store(endOfStream);
+  return numEnqueued == numTotalSamples ? EngineError::OK : EngineError::QUEUE_FULL;
+}
+
+EngineError SpeakersVirtualizerImpl::enqueueData(
+    const int16_t* interleavedBuffer,
+    int32_t numTotalSamples,
+    int32_t& numEnqueued,
+    bool endOfStream) {
+  numEnqueued = 0;
+  const EngineError error = checkEnqueue(numTotalSamples);
+  if (error != EngineError::OK) {
+    return error;
+  }
+  if (!interleavedBuffer && numTotalSamples > 0) {
+    return EngineError::INVALID_PARAM;
+  }
+
+  const SampleRingBuffer::Reservation reservation =
+      ring_.reserve(static_cast<size_t>(numTotalSamples), speakers_.size());
+  for (size_t i = 0; i < reservation.firstSize; ++i) {
+    reservation.first[i] = static_cast<float>(interleavedBuffer[i]) * (1.f / 32768.f);
+  }
+  const int16_t* second = interleavedBuffer + reservation.firstSize;
+  for (size_t i = 0; i < reservation.secondSize; ++i) {
+    reservation.second[i] = static_cast<float>(second[i]) * (1.f / 32768.f);
+  }
+  ring_.commit(reservation);
+  numEnqueued = static_cast<int32_t>(reservation.numSamples);
+  endOfStream_.store(endOfStream);
+  return numEnqueued == numTotalSamples ? EngineError::OK : EngineError::QUEUE_FULL;
+}
+
+int32_t SpeakersVirtualizerImpl::getFreeSpaceInQueue() const {
+  return static_cast<int32_t>(ring_.getFreeSpace());
+}
+
+int32_t SpeakersVirtualizerImpl::getQueueSize() const {
+  return static_cast<int32_t>(ring_.getCapacity());
+}
+
+void SpeakersVirtualizerImpl::flushQueue() {
+  flushPosition_.store(ring_.getWritePosition());
+  flushRequested_.store(true);
+  endOfStream_.store(false);
+}
+
+void SpeakersVirtualizerImpl::setEndOfStream(bool endOfStream) {
+  endOfStream_.store(endOfStream);
+}
+
+bool SpeakersVirtualizerImpl::getEndOfStreamStatus() const {
+  return endOfStream_.load();
+}
+
+uint64_t SpeakersVirtualizerImpl::getNumSamplesDequeuedPerChannel() const {
+  return numDequeued_.load();
+}
+
+QueueStatistics SpeakersVirtualizerImpl::getQueueStatistics() const {
+  QueueStatistics statistics = telemetry_.getStatistics();
+  statistics.queueSize = ring_.getCapacity();
+  statistics.numQueued = ring_.getCapacity() - ring_.getFreeSpace();
+  return statistics;
+}
+
+void SpeakersVirtualizerImpl::resetQueueStatistics() {
+  telemetry_.reset();
+}
+
+void SpeakersVirtualizerImpl::render(const RenderContext& context) {
+  const int numFrames = std::min(context.numFrames, engine_.bufferSize);
+  const Transport::Block block = transport_.process(numFrames, envelope_.data());
+  float volumeStart = 1.f;
+  float volumeEnd = 1.f;
+  volume_.process(numFrames, volumeStart, volumeEnd);
+
+  if (flushRequested_.exchange(false)) {
+    ring_.discardUntil(flushPosition_.load());
+  }
+
+  if (block.numFrames > 0 && !speakers_.empty()) {
+    const int numChannels = static_cast<int>(speakers_.size());
+    const size_t numQueued = ring_.getNumAvailable();
+    const size_t available = numQueued / numChannels;
+    const bool endOfStream = endOfStream_.load();
+    telemetry_.recordFill(numQueued);
+    if (available < static_cast<size_t>(block.numFrames) && !endOfStream) {
+      telemetry_.recordUnderrun(context.dspTime);
+      traceInstant(engine_.tracer, "SpeakersVirtualizer underrun", "dspTime", context.dspTime);
+      raiseEvent(Event::ERROR_BUFFER_UNDERRUN);
+    } else if (available > 0) {
+      const size_t count = std::min(available, static_cast<size_t>(block.numFrames));
+      float* frames = interleaved_.data();
+      std::memset(frames, 0, interleaved_.size() * sizeof(float));
+      ring_.read(frames + block.offset * numChannels, count * numChannels);
+      numDequeued_.fetch_add(count);
+
+      const float delta = (volumeEnd - volumeStart) / static_cast<float>(std::max(1, numFrames));
+      const int numAcn = SphericalHarmonics::getNumChannels(kOrder);
+      for (int speaker = 0; speaker < numChannels; ++speaker) {
+        const bool lfe = speakers_[speaker] == SpeakerPosition::LFE;
+        const float* gains = gains_.data() + speaker * SphericalHarmonics::kMaxChannels;
+        for (int n = block.offset; n < block.offset + block.numFrames; ++n) {
+          float sample = frames[n * numChannels + speaker] *
+              (volumeStart + delta * static_cast<float>(n + 1));
+          if (block.applyEnvelope) {
+            sample *= envelope_[n];
+          }
+          if (lfe) {
+            context.headlocked[0][n] += sample * kLfeGain;
+            context.headlocked[1][n] += sample * kLfeGain;
+            continue;
+          }
+          for (int acn = 0; acn < numAcn; ++acn) {
+            context.ambisonic[acn][n] += sample * gains[acn];
+          }
+        }
+      }
+    }
+  }
+
+  if (block.stateChanged) {
+    raiseEvent(Event::PLAY_STATE_CHANGED);
+  }
+}
+} // namespace TBE
@@ -0,0 +1,84 @@
+#ifndef FBA_SPEAKERSVIRTUALIZERIMPL_H
+#define FBA_SPEAKERSVIRTUALIZERIMPL_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "TransportControlBase.h"
+#include "dsp/SphericalHarmonics.h"
+#include "utils/QueueTelemetry.h"
+#include "utils/SampleRingBuffer.h"
+
+namespace TBE {
+/// Renders a loudspeaker layout (stereo up to 7.1) as virtual speakers around the listener's head.
+/// Each speaker is a third order plane wave at its standard position, relative to the head, and the
+/// LFE channel is sent to the head-locked mix.
+class SpeakersVirtualizerImpl : public TransportControlBase<SpeakersVirtualizer> {
+ public:
+  /// @param layout Speakers in channel order, terminated by SpeakerPosition::END_ENUM
+  /// @param channelBufferSizeInSamples Size of the queue for each channel
+  SpeakersVirtualizerImpl(
+      const EngineContext& engine,
+      SpeakerPosition const* layout,
+      size_t channelBufferSizeInSamples);
+
+  /// @return Number of speakers in a layout terminated by SpeakerPosition::END_ENUM
+  static size_t getNumSpeakers(SpeakerPosition const* layout);
+
+  /// @return Number of speakers of this virtualizer, each counting as one pooled AudioObject
+  size_t getNumSpeakers() const {
+    return speakers_.size();
+  }
+
+  EngineError enqueueData(
+      const float* interleavedBuffer,
+      int32_t numTotalSamples,
+      int32_t& numEnqueued,
+      bool endOfStream = false) override;
+  EngineError enqueueData(
+      const int16_t* interleavedBuffer,
+      int32_t numTotalSamples,
+      int32_t& numEnqueued,
+      bool endOfStream = false) override;
+  int32_t getFreeSpaceInQueue() const override;
+  int32_t getQueueSize() const override;
+  void flushQueue() override;
+  void setEndOfStream(bool endOfStream) override;
+  bool getEndOfStreamStatus() const override;
+  uint64_t getNumSamplesDequeuedPerChannel() const override;
+  QueueStatistics getQueueStatistics() const override;
+  void resetQueueStatistics() override;
+
+  // Renderable
+  void render(const RenderContext& context) override;
+
+ private:
+  /// @return OK, or an error if the data can't be enqueued from this thread or in this size
+  EngineError checkEnqueue(int32_t numTotalSamples);
+
+  static const int kOrder = 3;
+
+  std::vector<SpeakerPosition> speakers_;
+  std::vector<float> gains_; // SN3D gains, kMaxChannels per speaker. Unused for the LFE.
+  SampleRingBuffer ring_;
+  std::vector<float> interleaved_;
+  std::atomic<bool> endOfStream_{false};
+  std::atomic<bool> flushRequested_{false};
+  std::atomic<uint64_t> flushPosition_{0};
+  std::atomic<uint64_t> numDequeued_{0};
+  QueueTelemetry telemetry_;
+
+  std::mutex threadMutex_;
+  std::thread::id producerThread_;
+  bool hasProducerThread_{false};
+};
+} // namespace TBE
+
+#endif // FBA_SPEAKERSVIRTUALIZERIMPL_H
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "StreamingSource.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace TBE {
+static const size_t kMaxPitch = 4;
+
+StreamingSource::StreamingSource(
+    AudioFormatDecoder* decoder,
+    size_t bufferSizeInFrames,
+    int chunkSizeInFrames,
+    int maxReadFrames)
+    : decoder_(decoder),
+      numChannels_(std::max(1, decoder->getNumOfChannels())),
+      chunkSize_(std::max(1, std::min(chunkSizeInFrames, decoder->getMaxBufferSizePerChannel()))) {
+  const size_t frames = std::max(bufferSizeInFrames, static_cast<size_t>(chunkSize_) * 2);
+  ring_.allocate(frames * numChannels_);
+  decodeBuffer_.resize(static_cast<size_t>(chunkSize_) * numChannels_);
+  previousFrame_.assign(numChannels_, 0.f);
+  // Enough for the highest pitch, plus the previous frame and one frame of lookahead
+  readBuffer_.resize((static_cast<size_t>(maxReadFrames) * kMaxPitch + 2) * numChannels_);
+}
+
+int StreamingSource::getNumChannels() const {
+  return numChannels_;
+}
+
+size_t StreamingSource::getDurationInFrames() const {
+  return decoder_->getNumSamplesPerChannel();
+}
+
+float StreamingSource::getSampleRate() const {
+  return decoder_->getOutputSampleRate();
+}
+
+void StreamingSource::setLooping(bool loop) {
+  looping_.store(loop);
+}
+
+bool StreamingSource::isLooping() const {
+  return looping_.load();
+}
+
+void StreamingSource::seek(size_t frame) {
+  seekTarget_.store(std::min(frame, getDurationInFrames()));
+  seekRequested_.store(true);
+}
+
+bool StreamingSource::needsData() const {
+  if (seekRequested_.load()) {
+    return true;
+  }
+  return !decoderFinished_.load(std::memory_order_relaxed) &&
+      ring_.getFreeSpace() >= decodeBuffer_.size();
+}
+
+bool StreamingSource::fill(int maxChunks) {
+  std::lock_guard<std::mutex> lock(decodeMutex_);
+  bool progressed = false;
+
+  if (seekRequested_.exchange(false)) {
+    const size_t target = seekTarget_.load();
+    const Marker flush{
+        MarkerType::FLUSH, ring_.getWritePosition(), target, producerGeneration_ + 1};
+    if (markers_.push(flush)) {
+      decoder_->seekToSample(target);
+      decoderFinished_.store(false, std::memory_order_relaxed);
+      producerGeneration_++;
+      generation_.store(producerGeneration_, std::memory_order_release);
+      progressed = true;
+    } else {
+      // The consumer has not caught up with the markers yet, retry on the next fill
+      seekRequested_.store(true);
+      return false;
+    }
+  }
+
+  int numChunks = 0;
+  int emptyLoops = 0;
+  const size_t chunkSamples = decodeBuffer_.size();
+  while (!decoderFinished_.load(std::memory_order_relaxed) &&
+         (maxChunks <= 0 || numChunks < maxChunks) && ring_.getFreeSpace() >= chunkSamples) {
+    size_t decoded = decoder_->decode(decodeBuffer_.data(), static_cast<int32_t>(chunkSamples));
+    decoded -= decoded % numChannels_;
+    if (decoded > 0) {
+      ring_.write(decodeBuffer_.data(), decoded);
+      numChunks++;
+      emptyLoops = 0;
+      progressed = true;
+      continue;
+    }
+
+    const bool error = decoder_->decoderError();
+    // Stop looping a stream that produces nothing, to avoid spinning on an empty file
+    const bool loop = !error && looping_.load() && emptyLoops == 0;
+    const Marker marker{
+        loop ? MarkerType::LOOP : MarkerType::END_OF_STREAM,
+        ring_.getWritePosition(),
+        0,
+        producerGeneration_};
+    if (!markers_.push(marker)) {
+      break;
+    }
+    if (error) {
+      events_.fetch_or(EVENT_DECODER_ERROR);
+    }
+    if (loop) {
+      decoder_->seekToSample(0);
+      emptyLoops++;
+    } else {
+      decoderFinished_.store(true, std::memory_order_relaxed);
+    }
+    progressed = true;
+  }
+  return progressed;
+}
+
+size_t StreamingSource::getNumFramesAvailable() const {
+  return ring_.getNumAvailable() / numChannels_;
+}
+
+void StreamingSource::processMarkers() {
+  const uint32_t latest = generation_.load(std::memory_order_acquire);
+  Marker marker;
+  while (markers_.peek(marker)) {
+    if (marker.type == MarkerType::FLUSH) {
+      ring_.discardUntil(marker.writePosition);
+      consumerPosition_ = marker.framePosition;
+      phase_ = 0.0;
+      std::fill(previousFrame_.begin(), previousFrame_.end(), 0.f);
+      ended_.store(false);
+    } else if (marker.generation < latest) {
+      // Superseded by a seek that is further down the queue
+    } else if (ring_.getReadPosition() >= marker.writePosition) {
+      if (marker.type == MarkerType::LOOP) {
+        consumerPosition_ = marker.framePosition;
+        events_.fetch_or(EVENT_LOOPED);
+      } else {
+        ended_.store(true);
+        events_.fetch_or(EVENT_END_OF_STREAM);
+      }
+    } else {
+      break;
+    }
+    markers_.pop(marker);
+  }
+  position_.store(consumerPosition_, std::memory_order_relaxed);
+}
+
+void StreamingSource::update() {
+  processMarkers();
+}
+
+size_t StreamingSource::readFrames(float* interleaved, size_t numFrames) {
+  size_t total = 0;
+  while (total < numFrames) {
+    processMarkers();
+    if (ended_.load(std::memory_order_relaxed)) {
+      break;
+    }
+
+    // Never read across a loop or end marker, so that the position can be reset exactly there
+    size_t limit = numFrames - total;
+    Marker marker;
+    if (markers_.peek(marker) && marker.type != MarkerType::FLUSH) {
+      const uint64_t read = ring_.getReadPosition();
+      if (marker.writePosition > read) {
+        limit = std::min<size_t>(limit, (marker.writePosition - read) / numChannels_);
+      }
+    }
+
+    const size_t count = std::min(limit, getNumFramesAvailable());
+    if (count == 0) {
+      break;
+    }
+    ring_.read(interleaved + total * numChannels_, count * numChannels_);
+    consumerPosition_ += count;
+    total += count;
+  }
+  processMarkers();
+  return total;
+}
+
+int StreamingSource::read(float* interleaved, int numFrames, float pitch) {
+  if (numFrames <= 0) {
+    return 0;
+  }
+
+  int written = 0;
+  if (pitch == 1.f && phase_ == 0.0) {
+    written = static_cast<int>(readFrames(interleaved, static_cast<size_t>(numFrames)));
+    if (written > 0) {
+      std::memcpy(
+          previousFrame_.data(),
+          interleaved + (written - 1) * numChannels_,
+          numChannels_ * sizeof(float));
+    }
+  } else {
+    // Linear interpolation: index 0 is the last frame of the previous block, input frames are
+    // read after it. Output frame i is at fractional index phase_ + i * pitch.
+    const double end = phase_ + numFrames * static_cast<double>(pitch);
+    const size_t needed = static_cast<size_t>(end);
+    const size_t required = (needed + 2) * numChannels_;
+    if (readBuffer_.size() < required) {
+      // Only grows when the pitch or block size increases
+      readBuffer_.resize(required);
+    }
+    float* frames = readBuffer_.data();
+    std::memcpy(frames, previousFrame_.data(), numChannels_ * sizeof(float));
+    const size_t got = readFrames(frames + numChannels_, needed);
+
+    // One frame of lookahead, without consuming it
+    float* next = frames + (got + 1) * numChannels_;
+    if (ring_.peek(next, numChannels_) < static_cast<size_t>(numChannels_)) {
+      std::memcpy(next, frames + got * numChannels_, numChannels_ * sizeof(float));
+    }
+
+    for (int i = 0; i < numFrames; ++i) {
+      const double position = phase_ + i * static_cast<double>(pitch);
+      const size_t index = static_cast<size_t>(position);
+      if (index > got) {
+        break;
+      }
+      const float fraction = static_cast<float>(position - index);
+      const float* a = frames + index * numChannels_;
+      const float* b = a + numChannels_;
+      float* out = interleaved + i * numChannels_;
+      for (int ch = 0; ch < numChannels_; ++ch) {
+        out[ch] = a[ch] + fraction * (b[ch] - a[ch]);
+      }
+      written++;
+    }
+
+    std::memcpy(previousFrame_.data(), frames + got * numChannels_, numChannels_ * sizeof(float));
+    phase_ = got == needed ? end - static_cast<double>(needed) : 0.0;
+  }
+
+  if (written < numFrames) {
+    std::memset(
+        interleaved + written * numChannels_,
+        0,
+        static_cast<size_t>(numFrames - written) * numChannels_ * sizeof(float));
+    if (!ended_.load(std::memory_order_relaxed)) {
+      events_.fetch_or(EVENT_STARVED);
+    }
+  }
+  return written;
+}
+
+size_t StreamingSource::getPosition() const {
+  return position_.load(std::memory_order_relaxed);
+}
+
+bool StreamingSource::hasEnded() const {
+  return ended_.load();
+}
+
+uint32_t StreamingSource::takeEvents() {
+  return events_.exchange(EVENT_NONE);
+}
+} // namespace TBE
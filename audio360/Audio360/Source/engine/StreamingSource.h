@@ -0,0 +1,132 @@
+#ifndef FBA_STREAMINGSOURCE_H
+#define FBA_STREAMINGSOURCE_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "TBE_AudioFormatDecoder.h"
+#include "utils/SampleRingBuffer.h"
+#include "utils/SpscQueue.h"
+
+namespace TBE {
+/// Streams interleaved PCM from an AudioFormatDecoder into a lock-free ring buffer. The producer
+/// side (fill) runs on the decoder thread, or inline on the audio thread when decoding in the audio
+/// callback; the consumer side (read) runs on the audio thread.
+///
+/// Seeks, loops and the end of the stream are communicated to the consumer through markers that
+/// carry the ring buffer write position at which they take effect, so that the reported playback
+/// position stays sample accurate without any locking on the audio thread.
+class StreamingSource {
+ public:
+  /// Events raised by read(), cleared by takeEvents()
+  enum EventFlags : uint32_t {
+    EVENT_NONE = 0,
+    EVENT_LOOPED = 1 << 0,
+    EVENT_END_OF_STREAM = 1 << 1,
+    EVENT_STARVED = 1 << 2,
+    EVENT_DECODER_ERROR = 1 << 3,
+  };
+
+  /// @param decoder An initialised decoder. Ownership is transferred.
+  /// @param bufferSizeInFrames Capacity of the streaming buffer in frames
+  /// @param chunkSizeInFrames Number of frames decoded at a time
+  /// @param maxReadFrames Largest number of frames passed to read()
+  StreamingSource(
+      AudioFormatDecoder* decoder,
+      size_t bufferSizeInFrames,
+      int chunkSizeInFrames,
+      int maxReadFrames);
+
+  int getNumChannels() const;
+  size_t getDurationInFrames() const;
+  float getSampleRate() const;
+
+  /// Control thread: enable or disable looping. Takes effect for the next time the decoder reaches
+  /// the end of the stream.
+  void setLooping(bool loop);
+  bool isLooping() const;
+
+  /// Control thread: request a seek. The decoder is repositioned on the next fill().
+  void seek(size_t frame);
+
+  /// Producer: decode until the streaming buffer is full or the stream ends
+  /// @param maxChunks Maximum number of chunks to decode, or 0 for no limit
+  /// @return True if any frames were decoded or a seek was processed
+  bool fill(int maxChunks = 0);
+
+  /// Producer: true if the buffer is not full and the stream has not ended
+  bool needsData() const;
+
+  /// Consumer: number of frames that can be read without starving
+  size_t getNumFramesAvailable() const;
+
+  /// Consumer: read frames at a playback rate, resampling with linear interpolation
+  /// @param interleaved Output, numFrames * getNumChannels() samples. Frames that could not be read
+  /// are set to zero.
+  /// @param numFrames Number of frames to output
+  /// @param pitch Playback rate, 1 for the original speed
+  /// @return Number of frames written
+  int read(float* interleaved, int numFrames, float pitch = 1.f);
+
+  /// Consumer: apply pending seek markers without reading audio
+  void update();
+
+  /// Consumer: playback position in frames, as of the last read
+  size_t getPosition() const;
+
+  /// Consumer or control thread: true once the end of the stream has been played
+  bool hasEnded() const;
+
+  /// Return and clear the events raised since the last call
+  uint32_t takeEvents();
+
+ private:
+  enum class MarkerType : uint8_t { FLUSH, LOOP, END_OF_STREAM };
+
+  struct Marker {
+    MarkerType type;
+    uint64_t writePosition; /// Ring buffer write position (in samples) where the marker applies
+    uint64_t framePosition; /// Stream position (in frames) at the marker
+    uint32_t generation; /// Seek generation the marker belongs to
+  };
+
+  void processMarkers();
+  size_t readFrames(float* interleaved, size_t numFrames);
+
+  std::unique_ptr<AudioFormatDecoder> decoder_;
+  const int numChannels_;
+  const int chunkSize_;
+  SampleRingBuffer ring_;
+  SpscQueue<Marker, 64> markers_;
+  std::mutex decodeMutex_; // Serialises producers (decoder thread and inline decoding)
+
+  // Producer state
+  std::vector<float> decodeBuffer_;
+  uint32_t producerGeneration_{0};
+
+  // Shared state
+  std::atomic<bool> decoderFinished_{false};
+  std::atomic<bool> looping_{false};
+  std::atomic<bool> seekRequested_{false};
+  std::atomic<size_t> seekTarget_{0};
+  std::atomic<uint32_t> generation_{0};
+  std::atomic<size_t> position_{0};
+  std::atomic<bool> ended_{false};
+  std::atomic<uint32_t> events_{EVENT_NONE};
+
+  // Consumer state
+  std::vector<float> readBuffer_;
+  std::vector<float> previousFrame_;
+  double phase_{0.0};
+  size_t consumerPosition_{0};
+};
+} // namespace TBE
+
+#endif // FBA_STREAMINGSOURCE_H
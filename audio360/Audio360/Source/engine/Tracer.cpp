@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "Tracer.h"
+#include <cinttypes>
+#include <cstdio>
+#include "BusGraph.h"
+
+namespace TBE {
+namespace {
+std::atomic<uint64_t> nextTracerId{1};
+
+/// Name given to the calling thread with Tracer::setCurrentThreadName()
+thread_local const char* currentThreadName = nullptr;
+
+/// Ring of the last tracer the calling thread recorded into
+struct RingCache {
+  uint64_t tracerId{0};
+  void* ring{nullptr};
+};
+thread_local RingCache ringCache;
+
+void appendMicroSec(std::string& json, uint64_t nanoSec) {
+  char text[32];
+  snprintf(text, sizeof(text), "%" PRIu64 ".%03u", nanoSec / 1000, unsigned(nanoSec % 1000));
+  json += text;
+}
+} // namespace
+
+const size_t Tracer::kEventsPerThread;
+
+Tracer::Tracer() : id_(nextTracerId.fetch_add(1)), start_(std::chrono::steady_clock::now()) {}
+
+Tracer::~Tracer() {}
+
+void Tracer::setCurrentThreadName(const char* name) {
+  currentThreadName = name;
+}
+
+void Tracer::complete(const char* name, uint64_t startNanoSec, const char* argName, int64_t arg) {
+  const uint64_t end = now();
+  record(
+      Phase::COMPLETE,
+      name,
+      startNanoSec,
+      end > startNanoSec ? end - startNanoSec : 0,
+      argName,
+      arg);
+}
+
+void Tracer::instant(const char* name, const char* argName, int64_t arg) {
+  record(Phase::INSTANT, name, now(), 0, argName, arg);
+}
+
+void Tracer::record(
+    Phase phase,
+    const char* name,
+    uint64_t start,
+    uint64_t duration,
+    const char* argName,
+    int64_t arg) {
+  ThreadRing* ring = getThreadRing();
+  if (ring->threadName.load(std::memory_order_relaxed) != currentThreadName) {
+    ring->threadName.store(currentThreadName, std::memory_order_relaxed);
+  }
+
+  const uint64_t index = ring->numWritten.load(std::memory_order_relaxed);
+  Slot& slot = ring->slots[index % kEventsPerThread];
+  // Sequence lock: save() discards the slot unless it reads the same even sequence before and
+  // after its fields
+  slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.argName.store(argName, std::memory_order_relaxed);
+  slot.start.store(start, std::memory_order_relaxed);
+  slot.duration.store(duration, std::memory_order_relaxed);
+  slot.arg.store(arg, std::memory_order_relaxed);
+  slot.phase.store(phase, std::memory_order_relaxed);
+  slot.sequence.store(2 * index + 2, std::memory_order_release);
+  ring->numWritten.store(index + 1, std::memory_order_release);
+}
+
+Tracer::ThreadRing* Tracer::getThreadRing() {
+  if (ringCache.tracerId == id_) {
+    return static_cast<ThreadRing*>(ringCache.ring);
+  }
+
+  const std::thread::id threadId = std::this_thread::get_id();
+  ThreadRing* ring = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(ringsMutex_);
+    for (auto& existing : rings_) {
+      if (existing->threadId == threadId) {
+        ring = existing.get();
+        break;
+      }
+    }
+    if (!ring) {
+      rings_.emplace_back(new ThreadRing());
+      ring = rings_.back().get();
+      ring->threadId = threadId;
+      ring->tid = rings_.size();
+    }
+  }
+  ringCache.tracerId = id_;
+  ringCache.ring = ring;
+  return ring;
+}
+
+void Tracer::appendEvents(const ThreadRing& ring, std::string& json, bool& first) const {
+  const std::string tid = std::to_string(ring.tid);
+  const char* threadName = ring.threadName.load(std::memory_order_relaxed);
+  json += first ? "\n    " : ",\n    ";
+  first = false;
+  json += "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " + tid;
+  json += ", \"args\": {\"name\": ";
+  json += BusGraph::quote(threadName ? threadName : "thread " + tid);
+  json += "}}";
+
+  const uint64_t numWritten = ring.numWritten.load(std::memory_order_acquire);
+  const uint64_t begin = numWritten > kEventsPerThread ? numWritten - kEventsPerThread : 0;
+  for (uint64_t index = begin; index < numWritten; ++index) {
+    const Slot& slot = ring.slots[index % kEventsPerThread];
+    const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    const char* name = slot.name.load(std::memory_order_relaxed);
+    const char* argName = slot.argName.load(std::memory_order_relaxed);
+    const uint64_t start = slot.start.load(std::memory_order_relaxed);
+    const uint64_t duration = slot.duration.load(std::memory_order_relaxed);
+    const int64_t arg = slot.arg.load(std::memory_order_relaxed);
+    const Phase phase = slot.phase.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence != 2 * index + 2 || slot.sequence.load(std::memory_order_relaxed) != sequence ||
+        !name) {
+      continue; // Overwritten or being written
+    }
+
+    json += ",\n    {\"name\": ";
+    json += BusGraph::quote(name);
+    json += ", \"cat\": \"audio360\", \"pid\": 1, \"tid\": " + tid + ", \"ts\": ";
+    appendMicroSec(json, start);
+    if (phase == Phase::COMPLETE) {
+      json += ", \"ph\": \"X\", \"dur\": ";
+      appendMicroSec(json, duration);
+    } else {
+      json += ", \"ph\": \"i\", \"s\": \"t\"";
+    }
+    if (argName) {
+      json += ", \"args\": {" + BusGraph::quote(argName) + ": " + std::to_string(arg) + "}";
+    }
+    json += "}";
+  }
+}
+
+bool Tracer::save(const char* path) const {
+  if (!path) {
+    return false;
+  }
+  std::vector<const ThreadRing*> rings;
+  {
+    std::lock_guard<std::mutex> lock(ringsMutex_);
+    for (auto& ring : rings_) {
+      rings.push_back(ring.get());
+    }
+  }
+
+  std::string json = "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [";
+  bool first = true;
+  for (const ThreadRing* ring : rings) {
+    appendEvents(*ring, json, first);
+  }
+  json += first ? "]\n}\n" : "\n  ]\n}\n";
+
+  FILE* file = std::fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+  const bool written = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+  return std::fclose(file) == 0 && written;
+}
+} // namespace TBE
@@ -0,0 +1,150 @@
+#ifndef FBA_TRACER_H
+#define FBA_TRACER_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace TBE {
+/// Opt-in recorder of the engine's activity, saved in the Chrome trace event format that
+/// chrome://tracing and Perfetto open.
+///
+/// Every thread that records gets its own ring of events the first time it does, which takes a
+/// mutex once. After that, recording is a few relaxed stores into the thread's ring: nothing locks
+/// and the oldest events are overwritten. Each slot carries a sequence number, so save() can run
+/// while the rings are written and skips the slots it catches mid-write. While tracing is off,
+/// recording costs one relaxed load.
+///
+/// Event and argument names must be string literals: only the pointers are kept.
+class Tracer {
+ public:
+  /// Events kept per thread
+  static const size_t kEventsPerThread = 8192;
+
+  Tracer();
+  ~Tracer();
+
+  Tracer(const Tracer&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+
+  void setEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  bool isEnabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /// @return Nanoseconds since the tracer was created
+  uint64_t now() const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now() - start_)
+                                     .count());
+  }
+
+  /// Record an event that started at startNanoSec and ends now
+  /// @param argName Name of arg, or nullptr if the event has no argument
+  void complete(const char* name, uint64_t startNanoSec, const char* argName, int64_t arg);
+
+  /// Record an event without duration
+  /// @param argName Name of arg, or nullptr if the event has no argument
+  void instant(const char* name, const char* argName, int64_t arg);
+
+  /// Write the recorded events as Chrome trace json
+  /// @return true on success
+  bool save(const char* path) const;
+
+  /// Name the calling thread in the traces it records into from now on
+  static void setCurrentThreadName(const char* name);
+
+ private:
+  enum class Phase : uint8_t { COMPLETE, INSTANT };
+
+  struct Slot {
+    std::atomic<uint64_t> sequence{0}; // 2 * (index + 1) once written, odd while being written
+    std::atomic<const char*> name{nullptr};
+    std::atomic<const char*> argName{nullptr};
+    std::atomic<uint64_t> start{0};
+    std::atomic<uint64_t> duration{0};
+    std::atomic<int64_t> arg{0};
+    std::atomic<Phase> phase{Phase::INSTANT};
+  };
+
+  /// Events of one thread. Only that thread writes.
+  struct ThreadRing {
+    std::thread::id threadId;
+    std::atomic<const char*> threadName{nullptr};
+    size_t tid{0};
+    std::atomic<uint64_t> numWritten{0};
+    Slot slots[kEventsPerThread];
+  };
+
+  void record(
+      Phase phase,
+      const char* name,
+      uint64_t start,
+      uint64_t duration,
+      const char* argName,
+      int64_t arg);
+
+  /// @return The calling thread's ring, created on its first event
+  ThreadRing* getThreadRing();
+
+  void appendEvents(const ThreadRing& ring, std::string& json, bool& first) const;
+
+  const uint64_t id_; // Unique across tracers, so that thread caches never outlive their tracer
+  const std::chrono::steady_clock::time_point start_;
+  std::atomic<bool> enabled_{false};
+
+  mutable std::mutex ringsMutex_;
+  std::vector<std::unique_ptr<ThreadRing>> rings_;
+};
+
+/// Records the time spent in its scope as a complete event, if tracing is on when it starts
+class TraceScope {
+ public:
+  TraceScope(Tracer* tracer, const char* name, const char* argName = nullptr, int64_t arg = 0)
+      : tracer_(tracer && tracer->isEnabled() ? tracer : nullptr),
+        name_(name),
+        argName_(argName),
+        arg_(arg),
+        start_(tracer_ ? tracer_->now() : 0) {}
+
+  ~TraceScope() {
+    if (tracer_) {
+      tracer_->complete(name_, start_, argName_, arg_);
+    }
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  Tracer* const tracer_;
+  const char* const name_;
+  const char* const argName_;
+  const int64_t arg_;
+  const uint64_t start_;
+};
+
+/// Records an instant event if there is a tracer and tracing is on
+inline void traceInstant(Tracer* tracer, const char* name, const char* argName, int64_t arg) {
+  if (tracer && tracer->isEnabled()) {
+    tracer->instant(name, argName, arg);
+  }
+}
+} // namespace TBE
+
+#endif // FBA_TRACER_H
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "Transport.h"
+#include <algorithm>
+
+namespace TBE {
+Transport::Transport(float sampleRate) : sampleRate_(sampleRate) {}
+
+EngineError Transport::request(Command command, float delayMs, float fadeMs) {
+  if (delayMs < 0.f || fadeMs < 0.f) {
+    return EngineError::INVALID_PARAM;
+  }
+
+  Pending pending;
+  pending.command = command;
+  pending.delaySamples = static_cast<int64_t>(delayMs * 0.001 * sampleRate_);
+  pending.fadeSamples = static_cast<int>(fadeMs * 0.001f * sampleRate_);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_ = pending;
+  hasPending_ = true;
+  cancelRequested_ = false;
+  if (pending.delaySamples == 0) {
+    switch (command) {
+      case Command::PLAY:
+        reportedState_.store(PlayState::PLAYING);
+        break;
+      case Command::PAUSE:
+        if (reportedState_.load() != PlayState::STOPPED) {
+          reportedState_.store(PlayState::PAUSED);
+        }
+        break;
+      case Command::STOP:
+        reportedState_.store(PlayState::STOPPED);
+        break;
+    }
+  }
+  return EngineError::OK;
+}
+
+void Transport::cancelScheduled() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  hasPending_ = false;
+  cancelRequested_ = true;
+}
+
+PlayState Transport::getPlayState() const {
+  return reportedState_.load();
+}
+
+void Transport::apply(const Pending& pending, Block& block) {
+  const PlayState previous = state_;
+  if (pending.command == Command::PLAY) {
+    if (state_ != PlayState::PLAYING) {
+      state_ = PlayState::PLAYING;
+      gain_ = pending.fadeSamples > 0 ? 0.f : 1.f;
+    }
+    endState_ = PlayState::PLAYING;
+    fadeTarget_ = 1.f;
+  } else {
+    const PlayState end =
+        pending.command == Command::PAUSE ? PlayState::PAUSED : PlayState::STOPPED;
+    if (state_ == PlayState::PLAYING && pending.fadeSamples > 0) {
+      endState_ = end;
+      fadeTarget_ = 0.f;
+    } else {
+      // Pausing a stopped object keeps it stopped
+      if (!(end == PlayState::PAUSED && state_ == PlayState::STOPPED)) {
+        state_ = end;
+      }
+      block.rewind = block.rewind || end == PlayState::STOPPED;
+      gain_ = 0.f;
+      fadeRemaining_ = 0;
+    }
+  }
+
+  if (state_ == PlayState::PLAYING) {
+    fadeRemaining_ = gain_ != fadeTarget_ ? std::max(1, pending.fadeSamples) : 0;
+    fadeStep_ = fadeRemaining_ > 0 ? (fadeTarget_ - gain_) / fadeRemaining_ : 0.f;
+    if (pending.fadeSamples == 0) {
+      gain_ = fadeTarget_;
+      fadeRemaining_ = 0;
+    }
+  }
+
+  if (state_ != previous) {
+    reportedState_.store(state_);
+    block.stateChanged = true;
+  }
+}
+
+Transport::Block Transport::process(int numFrames, float* envelope) {
+  Block block;
+
+  if (mutex_.try_lock()) {
+    if (cancelRequested_) {
+      hasActive_ = false;
+      cancelRequested_ = false;
+    }
+    if (hasPending_) {
+      active_ = pending_;
+      hasActive_ = true;
+      hasPending_ = false;
+    }
+    mutex_.unlock();
+  }
+
+  int first = -1;
+  int last = -1;
+  int numAudible = 0;
+  for (int n = 0; n < numFrames; ++n) {
+    if (hasActive_) {
+      if (active_.delaySamples <= 0) {
+        hasActive_ = false;
+        apply(active_, block);
+      } else {
+        active_.delaySamples--;
+      }
+    }
+
+    if (state_ != PlayState::PLAYING) {
+      envelope[n] = 0.f;
+      continue;
+    }
+
+    envelope[n] = gain_;
+    block.applyEnvelope = block.applyEnvelope || gain_ != 1.f;
+    if (first < 0) {
+      first = n;
+    }
+    last = n;
+    numAudible++;
+
+    if (fadeRemaining_ > 0) {
+      gain_ += fadeStep_;
+      if (--fadeRemaining_ == 0) {
+        gain_ = fadeTarget_;
+        if (endState_ != PlayState::PLAYING) {
+          state_ = endState_;
+          block.rewind = block.rewind || state_ == PlayState::STOPPED;
+          block.stateChanged = true;
+          reportedState_.store(state_);
+          endState_ = PlayState::PLAYING;
+        }
+      }
+    }
+  }
+
+  if (first >= 0) {
+    block.offset = first;
+    block.numFrames = last - first + 1;
+    // A pause and a play within the same block leave a silent gap inside the audible part
+    if (numAudible != block.numFrames) {
+      block.applyEnvelope = true;
+    }
+  }
+  return block;
+}
+
+void Transport::stopNow() {
+  if (state_ != PlayState::STOPPED) {
+    state_ = PlayState::STOPPED;
+    reportedState_.store(state_);
+  }
+  gain_ = 0.f;
+  fadeRemaining_ = 0;
+  endState_ = PlayState::PLAYING;
+}
+
+void Transport::reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  hasPending_ = false;
+  cancelRequested_ = false;
+  hasActive_ = false;
+  state_ = PlayState::STOPPED;
+  endState_ = PlayState::PLAYING;
+  gain_ = 0.f;
+  fadeRemaining_ = 0;
+  reportedState_.store(PlayState::STOPPED);
+}
+} // namespace TBE
@@ -0,0 +1,85 @@
+#ifndef FBA_TRANSPORT_H
+#define FBA_TRANSPORT_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include "TBE_AudioEngineDefinitions.h"
+
+namespace TBE {
+/// Sample accurate play/pause/stop state machine shared by every TransportControl implementation.
+/// Commands are issued from control threads, optionally delayed and faded, and are applied by the
+/// audio thread. Only one command can be pending at a time: a new command replaces a pending one.
+class Transport {
+ public:
+  enum class Command { PLAY, PAUSE, STOP };
+
+  /// The part of a block during which the object is audible
+  struct Block {
+    int offset{0}; /// First audible frame in the block
+    int numFrames{0}; /// Number of frames from offset, 0 if silent for the whole block
+    bool applyEnvelope{false}; /// False if the envelope is 1 for all audible frames
+    bool stateChanged{false}; /// The play state changed during the block
+    bool rewind{false}; /// The object was stopped and must rewind to the start
+  };
+
+  explicit Transport(float sampleRate);
+
+  /// Control thread: issue a command
+  /// @param command The command
+  /// @param delayMs Delay from now in milliseconds before the command is applied
+  /// @param fadeMs Fade duration in milliseconds
+  EngineError request(Command command, float delayMs, float fadeMs);
+
+  /// Control thread: cancel a pending command
+  void cancelScheduled();
+
+  /// @return The play state, as seen by control threads
+  PlayState getPlayState() const;
+
+  /// Audio thread: advance the state machine by one block
+  /// @param numFrames Block size
+  /// @param envelope numFrames gains to apply to the output. Only valid within the audible part.
+  Block process(int numFrames, float* envelope);
+
+  /// Audio thread: stop immediately, e.g. at the end of a stream
+  void stopNow();
+
+  /// Reset to the stopped state and drop pending commands. The caller must ensure the audio thread
+  /// is not processing this object.
+  void reset();
+
+ private:
+  struct Pending {
+    Command command{Command::STOP};
+    int64_t delaySamples{0};
+    int fadeSamples{0};
+  };
+
+  void apply(const Pending& pending, Block& block);
+
+  const float sampleRate_;
+  std::mutex mutex_; // Guards pending_ and flags. The audio thread only ever try-locks.
+  Pending pending_;
+  bool hasPending_{false};
+  bool cancelRequested_{false};
+  std::atomic<PlayState> reportedState_{PlayState::STOPPED};
+
+  // Audio thread state
+  Pending active_;
+  bool hasActive_{false};
+  PlayState state_{PlayState::STOPPED};
+  PlayState endState_{PlayState::PLAYING};
+  float gain_{0.f};
+  float fadeStep_{0.f};
+  float fadeTarget_{1.f};
+  int fadeRemaining_{0};
+};
+} // namespace TBE
+
+#endif // FBA_TRANSPORT_H
@@ -0,0 +1,160 @@
+#ifndef FBA_TRANSPORTCONTROLBASE_H
+#define FBA_TRANSPORTCONTROLBASE_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <vector>
+#include "RenderContext.h"
+#include "TBE_AudioEngine.h"
+#include "Transport.h"
+#include "dsp/Ramp.h"
+
+namespace TBE {
+/// Implements the parts shared by every object with a transport: play/pause/stop, volume and event
+/// dispatch. Interface is either a SpatDecoderInterface or SpeakersVirtualizer.
+template <typename Interface>
+class TransportControlBase : public Interface, public Renderable {
+ public:
+  explicit TransportControlBase(const EngineContext& engine)
+      : engine_(engine), transport_(engine.sampleRate), volume_(1.f) {
+    envelope_.assign(static_cast<size_t>(engine.bufferSize), 0.f);
+  }
+
+  ~TransportControlBase() override {}
+
+  // TransportControl
+
+  EngineError play() override {
+    return requestTransport(Transport::Command::PLAY, 0.f, 0.f);
+  }
+
+  EngineError playScheduled(float millisecondsFromNow) override {
+    return requestTransport(Transport::Command::PLAY, millisecondsFromNow, 0.f);
+  }
+
+  EngineError playScheduled(float millisecondsFromNow, float fadeDurationInMs) override {
+    return requestTransport(Transport::Command::PLAY, millisecondsFromNow, fadeDurationInMs);
+  }
+
+  EngineError playWithFade(float fadeDurationInMs) override {
+    return requestTransport(Transport::Command::PLAY, 0.f, fadeDurationInMs);
+  }
+
+  EngineError pause() override {
+    return requestTransport(Transport::Command::PAUSE, 0.f, 0.f);
+  }
+
+  EngineError pauseScheduled(float millisecondsFromNow) override {
+    return requestTransport(Transport::Command::PAUSE, millisecondsFromNow, 0.f);
+  }
+
+  EngineError pauseScheduled(float millisecondsFromNow, float fadeDurationInMs) override {
+    return requestTransport(Transport::Command::PAUSE, millisecondsFromNow, fadeDurationInMs);
+  }
+
+  EngineError pauseWithFade(float fadeDurationInMs) override {
+    return requestTransport(Transport::Command::PAUSE, 0.f, fadeDurationInMs);
+  }
+
+  EngineError stop() override {
+    return requestTransport(Transport::Command::STOP, 0.f, 0.f);
+  }
+
+  EngineError stopScheduled(float millisecondsFromNow) override {
+    return requestTransport(Transport::Command::STOP, millisecondsFromNow, 0.f);
+  }
+
+  EngineError stopScheduled(float millisecondsFromNow, float fadeDurationInMs) override {
+    return requestTransport(Transport::Command::STOP, millisecondsFromNow, fadeDurationInMs);
+  }
+
+  EngineError stopWithFade(float fadeDurationInMs) override {
+    return requestTransport(Transport::Command::STOP, 0.f, fadeDurationInMs);
+  }
+
+  PlayState getPlayState() const override {
+    return transport_.getPlayState();
+  }
+
+  void cancelScheduledParams() override {
+    transport_.cancelScheduled();
+  }
+
+  void setVolume(float linearGain, float rampTimeMs, bool forcePreviousRamp = false) override {
+    volume_.setTarget(std::max(0.f, linearGain), msToSamples(rampTimeMs), forcePreviousRamp);
+  }
+
+  void setVolumeDecibels(float dB, float rampTimeMs, bool forcePreviousRamp = false) override {
+    setVolume(std::pow(10.f, dB / 20.f), rampTimeMs, forcePreviousRamp);
+  }
+
+  float getVolume() const override {
+    return volume_.getTarget();
+  }
+
+  float getVolumeDecibels() const override {
+    const float volume = getVolume();
+    return volume > 0.f ? 20.f * std::log10(volume) : -INFINITY;
+  }
+
+  EngineError setEventCallback(EventCallback callback, void* userData) override {
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    eventCallback_ = callback;
+    eventUserData_ = userData;
+    return EngineError::OK;
+  }
+
+  // Renderable
+
+  void dispatchEvents() override {
+    uint32_t events = pendingEvents_.exchange(0);
+    if (events == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    for (int event = 0; event < static_cast<int>(Event::INVALID); ++event) {
+      if ((events & (1u << event)) && eventCallback_) {
+        eventCallback_(static_cast<Event>(event), eventUserData_);
+      }
+    }
+  }
+
+  bool isPlaying() const override {
+    return transport_.getPlayState() == PlayState::PLAYING;
+  }
+
+ protected:
+  virtual EngineError requestTransport(Transport::Command command, float delayMs, float fadeMs) {
+    return transport_.request(command, delayMs, fadeMs);
+  }
+
+  /// Thread safe: raise an event, dispatched after the block has been rendered
+  void raiseEvent(Event event) {
+    pendingEvents_.fetch_or(1u << static_cast<int>(event));
+  }
+
+  int msToSamples(float ms) const {
+    return static_cast<int>(std::max(0.f, ms) * 0.001f * engine_.sampleRate);
+  }
+
+  const EngineContext engine_;
+  Transport transport_;
+  LinearRamp volume_;
+  std::vector<float> envelope_; // Transport gain envelope for the current block
+
+ private:
+  std::atomic<uint32_t> pendingEvents_{0};
+  std::mutex callbackMutex_;
+  EventCallback eventCallback_{nullptr};
+  void* eventUserData_{nullptr};
+};
+} // namespace TBE
+
+#endif // FBA_TRANSPORTCONTROLBASE_H
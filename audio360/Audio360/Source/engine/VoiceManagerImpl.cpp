@@ -0,0 +1,1088 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "VoiceManagerImpl.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "BusGraph.h"
+#include "Tracer.h"
+
+namespace TBE {
+namespace {
+/// Range, default and step of each VoiceParam, in declaration order
+const VoiceParamDescription kParamDescriptions[] = {
+    {0.f, 1.f, 0.f, 1.f}, // Loop
+    {0.f, 1.f, 1.f, 0.f}, // Volume
+    {0.f, 60000.f, 0.f, 0.f}, // VolumeRampMs
+    {0.001f, 4.f, 1.f, 0.f}, // Pitch
+    {0.f, 1.f, 1.f, 1.f}, // Spatialise
+    {0.f, 2.f, 0.f, 1.f}, // AttenuationMode
+    {0.f, 1.f, 1.f, 0.f}, // CustomAttenuation
+    {0.f, FLT_MAX, 1.f, 0.f}, // AttenuationProps_MinDistance
+    {0.f, FLT_MAX, 1000.f, 0.f}, // AttenuationProps_MaxDistance
+    {0.f, 10.f, 1.f, 0.f}, // AttenuationProps_Factor
+    {0.f, 1.f, 0.f, 1.f}, // AttenuationProps_MaxDistanceMute
+    {0.f, 1.f, 0.f, 1.f}, // DirectionalityEnabled
+    {0.f, 1.f, 1.f, 0.f}, // DirectionalProps_EffectLevel
+    {0.f, 359.f, 150.f, 0.f}, // DirectionalProps_ConeArea
+    {-FLT_MAX, FLT_MAX, 0.f, 0.f}, // Position_X
+    {-FLT_MAX, FLT_MAX, 0.f, 0.f}, // Position_Y
+    {-FLT_MAX, FLT_MAX, 0.f, 0.f}, // Position_Z
+    {-1.f, 1.f, 0.f, 0.f}, // Rotation_X
+    {-1.f, 1.f, 0.f, 0.f}, // Rotation_Y
+    {-1.f, 1.f, 0.f, 0.f}, // Rotation_Z
+    {-1.f, 1.f, 1.f, 0.f}, // Rotation_W
+    {0.f, 1.f, 0.5f, 0.f}, // Priority
+};
+static_assert(
+    sizeof(kParamDescriptions) / sizeof(kParamDescriptions[0]) ==
+        static_cast<size_t>(VoiceParam::Num_Params),
+    "A description is needed for every VoiceParam");
+static_assert(
+    static_cast<size_t>(VoiceParam::Num_Params) <= 32,
+    "Queued updates keep a bit per VoiceParam");
+
+/// Handles pack the voice index (plus one, so that 0 is never valid) and a generation count
+const VoiceHandle kIndexBits = 16;
+const VoiceHandle kIndexMask = (VoiceHandle(1) << kIndexBits) - 1;
+
+/// Score a virtual voice must beat a physical one by to take its AudioObject (3 dB), so that voices
+/// of about the same audibility don't keep swapping
+const float kModeChangeHysteresis = 1.41421356f;
+
+/// Fade in of a voice promoted while playing
+const float kPromotionFadeMs = 10.f;
+
+float clampParam(int index, float value) {
+  const VoiceParamDescription& description = kParamDescriptions[index];
+  return std::max(description.min, std::min(description.max, value));
+}
+
+/// @return The param that applies a group of params to an AudioObject, such as Position_X for the
+/// whole position, so that queued updates apply each group once
+VoiceParam getParamGroup(VoiceParam param) {
+  switch (param) {
+    case VoiceParam::CustomAttenuation:
+      return VoiceParam::Volume;
+    case VoiceParam::AttenuationProps_MaxDistance:
+    case VoiceParam::AttenuationProps_Factor:
+    case VoiceParam::AttenuationProps_MaxDistanceMute:
+      return VoiceParam::AttenuationProps_MinDistance;
+    case VoiceParam::DirectionalProps_ConeArea:
+      return VoiceParam::DirectionalProps_EffectLevel;
+    case VoiceParam::Position_Y:
+    case VoiceParam::Position_Z:
+      return VoiceParam::Position_X;
+    case VoiceParam::Rotation_Y:
+    case VoiceParam::Rotation_Z:
+    case VoiceParam::Rotation_W:
+      return VoiceParam::Rotation_X;
+    default:
+      return param;
+  }
+}
+
+float getParamValue(const float* params, VoiceParam param) {
+  return params[static_cast<int>(param)];
+}
+
+bool getParamFlag(const float* params, VoiceParam param) {
+  return getParamValue(params, param) >= 0.5f;
+}
+
+AttenuationMode getAttenuationMode(const float* params) {
+  return static_cast<AttenuationMode>(
+      static_cast<int>(std::round(getParamValue(params, VoiceParam::AttenuationMode))));
+}
+
+AttenuationProps getAttenuationProps(const float* params) {
+  return AttenuationProps(
+      getParamValue(params, VoiceParam::AttenuationProps_MinDistance),
+      getParamValue(params, VoiceParam::AttenuationProps_MaxDistance),
+      getParamValue(params, VoiceParam::AttenuationProps_Factor),
+      getParamFlag(params, VoiceParam::AttenuationProps_MaxDistanceMute));
+}
+
+DirectionalProps getDirectionalProps(const float* params) {
+  return DirectionalProps(
+      getParamValue(params, VoiceParam::DirectionalProps_EffectLevel),
+      getParamValue(params, VoiceParam::DirectionalProps_ConeArea));
+}
+
+TBVector getPosition(const float* params) {
+  return TBVector(
+      getParamValue(params, VoiceParam::Position_X),
+      getParamValue(params, VoiceParam::Position_Y),
+      getParamValue(params, VoiceParam::Position_Z));
+}
+
+/// Components are set one at a time, so the quaternion is only normalised when used
+/// @return False if the rotation is all zeros
+bool getRotation(const float* params, TBQuat& rotation) {
+  const float x = getParamValue(params, VoiceParam::Rotation_X);
+  const float y = getParamValue(params, VoiceParam::Rotation_Y);
+  const float z = getParamValue(params, VoiceParam::Rotation_Z);
+  const float w = getParamValue(params, VoiceParam::Rotation_W);
+  const float norm = std::sqrt(x * x + y * y + z * z + w * w);
+  if (norm <= 0.f) {
+    return false;
+  }
+  rotation = TBQuat(x / norm, y / norm, z / norm, w / norm);
+  return true;
+}
+} // namespace
+
+const size_t VoiceManagerImpl::kMaxModeChangesPerBlock;
+
+
+VoiceManagerImpl::VoiceManagerImpl(
+    AudioEngine& engine,
+    Tracer* tracer,
+    Bus masterBus,
+    const VoiceManagerSettings& settings,
+    size_t audioObjectPoolSize)
+    : engine_(engine),
+      tracer_(tracer),
+      masterBus_(masterBus),
+      maxPhysical_(std::min(
+          kMaxTotalVoices,
+          settings.maxPhysicalVoices > 0 ? settings.maxPhysicalVoices : audioObjectPoolSize)),
+      maxVirtual_(std::min(kMaxTotalVoices - maxPhysical_, settings.maxVirtualVoices)),
+      sampleRate_(engine.getSampleRate()),
+      spatial_(maxPhysical_ + maxVirtual_) {
+  const size_t maxTotal = maxPhysical_ + maxVirtual_;
+  voices_.reset(new Voice[maxTotal]);
+  for (size_t i = 0; i < maxTotal; ++i) {
+    voices_[i].index = i;
+  }
+  slots_.reserve(maxPhysical_);
+  freeSlots_.reserve(maxPhysical_);
+  promotions_.reserve(maxTotal);
+  demotions_.reserve(maxTotal);
+  updated_.reserve(maxTotal);
+  staged_.reserve(kMaxQueuedVoiceParams);
+  // Each voice finishes and changes state at most once per block, plus the mode changes
+  events_.reserve(2 * maxTotal + 3 * kMaxModeChangesPerBlock);
+  time_ = engine.getDSPTime();
+}
+
+VoiceManagerImpl::~VoiceManagerImpl() {
+  for (auto& slot : slots_) {
+    slot->handle.store(InvalidVoiceHandle);
+    engine_.destroyAudioObject(slot->object);
+  }
+}
+
+size_t VoiceManagerImpl::getMaxPhysicalVoices() const {
+  return maxPhysical_;
+}
+
+size_t VoiceManagerImpl::getMaxVirtualVoices() const {
+  return maxVirtual_;
+}
+
+size_t VoiceManagerImpl::getMaxTotalVoices() const {
+  return maxPhysical_ + maxVirtual_;
+}
+
+size_t VoiceManagerImpl::getNumPhysicalVoices() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return numPhysical_;
+}
+
+size_t VoiceManagerImpl::getNumVirtualVoices() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return numVoices_ - numPhysical_;
+}
+
+size_t VoiceManagerImpl::getNumTotalVoices() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return numVoices_;
+}
+
+VoiceHandle VoiceManagerImpl::makeHandle(const Voice& voice) {
+  return (static_cast<VoiceHandle>(voice.generation) << kIndexBits) | (voice.index + 1);
+}
+
+VoiceManagerImpl::Voice* VoiceManagerImpl::findVoice(VoiceHandle voiceHandle) {
+  const VoiceHandle index = voiceHandle & kIndexMask;
+  if (index == 0 || index > maxPhysical_ + maxVirtual_) {
+    return nullptr;
+  }
+  Voice& voice = voices_[index - 1];
+  return voice.inUse && voice.created && makeHandle(voice) == voiceHandle ? &voice : nullptr;
+}
+
+EngineError VoiceManagerImpl::openVoice(VoiceHandle& voiceHandle, AudioAssetHandle assetHandle) {
+  voiceHandle = InvalidVoiceHandle;
+  AudioAssetManager* assets = engine_.getAudioAssetManager();
+  if (!assets) {
+    return EngineError::NOT_INITIALISED;
+  }
+
+  // Reserve a voice and an AudioObject, then open the asset without holding mutex_: the engine may
+  // be dispatching events to callbacks that call back into the voice manager
+  Voice* voice = nullptr;
+  Slot* slot = nullptr;
+  bool createSlot = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < maxPhysical_ + maxVirtual_ && !voice; ++i) {
+      voice = voices_[i].inUse ? nullptr : &voices_[i];
+    }
+    if (!voice) {
+      return EngineError::VOICE_LIMIT_REACHED;
+    }
+    voice->inUse = true;
+    voice->created = false;
+    voice->generation++;
+    voice->asset = assetHandle;
+    for (int param = 0; param < kNumParams; ++param) {
+      voice->params[param] = kParamDescriptions[param].defaultValue;
+    }
+    voice->bus = masterBus_;
+    voice->slot = nullptr;
+    voice->score = 0.f;
+    voice->playState = PlayState::STOPPED;
+    voice->hasPending = false;
+    voice->reschedule = false;
+    voice->position = 0.0;
+    voice->opened.store(false);
+    voice->reportedState.store(PlayState::STOPPED);
+
+    if (!freeSlots_.empty()) {
+      slot = freeSlots_.back();
+      freeSlots_.pop_back();
+    } else if (numSlotsReserved_ < maxPhysical_) {
+      numSlotsReserved_++;
+      createSlot = true;
+    }
+  }
+  const VoiceHandle handle = makeHandle(*voice);
+
+  std::unique_ptr<Slot> newSlot;
+  if (createSlot) {
+    newSlot.reset(new Slot());
+    newSlot->owner = this;
+    if (engine_.createAudioObject(newSlot->object) == EngineError::OK) {
+      newSlot->object->setEventCallback(onObjectEvent, newSlot.get());
+      slot = newSlot.get();
+    } else {
+      newSlot.reset();
+    }
+  }
+
+  EngineError error = EngineError::OK;
+  size_t duration = 0;
+  AudioFormatDecoder* decoder =
+      assets->getNewDecoder(assetHandle, engine_.getBufferSize(), engine_.getSampleRate());
+  if (!decoder) {
+    error = EngineError::NO_ASSET;
+  } else if (slot) {
+    duration = decoder->getNumSamplesPerChannel();
+    slot->handle.store(handle);
+    error = slot->object->open(decoder);
+    if (error != EngineError::OK) {
+      slot->handle.store(InvalidVoiceHandle);
+    }
+  } else {
+    // Virtual voices only need the duration, the asset is opened again when they are promoted
+    duration = decoder->getNumSamplesPerChannel();
+    delete decoder;
+    error = maxVirtual_ > 0 ? EngineError::OK : EngineError::CANNOT_CREATE_VOICE;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (createSlot) {
+      if (newSlot) {
+        slots_.push_back(std::move(newSlot));
+      } else {
+        numSlotsReserved_--;
+      }
+    }
+    if (error != EngineError::OK) {
+      voice->inUse = false;
+      if (slot) {
+        freeSlots_.push_back(slot);
+      }
+      return error;
+    }
+    voice->slot = slot;
+    voice->duration = duration;
+    voice->created = true;
+    numVoices_++;
+    if (slot) {
+      numPhysical_++;
+      // Pooled objects keep the parameters of the voice they rendered last
+      applyParams(*voice);
+    }
+  }
+  voiceHandle = handle;
+  sendEvent(VoiceManagerEvent::VoiceCreated, voiceHandle);
+  if (!slot && !voice->opened.exchange(true)) {
+    sendEvent(VoiceManagerEvent::VoiceOpened, voiceHandle);
+  }
+  return EngineError::PENDING;
+}
+
+EngineError VoiceManagerImpl::closeVoice(VoiceHandle voiceHandle) {
+  Slot* slot = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Voice* voice = findVoice(voiceHandle);
+    if (!voice) {
+      return EngineError::VOICE_NOT_FOUND;
+    }
+    slot = voice->slot;
+    voice->slot = nullptr;
+    voice->inUse = false;
+    voice->created = false;
+    numVoices_--;
+    if (slot) {
+      slot->handle.store(InvalidVoiceHandle);
+      numPhysical_--;
+    }
+  }
+  // Closed outside the lock: the engine may be dispatching events of this voice. The object's
+  // callback stays, it ignores events until the slot is given to another voice.
+  if (slot) {
+    slot->object->close();
+    std::lock_guard<std::mutex> lock(mutex_);
+    freeSlots_.push_back(slot);
+  }
+  sendEvent(VoiceManagerEvent::VoiceDestroyed, voiceHandle);
+  return EngineError::PENDING;
+}
+
+bool VoiceManagerImpl::voiceIsOpen(VoiceHandle voiceHandle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Voice* voice = findVoice(voiceHandle);
+  // The asset of a virtual voice was opened successfully by openVoice()
+  return voice && (!voice->slot || voice->slot->object->isOpen());
+}
+
+EngineError VoiceManagerImpl::play(VoiceHandle voiceHandle, float delayMs, float fadeTimeMs) {
+  return request(voiceHandle, Transport::Command::PLAY, delayMs, fadeTimeMs);
+}
+
+EngineError VoiceManagerImpl::pause(VoiceHandle voiceHandle, float delayMs, float fadeTimeMs) {
+  return request(voiceHandle, Transport::Command::PAUSE, delayMs, fadeTimeMs);
+}
+
+EngineError VoiceManagerImpl::stop(VoiceHandle voiceHandle, float delayMs, float fadeTimeMs) {
+  return request(voiceHandle, Transport::Command::STOP, delayMs, fadeTimeMs);
+}
+
+EngineError VoiceManagerImpl::request(
+    VoiceHandle voiceHandle,
+    Transport::Command command,
+    float delayMs,
+    float fadeTimeMs) {
+  if (delayMs < 0.f || fadeTimeMs < 0.f) {
+    return EngineError::INVALID_PARAM;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  Voice* voice = findVoice(voiceHandle);
+  if (!voice) {
+    return EngineError::VOICE_NOT_FOUND;
+  }
+
+  const int64_t delaySamples = static_cast<int64_t>(delayMs * 0.001 * sampleRate_);
+  const int64_t fadeSamples = static_cast<int64_t>(fadeTimeMs * 0.001 * sampleRate_);
+  if (voice->slot) {
+    AudioObject* object = voice->slot->object;
+    EngineError error = EngineError::OK;
+    switch (command) {
+      case Transport::Command::PLAY:
+        error = object->playScheduled(delayMs, fadeTimeMs);
+        break;
+      case Transport::Command::PAUSE:
+        error = object->pauseScheduled(delayMs, fadeTimeMs);
+        break;
+      case Transport::Command::STOP:
+        error = object->stopScheduled(delayMs, fadeTimeMs);
+        break;
+    }
+    if (error != EngineError::OK) {
+      return error;
+    }
+  } else if (delaySamples == 0) {
+    // Fades are inaudible on a virtual voice
+    applyCommand(*voice, command);
+  }
+
+  // Like a transport, a new command replaces the pending one. Pausing and stopping complete at the
+  // end of their fade.
+  voice->hasPending = delaySamples > 0;
+  voice->reschedule = false;
+  voice->pendingCommand = command;
+  voice->pendingTime = engine_.getDSPTime() + delaySamples +
+      (command == Transport::Command::PLAY ? 0 : fadeSamples);
+  return EngineError::PENDING;
+}
+
+void VoiceManagerImpl::applyCommand(Voice& voice, Transport::Command command) {
+  switch (command) {
+    case Transport::Command::PLAY:
+      voice.playState = PlayState::PLAYING;
+      break;
+    case Transport::Command::PAUSE:
+      // Pausing a stopped voice keeps it stopped
+      if (voice.playState != PlayState::STOPPED) {
+        voice.playState = PlayState::PAUSED;
+      }
+      break;
+    case Transport::Command::STOP:
+      voice.playState = PlayState::STOPPED;
+      voice.position = 0.0;
+      break;
+  }
+}
+
+EngineError VoiceManagerImpl::getPlayState(VoiceHandle voiceHandle, PlayState& playState) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  playState = PlayState::INVALID;
+  const Voice* voice = findVoice(voiceHandle);
+  if (!voice) {
+    return EngineError::VOICE_NOT_FOUND;
+  }
+  playState = voice->slot ? voice->slot->object->getPlayState() : voice->playState;
+  return EngineError::OK;
+}
+
+EngineError VoiceManagerImpl::seekMs(VoiceHandle voiceHandle, float posMs) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Voice* voice = findVoice(voiceHandle);
+  if (!voice) {
+    return EngineError::VOICE_NOT_FOUND;
+  }
+  if (voice->slot) {
+    const EngineError error = voice->slot->object->seekToMs(posMs);
+    return error == EngineError::OK ? EngineError::PENDING : error;
+  }
+  const double position = std::round(posMs * 0.001 * sampleRate_);
+  if (position < 0.0 || position > static_cast<double>(voice->duration)) {
+    return EngineError::FAIL;
+  }
+  voice->position = position;
+  return EngineError::PENDING;
+}
+
+EngineError VoiceManagerImpl::getElapsedTimeMs(VoiceHandle voiceHandle, float& timeMs) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Voice* voice = findVoice(voiceHandle);
+  if (!voice) {
+    return EngineError::VOICE_NOT_FOUND;
+  }
+  timeMs = voice->slot ? static_cast<float>(voice->slot->object->getElapsedTimeInMs())
+                       : static_cast<float>(std::floor(voice->position) * 1000.0 / sampleRate_);
+  return EngineError::OK;
+}
+
+EngineError VoiceManagerImpl::getDurationMs(VoiceHandle voiceHandle, float& timeMs) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Voice* voice = findVoice(voiceHandle);
+  if (!voice) {
+    return EngineError::VOICE_NOT_FOUND;
+  }
+  timeMs = voice->slot
+      ? voice->slot->object->getAssetDurationInMs()
+      : static_cast<float>(static_cast<double>(voice->duration) * 1000.0 / sampleRate_);
+  return EngineError::OK;
+}
+
+EngineError VoiceManagerImpl::setParam(VoiceHandle voiceHandle, VoiceParam param, float value) {
+  const int index = static_cast<int>(param);
+  if (index < 0 || index >= kNumParams || std::isnan(value)) {
+    return EngineError::INVALID_PARAM;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  Voice* voice = findVoice(voiceHandle);
+  if (!voice) {
+    return EngineError::VOICE_NOT_FOUND;
+  }
+  voice->params[index] = clampParam(index, value);
+  applyParam(*voice, param);
+  return EngineError::OK;
+}
+
+void VoiceManagerImpl::applyParam(Voice& voice, VoiceParam param) {
+  if (!voice.slot) {
+    // Virtual voices only keep the value, which is applied when they are promoted
+    return;
+  }
+  AudioObject* object = voice.slot->object;
+  const float* params = voice.params;
+  const float value = getParamValue(params, param);
+  switch (param) {
+    case VoiceParam::Loop:
+      object->enableLooping(value >= 0.5f);
+      break;
+    case VoiceParam::Volume:
+    case VoiceParam::CustomAttenuation:
+      applyVolume(voice, getParamValue(params, VoiceParam::VolumeRampMs));
+      break;
+    case VoiceParam::Pitch:
+      object->setPitch(value);
+      break;
+    case VoiceParam::Spatialise:
+      object->shouldSpatialise(value >= 0.5f);
+      break;
+    case VoiceParam::AttenuationMode:
+      object->setAttenuationMode(getAttenuationMode(params));
+      applyVolume(voice, getParamValue(params, VoiceParam::VolumeRampMs));
+      break;
+    case VoiceParam::AttenuationProps_MinDistance:
+    case VoiceParam::AttenuationProps_MaxDistance:
+    case VoiceParam::AttenuationProps_Factor:
+    case VoiceParam::AttenuationProps_MaxDistanceMute:
+      object->setAttenuationProperties(getAttenuationProps(params));
+      break;
+    case VoiceParam::DirectionalityEnabled:
+      object->setDirectionalityEnabled(value >= 0.5f);
+      break;
+    case VoiceParam::DirectionalProps_EffectLevel:
+    case VoiceParam::DirectionalProps_ConeArea:
+      object->setDirectionalProperties(getDirectionalProps(params));
+      break;
+    case VoiceParam::Position_X:
+    case VoiceParam::Position_Y:
+    case VoiceParam::Position_Z:
+      object->setPosition(getPosition(params));
+      break;
+    case VoiceParam::Rotation_X:
+    case VoiceParam::Rotation_Y:
+    case VoiceParam::Rotation_Z:
+    case VoiceParam::Rotation_W: {
+      TBQuat rotation;
+      if (getRotation(params, rotation)) {
+        object->setRotation(rotation);
+      }
+      break;
+    }
+    default:
+      // VolumeRampMs and Priority only affect later calls
+      break;
+  }
+}
+
+void VoiceManagerImpl::applyVolume(Voice& voice, float rampMs) {
+  // A custom attenuation is applied on top of the volume
+  const float* params = voice.params;
+  const bool custom = getAttenuationMode(params) == AttenuationMode::CUSTOM;
+  const float attenuation = custom ? getParamValue(params, VoiceParam::CustomAttenuation) : 1.f;
+  voice.slot->object->setVolume(getParamValue(params, VoiceParam::Volume) * attenuation, rampMs);
+}
+
+void VoiceManagerImpl::applyParams(Voice& voice) {
+  AudioObject* object = voice.slot->object;
+  const VoiceParam params[] = {
+      VoiceParam::Loop,
+      VoiceParam::Pitch,
+      VoiceParam::Spatialise,
+      VoiceParam::AttenuationProps_MinDistance,
+      VoiceParam::DirectionalityEnabled,
+      VoiceParam::DirectionalProps_EffectLevel,
+      VoiceParam::Position_X,
+      VoiceParam::Rotation_X,
+  };
+  for (const VoiceParam param : params) {
+    applyParam(voice, param);
+  }
+  object->setAttenuationMode(getAttenuationMode(voice.params));
+  applyVolume(voice, 0.f);
+  if (engine_.connect(object, voice.bus) != EngineError::OK) {
+    // The bus was destroyed while the voice was virtual
+    engine_.disconnectOutput(object);
+  }
+}
+
+EngineError VoiceManagerImpl::getParam(VoiceHandle voiceHandle, VoiceParam param, float& value) {
+  const int index = static_cast<int>(param);
+  if (index < 0 || index >= kNumParams) {
+    return EngineError::INVALID_PARAM;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Voice* voice = findVoice(voiceHandle);
+  if (!voice) {
+    return EngineError::VOICE_NOT_FOUND;
+  }
+  value = voice->params[index];
+  return EngineError::OK;
+}
+
+EngineError VoiceManagerImpl::getParamDescription(
+    VoiceParam param,
+    VoiceParamDescription& description) {
+  const int index = static_cast<int>(param);
+  if (index < 0 || index >= kNumParams) {
+    return EngineError::INVALID_PARAM;
+  }
+  description = kParamDescriptions[index];
+  return EngineError::OK;
+}
+
+EngineError VoiceManagerImpl::setParams(
+    const VoiceHandle* voiceHandles,
+    const VoiceParam* params,
+    const float* values,
+    size_t count) {
+  if (count == 0) {
+    return EngineError::OK;
+  }
+  if (!voiceHandles || !params || !values) {
+    return EngineError::INVALID_PARAM;
+  }
+  if (count > kMaxQueuedVoiceParams) {
+    return EngineError::QUEUE_FULL;
+  }
+  std::lock_guard<std::mutex> lock(queueMutex_);
+  staged_.clear();
+  for (size_t i = 0; i < count; ++i) {
+    const int index = static_cast<int>(params[i]);
+    if (index < 0 || index >= kNumParams || std::isnan(values[i])) {
+      return EngineError::INVALID_PARAM;
+    }
+    staged_.push_back({voiceHandles[i], index, clampParam(index, values[i])});
+  }
+  return queueStaged();
+}
+
+EngineError VoiceManagerImpl::setTransforms(
+    const VoiceHandle* voiceHandles,
+    const TBVector* positions,
+    const TBQuat* rotations,
+    size_t count) {
+  if (count == 0) {
+    return EngineError::OK;
+  }
+  if (!voiceHandles || !positions) {
+    return EngineError::INVALID_PARAM;
+  }
+  const size_t paramsPerVoice = rotations ? 7 : 3;
+  if (count > kMaxQueuedVoiceParams / paramsPerVoice) {
+    return EngineError::QUEUE_FULL;
+  }
+  std::lock_guard<std::mutex> lock(queueMutex_);
+  staged_.clear();
+  const auto stage = [this](VoiceHandle voice, VoiceParam param, float value) {
+    const int index = static_cast<int>(param);
+    staged_.push_back({voice, index, clampParam(index, value)});
+  };
+  for (size_t i = 0; i < count; ++i) {
+    const VoiceHandle voice = voiceHandles[i];
+    const TBVector& position = positions[i];
+    if (std::isnan(position.x) || std::isnan(position.y) || std::isnan(position.z)) {
+      return EngineError::INVALID_PARAM;
+    }
+    stage(voice, VoiceParam::Position_X, position.x);
+    stage(voice, VoiceParam::Position_Y, position.y);
+    stage(voice, VoiceParam::Position_Z, position.z);
+    if (!rotations) {
+      continue;
+    }
+    const TBQuat& rotation = rotations[i];
+    if (std::isnan(rotation.x) || std::isnan(rotation.y) || std::isnan(rotation.z) ||
+        std::isnan(rotation.w)) {
+      return EngineError::INVALID_PARAM;
+    }
+    stage(voice, VoiceParam::Rotation_X, rotation.x);
+    stage(voice, VoiceParam::Rotation_Y, rotation.y);
+    stage(voice, VoiceParam::Rotation_Z, rotation.z);
+    stage(voice, VoiceParam::Rotation_W, rotation.w);
+  }
+  return queueStaged();
+}
+
+EngineError VoiceManagerImpl::queueStaged() {
+  // The audio thread sees every update of the batch or none of them
+  return queuedParams_.push(staged_.data(), staged_.size()) ? EngineError::PENDING
+                                                            : EngineError::QUEUE_FULL;
+}
+
+void VoiceManagerImpl::applyQueuedParams() {
+  if (queuedParams_.empty()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return;
+  }
+  // Store every value first, then apply each group of params once per voice
+  ParamUpdate update;
+  while (queuedParams_.pop(update)) {
+    Voice* voice = findVoice(update.voice);
+    if (!voice) {
+      continue;
+    }
+    if (voice->updatedParams == 0) {
+      updated_.push_back(voice);
+    }
+    voice->params[update.param] = update.value;
+    const VoiceParam group = getParamGroup(static_cast<VoiceParam>(update.param));
+    voice->updatedParams |= 1u << static_cast<int>(group);
+  }
+  for (Voice* voice : updated_) {
+    for (int index = 0; index < kNumParams; ++index) {
+      if (voice->updatedParams & (1u << index)) {
+        applyParam(*voice, static_cast<VoiceParam>(index));
+      }
+    }
+    voice->updatedParams = 0;
+  }
+  updated_.clear();
+}
+
+EngineError VoiceManagerImpl::setBus(VoiceHandle voiceHandle, Bus bus) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Voice* voice = findVoice(voiceHandle);
+  if (!voice) {
+    return EngineError::VOICE_NOT_FOUND;
+  }
+  if (voice->slot) {
+    const EngineError error = engine_.connect(voice->slot->object, bus);
+    if (error != EngineError::OK) {
+      return error;
+    }
+  }
+  voice->bus = bus;
+  return EngineError::PENDING;
+}
+
+EngineError VoiceManagerImpl::getBus(VoiceHandle voiceHandle, Bus& bus) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Voice* voice = findVoice(voiceHandle);
+  if (!voice) {
+    return EngineError::VOICE_NOT_FOUND;
+  }
+  bus = voice->slot ? voice->slot->object->getOutputBus() : voice->bus;
+  return EngineError::OK;
+}
+
+EngineError VoiceManagerImpl::getVoiceMode(VoiceHandle voiceHandle, VoiceMode& mode) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  mode = VoiceMode::Invalid;
+  const Voice* voice = findVoice(voiceHandle);
+  if (!voice) {
+    return EngineError::VOICE_NOT_FOUND;
+  }
+  mode = voice->slot ? VoiceMode::Physical : VoiceMode::Virtual;
+  return EngineError::OK;
+}
+
+EngineError VoiceManagerImpl::setEventCallback(VoiceManagerEventCb callback, void* userData) {
+  std::lock_guard<std::mutex> lock(callbackMutex_);
+  callback_ = callback;
+  callbackUserData_ = userData;
+  return EngineError::OK;
+}
+
+void VoiceManagerImpl::process(const RenderContext& context) {
+  std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return;
+  }
+  const int64_t end = context.dspTime + context.numFrames;
+  spatial_.clear();
+  for (size_t i = 0; i < maxPhysical_ + maxVirtual_; ++i) {
+    Voice& voice = voices_[i];
+    if (!voice.inUse || !voice.created) {
+      continue;
+    }
+    if (voice.slot) {
+      // The object applies the pending command itself, unless it has yet to be given it
+      if (voice.hasPending && !voice.reschedule && voice.pendingTime < end) {
+        voice.hasPending = false;
+      }
+    } else {
+      advance(voice, time_, end);
+      if (voice.reportedState.exchange(voice.playState) != voice.playState) {
+        events_.emplace_back(VoiceManagerEvent::VoicePlayStateChanged, makeHandle(voice));
+      }
+    }
+    addSpatialState(voice);
+  }
+  time_ = end;
+
+  spatial_.compute(context.listenerRotation, context.listenerPosition, context.listenerScale);
+  for (size_t i = 0; i < maxPhysical_ + maxVirtual_; ++i) {
+    Voice& voice = voices_[i];
+    if (voice.inUse && voice.created) {
+      voice.score = computeScore(voice, context);
+    }
+  }
+}
+
+void VoiceManagerImpl::addSpatialState(Voice& voice) {
+  const float* params = voice.params;
+  voice.spatialIndex = kNotSpatialised;
+  if (!getParamFlag(params, VoiceParam::Spatialise)) {
+    return;
+  }
+  TBQuat rotation;
+  const bool directivity =
+      getParamFlag(params, VoiceParam::DirectionalityEnabled) && getRotation(params, rotation);
+  voice.spatialIndex = spatial_.add(
+      getPosition(params),
+      rotation,
+      getAttenuationMode(params),
+      getAttenuationProps(params),
+      directivity,
+      getDirectionalProps(params));
+}
+
+void VoiceManagerImpl::advance(Voice& voice, int64_t from, int64_t to) {
+  if (voice.hasPending && voice.pendingTime < to) {
+    const int64_t time = std::max(from, voice.pendingTime);
+    advancePlayhead(voice, time - from);
+    applyCommand(voice, voice.pendingCommand);
+    voice.hasPending = false;
+    from = time;
+  }
+  advancePlayhead(voice, to - from);
+}
+
+void VoiceManagerImpl::advancePlayhead(Voice& voice, int64_t numFrames) {
+  if (voice.playState != PlayState::PLAYING || numFrames <= 0) {
+    return;
+  }
+  voice.position +=
+      static_cast<double>(numFrames) * getParamValue(voice.params, VoiceParam::Pitch);
+  const double duration = static_cast<double>(voice.duration);
+  if (voice.position < duration) {
+    return;
+  }
+  if (getParamFlag(voice.params, VoiceParam::Loop) && duration > 0.0) {
+    voice.position = std::fmod(voice.position, duration);
+    return;
+  }
+  voice.playState = PlayState::STOPPED;
+  voice.position = 0.0;
+  events_.emplace_back(VoiceManagerEvent::VoiceFinishedPlaying, makeHandle(voice));
+}
+
+float VoiceManagerImpl::computeScore(const Voice& voice, const RenderContext& context) const {
+  const float* params = voice.params;
+  float score = getParamValue(params, VoiceParam::Priority) *
+      getParamValue(params, VoiceParam::Volume);
+  const AttenuationMode mode = getAttenuationMode(params);
+  if (mode == AttenuationMode::CUSTOM) {
+    score *= getParamValue(params, VoiceParam::CustomAttenuation);
+  }
+
+  if (voice.spatialIndex != kNotSpatialised) {
+    // The same gains as AudioObjectImpl::render(), without the filtering
+    const ObjectSpatialStore::Result result = spatial_.getResult(voice.spatialIndex);
+    score *= result.attenuation;
+    if (result.outsideCone) {
+      score *= ObjectSpatialStore::getDirectivityGain(result.directivity);
+    }
+  }
+
+  // A destroyed bus leaves the voice silent, as it does an object
+  float busStart = 0.f;
+  float busEnd = 0.f;
+  if (context.buses && context.buses->contains(voice.bus)) {
+    context.buses->getOutputGain(voice.bus, busStart, busEnd);
+  }
+  return score * busEnd;
+}
+
+bool VoiceManagerImpl::wantsObject(const Voice& voice) {
+  const PlayState state = voice.slot ? voice.slot->object->getPlayState() : voice.playState;
+  return state == PlayState::PLAYING ||
+      (voice.hasPending && voice.pendingCommand == Transport::Command::PLAY);
+}
+
+void VoiceManagerImpl::updateModes() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (lock.owns_lock()) {
+      selectPhysicalVoices();
+    }
+  }
+  // Sent without holding mutex_, callbacks may call back into the voice manager
+  for (const auto& event : events_) {
+    sendEvent(event.first, event.second);
+  }
+  events_.clear();
+}
+
+void VoiceManagerImpl::selectPhysicalVoices() {
+  promotions_.clear();
+  demotions_.clear();
+  for (size_t i = 0; i < maxPhysical_ + maxVirtual_; ++i) {
+    Voice& voice = voices_[i];
+    if (!voice.inUse || !voice.created) {
+      continue;
+    }
+    if (voice.slot) {
+      if (voice.reschedule) {
+        schedulePending(voice, time_);
+      }
+      demotions_.push_back(&voice);
+    } else if (wantsObject(voice)) {
+      promotions_.push_back(&voice);
+    }
+  }
+  if (promotions_.empty()) {
+    return;
+  }
+
+  // The object of a stopped or paused voice goes first, then the least audible
+  const auto rank = [](const Voice* voice) {
+    return wantsObject(*voice) ? voice->score * kModeChangeHysteresis : -1.f;
+  };
+  const size_t numPromotions = std::min(promotions_.size(), kMaxModeChangesPerBlock);
+  std::partial_sort(
+      promotions_.begin(),
+      promotions_.begin() + static_cast<std::ptrdiff_t>(numPromotions),
+      promotions_.end(),
+      [](const Voice* a, const Voice* b) { return a->score > b->score; });
+  const size_t numDemotions = std::min(demotions_.size(), numPromotions);
+  std::partial_sort(
+      demotions_.begin(),
+      demotions_.begin() + static_cast<std::ptrdiff_t>(numDemotions),
+      demotions_.end(),
+      [&rank](const Voice* a, const Voice* b) { return rank(a) < rank(b); });
+
+  size_t demoted = 0;
+  for (size_t i = 0; i < numPromotions; ++i) {
+    Voice& voice = *promotions_[i];
+    Slot* slot = nullptr;
+    if (!freeSlots_.empty()) {
+      slot = freeSlots_.back();
+      freeSlots_.pop_back();
+    } else if (demoted < numDemotions && rank(demotions_[demoted]) < voice.score) {
+      Voice& victim = *demotions_[demoted++];
+      slot = victim.slot;
+      demote(victim);
+    } else {
+      // Both lists are sorted, so no later voice can take an object either
+      break;
+    }
+    promote(voice, *slot);
+  }
+}
+
+void VoiceManagerImpl::promote(Voice& voice, Slot& slot) {
+  const VoiceHandle handle = makeHandle(voice);
+  AudioAssetManager* assets = engine_.getAudioAssetManager();
+  AudioFormatDecoder* decoder = assets
+      ? assets->getNewDecoder(voice.asset, engine_.getBufferSize(), engine_.getSampleRate())
+      : nullptr;
+  if (!decoder || slot.object->open(decoder) != EngineError::OK) {
+    // Stop the voice rather than try again every block
+    freeSlots_.push_back(&slot);
+    voice.playState = PlayState::STOPPED;
+    voice.hasPending = false;
+    voice.position = 0.0;
+    events_.emplace_back(VoiceManagerEvent::VoiceError, handle);
+    return;
+  }
+
+  slot.handle.store(handle);
+  voice.slot = &slot;
+  numPhysical_++;
+  applyParams(voice);
+  AudioObject* object = slot.object;
+  object->seekToSample(std::min(static_cast<size_t>(voice.position), voice.duration));
+  if (voice.playState == PlayState::PLAYING) {
+    object->playWithFade(kPromotionFadeMs);
+  }
+  // A transport only keeps one command, so a pending command waits until the play is applied
+  voice.reschedule = voice.hasPending;
+  events_.emplace_back(VoiceManagerEvent::VoiceModeChanged, handle);
+}
+
+void VoiceManagerImpl::demote(Voice& voice) {
+  Slot& slot = *voice.slot;
+  AudioObject* object = slot.object;
+  slot.handle.store(InvalidVoiceHandle);
+  voice.playState = object->getPlayState();
+  voice.position = voice.playState == PlayState::STOPPED
+      ? 0.0
+      : static_cast<double>(object->getElapsedTimeInSamples());
+  voice.reschedule = false;
+  object->close();
+  voice.slot = nullptr;
+  numPhysical_--;
+  events_.emplace_back(VoiceManagerEvent::VoiceModeChanged, makeHandle(voice));
+}
+
+void VoiceManagerImpl::schedulePending(Voice& voice, int64_t now) {
+  voice.reschedule = false;
+  if (!voice.hasPending) {
+    return;
+  }
+  AudioObject* object = voice.slot->object;
+  const float delayMs = static_cast<float>(
+      static_cast<double>(std::max<int64_t>(0, voice.pendingTime - now)) * 1000.0 / sampleRate_);
+  switch (voice.pendingCommand) {
+    case Transport::Command::PLAY:
+      object->playScheduled(delayMs);
+      break;
+    case Transport::Command::PAUSE:
+      object->pauseScheduled(delayMs);
+      break;
+    case Transport::Command::STOP:
+      object->stopScheduled(delayMs);
+      break;
+  }
+}
+
+void VoiceManagerImpl::sendEvent(VoiceManagerEvent event, VoiceHandle voiceHandle) {
+  if (event == VoiceManagerEvent::VoiceModeChanged) {
+    traceInstant(tracer_, "voiceModeChanged", "voice", static_cast<int64_t>(voiceHandle));
+  }
+  VoiceManagerEventCb callback = nullptr;
+  void* userData = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    callback = callback_;
+    userData = callbackUserData_;
+  }
+  // Called without the lock, so that callbacks can open and close voices
+  if (callback) {
+    callback(event, voiceHandle, userData);
+  }
+}
+
+void VoiceManagerImpl::onObjectEvent(Event event, void* userData) {
+  auto* slot = static_cast<Slot*>(userData);
+  VoiceManagerImpl* self = slot->owner;
+  const VoiceHandle handle = slot->handle.load();
+  if (handle == InvalidVoiceHandle) {
+    return;
+  }
+  Voice& voice = self->voices_[(handle & kIndexMask) - 1];
+
+  switch (event) {
+    case Event::DECODER_INIT:
+      // Objects of promoted voices open the asset again
+      if (!voice.opened.exchange(true)) {
+        self->sendEvent(VoiceManagerEvent::VoiceOpened, handle);
+      }
+      break;
+    case Event::PLAY_STATE_CHANGED: {
+      // Promotions restart the object in the state the voice was already in
+      const PlayState state = slot->object->getPlayState();
+      if (voice.reportedState.exchange(state) != state) {
+        self->sendEvent(VoiceManagerEvent::VoicePlayStateChanged, handle);
+      }
+      break;
+    }
+    case Event::END_OF_STREAM:
+      self->sendEvent(VoiceManagerEvent::VoiceFinishedPlaying, handle);
+      break;
+    case Event::ERROR_DECODER_FAIL:
+      self->sendEvent(VoiceManagerEvent::VoiceError, handle);
+      break;
+    default:
+      break;
+  }
+}
+} // namespace TBE
@@ -0,0 +1,234 @@
+#ifndef FBA_VOICEMANAGERIMPL_H
+#define FBA_VOICEMANAGERIMPL_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "ObjectSpatialStore.h"
+#include "RenderContext.h"
+#include "TBE_AudioObject.h"
+#include "TBE_VoiceManager.h"
+#include "Transport.h"
+#include "utils/SpscQueue.h"
+
+namespace TBE {
+class Tracer;
+
+/// Voice manager built on the engine's public API: voices are opened from AudioAssetManager assets
+/// and handles carry a generation count so that stale handles are rejected.
+///
+/// Physical voices are rendered by an AudioObject from a pool of up to getMaxPhysicalVoices(),
+/// created as voices are opened. Virtual voices keep their parameters and play state, and their
+/// playhead follows the engine's clock without decoding anything. Every block the audio thread
+/// scores each voice by how audible it is likely to be (priority, volume, distance attenuation,
+/// directivity and bus gain) and moves the AudioObjects of the least audible physical voices to
+/// the most audible virtual ones. A promoted voice opens a new decoder and seeks to its playhead,
+/// so it resumes where it would have been had it been rendered all along.
+class VoiceManagerImpl : public VoiceManager {
+ public:
+  /// Most voices promoted in a block, which bounds the decoders opened by the audio thread
+  static const size_t kMaxModeChangesPerBlock = 8;
+
+  /// @param engine Engine that owns this voice manager
+  /// @param tracer Records voice mode changes, or nullptr
+  /// @param masterBus Bus voices are routed to when opened
+  /// @param settings Voice limits. A maximum of 0 physical voices means one per pooled AudioObject.
+  /// @param audioObjectPoolSize Number of AudioObjects available to the engine
+  VoiceManagerImpl(
+      AudioEngine& engine,
+      Tracer* tracer,
+      Bus masterBus,
+      const VoiceManagerSettings& settings,
+      size_t audioObjectPoolSize);
+  ~VoiceManagerImpl() override;
+
+  size_t getMaxPhysicalVoices() const override;
+  size_t getMaxVirtualVoices() const override;
+  size_t getMaxTotalVoices() const override;
+  size_t getNumPhysicalVoices() const override;
+  size_t getNumVirtualVoices() const override;
+  size_t getNumTotalVoices() const override;
+
+  EngineError openVoice(VoiceHandle& voiceHandle, AudioAssetHandle assetHandle) override;
+  EngineError closeVoice(VoiceHandle voiceHandle) override;
+  bool voiceIsOpen(VoiceHandle voiceHandle) override;
+
+  EngineError play(VoiceHandle voiceHandle, float delayMs, float fadeTimeMs) override;
+  EngineError pause(VoiceHandle voiceHandle, float delayMs, float fadeTimeMs) override;
+  EngineError stop(VoiceHandle voiceHandle, float delayMs, float fadeTimeMs) override;
+  EngineError getPlayState(VoiceHandle voiceHandle, PlayState& playState) override;
+  EngineError seekMs(VoiceHandle voiceHandle, float posMs) override;
+  EngineError getElapsedTimeMs(VoiceHandle voiceHandle, float& timeMs) override;
+  EngineError getDurationMs(VoiceHandle voiceHandle, float& timeMs) override;
+
+  EngineError setParam(VoiceHandle voiceHandle, VoiceParam param, float value) override;
+  EngineError getParam(VoiceHandle voiceHandle, VoiceParam param, float& value) override;
+  EngineError getParamDescription(VoiceParam param, VoiceParamDescription& description) override;
+  EngineError setParams(
+      const VoiceHandle* voiceHandles,
+      const VoiceParam* params,
+      const float* values,
+      size_t count) override;
+  EngineError setTransforms(
+      const VoiceHandle* voiceHandles,
+      const TBVector* positions,
+      const TBQuat* rotations,
+      size_t count) override;
+
+  EngineError setBus(VoiceHandle voiceHandle, Bus bus) override;
+  EngineError getBus(VoiceHandle voiceHandle, Bus& bus) override;
+
+  EngineError getVoiceMode(VoiceHandle voiceHandle, VoiceMode& mode) override;
+
+  EngineError setEventCallback(VoiceManagerEventCb callback, void* userData) override;
+
+  /// Audio thread, before a block is rendered: apply the updates queued by setParams() and
+  /// setTransforms(). Skipped while a control thread holds the voice manager, in which case they
+  /// are applied before the next block.
+  void applyQueuedParams();
+
+  /// Audio thread, with the graph mutex held: advance virtual voices to the end of a block and
+  /// score every voice. Skipped while a control thread holds the voice manager, in which case the
+  /// next block catches up.
+  void process(const RenderContext& context);
+
+  /// Audio thread, once the events of the block are dispatched: swap virtual and physical voices,
+  /// then send the events of virtual voices and of mode changes
+  void updateModes();
+
+ private:
+  static const int kNumParams = static_cast<int>(VoiceParam::Num_Params);
+  static const size_t kNotSpatialised = SIZE_MAX;
+
+  /// A queued setParams() update. Values are clamped before they are queued.
+  struct ParamUpdate {
+    VoiceHandle voice;
+    int param;
+    float value;
+  };
+
+  /// A pooled AudioObject. Its event callback gets the slot, which knows the voice it renders.
+  struct Slot {
+    VoiceManagerImpl* owner{nullptr};
+    AudioObject* object{nullptr};
+    std::atomic<VoiceHandle> handle{InvalidVoiceHandle}; // Read by object callbacks
+  };
+
+  struct Voice {
+    size_t index{0};
+    uint32_t generation{0};
+    bool inUse{false};
+    bool created{false}; // False while openVoice() opens the asset
+    AudioAssetHandle asset;
+    float params[kNumParams];
+    Bus bus{nullptr};
+    Slot* slot{nullptr}; // nullptr while virtual
+    float score{0.f};
+    size_t spatialIndex{kNotSpatialised}; // In spatial_, while process() scores the voice
+    uint32_t updatedParams{0}; // Bits of the params applyQueuedParams() has yet to apply
+
+    // Transport of a virtual voice. The object of a physical voice has its own, but the pending
+    // command is kept here too in case the voice is virtualised before it applies.
+    PlayState playState{PlayState::STOPPED};
+    bool hasPending{false};
+    bool reschedule{false}; // The pending command still has to be given to a new object
+    Transport::Command pendingCommand{Transport::Command::STOP};
+    int64_t pendingTime{0}; // DSP time at which the pending command applies
+    double position{0.0}; // Frames
+    size_t duration{0}; // Frames
+
+    std::atomic<bool> opened{false}; // VoiceOpened was sent
+    std::atomic<PlayState> reportedState{PlayState::STOPPED}; // As last sent to the callback
+  };
+
+  static void onObjectEvent(Event event, void* userData);
+  static VoiceHandle makeHandle(const Voice& voice);
+
+  /// @return The voice for a handle or nullptr if the handle is stale. Must hold mutex_.
+  Voice* findVoice(VoiceHandle voiceHandle);
+
+  EngineError
+  request(VoiceHandle voiceHandle, Transport::Command command, float delayMs, float fadeTimeMs);
+
+  /// Apply a play command to a virtual voice. Must hold mutex_.
+  static void applyCommand(Voice& voice, Transport::Command command);
+
+  /// Audio thread: advance a virtual voice from one DSP time to another. Must hold mutex_.
+  void advance(Voice& voice, int64_t from, int64_t to);
+  void advancePlayhead(Voice& voice, int64_t numFrames);
+
+  /// Audio thread: add a spatialised voice to spatial_. Must hold mutex_.
+  void addSpatialState(Voice& voice);
+
+  /// Audio thread: estimate how loud a voice is at the listener, once spatial_ is computed. Must
+  /// hold mutex_.
+  float computeScore(const Voice& voice, const RenderContext& context) const;
+
+  /// @return True if a voice is playing or about to
+  static bool wantsObject(const Voice& voice);
+
+  /// Audio thread: swap voices. Must hold mutex_.
+  void selectPhysicalVoices();
+  void promote(Voice& voice, Slot& slot);
+  void demote(Voice& voice);
+
+  /// Apply a parameter to the voice's object, if it has one. Must hold mutex_.
+  void applyParam(Voice& voice, VoiceParam param);
+  void applyVolume(Voice& voice, float rampMs);
+
+  /// Apply every parameter and the bus to the object a voice has just been given. Must hold
+  /// mutex_.
+  void applyParams(Voice& voice);
+
+  /// Give the pending command of a voice to its object. Must hold mutex_.
+  void schedulePending(Voice& voice, int64_t now);
+
+  /// Queue staged_ for the audio thread. Must hold queueMutex_.
+  EngineError queueStaged();
+
+  void sendEvent(VoiceManagerEvent event, VoiceHandle voiceHandle);
+
+  AudioEngine& engine_;
+  Tracer* const tracer_;
+  const Bus masterBus_;
+  const size_t maxPhysical_;
+  const size_t maxVirtual_;
+  const float sampleRate_;
+
+  mutable std::mutex mutex_;
+  std::unique_ptr<Voice[]> voices_; // maxPhysical_ + maxVirtual_
+  size_t numVoices_{0};
+  size_t numPhysical_{0};
+  std::vector<std::unique_ptr<Slot>> slots_;
+  std::vector<Slot*> freeSlots_;
+  size_t numSlotsReserved_{0}; // Slots created or being created by openVoice()
+  int64_t time_{0}; // DSP time virtual voices have advanced to
+
+  // Audio thread
+  std::vector<Voice*> promotions_;
+  std::vector<Voice*> demotions_;
+  ObjectSpatialStore spatial_; // Voices scored by process()
+  std::vector<std::pair<VoiceManagerEvent, VoiceHandle>> events_; // Sent by updateModes()
+  std::vector<Voice*> updated_; // Voices with queued updates to apply
+
+  // Batched updates, staged by one control thread at a time and pushed in one go
+  std::mutex queueMutex_;
+  std::vector<ParamUpdate> staged_;
+  SpscQueue<ParamUpdate, kMaxQueuedVoiceParams> queuedParams_;
+
+  std::mutex callbackMutex_;
+  VoiceManagerEventCb callback_{nullptr};
+  void* callbackUserData_{nullptr};
+};
+} // namespace TBE
+
+#endif // FBA_VOICEMANAGERIMPL_H
@@ -0,0 +1,40 @@
+#ifndef FBA_ASSETBYTES_H
+#define FBA_ASSETBYTES_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace TBE {
+/// Bytes of an asset held in memory by the AudioAssetManager and shared with the streams created
+/// from it
+class AssetBytes {
+ public:
+  virtual ~AssetBytes() = default;
+  virtual const char* data() const = 0;
+  virtual size_t size() const = 0;
+};
+
+/// Asset bytes owned by this process
+class VectorAssetBytes : public AssetBytes {
+ public:
+  explicit VectorAssetBytes(std::vector<char>&& bytes) : bytes_(std::move(bytes)) {}
+
+  const char* data() const override {
+    return bytes_.data();
+  }
+  size_t size() const override {
+    return bytes_.size();
+  }
+
+ private:
+  const std::vector<char> bytes_;
+};
+} // namespace TBE
+
+#endif // FBA_ASSETBYTES_H
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "AsyncFileStream.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__linux__)
+#define FBA_HAS_ASYNC_FILE_STREAM 1
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace TBE {
+#if FBA_HAS_ASYNC_FILE_STREAM
+const size_t AsyncFileStream::kBlockSize;
+const size_t AsyncFileStream::kNumBlocks;
+
+AsyncFileStream::AsyncFileStream(const char* file, AssetDescriptor ad)
+    : queue_(IoUringQueue::getShared()), offset_(ad.offsetInBytes) {
+  if (!file || !queue_) {
+    return;
+  }
+
+  fd_ = ::open(file, O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    return;
+  }
+
+  struct stat info;
+  if (fstat(fd_, &info) != 0 || info.st_size < 0 ||
+      offset_ > static_cast<size_t>(info.st_size)) {
+    ::close(fd_);
+    fd_ = -1;
+    return;
+  }
+
+  const size_t available = static_cast<size_t>(info.st_size) - offset_;
+  length_ = (ad.lengthInBytes > 0) ? std::min(ad.lengthInBytes, available) : available;
+  buffer_.resize(kNumBlocks * kBlockSize);
+  posix_fadvise(
+      fd_, static_cast<off_t>(offset_), static_cast<off_t>(length_), POSIX_FADV_SEQUENTIAL);
+  // Start reading ahead straight away, the header is usually parsed right after opening
+  fillWindow();
+}
+
+AsyncFileStream::~AsyncFileStream() {
+  // The kernel may still be writing into buffer_
+  for (Slot& slot : slots_) {
+    if (queue_) {
+      queue_->wait(slot.request);
+    }
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+void AsyncFileStream::fillWindow() {
+  const size_t current = position_ / kBlockSize;
+  for (size_t block = current; block < current + kNumBlocks && block * kBlockSize < length_;
+       ++block) {
+    Slot& slot = slots_[block % kNumBlocks];
+    if (slot.block == block) {
+      continue;
+    }
+
+    // Reached after a seek, before the slot's previous read completed
+    queue_->wait(slot.request);
+    slot.block = block;
+    slot.size = std::min(kBlockSize, length_ - block * kBlockSize);
+    slot.loaded = false;
+    char* data = &buffer_[(block % kNumBlocks) * kBlockSize];
+    if (!queue_->submitRead(fd_, data, slot.size, offset_ + block * kBlockSize, slot.request)) {
+      // Read synchronously when the block is needed
+      slot.request.result = -EAGAIN;
+    }
+  }
+}
+
+AsyncFileStream::Slot& AsyncFileStream::getCurrentSlot() {
+  fillWindow();
+  Slot& slot = slots_[(position_ / kBlockSize) % kNumBlocks];
+  if (slot.loaded) {
+    return slot;
+  }
+
+  queue_->wait(slot.request);
+  const int result = slot.request.result;
+  if (result < 0 || static_cast<size_t>(result) < slot.size) {
+    // Failed or short read, e.g. at the end of a file that shrank
+    char* data = &buffer_[(slot.block % kNumBlocks) * kBlockSize];
+    size_t numRead = (result > 0) ? static_cast<size_t>(result) : 0;
+    while (numRead < slot.size) {
+      const ssize_t n = pread(
+          fd_,
+          data + numRead,
+          slot.size - numRead,
+          static_cast<off_t>(offset_ + slot.block * kBlockSize + numRead));
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        break;
+      }
+      numRead += static_cast<size_t>(n);
+    }
+    slot.size = numRead;
+  }
+  slot.loaded = true;
+  return slot;
+}
+
+size_t AsyncFileStream::read(void* data, size_t numBytes) {
+  if (fd_ < 0 || !data) {
+    return IOSTREAM_OPERATION_FAIL;
+  }
+
+  char* out = static_cast<char*>(data);
+  size_t numRead = 0;
+  while (numRead < numBytes && position_ < length_) {
+    Slot& slot = getCurrentSlot();
+    const size_t inBlock = position_ - slot.block * kBlockSize;
+    if (inBlock >= slot.size) {
+      // The file is shorter than when it was opened
+      break;
+    }
+    const size_t n = std::min(numBytes - numRead, slot.size - inBlock);
+    std::memcpy(out + numRead, &buffer_[(slot.block % kNumBlocks) * kBlockSize + inBlock], n);
+    numRead += n;
+    position_ += n;
+  }
+  endOfStream_ = numRead < numBytes;
+  return numRead;
+}
+
+size_t AsyncFileStream::write(void*, size_t) {
+  return 0;
+}
+
+size_t AsyncFileStream::getPosition() {
+  return fd_ >= 0 ? position_ : IOSTREAM_OPERATION_FAIL;
+}
+
+bool AsyncFileStream::setPosition(int64_t pos) {
+  return setPosition(pos, SEEK_SET);
+}
+
+bool AsyncFileStream::setPosition(int64_t pos, int mode) {
+  int64_t target = pos;
+  if (mode == SEEK_CUR) {
+    target = static_cast<int64_t>(position_) + pos;
+  } else if (mode == SEEK_END) {
+    target = static_cast<int64_t>(length_) + pos;
+  }
+
+  if (fd_ < 0 || target < 0 || target > static_cast<int64_t>(length_)) {
+    return false;
+  }
+
+  // The window follows on the next read, blocks still in it are kept
+  position_ = static_cast<size_t>(target);
+  endOfStream_ = false;
+  return true;
+}
+
+int32_t AsyncFileStream::pushBackByte(int c) {
+  if (fd_ < 0 || position_ == 0 || c == EOF) {
+    return EOF;
+  }
+  position_--;
+  endOfStream_ = false;
+  return c;
+}
+
+size_t AsyncFileStream::getSize() {
+  return fd_ >= 0 ? length_ : IOSTREAM_OPERATION_FAIL;
+}
+
+bool AsyncFileStream::canSeek() {
+  return fd_ >= 0;
+}
+
+bool AsyncFileStream::ready() const {
+  return fd_ >= 0;
+}
+
+bool AsyncFileStream::endOfStream() {
+  return fd_ < 0 || endOfStream_ || position_ >= length_;
+}
+
+int AsyncFileStream::getFD() {
+  return fd_;
+}
+
+IOStream* IOStream::createAsyncFileStream(const char* file, AssetDescriptor ad) {
+  auto stream = new AsyncFileStream(file, ad);
+  if (!stream->ready()) {
+    delete stream;
+    return nullptr;
+  }
+  return stream;
+}
+#else
+IOStream* IOStream::createAsyncFileStream(const char*, AssetDescriptor) {
+  return nullptr;
+}
+#endif
+} // namespace TBE
@@ -0,0 +1,67 @@
+#ifndef FBA_ASYNCFILESTREAM_H
+#define FBA_ASYNCFILESTREAM_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <vector>
+#include "IoUringQueue.h"
+#include "TBE_IOStream.h"
+
+namespace TBE {
+/// Read-only file stream that keeps a window of reads in flight ahead of the read position through
+/// the shared IoUringQueue. Block k of the stream is loaded into slot k % kNumBlocks: whenever the
+/// position enters a new block, the slots behind it are resubmitted for the blocks at the end of
+/// the window, so a stream read sequentially only waits on the disk if it outruns kNumBlocks - 1
+/// blocks of read-ahead. Like FileStream, an AssetDescriptor makes the stream a window into the
+/// file.
+class AsyncFileStream : public IOStream {
+ public:
+  AsyncFileStream(const char* file, AssetDescriptor ad);
+  ~AsyncFileStream() override;
+
+  size_t read(void* data, size_t numBytes) override;
+  size_t write(void* data, size_t numBytes) override;
+  size_t getPosition() override;
+  bool setPosition(int64_t pos) override;
+  bool setPosition(int64_t pos, int mode) override;
+  int32_t pushBackByte(int c) override;
+  size_t getSize() override;
+  bool canSeek() override;
+  bool ready() const override;
+  bool endOfStream() override;
+  int getFD() override;
+
+  static const size_t kBlockSize = 64 * 1024;
+  static const size_t kNumBlocks = 4;
+
+ private:
+  struct Slot {
+    IoUringQueue::Request request;
+    size_t block{SIZE_MAX}; // Block loaded or being loaded into the slot
+    size_t size{0}; // Bytes of the block available once its read has completed
+    bool loaded{false};
+  };
+
+  /// Submit reads for the blocks of the window starting at the current block that are not loaded
+  /// or in flight
+  void fillWindow();
+
+  /// @return The slot holding the block at the current position, once it is loaded
+  Slot& getCurrentSlot();
+
+  IoUringQueue* queue_{nullptr};
+  int fd_{-1};
+  size_t offset_{0};
+  size_t length_{0};
+  size_t position_{0};
+  bool endOfStream_{false};
+  std::vector<char> buffer_; // kNumBlocks blocks
+  Slot slots_[kNumBlocks];
+};
+} // namespace TBE
+
+#endif // FBA_ASYNCFILESTREAM_H
@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "AudioAssetManagerImpl.h"
+#include <cstring>
+#include "MappedFileStream.h"
+#include "MemoryStream.h"
+#include "WavEncoder.h"
+
+namespace TBE {
+static const int32_t kDecodeBlockSize = 4096;
+
+static std::string makeKey(const char* path, AssetDescriptor ad, AssetAccessMode mode) {
+  return std::string(path) + '|' + std::to_string(ad.offsetInBytes) + '|' +
+      std::to_string(ad.lengthInBytes) + '|' + std::to_string(static_cast<int>(mode));
+}
+
+static const char* detectFormat(const char* magic, size_t size) {
+  if (size >= 4 && std::memcmp(magic, "RIFF", 4) == 0) {
+    return "wav";
+  }
+  if (size >= 4 && std::memcmp(magic, "OggS", 4) == 0) {
+    return "opus";
+  }
+  return "unknown";
+}
+
+EngineError AudioAssetManagerImpl::readFile(const Asset& asset, std::vector<char>& bytes) {
+  std::unique_ptr<IOStream> stream(IOStream::createFileStream(
+      asset.path.c_str(), IOStream::StreamOptions::READ_BINARY, asset.descriptor));
+  if (!stream) {
+    return EngineError::ERROR_OPENING_FILE;
+  }
+
+  const size_t size = stream->getSize();
+  if (size == IOSTREAM_OPERATION_FAIL) {
+    return EngineError::ERROR_OPENING_FILE;
+  }
+
+  bytes.resize(size);
+  if (size > 0 && stream->read(bytes.data(), size) != size) {
+    return EngineError::ERROR_OPENING_FILE;
+  }
+  return EngineError::OK;
+}
+
+EngineError AudioAssetManagerImpl::decodeFile(const Asset& asset, std::vector<char>& bytes) {
+  IOStream* stream = createReadStream(asset.path.c_str(), asset.descriptor);
+  if (!stream) {
+    return EngineError::ERROR_OPENING_FILE;
+  }
+
+  AudioFormatDecoder* rawDecoder = nullptr;
+  const EngineError error =
+      TBE_CreateAudioFormatDecoderFromStream(rawDecoder, stream, true, kDecodeBlockSize, 0.f);
+  if (error != EngineError::OK) {
+    return error;
+  }
+  std::unique_ptr<AudioFormatDecoder> decoder(rawDecoder);
+
+  const int32_t numChannels = decoder->getNumOfChannels();
+  const size_t totalSamples = decoder->getNumTotalSamples();
+  bytes.resize(WavEncoder::kHeaderSize + totalSamples * sizeof(float));
+
+  size_t numDecoded = 0;
+  std::vector<float> block(static_cast<size_t>(kDecodeBlockSize) * numChannels);
+  while (numDecoded < totalSamples) {
+    const size_t decoded = decoder->decode(block.data(), static_cast<int32_t>(block.size()));
+    if (decoded == 0) {
+      break;
+    }
+    const size_t toCopy = std::min(decoded, totalSamples - numDecoded);
+    std::memcpy(
+        bytes.data() + WavEncoder::kHeaderSize + numDecoded * sizeof(float),
+        block.data(),
+        toCopy * sizeof(float));
+    numDecoded += toCopy;
+  }
+
+  if (decoder->decoderError()) {
+    return EngineError::DECODER_FAIL;
+  }
+
+  bytes.resize(WavEncoder::kHeaderSize + numDecoded * sizeof(float));
+  WavEncoder::makeFloatHeader(
+      reinterpret_cast<unsigned char*>(bytes.data()),
+      numChannels,
+      decoder->getSampleRate(),
+      static_cast<uint32_t>(numDecoded * sizeof(float)));
+  return EngineError::OK;
+}
+
+AudioAssetManagerImpl::AudioAssetManagerImpl(const char* sharedPoolName)
+    : sharedPool_(sharedPoolName ? new SharedAssetPool(sharedPoolName) : nullptr) {}
+
+EngineError AudioAssetManagerImpl::loadBytes(
+    const Asset& asset,
+    std::shared_ptr<const AssetBytes>& bytes) const {
+  if (asset.mode == AssetAccessMode::DECODED_MEMORY && sharedPool_) {
+    return sharedPool_->acquire(
+        asset.path.c_str(),
+        asset.descriptor,
+        [&asset](std::vector<char>& decoded) { return decodeFile(asset, decoded); },
+        bytes);
+  }
+
+  std::vector<char> loaded;
+  const EngineError error = (asset.mode == AssetAccessMode::DECODED_MEMORY)
+      ? decodeFile(asset, loaded)
+      : readFile(asset, loaded);
+  if (error == EngineError::OK) {
+    bytes = std::make_shared<VectorAssetBytes>(std::move(loaded));
+  }
+  return error;
+}
+
+AudioAssetManagerImpl::Asset* AudioAssetManagerImpl::findAsset(const AudioAssetHandle& handle) {
+  if (handle.index >= assets_.size()) {
+    return nullptr;
+  }
+  Asset& asset = assets_[handle.index];
+  if (asset.id != handle.id || asset.refCount == 0) {
+    return nullptr;
+  }
+  return &asset;
+}
+
+EngineError AudioAssetManagerImpl::loadAudio(
+    AudioAssetHandle& handle,
+    const char* fileNameAndPath,
+    AssetDescriptor ad,
+    AssetAccessMode mode) {
+  if (!fileNameAndPath || mode == AssetAccessMode::INVALID) {
+    return EngineError::INVALID_PARAM;
+  }
+
+  const std::string key = makeKey(fileNameAndPath, ad, mode);
+  Asset evicted;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto existing = indexForKey_.find(key);
+    if (existing != indexForKey_.end()) {
+      Asset& asset = assets_[existing->second];
+      asset.refCount++;
+      asset.lastUse = ++useCount_;
+      handle.index = existing->second;
+      handle.id = asset.id;
+      if (!asset.evicted) {
+        return EngineError::OK;
+      }
+      evicted = asset;
+    }
+  }
+
+  if (evicted.evicted) {
+    // Decode it again. If that fails, the handle is still served from the fallback.
+    std::shared_ptr<const AssetBytes> bytes;
+    if (loadBytes(evicted, bytes) == EngineError::OK) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Asset* asset = findAsset(handle);
+      if (asset && asset->evicted) {
+        addDecoded(*asset, bytes);
+        applyBudget();
+      }
+    }
+    return EngineError::OK;
+  }
+
+  // Load outside of the lock, other assets can still be accessed in the meantime
+  Asset asset;
+  asset.key = key;
+  asset.path = fileNameAndPath;
+  asset.descriptor = ad;
+  asset.mode = mode;
+  asset.refCount = 1;
+
+  {
+    std::unique_ptr<IOStream> probe(IOStream::createFileStream(
+        fileNameAndPath, IOStream::StreamOptions::READ_BINARY, ad));
+    if (!probe) {
+      return EngineError::ERROR_OPENING_FILE;
+    }
+    char magic[4] = {0};
+    const size_t numRead = probe->read(magic, sizeof(magic));
+    asset.format =
+        detectFormat(magic, numRead == IOSTREAM_OPERATION_FAIL ? 0 : numRead);
+    asset.sourceFormat = asset.format;
+  }
+
+  std::shared_ptr<const AssetBytes> bytes;
+  if (mode != AssetAccessMode::FILE) {
+    const EngineError error = loadBytes(asset, bytes);
+    if (error != EngineError::OK) {
+      return error;
+    }
+    if (mode == AssetAccessMode::MEMORY) {
+      asset.data = bytes;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Another thread may have loaded the same asset while this one was decoding
+  auto existing = indexForKey_.find(key);
+  if (existing != indexForKey_.end()) {
+    Asset& loaded = assets_[existing->second];
+    loaded.refCount++;
+    handle.index = existing->second;
+    handle.id = loaded.id;
+    return EngineError::OK;
+  }
+
+  size_t index = assets_.size();
+  for (size_t i = 0; i < assets_.size(); ++i) {
+    if (assets_[i].refCount == 0) {
+      index = i;
+      break;
+    }
+  }
+  if (index == assets_.size()) {
+    assets_.emplace_back();
+  }
+
+  asset.id = nextId_++;
+  asset.lastUse = ++useCount_;
+  assets_[index] = std::move(asset);
+  indexForKey_[key] = index;
+  handle.index = index;
+  handle.id = assets_[index].id;
+  if (mode == AssetAccessMode::DECODED_MEMORY) {
+    addDecoded(assets_[index], bytes);
+    applyBudget();
+  }
+  return EngineError::OK;
+}
+
+void AudioAssetManagerImpl::addDecoded(Asset& asset, std::shared_ptr<const AssetBytes> bytes) {
+  decodedBytes_ += bytes->size();
+  asset.data = std::move(bytes);
+  asset.format = "wav";
+  asset.evicted = false;
+  asset.lastUse = ++useCount_;
+}
+
+void AudioAssetManagerImpl::applyBudget() {
+  while (budget_ > 0 && decodedBytes_ > budget_) {
+    Asset* oldest = nullptr;
+    for (auto& asset : assets_) {
+      if (asset.refCount > 0 && asset.mode == AssetAccessMode::DECODED_MEMORY && !asset.evicted &&
+          (!oldest || asset.lastUse < oldest->lastUse)) {
+        oldest = &asset;
+      }
+    }
+    if (!oldest) {
+      break;
+    }
+
+    // Streams that are still open keep their own reference to the data
+    decodedBytes_ -= oldest->data->size();
+    oldest->data.reset();
+    oldest->format = oldest->sourceFormat;
+    oldest->evicted = true;
+    evictions_++;
+  }
+}
+
+IOStream* AudioAssetManagerImpl::getNewStream(AudioAssetHandle& handle) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Asset* asset = findAsset(handle);
+  if (!asset) {
+    return nullptr;
+  }
+
+  if (asset->mode == AssetAccessMode::DECODED_MEMORY) {
+    if (!asset->evicted) {
+      hits_++;
+      asset->lastUse = ++useCount_;
+    } else {
+      misses_++;
+      if (!asset->data && fallbackMode_ == AssetAccessMode::MEMORY) {
+        // Load the raw bytes outside of the lock, then share them with later streams
+        Asset source = *asset;
+        source.mode = AssetAccessMode::MEMORY;
+        lock.unlock();
+        std::shared_ptr<const AssetBytes> bytes;
+        const bool loaded = loadBytes(source, bytes) == EngineError::OK;
+        lock.lock();
+        asset = findAsset(handle);
+        if (!asset) {
+          return nullptr;
+        }
+        if (loaded && asset->evicted && !asset->data) {
+          asset->data = bytes;
+        }
+      }
+    }
+  }
+
+  // FILE assets, and evicted assets without their raw bytes
+  if (!asset->data) {
+    return createReadStream(asset->path.c_str(), asset->descriptor);
+  }
+  return new MemoryStream(asset->data->data(), asset->data->size(), asset->data);
+}
+
+AudioFormatDecoder* AudioAssetManagerImpl::getNewDecoder(
+    AudioAssetHandle& handle,
+    int32_t bufferSize,
+    float sampleRate) {
+  IOStream* stream = getNewStream(handle);
+  if (!stream) {
+    return nullptr;
+  }
+
+  AudioFormatDecoder* decoder = nullptr;
+  if (TBE_CreateAudioFormatDecoderFromStream(decoder, stream, true, bufferSize, sampleRate) !=
+      EngineError::OK) {
+    return nullptr;
+  }
+  return decoder;
+}
+
+bool AudioAssetManagerImpl::unloadAudio(AudioAssetHandle& handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Asset* asset = findAsset(handle);
+  if (!asset) {
+    return false;
+  }
+
+  if (--asset->refCount == 0) {
+    // Streams that are still open keep their own reference to the data
+    if (asset->mode == AssetAccessMode::DECODED_MEMORY && !asset->evicted) {
+      decodedBytes_ -= asset->data->size();
+    }
+    indexForKey_.erase(asset->key);
+    asset->data.reset();
+    asset->id = uninitializedHandle;
+  }
+  handle = InvalidAudioAssetHandle;
+  return true;
+}
+
+AssetAccessMode AudioAssetManagerImpl::getMode(AudioAssetHandle& handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Asset* asset = findAsset(handle);
+  if (!asset) {
+    return AssetAccessMode::INVALID;
+  }
+  return asset->evicted ? fallbackMode_ : asset->mode;
+}
+
+const char* AudioAssetManagerImpl::getFormat(AudioAssetHandle& handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Asset* asset = findAsset(handle);
+  return asset ? asset->format.c_str() : "";
+}
+
+size_t AudioAssetManagerImpl::getBytesInMemory() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t total = 0;
+  for (const auto& asset : assets_) {
+    if (asset.refCount > 0 && asset.data) {
+      total += asset.data->size();
+    }
+  }
+  return total;
+}
+
+EngineError AudioAssetManagerImpl::setDecodedMemoryBudget(
+    size_t budgetInBytes,
+    AssetAccessMode fallbackMode) {
+  if (fallbackMode != AssetAccessMode::FILE && fallbackMode != AssetAccessMode::MEMORY) {
+    return EngineError::INVALID_PARAM;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_ = budgetInBytes;
+  fallbackMode_ = fallbackMode;
+  if (fallbackMode_ == AssetAccessMode::FILE) {
+    // Release the raw bytes loaded for evicted assets
+    for (auto& asset : assets_) {
+      if (asset.evicted) {
+        asset.data.reset();
+      }
+    }
+  }
+  applyBudget();
+  return EngineError::OK;
+}
+
+AudioAssetCacheStatistics AudioAssetManagerImpl::getCacheStatistics() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  AudioAssetCacheStatistics statistics;
+  statistics.hits = hits_;
+  statistics.misses = misses_;
+  statistics.evictions = evictions_;
+  statistics.decodedBytes = decodedBytes_;
+  statistics.budgetBytes = budget_;
+  return statistics;
+}
+} // namespace TBE
+
+TBE::EngineError TBE_CreateAudioAssetManager(TBE::AudioAssetManager*& assetManager) {
+  if (assetManager) {
+    return TBE::EngineError::INVALID_PARAM;
+  }
+  assetManager = new TBE::AudioAssetManagerImpl();
+  return TBE::EngineError::OK;
+}
+
+TBE::EngineError TBE_CreateSharedAudioAssetManager(
+    TBE::AudioAssetManager*& assetManager,
+    const char* poolName) {
+  if (assetManager || !TBE::SharedAssetPool::isValidName(poolName)) {
+    return TBE::EngineError::INVALID_PARAM;
+  }
+  if (!TBE::SharedAssetPool::isSupported()) {
+    return TBE::EngineError::NOT_SUPPORTED;
+  }
+  assetManager = new TBE::AudioAssetManagerImpl(poolName);
+  return TBE::EngineError::OK;
+}
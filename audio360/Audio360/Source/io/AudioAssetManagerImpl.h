@@ -0,0 +1,101 @@
+#ifndef FBA_AUDIOASSETMANAGERIMPL_H
+#define FBA_AUDIOASSETMANAGERIMPL_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AssetBytes.h"
+#include "SharedAssetPool.h"
+#include "TBE_AudioAssetManager.h"
+
+namespace TBE {
+/// Thread safe asset manager. MEMORY assets hold the raw bytes of the file (or of the
+/// AssetDescriptor window), DECODED_MEMORY assets hold the whole file decoded to a 32 bit float WAV
+/// image at its native sample rate. Both are shared with the streams created from them, so an asset
+/// can be unloaded while objects are still playing it.
+///
+/// With a decoded memory budget, decoded assets are evicted least recently used first: an asset is
+/// used when it is loaded and whenever a stream is created from it. Evicted assets keep their
+/// handle and are served from the file, or from their raw bytes loaded on first use.
+///
+/// With a shared pool, decoded assets are mapped from a SharedAssetPool instead, so processes that
+/// use the same pool decode each asset once and share one copy of it.
+class AudioAssetManagerImpl : public AudioAssetManager {
+ public:
+  /// @param sharedPoolName Name of the SharedAssetPool holding decoded assets, or nullptr to keep
+  /// them in this process
+  explicit AudioAssetManagerImpl(const char* sharedPoolName = nullptr);
+
+  EngineError loadAudio(
+      AudioAssetHandle& handle,
+      const char* fileNameAndPath,
+      AssetDescriptor ad,
+      AssetAccessMode mode) override;
+  IOStream* getNewStream(AudioAssetHandle& handle) override;
+  AudioFormatDecoder* getNewDecoder(AudioAssetHandle& handle, int32_t bufferSize, float sampleRate)
+      override;
+  bool unloadAudio(AudioAssetHandle& handle) override;
+  AssetAccessMode getMode(AudioAssetHandle& handle) override;
+  const char* getFormat(AudioAssetHandle& handle) override;
+  size_t getBytesInMemory() override;
+  EngineError setDecodedMemoryBudget(size_t budgetInBytes, AssetAccessMode fallbackMode) override;
+  AudioAssetCacheStatistics getCacheStatistics() override;
+
+ private:
+  struct Asset {
+    size_t id{uninitializedHandle};
+    std::string key;
+    std::string path;
+    AssetDescriptor descriptor;
+    AssetAccessMode mode{AssetAccessMode::INVALID};
+    std::string format;
+    std::string sourceFormat; // Format of the file, served once a decoded asset is evicted
+    std::shared_ptr<const AssetBytes> data;
+    size_t refCount{0};
+    bool evicted{false}; // Decoded audio released to stay within the budget
+    uint64_t lastUse{0};
+  };
+
+  /// Read the file (or the descriptor window) into memory
+  static EngineError readFile(const Asset& asset, std::vector<char>& bytes);
+  /// Decode the file into a float WAV image
+  static EngineError decodeFile(const Asset& asset, std::vector<char>& bytes);
+  /// Read or decode an asset, according to its mode, through the shared pool if there is one
+  EngineError loadBytes(const Asset& asset, std::shared_ptr<const AssetBytes>& bytes) const;
+
+  /// @return The asset for a handle or nullptr if the handle is stale. Must hold mutex_
+  Asset* findAsset(const AudioAssetHandle& handle);
+
+  /// Hold decoded audio for an asset and mark it as used. Must hold mutex_
+  void addDecoded(Asset& asset, std::shared_ptr<const AssetBytes> bytes);
+
+  /// Evict the least recently used decoded assets until the decoded audio fits the budget. Must
+  /// hold mutex_
+  void applyBudget();
+
+  const std::unique_ptr<const SharedAssetPool> sharedPool_;
+
+  std::mutex mutex_;
+  std::vector<Asset> assets_;
+  std::unordered_map<std::string, size_t> indexForKey_;
+  size_t nextId_{0};
+
+  size_t budget_{0};
+  AssetAccessMode fallbackMode_{AssetAccessMode::FILE};
+  size_t decodedBytes_{0};
+  uint64_t useCount_{0};
+  size_t hits_{0};
+  size_t misses_{0};
+  size_t evictions_{0};
+};
+} // namespace TBE
+
+#endif // FBA_AUDIOASSETMANAGERIMPL_H
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include <cstring>
+#include "MappedFileStream.h"
+#include "TBE_AudioFormatDecoder.h"
+#include "WavDecoder.h"
+
+namespace TBE {
+static void* javaVM = nullptr;
+
+void AudioFormatDecoder::setJavaVM(void* vm) {
+  // Only used by the Android native codecs, kept for API compatibility
+  javaVM = vm;
+}
+
+void* AudioFormatDecoder::getJavaVM() {
+  return javaVM;
+}
+} // namespace TBE
+
+TBE::EngineError TBE_CreateAudioFormatDecoderFromHeader(
+    TBE::AudioFormatDecoder*& decoder,
+    const char* headerData,
+    size_t headerDataSize) {
+  if (decoder || !headerData || headerDataSize == 0) {
+    return TBE::EngineError::INVALID_PARAM;
+  }
+  // Opus packet decoding requires libopus, which is not part of the open implementation
+  return TBE::EngineError::NOT_SUPPORTED;
+}
+
+TBE::EngineError TBE_CreateAudioFormatDecoder(
+    TBE::AudioFormatDecoder*& decoder,
+    const char* file,
+    int maxBufferSizePerChannel,
+    float outputSampleRate) {
+  if (decoder || !file) {
+    return TBE::EngineError::INVALID_PARAM;
+  }
+
+  TBE::IOStream* stream = TBE::createReadStream(file, TBE::AssetDescriptor());
+  if (!stream) {
+    return TBE::EngineError::ERROR_OPENING_FILE;
+  }
+  return TBE_CreateAudioFormatDecoderFromStream(
+      decoder, stream, true, maxBufferSizePerChannel, outputSampleRate);
+}
+
+TBE::EngineError TBE_CreateAudioFormatDecoderFromStream(
+    TBE::AudioFormatDecoder*& decoder,
+    TBE::IOStream* stream,
+    bool decoderOwnsStream,
+    int maxBufferSizePerChannel,
+    float outputSampleRate) {
+  if (decoder || !stream) {
+    if (stream && decoderOwnsStream) {
+      delete stream;
+    }
+    return TBE::EngineError::INVALID_PARAM;
+  }
+  if (maxBufferSizePerChannel <= 0) {
+    if (decoderOwnsStream) {
+      delete stream;
+    }
+    return TBE::EngineError::INVALID_BUFFER_SIZE;
+  }
+
+  char magic[4] = {0};
+  const bool hasMagic = stream->setPosition(0) && stream->read(magic, 4) == 4;
+  stream->setPosition(0);
+
+  if (hasMagic && std::memcmp(magic, "RIFF", 4) == 0) {
+    auto wav =
+        new TBE::WavDecoder(stream, decoderOwnsStream, maxBufferSizePerChannel, outputSampleRate);
+    const TBE::EngineError error = wav->getInitError();
+    if (error != TBE::EngineError::OK) {
+      delete wav;
+      return error;
+    }
+    decoder = wav;
+    return TBE::EngineError::OK;
+  }
+
+  // Opus (OggS) and .tbe containers need codecs that are not part of the open implementation
+  if (decoderOwnsStream) {
+    delete stream;
+  }
+  return TBE::EngineError::CANNOT_INIT_DECODER;
+}
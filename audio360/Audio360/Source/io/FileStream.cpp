@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "FileStream.h"
+#include <algorithm>
+
+namespace TBE {
+static const char* getOpenMode(IOStream::StreamOptions options) {
+  switch (options) {
+    case IOStream::StreamOptions::WRITE_BINARY:
+      return "wb";
+    case IOStream::StreamOptions::READ_WRITE_BINARY:
+      return "r+b";
+    case IOStream::StreamOptions::READ_BINARY:
+    default:
+      return "rb";
+  }
+}
+
+FileStream::FileStream(const char* file, StreamOptions options, AssetDescriptor ad)
+    : options_(options), offset_(ad.offsetInBytes) {
+  if (!file) {
+    return;
+  }
+
+  file_ = std::fopen(file, getOpenMode(options));
+  if (!file_) {
+    return;
+  }
+
+  if (options_ == StreamOptions::WRITE_BINARY) {
+    offset_ = 0;
+    return;
+  }
+
+  std::fseek(file_, 0, SEEK_END);
+  const long fileSize = std::ftell(file_);
+  if (fileSize < 0 || offset_ > static_cast<size_t>(fileSize)) {
+    std::fclose(file_);
+    file_ = nullptr;
+    return;
+  }
+
+  const size_t available = static_cast<size_t>(fileSize) - offset_;
+  length_ = (ad.lengthInBytes > 0) ? std::min(ad.lengthInBytes, available) : available;
+  std::fseek(file_, static_cast<long>(offset_), SEEK_SET);
+}
+
+FileStream::~FileStream() {
+  if (file_) {
+    std::fclose(file_);
+  }
+}
+
+size_t FileStream::read(void* data, size_t numBytes) {
+  if (!file_ || !data) {
+    return IOSTREAM_OPERATION_FAIL;
+  }
+
+  const size_t remaining = (position_ < length_) ? length_ - position_ : 0;
+  const size_t toRead = std::min(numBytes, remaining);
+  const size_t numRead = std::fread(data, 1, toRead, file_);
+  position_ += numRead;
+  endOfStream_ = numRead < numBytes;
+  return numRead;
+}
+
+size_t FileStream::write(void* data, size_t numBytes) {
+  if (!file_ || !data || options_ == StreamOptions::READ_BINARY) {
+    return IOSTREAM_OPERATION_FAIL;
+  }
+
+  const size_t numWritten = std::fwrite(data, 1, numBytes, file_);
+  position_ += numWritten;
+  length_ = std::max(length_, position_);
+  return numWritten;
+}
+
+size_t FileStream::getPosition() {
+  return file_ ? position_ : IOSTREAM_OPERATION_FAIL;
+}
+
+bool FileStream::setPosition(int64_t pos) {
+  return setPosition(pos, SEEK_SET);
+}
+
+bool FileStream::setPosition(int64_t pos, int mode) {
+  if (!file_) {
+    return false;
+  }
+
+  int64_t target = pos;
+  if (mode == SEEK_CUR) {
+    target = static_cast<int64_t>(position_) + pos;
+  } else if (mode == SEEK_END) {
+    target = static_cast<int64_t>(length_) + pos;
+  }
+
+  const bool canGrow = options_ != StreamOptions::READ_BINARY;
+  if (target < 0 || (!canGrow && target > static_cast<int64_t>(length_))) {
+    return false;
+  }
+
+  if (std::fseek(file_, static_cast<long>(offset_ + static_cast<size_t>(target)), SEEK_SET) != 0) {
+    return false;
+  }
+
+  position_ = static_cast<size_t>(target);
+  endOfStream_ = false;
+  return true;
+}
+
+int32_t FileStream::pushBackByte(int c) {
+  if (!file_ || position_ == 0 || c == EOF) {
+    return EOF;
+  }
+
+  const int result = std::ungetc(c, file_);
+  if (result != EOF) {
+    position_--;
+    endOfStream_ = false;
+  }
+  return result;
+}
+
+size_t FileStream::getSize() {
+  return file_ ? length_ : IOSTREAM_OPERATION_FAIL;
+}
+
+bool FileStream::canSeek() {
+  return file_ != nullptr;
+}
+
+bool FileStream::ready() const {
+  return file_ != nullptr;
+}
+
+bool FileStream::endOfStream() {
+  return !file_ || endOfStream_ || position_ >= length_;
+}
+
+int FileStream::getFD() {
+  return file_ ? fileno(file_) : -1;
+}
+
+IOStream* IOStream::createFileStream(const char* file, StreamOptions options, AssetDescriptor ad) {
+  auto stream = new FileStream(file, options, ad);
+  if (!stream->ready()) {
+    delete stream;
+    return nullptr;
+  }
+  return stream;
+}
+} // namespace TBE
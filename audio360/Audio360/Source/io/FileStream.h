@@ -0,0 +1,43 @@
+#ifndef FBA_FILESTREAM_H
+#define FBA_FILESTREAM_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <cstdio>
+#include "TBE_IOStream.h"
+
+namespace TBE {
+/// Buffered stdio file stream. When an AssetDescriptor is specified, the stream is a window into
+/// the file: position 0 maps to the descriptor offset and the size is clamped to its length.
+class FileStream : public IOStream {
+ public:
+  FileStream(const char* file, StreamOptions options, AssetDescriptor ad);
+  ~FileStream() override;
+
+  size_t read(void* data, size_t numBytes) override;
+  size_t write(void* data, size_t numBytes) override;
+  size_t getPosition() override;
+  bool setPosition(int64_t pos) override;
+  bool setPosition(int64_t pos, int mode) override;
+  int32_t pushBackByte(int c) override;
+  size_t getSize() override;
+  bool canSeek() override;
+  bool ready() const override;
+  bool endOfStream() override;
+  int getFD() override;
+
+ private:
+  FILE* file_{nullptr};
+  StreamOptions options_;
+  size_t offset_{0};
+  size_t length_{0};
+  size_t position_{0};
+  bool endOfStream_{false};
+};
+} // namespace TBE
+
+#endif // FBA_FILESTREAM_H
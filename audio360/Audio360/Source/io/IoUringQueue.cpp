@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "IoUringQueue.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define FBA_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace TBE {
+#if FBA_HAS_IO_URING
+static_assert(
+    sizeof(IoUringQueue::Request::Buffer) == sizeof(iovec) &&
+        offsetof(IoUringQueue::Request::Buffer, base) == offsetof(iovec, iov_base) &&
+        offsetof(IoUringQueue::Request::Buffer, length) == offsetof(iovec, iov_len),
+    "Request::Buffer must be laid out as struct iovec");
+
+static int ioUringSetup(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+  int result;
+  do {
+    result = static_cast<int>(
+        syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+IoUringQueue::IoUringQueue() {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  ringFd_ = ioUringSetup(kNumEntries, &params);
+  if (ringFd_ < 0) {
+    return;
+  }
+
+  sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (singleMap) {
+    sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+  }
+
+  sqRing_ = mmap(
+      nullptr,
+      sqRingSize_,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE,
+      ringFd_,
+      IORING_OFF_SQ_RING);
+  if (sqRing_ == MAP_FAILED) {
+    sqRing_ = nullptr;
+  } else if (singleMap) {
+    cqRing_ = sqRing_;
+  } else {
+    cqRing_ = mmap(
+        nullptr,
+        cqRingSize_,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        ringFd_,
+        IORING_OFF_CQ_RING);
+    cqRing_ = (cqRing_ == MAP_FAILED) ? nullptr : cqRing_;
+  }
+  sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = mmap(
+      nullptr,
+      sqesSize_,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE,
+      ringFd_,
+      IORING_OFF_SQES);
+  sqes_ = (sqes_ == MAP_FAILED) ? nullptr : sqes_;
+
+  if (!sqRing_ || !cqRing_ || !sqes_) {
+    release();
+    return;
+  }
+
+  char* sq = static_cast<char*>(sqRing_);
+  sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sqEntries_ = params.sq_entries;
+
+  char* cq = static_cast<char*>(cqRing_);
+  cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cqes_ = cq + params.cq_off.cqes;
+  cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  maxInFlight_ = (params.features & IORING_FEAT_NODROP) != 0 ? 0 : params.cq_entries;
+}
+
+IoUringQueue::~IoUringQueue() {
+  release();
+}
+
+void IoUringQueue::release() {
+  if (sqes_) {
+    munmap(sqes_, sqesSize_);
+    sqes_ = nullptr;
+  }
+  if (cqRing_ && cqRing_ != sqRing_) {
+    munmap(cqRing_, cqRingSize_);
+  }
+  cqRing_ = nullptr;
+  if (sqRing_) {
+    munmap(sqRing_, sqRingSize_);
+    sqRing_ = nullptr;
+  }
+  if (ringFd_ >= 0) {
+    close(ringFd_);
+    ringFd_ = -1;
+  }
+}
+
+IoUringQueue* IoUringQueue::getShared() {
+  // Never destroyed: streams may still be closed by static destructors
+  static IoUringQueue* queue = new IoUringQueue();
+  return queue->ready() ? queue : nullptr;
+}
+
+bool IoUringQueue::submitRead(
+    int fd,
+    void* buffer,
+    size_t numBytes,
+    uint64_t offset,
+    Request& request) {
+  std::lock_guard<std::mutex> lock(submitMutex_);
+  // Every entry is submitted as soon as it is queued, so the queue only fills up if the kernel
+  // failed to consume an earlier one
+  const unsigned tail = *sqTail_;
+  if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+    return false;
+  }
+  // Without IORING_FEAT_NODROP, a completion that doesn't fit in the completion queue is lost and
+  // its request would never complete
+  if (maxInFlight_ > 0 && numInFlight_.load(std::memory_order_relaxed) >= maxInFlight_) {
+    return false;
+  }
+
+  // IORING_OP_READ would save the iovec, but needs Linux 5.6
+  request.buffer.base = buffer;
+  request.buffer.length = numBytes;
+  const unsigned index = tail & sqMask_;
+  io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes_) + index;
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_READV;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(&request.buffer);
+  sqe->len = 1;
+  sqe->off = offset;
+  sqe->user_data = reinterpret_cast<uint64_t>(&request);
+  sqArray_[index] = index;
+
+  request.complete.store(false, std::memory_order_release);
+  numInFlight_.fetch_add(1, std::memory_order_relaxed);
+  __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+  if (ioUringEnter(ringFd_, 1, 0, 0) != 1) {
+    // Not consumed by the kernel: only this thread submits, so the entry can be taken back
+    __atomic_store_n(sqTail_, tail, __ATOMIC_RELEASE);
+    numInFlight_.fetch_sub(1, std::memory_order_relaxed);
+    request.complete.store(true, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+unsigned IoUringQueue::reap() {
+  unsigned head = *cqHead_;
+  const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+  const unsigned numCompleted = tail - head;
+  for (; head != tail; ++head) {
+    const io_uring_cqe& cqe = static_cast<const io_uring_cqe*>(cqes_)[head & cqMask_];
+    Request* request = reinterpret_cast<Request*>(cqe.user_data);
+    // Pairs with the release in submitRead(): the submitting thread is done with the request. The
+    // ring itself orders this too, but through the kernel, which the language can't see.
+    (void)request->complete.load(std::memory_order_acquire);
+    request->result = cqe.res;
+    // The request may be destroyed as soon as it is flagged
+    request->complete.store(true, std::memory_order_release);
+  }
+  __atomic_store_n(cqHead_, tail, __ATOMIC_RELEASE);
+  numInFlight_.fetch_sub(numCompleted, std::memory_order_relaxed);
+  return numCompleted;
+}
+
+void IoUringQueue::wait(Request& request) {
+  while (!request.complete.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(completionMutex_);
+    // Another thread may have reaped it while this one waited for the lock
+    if (reap() == 0 && !request.complete.load(std::memory_order_acquire)) {
+      ioUringEnter(ringFd_, 0, 1, IORING_ENTER_GETEVENTS);
+    }
+  }
+}
+#else
+IoUringQueue::IoUringQueue() {}
+
+IoUringQueue::~IoUringQueue() {}
+
+void IoUringQueue::release() {}
+
+IoUringQueue* IoUringQueue::getShared() {
+  return nullptr;
+}
+
+bool IoUringQueue::submitRead(int, void*, size_t, uint64_t, Request&) {
+  return false;
+}
+
+unsigned IoUringQueue::reap() {
+  return 0;
+}
+
+void IoUringQueue::wait(Request&) {}
+#endif
+} // namespace TBE
@@ -0,0 +1,98 @@
+#ifndef FBA_IOURINGQUEUE_H
+#define FBA_IOURINGQUEUE_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace TBE {
+/// An io_uring instance shared by every AsyncFileStream in the process, so that any number of
+/// streams keep their reads in flight through a single submission queue. Reads are submitted as
+/// soon as they are queued. Completions are reaped by whichever thread waits for one and are
+/// handed to the request they belong to, whichever stream issued it.
+///
+/// Uses the raw system calls, so there is no dependency on liburing, and only IORING_OP_READV, so
+/// any kernel with io_uring (Linux 5.1 and above) can run it. On other platforms, or when the
+/// kernel doesn't support io_uring, getShared() returns nullptr.
+class IoUringQueue {
+ public:
+  /// A read in flight. Must outlive the read, i.e. wait() for it before destroying it.
+  struct Request {
+    /// Laid out as struct iovec
+    struct Buffer {
+      void* base;
+      size_t length;
+    };
+
+    std::atomic<bool> complete{true};
+    int result{0}; // Bytes read or a negative errno, valid once complete
+    Buffer buffer{nullptr, 0}; // Read by the kernel until the read completes on kernels before 5.5
+  };
+
+  /// @return The process wide queue, or nullptr if io_uring is not available
+  static IoUringQueue* getShared();
+
+  /// Submit a read of numBytes at offset in fd into buffer
+  /// @return False if the read could not be submitted, or if as many reads as the completion
+  /// queue holds are in flight and the kernel would drop the completions of more. request is left
+  /// untouched.
+  bool submitRead(int fd, void* buffer, size_t numBytes, uint64_t offset, Request& request);
+
+  /// Block until request has completed, dispatching the completions of other requests on the way
+  void wait(Request& request);
+
+  /// Submission queue entries. The completion queue is twice as large. Kernels with
+  /// IORING_FEAT_NODROP (5.5 and above) buffer overflowing completions, so more reads than that
+  /// can be in flight. Older kernels drop them, so reads in flight are capped at its size there.
+  static const unsigned kNumEntries = 256;
+
+ private:
+  IoUringQueue();
+  ~IoUringQueue();
+  IoUringQueue(const IoUringQueue&) = delete;
+  IoUringQueue& operator=(const IoUringQueue&) = delete;
+
+  /// Unmap the rings and close the ring
+  void release();
+
+  bool ready() const {
+    return ringFd_ >= 0;
+  }
+
+  /// Dispatch every completion in the completion queue. Must hold completionMutex_.
+  /// @return Number of completions dispatched
+  unsigned reap();
+
+  int ringFd_{-1};
+  void* sqRing_{nullptr};
+  size_t sqRingSize_{0};
+  void* cqRing_{nullptr};
+  size_t cqRingSize_{0};
+  void* sqes_{nullptr};
+  size_t sqesSize_{0};
+
+  unsigned* sqHead_{nullptr};
+  unsigned* sqTail_{nullptr};
+  unsigned* sqArray_{nullptr};
+  unsigned sqMask_{0};
+  unsigned sqEntries_{0};
+  unsigned* cqHead_{nullptr};
+  unsigned* cqTail_{nullptr};
+  void* cqes_{nullptr};
+  unsigned cqMask_{0};
+  unsigned maxInFlight_{0}; // Completion queue size, or 0 if the kernel never drops completions
+  std::atomic<unsigned> numInFlight_{0};
+
+  std::mutex submitMutex_;
+  std::mutex completionMutex_;
+};
+} // namespace TBE
+
+#endif // FBA_IOURINGQUEUE_H
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "MappedFileStream.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "FileStream.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define FBA_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define FBA_HAS_MMAP 0
+#endif
+
+namespace TBE {
+#if FBA_HAS_MMAP
+static size_t getPageSize() {
+  static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return pageSize;
+}
+
+MappedFileStream::MappedFileStream(const char* file, AssetDescriptor ad) {
+  if (!file) {
+    return;
+  }
+
+  fd_ = ::open(file, O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    return;
+  }
+
+  // An empty window can't be mapped, createReadStream() falls back to a FileStream for it
+  struct stat info;
+  if (fstat(fd_, &info) != 0 || info.st_size <= 0 ||
+      ad.offsetInBytes >= static_cast<size_t>(info.st_size)) {
+    ::close(fd_);
+    fd_ = -1;
+    return;
+  }
+
+  const size_t available = static_cast<size_t>(info.st_size) - ad.offsetInBytes;
+  length_ = (ad.lengthInBytes > 0) ? std::min(ad.lengthInBytes, available) : available;
+
+  // The mapping must start on a page boundary, the window starts within its first page
+  const size_t alignedOffset = ad.offsetInBytes - ad.offsetInBytes % getPageSize();
+  mappingSize_ = ad.offsetInBytes - alignedOffset + length_;
+  void* mapping =
+      mmap(nullptr, mappingSize_, PROT_READ, MAP_PRIVATE, fd_, static_cast<off_t>(alignedOffset));
+  if (mapping == MAP_FAILED) {
+    ::close(fd_);
+    fd_ = -1;
+    length_ = 0;
+    return;
+  }
+
+  mapping_ = mapping;
+  data_ = static_cast<const char*>(mapping) + (ad.offsetInBytes - alignedOffset);
+  madvise(mapping_, mappingSize_, MADV_SEQUENTIAL);
+  readAhead();
+}
+
+MappedFileStream::~MappedFileStream() {
+  if (mapping_) {
+    munmap(mapping_, mappingSize_);
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+void MappedFileStream::readAhead() {
+  // Refill once half of the window has been consumed, which keeps the number of syscalls low
+  if (readAheadEnd_ >= length_ || position_ + kReadAheadBytes / 2 < readAheadEnd_) {
+    return;
+  }
+
+  const size_t windowOffset = static_cast<size_t>(data_ - static_cast<const char*>(mapping_));
+  const size_t begin = windowOffset + std::max(position_, readAheadEnd_);
+  const size_t end = windowOffset + std::min(position_ + kReadAheadBytes, length_);
+  const size_t alignedBegin = begin - begin % getPageSize();
+  madvise(static_cast<char*>(mapping_) + alignedBegin, end - alignedBegin, MADV_WILLNEED);
+  readAheadEnd_ = end - windowOffset;
+}
+
+size_t MappedFileStream::read(void* data, size_t numBytes) {
+  if (!data_ || !data) {
+    return IOSTREAM_OPERATION_FAIL;
+  }
+
+  size_t numRead = 0;
+  const void* source = borrow(numBytes, numRead);
+  if (numRead > 0) {
+    std::memcpy(data, source, numRead);
+  }
+  return numRead;
+}
+
+const void* MappedFileStream::borrow(size_t numBytes, size_t& numBorrowed) {
+  numBorrowed = 0;
+  if (!data_) {
+    return nullptr;
+  }
+
+  const char* source = data_ + position_;
+  numBorrowed = std::min(numBytes, length_ - position_);
+  position_ += numBorrowed;
+  readAhead();
+  return source;
+}
+
+size_t MappedFileStream::write(void*, size_t) {
+  return 0;
+}
+
+size_t MappedFileStream::getPosition() {
+  return data_ ? position_ : IOSTREAM_OPERATION_FAIL;
+}
+
+bool MappedFileStream::setPosition(int64_t pos) {
+  return setPosition(pos, SEEK_SET);
+}
+
+bool MappedFileStream::setPosition(int64_t pos, int mode) {
+  int64_t target = pos;
+  if (mode == SEEK_CUR) {
+    target = static_cast<int64_t>(position_) + pos;
+  } else if (mode == SEEK_END) {
+    target = static_cast<int64_t>(length_) + pos;
+  }
+
+  if (!data_ || target < 0 || target > static_cast<int64_t>(length_)) {
+    return false;
+  }
+
+  position_ = static_cast<size_t>(target);
+  // Restart the read-ahead from the new position
+  readAheadEnd_ = position_;
+  readAhead();
+  return true;
+}
+
+int32_t MappedFileStream::pushBackByte(int c) {
+  if (!data_ || position_ == 0 || c == EOF) {
+    return EOF;
+  }
+  position_--;
+  return c;
+}
+
+size_t MappedFileStream::getSize() {
+  return data_ ? length_ : IOSTREAM_OPERATION_FAIL;
+}
+
+bool MappedFileStream::canSeek() {
+  return data_ != nullptr;
+}
+
+bool MappedFileStream::ready() const {
+  return data_ != nullptr;
+}
+
+bool MappedFileStream::endOfStream() {
+  return position_ >= length_;
+}
+
+int MappedFileStream::getFD() {
+  return fd_;
+}
+
+IOStream* IOStream::createMappedFileStream(const char* file, AssetDescriptor ad) {
+  auto stream = new MappedFileStream(file, ad);
+  if (!stream->ready()) {
+    delete stream;
+    return nullptr;
+  }
+  return stream;
+}
+#else
+IOStream* IOStream::createMappedFileStream(const char*, AssetDescriptor) {
+  return nullptr;
+}
+#endif
+
+IOStream* createReadStream(const char* file, AssetDescriptor ad) {
+  IOStream* stream = IOStream::createMappedFileStream(file, ad);
+  if (!stream) {
+    stream = IOStream::createFileStream(file, IOStream::StreamOptions::READ_BINARY, ad);
+  }
+  return stream;
+}
+} // namespace TBE
@@ -0,0 +1,56 @@
+#ifndef FBA_MAPPEDFILESTREAM_H
+#define FBA_MAPPEDFILESTREAM_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include "TBE_IOStream.h"
+
+namespace TBE {
+/// Read-only stream over a memory mapped file. Like FileStream, an AssetDescriptor makes the stream
+/// a window into the file, so a chunk of a bundle is mapped directly. The mapping is advised as
+/// sequential, and the pages ahead of the read position are requested from the kernel as the
+/// stream advances, so that reads and borrows rarely fault on the audio or decoder thread.
+class MappedFileStream : public IOStream {
+ public:
+  MappedFileStream(const char* file, AssetDescriptor ad);
+  ~MappedFileStream() override;
+
+  size_t read(void* data, size_t numBytes) override;
+  size_t write(void* data, size_t numBytes) override;
+  size_t getPosition() override;
+  bool setPosition(int64_t pos) override;
+  bool setPosition(int64_t pos, int mode) override;
+  int32_t pushBackByte(int c) override;
+  size_t getSize() override;
+  bool canSeek() override;
+  bool ready() const override;
+  bool endOfStream() override;
+  int getFD() override;
+  const void* borrow(size_t numBytes, size_t& numBorrowed) override;
+
+  /// Bytes requested ahead of the read position
+  static const size_t kReadAheadBytes = 512 * 1024;
+
+ private:
+  /// Request the read-ahead window from the kernel once the position gets close to its end
+  void readAhead();
+
+  int fd_{-1};
+  void* mapping_{nullptr};
+  size_t mappingSize_{0};
+  const char* data_{nullptr}; // Start of the window, inside the page aligned mapping
+  size_t length_{0};
+  size_t position_{0};
+  size_t readAheadEnd_{0}; // End of the window last requested from the kernel
+};
+
+/// Open a file for reading, memory mapped where possible and through a FileStream otherwise
+/// @return New IOStream object or nullptr if the file could not be opened
+IOStream* createReadStream(const char* file, AssetDescriptor ad);
+} // namespace TBE
+
+#endif // FBA_MAPPEDFILESTREAM_H
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "MemoryStream.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace TBE {
+MemoryStream::MemoryStream(
+    const void* buffer,
+    size_t sizeInBytes,
+    std::shared_ptr<const void> owner)
+    : data_(static_cast<const char*>(buffer)),
+      size_(buffer ? sizeInBytes : 0),
+      owner_(std::move(owner)) {}
+
+size_t MemoryStream::read(void* data, size_t numBytes) {
+  if (!data_ || !data) {
+    return IOSTREAM_OPERATION_FAIL;
+  }
+
+  const size_t toRead = std::min(numBytes, size_ - position_);
+  std::memcpy(data, data_ + position_, toRead);
+  position_ += toRead;
+  return toRead;
+}
+
+size_t MemoryStream::write(void*, size_t) {
+  return 0;
+}
+
+size_t MemoryStream::getPosition() {
+  return data_ ? position_ : IOSTREAM_OPERATION_FAIL;
+}
+
+bool MemoryStream::setPosition(int64_t pos) {
+  return setPosition(pos, SEEK_SET);
+}
+
+bool MemoryStream::setPosition(int64_t pos, int mode) {
+  int64_t target = pos;
+  if (mode == SEEK_CUR) {
+    target = static_cast<int64_t>(position_) + pos;
+  } else if (mode == SEEK_END) {
+    target = static_cast<int64_t>(size_) + pos;
+  }
+
+  if (!data_ || target < 0 || target > static_cast<int64_t>(size_)) {
+    return false;
+  }
+
+  position_ = static_cast<size_t>(target);
+  return true;
+}
+
+int32_t MemoryStream::pushBackByte(int c) {
+  if (!data_ || position_ == 0 || c == EOF) {
+    return EOF;
+  }
+  position_--;
+  return c;
+}
+
+size_t MemoryStream::getSize() {
+  return data_ ? size_ : IOSTREAM_OPERATION_FAIL;
+}
+
+bool MemoryStream::canSeek() {
+  return data_ != nullptr;
+}
+
+bool MemoryStream::ready() const {
+  return data_ != nullptr;
+}
+
+bool MemoryStream::endOfStream() {
+  return position_ >= size_;
+}
+
+int MemoryStream::getFD() {
+  return -1;
+}
+
+const void* MemoryStream::borrow(size_t numBytes, size_t& numBorrowed) {
+  numBorrowed = 0;
+  if (!data_) {
+    return nullptr;
+  }
+
+  const char* source = data_ + position_;
+  numBorrowed = std::min(numBytes, size_ - position_);
+  position_ += numBorrowed;
+  return source;
+}
+
+IOStream* IOStream::createMemoryStream(void* buffer, size_t sizeInBytes, size_t offsetInBytes) {
+  if (!buffer || offsetInBytes > sizeInBytes) {
+    return nullptr;
+  }
+  return new MemoryStream(static_cast<char*>(buffer) + offsetInBytes, sizeInBytes - offsetInBytes);
+}
+} // namespace TBE
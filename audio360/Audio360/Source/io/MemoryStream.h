@@ -0,0 +1,42 @@
+#ifndef FBA_MEMORYSTREAM_H
+#define FBA_MEMORYSTREAM_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <memory>
+#include "TBE_IOStream.h"
+
+namespace TBE {
+/// Read-only stream over a block of memory. The memory is either borrowed from the caller or kept
+/// alive through a shared owner, which lets the asset manager unload an asset while streams created
+/// from it are still in use.
+class MemoryStream : public IOStream {
+ public:
+  MemoryStream(const void* buffer, size_t sizeInBytes, std::shared_ptr<const void> owner = nullptr);
+
+  size_t read(void* data, size_t numBytes) override;
+  size_t write(void* data, size_t numBytes) override;
+  size_t getPosition() override;
+  bool setPosition(int64_t pos) override;
+  bool setPosition(int64_t pos, int mode) override;
+  int32_t pushBackByte(int c) override;
+  size_t getSize() override;
+  bool canSeek() override;
+  bool ready() const override;
+  bool endOfStream() override;
+  int getFD() override;
+  const void* borrow(size_t numBytes, size_t& numBorrowed) override;
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t position_{0};
+  std::shared_ptr<const void> owner_;
+};
+} // namespace TBE
+
+#endif // FBA_MEMORYSTREAM_H
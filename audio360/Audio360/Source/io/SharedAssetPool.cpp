@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "SharedAssetPool.h"
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#define FBA_HAS_SHARED_ASSET_POOL 1
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace TBE {
+const size_t SharedAssetPool::kMaxNameLength;
+
+SharedAssetPool::SharedAssetPool(const char* name) : name_(name ? name : "") {}
+
+bool SharedAssetPool::isValidName(const char* name) {
+  if (!name || name[0] == '\0' || std::strlen(name) > kMaxNameLength) {
+    return false;
+  }
+  return std::strchr(name, '/') == nullptr;
+}
+
+#if FBA_HAS_SHARED_ASSET_POOL
+namespace {
+const uint32_t kMagic = 0x46424153; // Set once the audio is published
+
+/// Start of every shared memory object. Only changed while the object is flock()ed.
+struct SegmentHeader {
+  uint32_t magic;
+  uint32_t reserved;
+  uint64_t size; // Bytes of audio following the header
+  int64_t numMappings; // Across all processes
+};
+
+/// The audio starts 64 bytes in, which keeps it cache line aligned
+const size_t kHeaderSize = 64;
+static_assert(sizeof(SegmentHeader) <= kHeaderSize, "The header must fit before the audio");
+
+uint64_t hash(const std::string& key) {
+  // FNV-1a
+  uint64_t value = 14695981039346656037ull;
+  for (const char c : key) {
+    value = (value ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  }
+  return value;
+}
+
+void lock(int fd) {
+  while (flock(fd, LOCK_EX) != 0 && errno == EINTR) {
+  }
+}
+
+/// A process' mapping of a published asset
+class SharedSegment : public AssetBytes {
+ public:
+  SharedSegment(std::string name, void* mapping, size_t mappingSize, const struct stat& info)
+      : name_(std::move(name)),
+        mapping_(mapping),
+        mappingSize_(mappingSize),
+        device_(info.st_dev),
+        inode_(info.st_ino) {}
+
+  ~SharedSegment() override {
+    SegmentHeader* header = static_cast<SegmentHeader*>(mapping_);
+    const int fd = shm_open(name_.c_str(), O_RDWR | O_CLOEXEC, 0);
+    struct stat info;
+    if (fd >= 0 && fstat(fd, &info) == 0 && info.st_dev == device_ && info.st_ino == inode_) {
+      lock(fd);
+      if (--header->numMappings <= 0) {
+        shm_unlink(name_.c_str());
+      }
+      flock(fd, LOCK_UN);
+    } else {
+      // Already unlinked, nobody else can acquire this object any more
+      __atomic_sub_fetch(&header->numMappings, 1, __ATOMIC_ACQ_REL);
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+    munmap(mapping_, mappingSize_);
+  }
+
+  const char* data() const override {
+    return static_cast<const char*>(mapping_) + kHeaderSize;
+  }
+
+  size_t size() const override {
+    return static_cast<const SegmentHeader*>(mapping_)->size;
+  }
+
+ private:
+  const std::string name_;
+  void* const mapping_;
+  const size_t mappingSize_;
+  const dev_t device_;
+  const ino_t inode_;
+};
+} // namespace
+
+bool SharedAssetPool::isSupported() {
+  return true;
+}
+
+EngineError SharedAssetPool::acquire(
+    const char* path,
+    AssetDescriptor ad,
+    const Decode& decode,
+    std::shared_ptr<const AssetBytes>& bytes) const {
+  // Processes may open the same file through different paths, and the file may change between
+  // the runs of a process
+  char canonical[PATH_MAX];
+  struct stat file;
+  if (!path || !realpath(path, canonical) || stat(canonical, &file) != 0) {
+    return EngineError::ERROR_OPENING_FILE;
+  }
+  const std::string key = std::string(canonical) + '|' + std::to_string(ad.offsetInBytes) + '|' +
+      std::to_string(ad.lengthInBytes) + '|' + std::to_string(file.st_size) + '|' +
+      std::to_string(file.st_mtime);
+  char suffix[24];
+  std::snprintf(suffix, sizeof(suffix), ".%016llx", static_cast<unsigned long long>(hash(key)));
+  const std::string name = "/" + name_ + suffix;
+
+  for (;;) {
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+      return EngineError::MEMORY_MAP_FAIL;
+    }
+    lock(fd);
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      close(fd);
+      return EngineError::MEMORY_MAP_FAIL;
+    }
+    if (info.st_nlink == 0) {
+      // Unlinked by its last user while this process waited for the lock
+      close(fd);
+      continue;
+    }
+
+    // Left unpublished by a process that failed or crashed while decoding, if not empty
+    void* mapping = nullptr;
+    size_t mappingSize = static_cast<size_t>(info.st_size);
+    if (mappingSize >= kHeaderSize) {
+      mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (mapping == MAP_FAILED) {
+        close(fd);
+        return EngineError::MEMORY_MAP_FAIL;
+      }
+      if (static_cast<SegmentHeader*>(mapping)->magic != kMagic) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+      }
+    }
+
+    if (!mapping) {
+      std::vector<char> decoded;
+      EngineError error = decode(decoded);
+      mappingSize = kHeaderSize + decoded.size();
+      if (error == EngineError::OK && ftruncate(fd, static_cast<off_t>(mappingSize)) != 0) {
+        error = EngineError::MEMORY_MAP_FAIL;
+      }
+      if (error == EngineError::OK) {
+        mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+          mapping = nullptr;
+          error = EngineError::MEMORY_MAP_FAIL;
+        }
+      }
+      if (error != EngineError::OK) {
+        // Processes waiting for the lock retry with a new object
+        shm_unlink(name.c_str());
+        close(fd);
+        return error;
+      }
+
+      SegmentHeader* header = static_cast<SegmentHeader*>(mapping);
+      std::memcpy(static_cast<char*>(mapping) + kHeaderSize, decoded.data(), decoded.size());
+      header->size = decoded.size();
+      header->numMappings = 0;
+      header->magic = kMagic;
+    }
+
+    static_cast<SegmentHeader*>(mapping)->numMappings++;
+    flock(fd, LOCK_UN);
+    close(fd);
+    bytes = std::make_shared<SharedSegment>(name, mapping, mappingSize, info);
+    return EngineError::OK;
+  }
+}
+#else
+bool SharedAssetPool::isSupported() {
+  return false;
+}
+
+EngineError SharedAssetPool::acquire(
+    const char*,
+    AssetDescriptor,
+    const Decode&,
+    std::shared_ptr<const AssetBytes>&) const {
+  return EngineError::NOT_SUPPORTED;
+}
+#endif
+} // namespace TBE
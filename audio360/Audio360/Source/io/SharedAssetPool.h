@@ -0,0 +1,65 @@
+#ifndef FBA_SHAREDASSETPOOL_H
+#define FBA_SHAREDASSETPOOL_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "AssetBytes.h"
+#include "TBE_AudioEngineDefinitions.h"
+
+namespace TBE {
+/// Decoded assets published in POSIX shared memory, so that processes using the same pool name
+/// decode each asset once and map the same copy of it.
+///
+/// Each asset is a shared memory object named /<pool>.<hash>, hashed from the canonical path, the
+/// AssetDescriptor and the size and modification time of the file. The object starts with a header
+/// holding the size of the audio and the number of mappings across processes. The header is only
+/// changed with the object flock()ed, which also makes the processes that ask for an asset while
+/// it is being decoded wait for it. The last process to release an asset unlinks its object.
+/// Mappings of a process that crashes are never released, so its objects stay in /dev/shm until
+/// they are removed by hand.
+///
+/// Linux only, isSupported() is false elsewhere.
+class SharedAssetPool {
+ public:
+  /// Decodes an asset into a float WAV image
+  using Decode = std::function<EngineError(std::vector<char>& bytes)>;
+
+  /// @param name Pool name, at most kMaxNameLength characters and without '/'
+  explicit SharedAssetPool(const char* name);
+
+  /// Map the decoded image of an asset, decoding and publishing it if no process has yet. Safe to
+  /// call from any thread.
+  /// @param path Path of the asset file
+  /// @param ad Window of the file holding the asset
+  /// @param decode Called if this process publishes the asset
+  /// @param bytes Set to the mapping, which is released when the last reference to it is destroyed
+  /// @return The decode error, EngineError::ERROR_OPENING_FILE if the file doesn't exist, or
+  /// EngineError::MEMORY_MAP_FAIL if the shared memory object could not be created or mapped
+  EngineError acquire(
+      const char* path,
+      AssetDescriptor ad,
+      const Decode& decode,
+      std::shared_ptr<const AssetBytes>& bytes) const;
+
+  /// @return True if name can be used as a pool name
+  static bool isValidName(const char* name);
+
+  /// @return True if shared asset pools are supported on this platform
+  static bool isSupported();
+
+  static const size_t kMaxNameLength = 200;
+
+ private:
+  const std::string name_;
+};
+} // namespace TBE
+
+#endif // FBA_SHAREDASSETPOOL_H
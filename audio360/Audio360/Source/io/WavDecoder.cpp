@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "WavDecoder.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace TBE {
+static const uint16_t kWaveFormatPcm = 0x0001;
+static const uint16_t kWaveFormatIeeeFloat = 0x0003;
+static const uint16_t kWaveFormatExtensible = 0xFFFE;
+
+static inline uint16_t readLE16(const unsigned char* p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t readLE32(const unsigned char* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+      (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+WavDecoder::WavDecoder(
+    IOStream* stream,
+    bool ownsStream,
+    int maxBufferSizePerChannel,
+    float outputSampleRate)
+    : stream_(stream),
+      ownsStream_(ownsStream),
+      maxBufferSizePerChannel_(std::max(1, maxBufferSizePerChannel)),
+      outputSampleRate_(outputSampleRate) {
+  initError_ = parseHeader();
+  if (initError_ != EngineError::OK) {
+    return;
+  }
+
+  if (outputSampleRate_ <= 0.f) {
+    outputSampleRate_ = sampleRate_;
+  }
+
+  readBuffer_.resize(static_cast<size_t>(maxBufferSizePerChannel_) * bytesPerFrame_);
+  if (outputSampleRate_ != sampleRate_) {
+    resampler_.reset(new AudioResamplerImpl(
+        static_cast<unsigned>(numChannels_),
+        sampleRate_,
+        outputSampleRate_,
+        static_cast<size_t>(maxBufferSizePerChannel_),
+        AudioResampler::Quality::OPTIMAL));
+    resampleBuffer_.resize(static_cast<size_t>(maxBufferSizePerChannel_) * numChannels_);
+  }
+}
+
+WavDecoder::~WavDecoder() {
+  if (ownsStream_) {
+    delete stream_;
+  }
+}
+
+EngineError WavDecoder::getInitError() const {
+  return initError_;
+}
+
+EngineError WavDecoder::parseHeader() {
+  if (!stream_ || !stream_->ready() || !stream_->setPosition(0)) {
+    return EngineError::ERROR_OPENING_FILE;
+  }
+
+  unsigned char riff[12];
+  if (stream_->read(riff, sizeof(riff)) != sizeof(riff) || std::memcmp(riff, "RIFF", 4) != 0 ||
+      std::memcmp(riff + 8, "WAVE", 4) != 0) {
+    return EngineError::INVALID_HEADER;
+  }
+
+  bool foundFormat = false;
+  uint16_t formatTag = 0;
+  size_t position = sizeof(riff);
+  const size_t streamSize = stream_->getSize();
+
+  for (;;) {
+    unsigned char chunkHeader[8];
+    if (stream_->read(chunkHeader, sizeof(chunkHeader)) != sizeof(chunkHeader)) {
+      return EngineError::INVALID_HEADER;
+    }
+    position += sizeof(chunkHeader);
+    const uint32_t chunkSize = readLE32(chunkHeader + 4);
+
+    if (std::memcmp(chunkHeader, "fmt ", 4) == 0) {
+      unsigned char fmt[40] = {0};
+      const size_t toRead = std::min<size_t>(chunkSize, sizeof(fmt));
+      if (chunkSize < 16 || stream_->read(fmt, toRead) != toRead) {
+        return EngineError::INVALID_HEADER;
+      }
+      formatTag = readLE16(fmt);
+      numChannels_ = readLE16(fmt + 2);
+      sampleRate_ = static_cast<float>(readLE32(fmt + 4));
+      bytesPerFrame_ = readLE16(fmt + 12);
+      numBits_ = readLE16(fmt + 14);
+      if (formatTag == kWaveFormatExtensible && chunkSize >= 40) {
+        // The first two bytes of the sub-format GUID hold the actual format tag
+        formatTag = readLE16(fmt + 24);
+      }
+      foundFormat = true;
+    } else if (std::memcmp(chunkHeader, "data", 4) == 0) {
+      if (!foundFormat) {
+        return EngineError::INVALID_HEADER;
+      }
+      dataOffset_ = position;
+      size_t dataSize = chunkSize;
+      // Streaming writers leave the size at 0 or 0xFFFFFFFF, fall back to the stream size
+      if ((dataSize == 0 || dataSize == 0xFFFFFFFF) && streamSize != IOSTREAM_OPERATION_FAIL) {
+        dataSize = streamSize - dataOffset_;
+      } else if (streamSize != IOSTREAM_OPERATION_FAIL) {
+        dataSize = std::min(dataSize, streamSize - dataOffset_);
+      }
+      if (bytesPerFrame_ == 0) {
+        return EngineError::INVALID_HEADER;
+      }
+      numFrames_ = dataSize / bytesPerFrame_;
+      break;
+    }
+
+    // Chunks are padded to an even number of bytes
+    const size_t skip = chunkSize + (chunkSize & 1);
+    if (std::memcmp(chunkHeader, "fmt ", 4) == 0) {
+      const size_t consumed = std::min<size_t>(chunkSize, 40);
+      if (!stream_->setPosition(static_cast<int64_t>(skip - consumed), SEEK_CUR)) {
+        return EngineError::INVALID_HEADER;
+      }
+    } else if (!stream_->setPosition(static_cast<int64_t>(skip), SEEK_CUR)) {
+      return EngineError::INVALID_HEADER;
+    }
+    position += skip;
+  }
+
+  if (numChannels_ <= 0) {
+    return EngineError::INVALID_CHANNEL_COUNT;
+  }
+  if (sampleRate_ <= 0.f) {
+    return EngineError::INVALID_SAMPLE_RATE;
+  }
+
+  if (formatTag == kWaveFormatPcm) {
+    switch (numBits_) {
+      case 8:
+        format_ = SampleFormat::INT8;
+        break;
+      case 16:
+        format_ = SampleFormat::INT16;
+        break;
+      case 24:
+        format_ = SampleFormat::INT24;
+        break;
+      case 32:
+        format_ = SampleFormat::INT32;
+        break;
+      default:
+        return EngineError::NOT_SUPPORTED;
+    }
+  } else if (formatTag == kWaveFormatIeeeFloat) {
+    if (numBits_ == 32) {
+      format_ = SampleFormat::FLOAT32;
+    } else if (numBits_ == 64) {
+      format_ = SampleFormat::FLOAT64;
+    } else {
+      return EngineError::NOT_SUPPORTED;
+    }
+  } else {
+    return EngineError::NOT_SUPPORTED;
+  }
+
+  if (bytesPerFrame_ != static_cast<size_t>(numChannels_ * numBits_ / 8)) {
+    return EngineError::INVALID_HEADER;
+  }
+  return EngineError::OK;
+}
+
+size_t WavDecoder::readFrames(float* out, size_t numFrames) {
+  numFrames = std::min(numFrames, numFrames_ - framePosition_);
+  numFrames = std::min(numFrames, static_cast<size_t>(maxBufferSizePerChannel_));
+  if (numFrames == 0) {
+    return 0;
+  }
+
+  // Streams backed by memory hand out the PCM in place, anything else is read into readBuffer_
+  const size_t numBytes = numFrames * bytesPerFrame_;
+  size_t bytesRead = 0;
+  const void* pcm = stream_->borrow(numBytes, bytesRead);
+  if (!pcm) {
+    pcm = readBuffer_.data();
+    bytesRead = stream_->read(readBuffer_.data(), numBytes);
+  }
+  if (bytesRead == IOSTREAM_OPERATION_FAIL) {
+    error_ = true;
+    return 0;
+  }
+
+  const size_t framesRead = bytesRead / bytesPerFrame_;
+  const size_t numSamples = framesRead * numChannels_;
+  const unsigned char* in = static_cast<const unsigned char*>(pcm);
+
+  switch (format_) {
+    case SampleFormat::INT8:
+      for (size_t i = 0; i < numSamples; ++i) {
+        out[i] = (static_cast<float>(in[i]) - 128.f) * (1.f / 128.f);
+      }
+      break;
+    case SampleFormat::INT16:
+      for (size_t i = 0; i < numSamples; ++i, in += 2) {
+        out[i] = static_cast<float>(static_cast<int16_t>(readLE16(in))) * (1.f / 32768.f);
+      }
+      break;
+    case SampleFormat::INT24:
+      for (size_t i = 0; i < numSamples; ++i, in += 3) {
+        const int32_t value = static_cast<int32_t>(
+                                  (static_cast<uint32_t>(in[0]) << 8) |
+                                  (static_cast<uint32_t>(in[1]) << 16) |
+                                  (static_cast<uint32_t>(in[2]) << 24)) >>
+            8;
+        out[i] = static_cast<float>(value) * (1.f / 8388608.f);
+      }
+      break;
+    case SampleFormat::INT32:
+      for (size_t i = 0; i < numSamples; ++i, in += 4) {
+        out[i] = static_cast<float>(static_cast<int32_t>(readLE32(in))) * (1.f / 2147483648.f);
+      }
+      break;
+    case SampleFormat::FLOAT32:
+      std::memcpy(out, in, numSamples * sizeof(float));
+      break;
+    case SampleFormat::FLOAT64:
+      for (size_t i = 0; i < numSamples; ++i, in += 8) {
+        double value;
+        std::memcpy(&value, in, sizeof(double));
+        out[i] = static_cast<float>(value);
+      }
+      break;
+  }
+
+  framePosition_ += framesRead;
+  if (framesRead < numFrames) {
+    // The data chunk is shorter than the header claims
+    numFrames_ = framePosition_;
+  }
+  return framesRead;
+}
+
+int32_t WavDecoder::getNumOfChannels() const {
+  return numChannels_;
+}
+
+size_t WavDecoder::getNumTotalSamples() const {
+  return getNumSamplesPerChannel() * static_cast<size_t>(numChannels_);
+}
+
+size_t WavDecoder::getNumSamplesPerChannel() const {
+  if (!resampler_) {
+    return numFrames_;
+  }
+  return static_cast<size_t>(
+      static_cast<double>(numFrames_) * outputSampleRate_ / static_cast<double>(sampleRate_));
+}
+
+double WavDecoder::getMsPerChannel() const {
+  return sampleRate_ > 0.f ? static_cast<double>(numFrames_) * 1000.0 / sampleRate_ : 0.0;
+}
+
+size_t WavDecoder::getSamplePosition() {
+  return outputPosition_;
+}
+
+EngineError WavDecoder::seekToSample(size_t samplePosition) {
+  if (initError_ != EngineError::OK) {
+    return initError_;
+  }
+
+  size_t frame = samplePosition;
+  if (resampler_) {
+    frame = static_cast<size_t>(
+        static_cast<double>(samplePosition) * sampleRate_ / static_cast<double>(outputSampleRate_));
+  }
+  frame = std::min(frame, numFrames_);
+
+  if (!stream_->setPosition(static_cast<int64_t>(dataOffset_ + frame * bytesPerFrame_))) {
+    error_ = true;
+    return EngineError::FAIL;
+  }
+
+  framePosition_ = frame;
+  outputPosition_ = std::min(samplePosition, getNumSamplesPerChannel());
+  if (resampler_) {
+    resampler_->reset();
+  }
+  return EngineError::OK;
+}
+
+size_t WavDecoder::decode(const char*, size_t, float*, int32_t) {
+  // WAV data is read from the stream owned by the decoder, there are no packets to decode
+  return 0;
+}
+
+size_t WavDecoder::decode(float* bufferOut, int32_t numOfSamplesInBuffer) {
+  if (initError_ != EngineError::OK || !bufferOut || numOfSamplesInBuffer <= 0) {
+    return 0;
+  }
+
+  const size_t requestedFrames = std::min<size_t>(
+      static_cast<size_t>(numOfSamplesInBuffer) / numChannels_,
+      static_cast<size_t>(maxBufferSizePerChannel_));
+
+  if (!resampler_) {
+    const size_t frames = readFrames(bufferOut, requestedFrames);
+    outputPosition_ += frames;
+    return frames * numChannels_;
+  }
+
+  size_t producedFrames = 0;
+  while (producedFrames < requestedFrames) {
+    // Drain whatever the resampler can already produce before reading more input
+    float* out = bufferOut + producedFrames * numChannels_;
+    const size_t remaining = requestedFrames - producedFrames;
+    const bool inputFinished = framePosition_ >= numFrames_;
+    size_t inputFrames = 0;
+
+    if (!inputFinished) {
+      const double ratio = resampler_->getRatio();
+      const size_t needed = static_cast<size_t>(static_cast<double>(remaining) / ratio) + 1;
+      inputFrames = readFrames(resampleBuffer_.data(), needed);
+      if (error_) {
+        break;
+      }
+    }
+
+    const size_t produced = resampler_->process(
+        resampleBuffer_.data(),
+        inputFrames * numChannels_,
+        out,
+        remaining * numChannels_,
+        framePosition_ >= numFrames_);
+    producedFrames += produced / numChannels_;
+
+    if (produced == 0 && inputFrames == 0) {
+      break;
+    }
+  }
+
+  // Never report more output than the nominal length of the stream
+  const size_t total = getNumSamplesPerChannel();
+  producedFrames = std::min(producedFrames, total - std::min(total, outputPosition_));
+  outputPosition_ += producedFrames;
+  return producedFrames * numChannels_;
+}
+
+float WavDecoder::getSampleRate() const {
+  return sampleRate_;
+}
+
+float WavDecoder::getOutputSampleRate() const {
+  return outputSampleRate_;
+}
+
+int32_t WavDecoder::getNumBits() const {
+  return numBits_;
+}
+
+bool WavDecoder::endOfStream() {
+  return initError_ == EngineError::OK && outputPosition_ >= getNumSamplesPerChannel();
+}
+
+bool WavDecoder::decoderError() {
+  return initError_ != EngineError::OK || error_;
+}
+
+int32_t WavDecoder::getMaxBufferSizePerChannel() const {
+  return maxBufferSizePerChannel_;
+}
+
+const char* WavDecoder::getName() const {
+  return "wav";
+}
+
+void WavDecoder::flush(bool resetToZero) {
+  if (resampler_) {
+    resampler_->reset();
+  }
+  if (resetToZero) {
+    seekToSample(0);
+  }
+}
+
+int32_t WavDecoder::getInfo(Info info) {
+  switch (info) {
+    case Info::PRE_SKIP:
+      return 0;
+  }
+  return 0;
+}
+
+ChannelMap WavDecoder::getChannelMap() const {
+  // WAV files carry no ambisonic layout metadata
+  return ChannelMap::INVALID;
+}
+} // namespace TBE
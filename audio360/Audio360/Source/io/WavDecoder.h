@@ -0,0 +1,84 @@
+#ifndef FBA_WAVDECODER_H
+#define FBA_WAVDECODER_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "TBE_AudioFormatDecoder.h"
+#include "dsp/AudioResamplerImpl.h"
+
+namespace TBE {
+/// Decoder for RIFF/WAVE streams: 8, 16, 24 and 32 bit integer PCM and 32/64 bit IEEE float,
+/// including WAVE_FORMAT_EXTENSIBLE and broadcast WAV files. Decoded audio is resampled to the
+/// output sample rate when it differs from the rate of the file.
+class WavDecoder : public AudioFormatDecoder {
+ public:
+  /// @param stream Stream positioned anywhere; the header is parsed from the start of the stream
+  /// @param ownsStream If the decoder must delete the stream on destruction
+  /// @param maxBufferSizePerChannel Largest number of frames requested in a single decode() call
+  /// @param outputSampleRate Target sample rate, or 0 to use the rate of the file
+  WavDecoder(
+      IOStream* stream,
+      bool ownsStream,
+      int maxBufferSizePerChannel,
+      float outputSampleRate);
+  ~WavDecoder() override;
+
+  /// @return EngineError::OK if the stream contains a supported WAV file
+  EngineError getInitError() const;
+
+  int32_t getNumOfChannels() const override;
+  size_t getNumTotalSamples() const override;
+  size_t getNumSamplesPerChannel() const override;
+  double getMsPerChannel() const override;
+  size_t getSamplePosition() override;
+  EngineError seekToSample(size_t samplePosition) override;
+  size_t decode(const char* data, size_t dataSize, float* bufferOut, int32_t numOfSamplesInBuffer)
+      override;
+  size_t decode(float* bufferOut, int32_t numOfSamplesInBuffer) override;
+  float getSampleRate() const override;
+  float getOutputSampleRate() const override;
+  int32_t getNumBits() const override;
+  bool endOfStream() override;
+  bool decoderError() override;
+  int32_t getMaxBufferSizePerChannel() const override;
+  const char* getName() const override;
+  void flush(bool resetToZero = false) override;
+  int32_t getInfo(Info info) override;
+  ChannelMap getChannelMap() const override;
+
+ private:
+  enum class SampleFormat { INT8, INT16, INT24, INT32, FLOAT32, FLOAT64 };
+
+  EngineError parseHeader();
+  size_t readFrames(float* out, size_t numFrames);
+
+  IOStream* stream_;
+  const bool ownsStream_;
+  const int32_t maxBufferSizePerChannel_;
+  EngineError initError_{EngineError::OK};
+
+  SampleFormat format_{SampleFormat::INT16};
+  int32_t numChannels_{0};
+  int32_t numBits_{0};
+  size_t bytesPerFrame_{0};
+  float sampleRate_{0.f};
+  float outputSampleRate_{0.f};
+  size_t dataOffset_{0};
+  size_t numFrames_{0}; // In the file's sample rate
+  size_t framePosition_{0}; // Next frame to read, in the file's sample rate
+  size_t outputPosition_{0}; // Frames decoded, in the output sample rate
+  bool error_{false};
+
+  std::vector<char> readBuffer_;
+  std::vector<float> resampleBuffer_;
+  std::unique_ptr<AudioResamplerImpl> resampler_;
+};
+} // namespace TBE
+
+#endif // FBA_WAVDECODER_H
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "WavEncoder.h"
+#include <cstring>
+
+namespace TBE {
+const size_t WavEncoder::kHeaderSize;
+static const uint16_t kWaveFormatIeeeFloat = 0x0003;
+
+static inline void writeLE16(unsigned char* p, uint16_t value) {
+  p[0] = static_cast<unsigned char>(value & 0xFF);
+  p[1] = static_cast<unsigned char>((value >> 8) & 0xFF);
+}
+
+static inline void writeLE32(unsigned char* p, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    p[i] = static_cast<unsigned char>((value >> (8 * i)) & 0xFF);
+  }
+}
+
+WavEncoder::WavEncoder(
+    IOStream* outputStream,
+    float inputSampleRate,
+    float outputSampleRate,
+    size_t maxBufferSize,
+    int numChannels)
+    : stream_(outputStream),
+      outputSampleRate_(outputSampleRate > 0.f ? outputSampleRate : inputSampleRate),
+      maxBufferSize_(maxBufferSize),
+      numChannels_(numChannels) {
+  if (outputSampleRate_ != inputSampleRate) {
+    resampler_.reset(new AudioResamplerImpl(
+        static_cast<unsigned>(numChannels_),
+        inputSampleRate,
+        outputSampleRate_,
+        maxBufferSize_,
+        AudioResampler::Quality::OPTIMAL));
+    const double ratio = static_cast<double>(outputSampleRate_) / inputSampleRate;
+    resampleBuffer_.resize(
+        (static_cast<size_t>(maxBufferSize_ * ratio) + 32) * static_cast<size_t>(numChannels_));
+  }
+}
+
+void WavEncoder::makeFloatHeader(
+    unsigned char* header,
+    int numChannels,
+    float sampleRate,
+    uint32_t dataSizeInBytes) {
+  const uint16_t bitsPerSample = 32;
+  const uint16_t blockAlign = static_cast<uint16_t>(numChannels * bitsPerSample / 8);
+  const uint32_t rate = static_cast<uint32_t>(sampleRate);
+  const uint32_t riffSize = dataSizeInBytes == 0xFFFFFFFF
+      ? 0xFFFFFFFF
+      : dataSizeInBytes + static_cast<uint32_t>(kHeaderSize) - 8;
+
+  std::memcpy(header, "RIFF", 4);
+  writeLE32(header + 4, riffSize);
+  std::memcpy(header + 8, "WAVE", 4);
+  std::memcpy(header + 12, "fmt ", 4);
+  writeLE32(header + 16, 16);
+  writeLE16(header + 20, kWaveFormatIeeeFloat);
+  writeLE16(header + 22, static_cast<uint16_t>(numChannels));
+  writeLE32(header + 24, rate);
+  writeLE32(header + 28, rate * blockAlign);
+  writeLE16(header + 32, blockAlign);
+  writeLE16(header + 34, bitsPerSample);
+  std::memcpy(header + 36, "data", 4);
+  writeLE32(header + 40, dataSizeInBytes);
+}
+
+bool WavEncoder::writeHeader(uint32_t dataSizeInBytes) {
+  unsigned char header[kHeaderSize];
+  makeFloatHeader(header, numChannels_, outputSampleRate_, dataSizeInBytes);
+  return stream_->write(header, kHeaderSize) == kHeaderSize;
+}
+
+bool WavEncoder::writeSamples(const float* samples, size_t numSamples) {
+  if (numSamples == 0) {
+    return true;
+  }
+  const size_t numBytes = numSamples * sizeof(float);
+  const size_t written = stream_->write(const_cast<float*>(samples), numBytes);
+  if (written == IOSTREAM_OPERATION_FAIL) {
+    return false;
+  }
+  dataBytesWritten_ += written;
+  return written == numBytes;
+}
+
+size_t
+WavEncoder::encode(const float* inputInterleavedAudio, size_t totalNumSamples, bool endOfStream) {
+  if (!stream_ || finished_) {
+    return 0;
+  }
+
+  if (!headerWritten_) {
+    headerPosition_ = stream_->getPosition();
+    if (!writeHeader(0xFFFFFFFF)) {
+      return 0;
+    }
+    headerWritten_ = true;
+  }
+
+  if (!inputInterleavedAudio) {
+    totalNumSamples = 0;
+  }
+
+  if (!resampler_) {
+    if (!writeSamples(inputInterleavedAudio, totalNumSamples)) {
+      return 0;
+    }
+  } else {
+    // The resampler keeps any input it cannot convert yet, so the input is only fed once and the
+    // remainder is drained until nothing more can be produced
+    const float* input = inputInterleavedAudio;
+    size_t inputSamples = totalNumSamples;
+    for (;;) {
+      const size_t produced = resampler_->process(
+          input, inputSamples, resampleBuffer_.data(), resampleBuffer_.size(), endOfStream);
+      input = nullptr;
+      inputSamples = 0;
+      if (produced == 0) {
+        break;
+      }
+      if (!writeSamples(resampleBuffer_.data(), produced)) {
+        return 0;
+      }
+    }
+  }
+
+  if (endOfStream) {
+    finished_ = true;
+    // Patch the chunk sizes now that the length is known
+    if (stream_->canSeek()) {
+      const size_t endPosition = stream_->getPosition();
+      if (stream_->setPosition(static_cast<int64_t>(headerPosition_))) {
+        writeHeader(static_cast<uint32_t>(dataBytesWritten_));
+        stream_->setPosition(static_cast<int64_t>(endPosition));
+      }
+    }
+  }
+  return totalNumSamples;
+}
+
+AudioFormat WavEncoder::getAudioFormat() const {
+  return AudioFormat::WAV;
+}
+
+EngineError WavEncoder::getQualityIndex(int& qualityIndex) {
+  qualityIndex = 0;
+  return EngineError::NOT_SUPPORTED;
+}
+
+EngineError WavEncoder::getBitRate(int& bitRate) {
+  bitRate = static_cast<int>(outputSampleRate_) * numChannels_ * 32;
+  return EngineError::OK;
+}
+
+float WavEncoder::getOutputSampleRate() const {
+  return outputSampleRate_;
+}
+
+int WavEncoder::getNumOfChannels() {
+  return numChannels_;
+}
+
+size_t WavEncoder::getMaxBufferSize() const {
+  return maxBufferSize_;
+}
+
+EngineError AudioFormatEncoder::getBitRateForQualityIndex(AudioFormat, int, int& bitRate) {
+  // Quality indices only apply to Opus, which is not part of the open implementation
+  bitRate = 0;
+  return EngineError::NOT_SUPPORTED;
+}
+
+EngineError
+AudioFormatEncoder::getIndexForQuality(AudioFormat, AudioFormatQuality, int& qualityIndex) {
+  qualityIndex = 0;
+  return EngineError::NOT_SUPPORTED;
+}
+} // namespace TBE
+
+TBE::EngineError TBE_CreateAudioFormatEncoder(
+    TBE::AudioFormatEncoder*& encoder,
+    TBE::IOStream* outputStream,
+    TBE::AudioFormat format,
+    float inputSampleRate,
+    float outputSampleRate,
+    size_t maxBufferSize,
+    int numChannels,
+    TBE::AudioFormatQuality) {
+  return TBE_CreateAudioFormatEncoderWithIndex(
+      encoder,
+      outputStream,
+      format,
+      inputSampleRate,
+      outputSampleRate,
+      maxBufferSize,
+      numChannels,
+      10);
+}
+
+TBE::EngineError TBE_CreateAudioFormatEncoderWithIndex(
+    TBE::AudioFormatEncoder*& encoder,
+    TBE::IOStream* outputStream,
+    TBE::AudioFormat format,
+    float inputSampleRate,
+    float outputSampleRate,
+    size_t maxBufferSize,
+    int numChannels,
+    int) {
+  if (encoder || !outputStream || !outputStream->ready() || maxBufferSize == 0) {
+    return TBE::EngineError::INVALID_PARAM;
+  }
+  if (numChannels <= 0) {
+    return TBE::EngineError::INVALID_CHANNEL_COUNT;
+  }
+  if (inputSampleRate <= 0.f) {
+    return TBE::EngineError::INVALID_SAMPLE_RATE;
+  }
+  if (format != TBE::AudioFormat::WAV) {
+    return TBE::EngineError::NOT_SUPPORTED;
+  }
+
+  encoder = new TBE::WavEncoder(
+      outputStream, inputSampleRate, outputSampleRate, maxBufferSize, numChannels);
+  return TBE::EngineError::OK;
+}
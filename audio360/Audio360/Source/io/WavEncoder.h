@@ -0,0 +1,65 @@
+#ifndef FBA_WAVENCODER_H
+#define FBA_WAVENCODER_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "TBE_AudioFormat.h"
+#include "dsp/AudioResamplerImpl.h"
+
+namespace TBE {
+/// Writes 32 bit IEEE float WAV files. The RIFF and data chunk sizes are written as 0xFFFFFFFF when
+/// the header is first written and patched once the end of the stream is reached, if the stream can
+/// seek.
+class WavEncoder : public AudioFormatEncoder {
+ public:
+  WavEncoder(
+      IOStream* outputStream,
+      float inputSampleRate,
+      float outputSampleRate,
+      size_t maxBufferSize,
+      int numChannels);
+
+  size_t encode(const float* inputInterleavedAudio, size_t totalNumSamples, bool endOfStream)
+      override;
+  AudioFormat getAudioFormat() const override;
+  EngineError getQualityIndex(int& qualityIndex) override;
+  EngineError getBitRate(int& bitRate) override;
+  float getOutputSampleRate() const override;
+  int getNumOfChannels() override;
+  size_t getMaxBufferSize() const override;
+
+  /// Size of the header written by makeFloatHeader
+  static const size_t kHeaderSize = 44;
+
+  /// Fill in the header of a 32 bit IEEE float WAV file
+  /// @param header Buffer of at least kHeaderSize bytes
+  /// @param numChannels Number of interleaved channels
+  /// @param sampleRate Sample rate in Hz
+  /// @param dataSizeInBytes Size of the data chunk, or 0xFFFFFFFF if unknown
+  static void
+  makeFloatHeader(unsigned char* header, int numChannels, float sampleRate, uint32_t dataBytes);
+
+ private:
+  bool writeHeader(uint32_t dataSizeInBytes);
+  bool writeSamples(const float* samples, size_t numSamples);
+
+  IOStream* stream_;
+  const float outputSampleRate_;
+  const size_t maxBufferSize_;
+  const int numChannels_;
+  size_t headerPosition_{0};
+  size_t dataBytesWritten_{0};
+  bool headerWritten_{false};
+  bool finished_{false};
+  std::vector<float> resampleBuffer_;
+  std::unique_ptr<AudioResamplerImpl> resampler_;
+};
+} // namespace TBE
+
+#endif // FBA_WAVENCODER_H
@@ -0,0 +1,86 @@
+#ifndef FBA_ATOMICTRANSFORM_H
+#define FBA_ATOMICTRANSFORM_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include "TBE_Quat.hh"
+#include "TBE_Vector.hh"
+
+namespace TBE {
+/// A TBVector that can be written by a control thread and read by the audio thread. Components are
+/// individually atomic; a reader can observe a partially updated vector for one block, which is
+/// inaudible for positional data and avoids any locking on the audio thread.
+class AtomicVector {
+ public:
+  AtomicVector() {}
+
+  explicit AtomicVector(TBVector value) {
+    store(value);
+  }
+
+  void store(TBVector value) {
+    x_.store(value.x, std::memory_order_relaxed);
+    y_.store(value.y, std::memory_order_relaxed);
+    z_.store(value.z, std::memory_order_relaxed);
+  }
+
+  TBVector load() const {
+    return TBVector(
+        x_.load(std::memory_order_relaxed),
+        y_.load(std::memory_order_relaxed),
+        z_.load(std::memory_order_relaxed));
+  }
+
+ private:
+  std::atomic<float> x_{0.f};
+  std::atomic<float> y_{0.f};
+  std::atomic<float> z_{0.f};
+};
+
+/// A TBQuat that can be written by a control thread and read by the audio thread. The value is
+/// renormalised on load so that a torn read still yields a valid rotation.
+class AtomicQuat {
+ public:
+  AtomicQuat() {}
+
+  explicit AtomicQuat(TBQuat value) {
+    store(value);
+  }
+
+  void store(TBQuat value) {
+    x_.store(value.x, std::memory_order_relaxed);
+    y_.store(value.y, std::memory_order_relaxed);
+    z_.store(value.z, std::memory_order_relaxed);
+    w_.store(value.w, std::memory_order_relaxed);
+  }
+
+  TBQuat load() const {
+    TBQuat q(
+        x_.load(std::memory_order_relaxed),
+        y_.load(std::memory_order_relaxed),
+        z_.load(std::memory_order_relaxed),
+        w_.load(std::memory_order_relaxed));
+    const float norm = q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w;
+    if (norm < TBE_SMALL_NUMBER) {
+      return TBQuat::identity();
+    }
+    if (std::abs(norm - 1.f) > 1.e-4f) {
+      q.normalise();
+    }
+    return q;
+  }
+
+ private:
+  std::atomic<float> x_{0.f};
+  std::atomic<float> y_{0.f};
+  std::atomic<float> z_{0.f};
+  std::atomic<float> w_{1.f};
+};
+} // namespace TBE
+
+#endif // FBA_ATOMICTRANSFORM_H
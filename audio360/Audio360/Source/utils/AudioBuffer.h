@@ -0,0 +1,79 @@
+#ifndef FBA_AUDIOBUFFER_H
+#define FBA_AUDIOBUFFER_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace TBE {
+/// Planar (deinterleaved) multichannel float buffer. Every channel starts on a 64 byte boundary so
+/// that SIMD kernels can use aligned loads. Memory is only allocated in resize(), never while
+/// processing.
+class AudioBuffer {
+ public:
+  static const size_t kAlignmentFloats = 16;
+
+  AudioBuffer() {}
+
+  AudioBuffer(size_t numChannels, size_t numFrames) {
+    resize(numChannels, numFrames);
+  }
+
+  /// Allocate storage for the given number of channels and frames. All samples are cleared.
+  void resize(size_t numChannels, size_t numFrames) {
+    numChannels_ = numChannels;
+    numFrames_ = numFrames;
+    stride_ = (numFrames + kAlignmentFloats - 1) / kAlignmentFloats * kAlignmentFloats;
+    storage_.assign(stride_ * numChannels + kAlignmentFloats, 0.f);
+    const auto address = reinterpret_cast<uintptr_t>(storage_.data());
+    const auto alignBytes = kAlignmentFloats * sizeof(float);
+    offset_ = ((alignBytes - (address % alignBytes)) % alignBytes) / sizeof(float);
+  }
+
+  /// Set all samples in all channels to zero
+  void clear() {
+    if (numChannels_ > 0) {
+      std::memset(getChannel(0), 0, stride_ * numChannels_ * sizeof(float));
+    }
+  }
+
+  /// Set the first numFrames samples of the first numChannels channels to zero
+  void clear(size_t numChannels, size_t numFrames) {
+    for (size_t ch = 0; ch < numChannels && ch < numChannels_; ++ch) {
+      std::memset(getChannel(ch), 0, numFrames * sizeof(float));
+    }
+  }
+
+  inline float* getChannel(size_t channel) {
+    return storage_.data() + offset_ + channel * stride_;
+  }
+
+  inline const float* getChannel(size_t channel) const {
+    return storage_.data() + offset_ + channel * stride_;
+  }
+
+  inline size_t getNumChannels() const {
+    return numChannels_;
+  }
+
+  inline size_t getNumFrames() const {
+    return numFrames_;
+  }
+
+ private:
+  std::vector<float> storage_;
+  size_t numChannels_{0};
+  size_t numFrames_{0};
+  size_t stride_{0};
+  size_t offset_{0};
+};
+} // namespace TBE
+
+#endif // FBA_AUDIOBUFFER_H
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "FreeSpaceSignal.h"
+#include <chrono>
+#include <thread>
+#include "Futex.h"
+
+#if FBA_HAS_FUTEX
+#include <sys/eventfd.h>
+#endif
+
+namespace TBE {
+FreeSpaceSignal::~FreeSpaceSignal() {
+#if FBA_HAS_FUTEX
+  const int fd = eventFd_.load();
+  if (fd >= 0) {
+    close(fd);
+  }
+#endif
+}
+
+bool FreeSpaceSignal::arm(const SampleRingBuffer& ring, size_t numSamples) {
+  size_t current = threshold_.load();
+  while ((current == 0 || numSamples < current) &&
+         !threshold_.compare_exchange_weak(current, numSamples)) {
+  }
+  // Pairs with the fence in notify(): either the consumer sees the armed threshold, or this
+  // thread sees the space it freed
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return ring.getFreeSpace() >= numSamples;
+}
+
+bool FreeSpaceSignal::wait(const SampleRingBuffer& ring, size_t numSamples, int32_t timeoutMs) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+  for (;;) {
+    // Read before arming, so that firing in between makes the futex wait return immediately
+    const uint32_t sequence = sequence_.load(std::memory_order_acquire);
+    if (arm(ring, numSamples)) {
+      return true;
+    }
+    int32_t remainingMs = -1;
+    if (timeoutMs >= 0) {
+      const auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+          deadline - std::chrono::steady_clock::now());
+      if (remaining.count() <= 0) {
+        return false;
+      }
+      remainingMs = static_cast<int32_t>((remaining.count() + 999) / 1000);
+    }
+#if FBA_HAS_FUTEX
+    Futex::wait(sequence_, sequence, remainingMs);
+#else
+    (void)sequence;
+    (void)remainingMs;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+  }
+}
+
+void FreeSpaceSignal::notify(const SampleRingBuffer& ring) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  size_t threshold = threshold_.load(std::memory_order_relaxed);
+  if (threshold == 0 || ring.getFreeSpace() < threshold) {
+    return;
+  }
+  // A producer that armed a smaller amount in the meantime is handled on the next call
+  if (!threshold_.compare_exchange_strong(threshold, 0, std::memory_order_relaxed)) {
+    return;
+  }
+  sequence_.fetch_add(1, std::memory_order_release);
+#if FBA_HAS_FUTEX
+  Futex::wakeAll(sequence_);
+  const int fd = eventFd_.load(std::memory_order_acquire);
+  if (fd >= 0) {
+    const uint64_t one = 1;
+    ssize_t result = write(fd, &one, sizeof(one));
+    (void)result; // Only fails if the counter is saturated, in which case it is readable anyway
+  }
+#endif
+}
+
+int FreeSpaceSignal::getEventFD() {
+#if FBA_HAS_FUTEX
+  std::lock_guard<std::mutex> lock(eventFdMutex_);
+  if (eventFd_.load() < 0) {
+    eventFd_.store(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), std::memory_order_release);
+  }
+  return eventFd_.load();
+#else
+  return -1;
+#endif
+}
+} // namespace TBE
@@ -0,0 +1,57 @@
+#ifndef FBA_FREESPACESIGNAL_H
+#define FBA_FREESPACESIGNAL_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "SampleRingBuffer.h"
+
+namespace TBE {
+/// Lets producers sleep until the consumer of a SampleRingBuffer has freed enough space.
+///
+/// A producer arms the signal with the free space it needs. After reading, the consumer calls
+/// notify(), which costs one relaxed load while the signal is unarmed. Once the free space reaches
+/// the smallest armed amount, the signal disarms itself, wakes the waiting producers through a
+/// futex and makes the event fd readable, if one was created. The consumer never blocks.
+///
+/// On platforms without futexes, wait() polls every millisecond and there is no event fd.
+class FreeSpaceSignal {
+ public:
+  FreeSpaceSignal() {}
+  ~FreeSpaceSignal();
+
+  FreeSpaceSignal(const FreeSpaceSignal&) = delete;
+  FreeSpaceSignal& operator=(const FreeSpaceSignal&) = delete;
+
+  /// Producer: arm the signal unless ring already has numSamples samples of free space
+  /// @return True if the space is already free
+  bool arm(const SampleRingBuffer& ring, size_t numSamples);
+
+  /// Producer: wait until ring has numSamples samples of free space
+  /// @param timeoutMs Negative to wait forever, 0 to only arm the signal
+  /// @return True if the space is free, false on timeout
+  bool wait(const SampleRingBuffer& ring, size_t numSamples, int32_t timeoutMs);
+
+  /// Consumer: fire the signal if it is armed and enough space has been freed
+  void notify(const SampleRingBuffer& ring);
+
+  /// Non-blocking eventfd, readable once the signal fires. Created on the first call.
+  /// @return The file descriptor, or -1 if event fds are not supported
+  int getEventFD();
+
+ private:
+  std::atomic<size_t> threshold_{0}; // Smallest armed amount, 0 if unarmed
+  std::atomic<uint32_t> sequence_{0}; // Futex word, incremented when the signal fires
+  std::atomic<int> eventFd_{-1};
+  std::mutex eventFdMutex_;
+};
+} // namespace TBE
+
+#endif // FBA_FREESPACESIGNAL_H
@@ -0,0 +1,59 @@
+#ifndef FBA_FUTEX_H
+#define FBA_FUTEX_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(__linux__)
+#define FBA_HAS_FUTEX 1
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace TBE {
+#if FBA_HAS_FUTEX
+/// Process-private futex operations on an atomic 32 bit word
+namespace Futex {
+static_assert(
+    sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+    "The futex word must be a plain 32 bit integer");
+
+inline uint32_t* getWord(std::atomic<uint32_t>& word) {
+  return reinterpret_cast<uint32_t*>(&word);
+}
+
+/// Sleep while word equals expected. Returns early on a wake, a changed word, a signal or the
+/// timeout, which the caller rechecks.
+/// @param timeoutMs Negative to wait without a timeout
+inline void wait(std::atomic<uint32_t>& word, uint32_t expected, int32_t timeoutMs) {
+  struct timespec timeout;
+  timeout.tv_sec = timeoutMs / 1000;
+  timeout.tv_nsec = static_cast<long>(timeoutMs % 1000) * 1000000;
+  syscall(
+      SYS_futex,
+      getWord(word),
+      FUTEX_WAIT_PRIVATE,
+      expected,
+      timeoutMs < 0 ? nullptr : &timeout,
+      nullptr,
+      0);
+}
+
+/// Wake every thread sleeping on word. Never blocks.
+inline void wakeAll(std::atomic<uint32_t>& word) {
+  syscall(SYS_futex, getWord(word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+} // namespace Futex
+#endif
+} // namespace TBE
+
+#endif // FBA_FUTEX_H
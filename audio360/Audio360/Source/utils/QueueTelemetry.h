@@ -0,0 +1,80 @@
+#ifndef FBA_QUEUETELEMETRY_H
+#define FBA_QUEUETELEMETRY_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include "TBE_AudioEngineDefinitions.h"
+
+namespace TBE {
+/// Fill level watermarks and underruns of a queue played by the audio thread. Only the audio
+/// thread records, so every counter is a plain load and store; snapshots can be taken from any
+/// thread without locking. Resets are requested from any thread and applied by the audio thread on
+/// its next block.
+class QueueTelemetry {
+ public:
+  /// Audio thread: record the number of samples queued when a block starts
+  void recordFill(size_t numQueued) {
+    applyReset();
+    if (numQueued > high_.load(std::memory_order_relaxed)) {
+      high_.store(numQueued, std::memory_order_relaxed);
+    }
+    if (numQueued < low_.load(std::memory_order_relaxed)) {
+      low_.store(numQueued, std::memory_order_relaxed);
+    }
+  }
+
+  /// Audio thread: record a block that could not be played in full for lack of data
+  /// @param dspTime AudioEngine::getDSPTime() at the start of the block
+  void recordUnderrun(int64_t dspTime) {
+    applyReset();
+    numUnderruns_.store(
+        numUnderruns_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    lastUnderrun_.store(dspTime, std::memory_order_relaxed);
+  }
+
+  /// Any thread: clear the watermarks and counters before the next block
+  void reset() {
+    resetRequested_.store(true, std::memory_order_release);
+  }
+
+  /// Any thread: snapshot of the counters. The fields are read one by one, so a snapshot taken
+  /// while a block is being rendered can mix values from before and after it.
+  QueueStatistics getStatistics() const {
+    QueueStatistics statistics;
+    statistics.highWatermark = high_.load(std::memory_order_relaxed);
+    const size_t low = low_.load(std::memory_order_relaxed);
+    statistics.lowWatermark = low == kNone ? 0 : low;
+    statistics.numUnderrunBlocks = numUnderruns_.load(std::memory_order_relaxed);
+    statistics.lastStarvationDSPTime = lastUnderrun_.load(std::memory_order_relaxed);
+    return statistics;
+  }
+
+ private:
+  static constexpr size_t kNone = std::numeric_limits<size_t>::max();
+
+  void applyReset() {
+    if (resetRequested_.load(std::memory_order_relaxed) && resetRequested_.exchange(false)) {
+      high_.store(0, std::memory_order_relaxed);
+      low_.store(kNone, std::memory_order_relaxed);
+      numUnderruns_.store(0, std::memory_order_relaxed);
+      lastUnderrun_.store(-1, std::memory_order_relaxed);
+    }
+  }
+
+  std::atomic<size_t> high_{0};
+  std::atomic<size_t> low_{kNone};
+  std::atomic<size_t> numUnderruns_{0};
+  std::atomic<int64_t> lastUnderrun_{-1};
+  std::atomic<bool> resetRequested_{false};
+};
+} // namespace TBE
+
+#endif // FBA_QUEUETELEMETRY_H
@@ -0,0 +1,246 @@
+#ifndef FBA_SAMPLERINGBUFFER_H
+#define FBA_SAMPLERINGBUFFER_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace TBE {
+/// Circular buffer of float samples, thread safe for any number of producers and one consumer.
+/// Reading and reserving are lock-free, committing is not: see below. Read and write positions
+/// are monotonic 64 bit sample counters, which lets callers reason about absolute stream
+/// positions (e.g. for seek flushes and loop markers) without wrap ambiguity.
+///
+/// Producers first reserve a region with a compare-and-swap on the reserve position. A producer
+/// only retries when another one reserved in the meantime, so some producer always makes
+/// progress, but the retries of any one producer are not bounded while others keep reserving:
+/// reserving is lock-free, not wait-free. Each producer then fills its region while the others
+/// fill theirs, and commits it. Regions are published to the consumer in the order they were
+/// reserved: a commit waits for the producers that reserved earlier to commit first, for as long
+/// as they take unless it is given a timeout. This only ever happens with concurrent producers.
+/// With a single producer, reserving and committing never wait.
+class SampleRingBuffer {
+ public:
+  /// A reserved region, split in two spans where it wraps around the end of the buffer
+  struct Reservation {
+    uint64_t position{0}; // Absolute write position of the first sample
+    size_t numSamples{0};
+    float* first{nullptr};
+    size_t firstSize{0};
+    float* second{nullptr};
+    size_t secondSize{0};
+  };
+
+  SampleRingBuffer() {}
+
+  explicit SampleRingBuffer(size_t capacity) {
+    allocate(capacity);
+  }
+
+  /// Allocate the buffer. Not thread safe, must be called before any reads or writes.
+  void allocate(size_t capacity) {
+    data_.assign(std::max<size_t>(capacity, 1), 0.f);
+    reserve_.store(0);
+    write_.store(0);
+    read_.store(0);
+  }
+
+  size_t getCapacity() const {
+    return data_.size();
+  }
+
+  /// Producer: number of samples that can be reserved
+  size_t getFreeSpace() const {
+    return data_.size() -
+        static_cast<size_t>(
+               reserve_.load(std::memory_order_relaxed) - read_.load(std::memory_order_acquire));
+  }
+
+  /// Consumer: number of samples that can be read
+  size_t getNumAvailable() const {
+    return static_cast<size_t>(
+        write_.load(std::memory_order_acquire) - read_.load(std::memory_order_relaxed));
+  }
+
+  /// Producer: reserve up to numSamples samples to fill, rounded down to a multiple of
+  /// granularity. Every reservation must be committed, even if it is not filled, as later ones are
+  /// only published after it.
+  /// @return The reserved region, empty if there is not enough free space
+  Reservation reserve(size_t numSamples, size_t granularity = 1) {
+    Reservation reservation;
+    auto position = reserve_.load(std::memory_order_relaxed);
+    size_t count = 0;
+    do {
+      const size_t used = static_cast<size_t>(position - read_.load(std::memory_order_acquire));
+      count = std::min(numSamples, data_.size() - used);
+      count -= count % granularity;
+      if (count == 0) {
+        return reservation;
+      }
+    } while (!reserve_.compare_exchange_weak(
+        position, position + count, std::memory_order_relaxed, std::memory_order_relaxed));
+
+    const size_t start = static_cast<size_t>(position % data_.size());
+    reservation.position = position;
+    reservation.numSamples = count;
+    reservation.first = data_.data() + start;
+    reservation.firstSize = std::min(count, data_.size() - start);
+    reservation.second = data_.data();
+    reservation.secondSize = count - reservation.firstSize;
+    return reservation;
+  }
+
+  /// Producer: publish a filled reservation to the consumer, after every region reserved before it
+  void commit(const Reservation& reservation) {
+    commit(reservation, reservation.numSamples);
+  }
+
+  /// Producer: publish the first numSamples samples of a reservation. The rest of it is released
+  /// if it is the last region reserved, and published as silence otherwise.
+  void commit(const Reservation& reservation, size_t numSamples) {
+    if (reservation.numSamples == 0) {
+      return;
+    }
+    for (int spin = 0; write_.load(std::memory_order_acquire) != reservation.position; ++spin) {
+      if (spin >= kSpinsBeforeYield) {
+        std::this_thread::yield();
+      }
+    }
+    publish(reservation, numSamples);
+  }
+
+  /// Producer: as commit(), but give up if the regions reserved before this one are not all
+  /// committed within timeout. The reservation then stays pending and must be committed again.
+  /// @return true if the region was published
+  bool
+  commit(const Reservation& reservation, size_t numSamples, std::chrono::microseconds timeout) {
+    if (reservation.numSamples == 0) {
+      return true;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (int spin = 0; write_.load(std::memory_order_acquire) != reservation.position; ++spin) {
+      if (spin >= kSpinsBeforeYield) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+          return false;
+        }
+        std::this_thread::yield();
+      }
+    }
+    publish(reservation, numSamples);
+    return true;
+  }
+
+  /// Producer: write up to numSamples samples, rounded down to a multiple of granularity. If
+  /// source is null, silence is written.
+  /// @return the number of samples written
+  size_t write(const float* source, size_t numSamples, size_t granularity = 1) {
+    const Reservation reservation = reserve(numSamples, granularity);
+    if (reservation.numSamples == 0) {
+      return 0;
+    }
+    const size_t firstBytes = reservation.firstSize * sizeof(float);
+    const size_t secondBytes = reservation.secondSize * sizeof(float);
+    if (source) {
+      std::memcpy(reservation.first, source, firstBytes);
+      std::memcpy(reservation.second, source + reservation.firstSize, secondBytes);
+    } else {
+      std::memset(reservation.first, 0, firstBytes);
+      std::memset(reservation.second, 0, secondBytes);
+    }
+    commit(reservation);
+    return reservation.numSamples;
+  }
+
+  /// Consumer: read up to numSamples samples into dest.
+  /// @return the number of samples read
+  size_t read(float* dest, size_t numSamples) {
+    const auto read = read_.load(std::memory_order_relaxed);
+    numSamples = peek(dest, numSamples);
+    read_.store(read + numSamples, std::memory_order_release);
+    return numSamples;
+  }
+
+  /// Consumer: copy up to numSamples samples without consuming them
+  size_t peek(float* dest, size_t numSamples) const {
+    const auto read = read_.load(std::memory_order_relaxed);
+    numSamples = std::min(numSamples, getNumAvailable());
+    const size_t start = static_cast<size_t>(read % data_.size());
+    const size_t first = std::min(numSamples, data_.size() - start);
+    std::memcpy(dest, data_.data() + start, first * sizeof(float));
+    std::memcpy(dest + first, data_.data(), (numSamples - first) * sizeof(float));
+    return numSamples;
+  }
+
+  /// Consumer: drop up to numSamples samples
+  size_t skip(size_t numSamples) {
+    numSamples = std::min(numSamples, getNumAvailable());
+    read_.fetch_add(numSamples, std::memory_order_release);
+    return numSamples;
+  }
+
+  /// Consumer: drop every sample written before the absolute write position
+  void discardUntil(uint64_t writePosition) {
+    if (read_.load(std::memory_order_relaxed) < writePosition) {
+      read_.store(writePosition, std::memory_order_release);
+    }
+  }
+
+  /// Absolute number of samples committed since allocation
+  uint64_t getWritePosition() const {
+    return write_.load(std::memory_order_acquire);
+  }
+
+  /// Absolute number of samples read since allocation
+  uint64_t getReadPosition() const {
+    return read_.load(std::memory_order_acquire);
+  }
+
+ private:
+  /// Busy waits for an earlier producer's commit before yielding the thread
+  static const int kSpinsBeforeYield = 64;
+
+  /// Publish a reservation once every region reserved before it is
+  void publish(const Reservation& reservation, size_t numSamples) {
+    // Only release the tail once every earlier region is published. Releasing it before would let
+    // an earlier producer release its own tail too, and the write position would never reach this
+    // region.
+    numSamples = std::min(numSamples, reservation.numSamples);
+    auto end = reservation.position + reservation.numSamples;
+    if (numSamples < reservation.numSamples &&
+        !reserve_.compare_exchange_strong(
+            end,
+            reservation.position + numSamples,
+            std::memory_order_relaxed,
+            std::memory_order_relaxed)) {
+      const size_t firstStart = std::min(numSamples, reservation.firstSize);
+      const size_t secondStart = numSamples - firstStart;
+      std::memset(
+          reservation.first + firstStart, 0, (reservation.firstSize - firstStart) * sizeof(float));
+      std::memset(
+          reservation.second + secondStart,
+          0,
+          (reservation.secondSize - secondStart) * sizeof(float));
+      numSamples = reservation.numSamples;
+    }
+    write_.store(reservation.position + numSamples, std::memory_order_release);
+  }
+
+  std::vector<float> data_;
+  std::atomic<uint64_t> reserve_{0}; // End of the reserved regions
+  std::atomic<uint64_t> write_{0}; // End of the committed regions
+  std::atomic<uint64_t> read_{0};
+};
+} // namespace TBE
+
+#endif // FBA_SAMPLERINGBUFFER_H
@@ -0,0 +1,80 @@
+#ifndef FBA_SPSCQUEUE_H
+#define FBA_SPSCQUEUE_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace TBE {
+/// Fixed capacity, lock-free queue of trivially copyable messages for exactly one producer thread
+/// and one consumer thread. Used to hand commands from control threads to the audio thread.
+template <typename T, size_t Capacity>
+class SpscQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+ public:
+  /// Producer: push a message. Returns false if the queue is full.
+  bool push(const T& item) {
+    const auto write = write_.load(std::memory_order_relaxed);
+    if (write - read_.load(std::memory_order_acquire) >= Capacity) {
+      return false;
+    }
+    items_[write & (Capacity - 1)] = item;
+    write_.store(write + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Producer: push several messages, which the consumer sees all at once. Returns false, and
+  /// pushes nothing, if they don't all fit.
+  bool push(const T* items, size_t count) {
+    const auto write = write_.load(std::memory_order_relaxed);
+    if (count > Capacity - (write - read_.load(std::memory_order_acquire))) {
+      return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      items_[(write + i) & (Capacity - 1)] = items[i];
+    }
+    write_.store(write + count, std::memory_order_release);
+    return true;
+  }
+
+  /// Consumer: pop a message. Returns false if the queue is empty.
+  bool pop(T& item) {
+    const auto read = read_.load(std::memory_order_relaxed);
+    if (read == write_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = items_[read & (Capacity - 1)];
+    read_.store(read + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Consumer: copy the next message without popping it. Returns false if the queue is empty.
+  bool peek(T& item) const {
+    const auto read = read_.load(std::memory_order_relaxed);
+    if (read == write_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = items_[read & (Capacity - 1)];
+    return true;
+  }
+
+  /// Consumer: true if there is nothing to pop
+  bool empty() const {
+    return read_.load(std::memory_order_relaxed) == write_.load(std::memory_order_acquire);
+  }
+
+ private:
+  T items_[Capacity];
+  std::atomic<uint64_t> write_{0};
+  std::atomic<uint64_t> read_{0};
+};
+} // namespace TBE
+
+#endif // FBA_SPSCQUEUE_H
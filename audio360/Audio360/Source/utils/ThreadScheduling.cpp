@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "ThreadScheduling.h"
+
+#if defined(__linux__)
+#define FBA_HAS_THREAD_SCHEDULING 1
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+namespace TBE {
+namespace {
+const int32_t kMinPriority = 1;
+const int32_t kMaxPriority = 99;
+
+bool isDefault(const ThreadScheduling& scheduling) {
+  return scheduling.policy == ThreadPolicy::DEFAULT && scheduling.cpuAffinityMask == 0;
+}
+} // namespace
+
+EngineError validateThreadScheduling(const ThreadScheduling& scheduling) {
+  switch (scheduling.policy) {
+    case ThreadPolicy::DEFAULT:
+      return EngineError::OK;
+    case ThreadPolicy::FIFO:
+    case ThreadPolicy::ROUND_ROBIN:
+      return scheduling.priority >= kMinPriority && scheduling.priority <= kMaxPriority
+          ? EngineError::OK
+          : EngineError::INVALID_PARAM;
+  }
+  return EngineError::INVALID_PARAM;
+}
+
+EngineError applyThreadScheduling(std::thread& thread, const ThreadScheduling& scheduling) {
+  if (isDefault(scheduling)) {
+    return EngineError::OK;
+  }
+#if FBA_HAS_THREAD_SCHEDULING
+  const pthread_t handle = thread.native_handle();
+  if (scheduling.policy != ThreadPolicy::DEFAULT) {
+    sched_param param = {};
+    param.sched_priority = scheduling.priority;
+    const int policy = scheduling.policy == ThreadPolicy::FIFO ? SCHED_FIFO : SCHED_RR;
+    if (pthread_setschedparam(handle, policy, &param) != 0) {
+      return EngineError::CANNOT_APPLY_THREAD_SETTINGS;
+    }
+  }
+  if (scheduling.cpuAffinityMask != 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; ++cpu) {
+      if (scheduling.cpuAffinityMask & (uint64_t(1) << cpu)) {
+        CPU_SET(cpu, &cpus);
+      }
+    }
+    if (pthread_setaffinity_np(handle, sizeof(cpus), &cpus) != 0) {
+      return EngineError::CANNOT_APPLY_THREAD_SETTINGS;
+    }
+  }
+  return EngineError::OK;
+#else
+  (void)thread;
+  return EngineError::NOT_SUPPORTED;
+#endif
+}
+
+EngineError lockProcessMemory() {
+#if FBA_HAS_THREAD_SCHEDULING
+  return mlockall(MCL_CURRENT | MCL_FUTURE) == 0 ? EngineError::OK
+                                                 : EngineError::CANNOT_APPLY_THREAD_SETTINGS;
+#else
+  return EngineError::NOT_SUPPORTED;
+#endif
+}
+} // namespace TBE
@@ -0,0 +1,30 @@
+#ifndef FBA_THREADSCHEDULING_H
+#define FBA_THREADSCHEDULING_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <thread>
+#include "TBE_AudioEngineDefinitions.h"
+
+namespace TBE {
+/// @return EngineError::INVALID_PARAM if the priority is out of range for the policy, or
+/// EngineError::OK
+EngineError validateThreadScheduling(const ThreadScheduling& scheduling);
+
+/// Apply a scheduling policy, priority and CPU affinity to a running thread. Nothing is changed
+/// for ThreadPolicy::DEFAULT with an affinity mask of 0.
+/// @return EngineError::CANNOT_APPLY_THREAD_SETTINGS if the system refused, typically for lack of
+/// privileges, EngineError::NOT_SUPPORTED on platforms other than Linux, or EngineError::OK
+EngineError applyThreadScheduling(std::thread& thread, const ThreadScheduling& scheduling);
+
+/// Lock all current and future memory of the process into RAM
+/// @return EngineError::CANNOT_APPLY_THREAD_SETTINGS if the system refused, typically because of
+/// RLIMIT_MEMLOCK, EngineError::NOT_SUPPORTED on platforms other than Linux, or EngineError::OK
+EngineError lockProcessMemory();
+} // namespace TBE
+
+#endif // FBA_THREADSCHEDULING_H
@@ -0,0 +1,60 @@
+#ifndef FBA_TIMER_H
+#define FBA_TIMER_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace TBE {
+/// Monotonic stopwatch used for profiling the audio and decoder threads
+class Timer {
+ public:
+  Timer() : start_(std::chrono::steady_clock::now()) {}
+
+  void reset() {
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  size_t getElapsedMicroSec() const {
+    return static_cast<size_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now() - start_)
+                                   .count());
+  }
+
+  uint64_t getElapsedNanoSec() const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now() - start_)
+                                     .count());
+  }
+
+  double getElapsedSeconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+/// Stores the elapsed time of its scope, in microseconds, into an atomic on destruction
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(std::atomic<size_t>& result) : result_(result) {}
+
+  ~ScopedTimer() {
+    result_.store(timer_.getElapsedMicroSec(), std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<size_t>& result_;
+  Timer timer_;
+};
+} // namespace TBE
+
+#endif // FBA_TIMER_H
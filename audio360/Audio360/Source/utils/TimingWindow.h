@@ -0,0 +1,64 @@
+#ifndef FBA_TIMINGWINDOW_H
+#define FBA_TIMINGWINDOW_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include "TBE_AudioEngineDefinitions.h"
+
+namespace TBE {
+/// The last StageStatistics::kTimingWindow durations recorded by one thread, summarised from any
+/// other without locking. Recording is two relaxed stores; the summary sorts a copy of the window.
+class TimingWindow {
+ public:
+  static const size_t kSize = StageStatistics::kTimingWindow;
+
+  /// Writer thread: record a duration
+  void record(uint64_t nanoSec) {
+    const uint64_t count = count_.load(std::memory_order_relaxed);
+    const uint64_t clamped = std::min<uint64_t>(nanoSec, std::numeric_limits<uint32_t>::max());
+    slots_[count % kSize].store(static_cast<uint32_t>(clamped), std::memory_order_relaxed);
+    count_.store(count + 1, std::memory_order_release);
+  }
+
+  /// Any thread: min, mean, 99th percentile and max of the window. A summary taken while a
+  /// duration is being recorded can include the one it replaces.
+  StageTiming summarise() const {
+    StageTiming timing;
+    const uint64_t size = kSize;
+    const size_t count =
+        static_cast<size_t>(std::min<uint64_t>(count_.load(std::memory_order_acquire), size));
+    if (count == 0) {
+      return timing;
+    }
+    uint32_t values[kSize];
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; ++i) {
+      values[i] = slots_[i].load(std::memory_order_relaxed);
+      sum += values[i];
+    }
+    const auto range = std::minmax_element(values, values + count);
+    timing.minMicroSec = static_cast<float>(*range.first) * 1e-3f;
+    timing.maxMicroSec = static_cast<float>(*range.second) * 1e-3f;
+    const size_t percentile = (count * 99 + 99) / 100 - 1;
+    std::nth_element(values, values + percentile, values + count);
+    timing.meanMicroSec = static_cast<float>(sum) / static_cast<float>(count) * 1e-3f;
+    timing.p99MicroSec = static_cast<float>(values[percentile]) * 1e-3f;
+    return timing;
+  }
+
+ private:
+  std::atomic<uint32_t> slots_[kSize] = {};
+  std::atomic<uint64_t> count_{0};
+};
+} // namespace TBE
+
+#endif // FBA_TIMINGWINDOW_H
@@ -0,0 +1,749 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "VectorBatch.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FBA_BATCH_SSE 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+// Divisions, square roots and rounding conversions are only vectorised on AArch64
+#define FBA_BATCH_NEON 1
+#include <arm_neon.h>
+#endif
+#if FBA_BATCH_SSE && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// Compiled with a target attribute and only called if the CPU reports AVX2 and FMA
+#define FBA_BATCH_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace TBE {
+namespace {
+typedef VectorBatch::ConstVectors ConstVectors;
+typedef VectorBatch::Vectors Vectors;
+typedef VectorBatch::ConstQuats ConstQuats;
+
+// Only used by the vector kernels
+#if FBA_BATCH_SSE || FBA_BATCH_NEON
+const float kPi = 3.14159265358979323846f;
+const float kRadiansToDegrees = 180.f / kPi;
+const float kDegreesToRadians = kPi / 180.f;
+const float kTanPiOver8 = 0.414213562373095f;
+
+// Minimax polynomials of atan(x) for |x| <= tan(pi / 8), and of sin(x) and cos(x) for
+// |x| <= pi / 4 (Cephes)
+const float kAtan[] = {
+    8.05374449538e-2f, -1.38776856032e-1f, 1.99777106478e-1f, -3.33329491539e-1f};
+const float kSin[] = {-1.9515295891e-4f, 8.3321608736e-3f, -1.6666654611e-1f};
+const float kCos[] = {2.443315711809948e-5f, -1.388731625493765e-3f, 4.166664568298827e-2f};
+#endif
+
+void rotateScalar(
+    ConstQuats rotations,
+    bool anti,
+    ConstVectors vectors,
+    Vectors output,
+    size_t begin,
+    size_t count) {
+  for (size_t i = begin; i < count; ++i) {
+    const TBQuat rotation(rotations.x[i], rotations.y[i], rotations.z[i], rotations.w[i]);
+    const TBVector vector(vectors.x[i], vectors.y[i], vectors.z[i]);
+    const TBVector rotated = anti ? TBQuat::antiRotateVectorByQuat(rotation, vector)
+                                  : TBQuat::rotateVectorByQuat(rotation, vector);
+    output.x[i] = rotated.x;
+    output.y[i] = rotated.y;
+    output.z[i] = rotated.z;
+  }
+}
+
+void getAedScalar(
+    const TBQuat& listenerRotation,
+    const TBVector& listenerPosition,
+    ConstVectors sources,
+    float* azimuth,
+    float* elevation,
+    float* distance,
+    size_t begin,
+    size_t count) {
+  for (size_t i = begin; i < count; ++i) {
+    const Aed aed = TBQuat::getAedFromQuat(
+        listenerRotation, TBVector(sources.x[i], sources.y[i], sources.z[i]), listenerPosition);
+    azimuth[i] = aed.azimuth;
+    elevation[i] = aed.elevation;
+    distance[i] = aed.distance;
+  }
+}
+
+void getVectorScalar(
+    const float* azimuth,
+    const float* elevation,
+    const float* distance,
+    Vectors output,
+    size_t begin,
+    size_t count) {
+  for (size_t i = begin; i < count; ++i) {
+    const TBVector vector =
+        TBVector::getVectorFromAziEleDist(azimuth[i], elevation[i], distance[i]);
+    output.x[i] = vector.x;
+    output.y[i] = vector.y;
+    output.z[i] = vector.z;
+  }
+}
+
+void rotateScalar(
+    ConstQuats rotations,
+    bool anti,
+    ConstVectors vectors,
+    Vectors output,
+    size_t count) {
+  rotateScalar(rotations, anti, vectors, output, 0, count);
+}
+
+void getAedScalar(
+    const TBQuat& listenerRotation,
+    const TBVector& listenerPosition,
+    ConstVectors sources,
+    float* azimuth,
+    float* elevation,
+    float* distance,
+    size_t count) {
+  getAedScalar(
+      listenerRotation, listenerPosition, sources, azimuth, elevation, distance, 0, count);
+}
+
+void getVectorScalar(
+    const float* azimuth,
+    const float* elevation,
+    const float* distance,
+    Vectors output,
+    size_t count) {
+  getVectorScalar(azimuth, elevation, distance, output, 0, count);
+}
+
+#if FBA_BATCH_SSE
+inline __m128 selectSse(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/// a * (x, y, z, 0) * b for four vectors, with the products of TBQuat::quatProductUnNormalised()
+/// @param a, b Quaternions as x, y, z, w
+inline void sandwichSse(const __m128* a, const __m128* b, __m128& x, __m128& y, __m128& z) {
+  const __m128 fw = _mm_sub_ps(
+      _mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(a[0], x)), _mm_mul_ps(a[1], y)),
+      _mm_mul_ps(a[2], z));
+  const __m128 fx =
+      _mm_sub_ps(_mm_add_ps(_mm_mul_ps(a[3], x), _mm_mul_ps(a[1], z)), _mm_mul_ps(a[2], y));
+  const __m128 fy =
+      _mm_add_ps(_mm_sub_ps(_mm_mul_ps(a[3], y), _mm_mul_ps(a[0], z)), _mm_mul_ps(a[2], x));
+  const __m128 fz =
+      _mm_sub_ps(_mm_add_ps(_mm_mul_ps(a[3], z), _mm_mul_ps(a[0], y)), _mm_mul_ps(a[1], x));
+  x = _mm_sub_ps(
+      _mm_add_ps(_mm_add_ps(_mm_mul_ps(fw, b[0]), _mm_mul_ps(fx, b[3])), _mm_mul_ps(fy, b[2])),
+      _mm_mul_ps(fz, b[1]));
+  y = _mm_add_ps(
+      _mm_add_ps(_mm_sub_ps(_mm_mul_ps(fw, b[1]), _mm_mul_ps(fx, b[2])), _mm_mul_ps(fy, b[3])),
+      _mm_mul_ps(fz, b[0]));
+  z = _mm_add_ps(
+      _mm_sub_ps(_mm_add_ps(_mm_mul_ps(fw, b[2]), _mm_mul_ps(fx, b[1])), _mm_mul_ps(fy, b[0])),
+      _mm_mul_ps(fz, b[3]));
+}
+
+/// atan2(y, x) of four pairs, in radians. Signed zeros give the same angles as std::atan2, but
+/// infinities don't.
+inline __m128 atan2Sse(__m128 y, __m128 x) {
+  const __m128 sign = _mm_set1_ps(-0.f);
+  const __m128 absX = _mm_andnot_ps(sign, x);
+  const __m128 absY = _mm_andnot_ps(sign, y);
+  // atan of the smaller magnitude over the larger, reduced to within tan(pi / 8) with
+  // atan(t) = pi / 4 + atan((t - 1) / (t + 1))
+  const __m128 low = _mm_min_ps(absX, absY);
+  const __m128 high = _mm_max_ps(absX, absY);
+  const __m128 reduce = _mm_cmpgt_ps(low, _mm_mul_ps(high, _mm_set1_ps(kTanPiOver8)));
+  const __m128 numerator = selectSse(reduce, _mm_sub_ps(low, high), low);
+  const __m128 denominator = selectSse(reduce, _mm_add_ps(low, high), high);
+  // 0 / 0 where both are zero is masked out
+  const __m128 t = _mm_andnot_ps(
+      _mm_cmpeq_ps(denominator, _mm_setzero_ps()), _mm_div_ps(numerator, denominator));
+  const __m128 t2 = _mm_mul_ps(t, t);
+  __m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kAtan[0]), t2), _mm_set1_ps(kAtan[1]));
+  p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(kAtan[2]));
+  p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(kAtan[3]));
+  __m128 angle = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, t2), t), t);
+  angle = _mm_add_ps(angle, _mm_and_ps(reduce, _mm_set1_ps(0.25f * kPi)));
+
+  // Back to the octant of (x, y)
+  angle = selectSse(_mm_cmpgt_ps(absY, absX), _mm_sub_ps(_mm_set1_ps(0.5f * kPi), angle), angle);
+  const __m128 negativeX = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(x), 31));
+  angle = selectSse(negativeX, _mm_sub_ps(_mm_set1_ps(kPi), angle), angle);
+  return _mm_xor_ps(angle, _mm_and_ps(sign, y));
+}
+
+/// sin and cos of four angles in degrees
+inline void sinCosDegreesSse(__m128 degrees, __m128& sine, __m128& cosine) {
+  // Nearest multiple of 90 degrees and the remainder in radians, within pi / 4
+  const __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(degrees, _mm_set1_ps(1.f / 90.f)));
+  const __m128 x = _mm_mul_ps(
+      _mm_sub_ps(degrees, _mm_mul_ps(_mm_cvtepi32_ps(quadrant), _mm_set1_ps(90.f))),
+      _mm_set1_ps(kDegreesToRadians));
+  const __m128 x2 = _mm_mul_ps(x, x);
+  __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kSin[0]), x2), _mm_set1_ps(kSin[1]));
+  s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(kSin[2]));
+  s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, x2), x), x);
+  __m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kCos[0]), x2), _mm_set1_ps(kCos[1]));
+  c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(kCos[2]));
+  c = _mm_add_ps(
+      _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(c, x2), x2), _mm_mul_ps(_mm_set1_ps(0.5f), x2)),
+      _mm_set1_ps(1.f));
+
+  // Odd quadrants swap sin and cos, and bit 1 of the quadrant (of the next one for cos) is the
+  // sign
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i two = _mm_set1_epi32(2);
+  const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+  const __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+  const __m128 cosSign =
+      _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+  sine = _mm_xor_ps(selectSse(swap, c, s), sinSign);
+  cosine = _mm_xor_ps(selectSse(swap, s, c), cosSign);
+}
+
+void rotateSse(
+    ConstQuats rotations,
+    bool anti,
+    ConstVectors vectors,
+    Vectors output,
+    size_t count) {
+  const __m128 sign = _mm_set1_ps(-0.f);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128 q[4] = {
+        _mm_loadu_ps(rotations.x + i),
+        _mm_loadu_ps(rotations.y + i),
+        _mm_loadu_ps(rotations.z + i),
+        _mm_loadu_ps(rotations.w + i)};
+    const __m128 conjugate[4] = {
+        _mm_xor_ps(q[0], sign), _mm_xor_ps(q[1], sign), _mm_xor_ps(q[2], sign), q[3]};
+    __m128 x = _mm_loadu_ps(vectors.x + i);
+    __m128 y = _mm_loadu_ps(vectors.y + i);
+    __m128 z = _mm_loadu_ps(vectors.z + i);
+    // q v q* or, anti-rotated, q* v q
+    sandwichSse(anti ? conjugate : q, anti ? q : conjugate, x, y, z);
+    _mm_storeu_ps(output.x + i, x);
+    _mm_storeu_ps(output.y + i, y);
+    _mm_storeu_ps(output.z + i, z);
+  }
+  rotateScalar(rotations, anti, vectors, output, i, count);
+}
+
+void getAedSse(
+    const TBQuat& listenerRotation,
+    const TBVector& listenerPosition,
+    ConstVectors sources,
+    float* azimuth,
+    float* elevation,
+    float* distance,
+    size_t count) {
+  // Anti-rotated by the listener: q* v q
+  const __m128 conjugate[4] = {
+      _mm_set1_ps(-listenerRotation.x),
+      _mm_set1_ps(-listenerRotation.y),
+      _mm_set1_ps(-listenerRotation.z),
+      _mm_set1_ps(listenerRotation.w)};
+  const __m128 q[4] = {
+      _mm_set1_ps(listenerRotation.x),
+      _mm_set1_ps(listenerRotation.y),
+      _mm_set1_ps(listenerRotation.z),
+      _mm_set1_ps(listenerRotation.w)};
+  const __m128 toDegrees = _mm_set1_ps(kRadiansToDegrees);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 x = _mm_sub_ps(_mm_loadu_ps(sources.x + i), _mm_set1_ps(listenerPosition.x));
+    __m128 y = _mm_sub_ps(_mm_loadu_ps(sources.y + i), _mm_set1_ps(listenerPosition.y));
+    __m128 z = _mm_sub_ps(_mm_loadu_ps(sources.z + i), _mm_set1_ps(listenerPosition.z));
+    sandwichSse(conjugate, q, x, y, z);
+    const __m128 xx = _mm_mul_ps(x, x);
+    const __m128 zz = _mm_mul_ps(z, z);
+    _mm_storeu_ps(azimuth + i, _mm_mul_ps(atan2Sse(x, z), toDegrees));
+    _mm_storeu_ps(
+        elevation + i, _mm_mul_ps(atan2Sse(y, _mm_sqrt_ps(_mm_add_ps(xx, zz))), toDegrees));
+    _mm_storeu_ps(distance + i, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(xx, _mm_mul_ps(y, y)), zz)));
+  }
+  getAedScalar(
+      listenerRotation, listenerPosition, sources, azimuth, elevation, distance, i, count);
+}
+
+void getVectorSse(
+    const float* azimuth,
+    const float* elevation,
+    const float* distance,
+    Vectors output,
+    size_t count) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 sinAzimuth, cosAzimuth, sinElevation, cosElevation;
+    sinCosDegreesSse(_mm_loadu_ps(azimuth + i), sinAzimuth, cosAzimuth);
+    sinCosDegreesSse(_mm_loadu_ps(elevation + i), sinElevation, cosElevation);
+    const __m128 d = _mm_loadu_ps(distance + i);
+    _mm_storeu_ps(output.x + i, _mm_mul_ps(_mm_mul_ps(d, sinAzimuth), cosElevation));
+    _mm_storeu_ps(output.y + i, _mm_mul_ps(d, sinElevation));
+    _mm_storeu_ps(output.z + i, _mm_mul_ps(_mm_mul_ps(d, cosAzimuth), cosElevation));
+  }
+  getVectorScalar(azimuth, elevation, distance, output, i, count);
+}
+#endif
+
+#if FBA_BATCH_AVX2
+__attribute__((target("avx2,fma"))) inline void
+sandwichAvx2(const __m256* a, const __m256* b, __m256& x, __m256& y, __m256& z) {
+  const __m256 fw = _mm256_sub_ps(
+      _mm256_sub_ps(
+          _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(a[0], x)), _mm256_mul_ps(a[1], y)),
+      _mm256_mul_ps(a[2], z));
+  const __m256 fx = _mm256_sub_ps(
+      _mm256_add_ps(_mm256_mul_ps(a[3], x), _mm256_mul_ps(a[1], z)), _mm256_mul_ps(a[2], y));
+  const __m256 fy = _mm256_add_ps(
+      _mm256_sub_ps(_mm256_mul_ps(a[3], y), _mm256_mul_ps(a[0], z)), _mm256_mul_ps(a[2], x));
+  const __m256 fz = _mm256_sub_ps(
+      _mm256_add_ps(_mm256_mul_ps(a[3], z), _mm256_mul_ps(a[0], y)), _mm256_mul_ps(a[1], x));
+  x = _mm256_sub_ps(
+      _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(fw, b[0]), _mm256_mul_ps(fx, b[3])),
+          _mm256_mul_ps(fy, b[2])),
+      _mm256_mul_ps(fz, b[1]));
+  y = _mm256_add_ps(
+      _mm256_add_ps(
+          _mm256_sub_ps(_mm256_mul_ps(fw, b[1]), _mm256_mul_ps(fx, b[2])),
+          _mm256_mul_ps(fy, b[3])),
+      _mm256_mul_ps(fz, b[0]));
+  z = _mm256_add_ps(
+      _mm256_sub_ps(
+          _mm256_add_ps(_mm256_mul_ps(fw, b[2]), _mm256_mul_ps(fx, b[1])),
+          _mm256_mul_ps(fy, b[0])),
+      _mm256_mul_ps(fz, b[3]));
+}
+
+__attribute__((target("avx2,fma"))) inline __m256 atan2Avx2(__m256 y, __m256 x) {
+  const __m256 sign = _mm256_set1_ps(-0.f);
+  const __m256 absX = _mm256_andnot_ps(sign, x);
+  const __m256 absY = _mm256_andnot_ps(sign, y);
+  const __m256 low = _mm256_min_ps(absX, absY);
+  const __m256 high = _mm256_max_ps(absX, absY);
+  const __m256 reduce =
+      _mm256_cmp_ps(low, _mm256_mul_ps(high, _mm256_set1_ps(kTanPiOver8)), _CMP_GT_OQ);
+  const __m256 numerator = _mm256_blendv_ps(low, _mm256_sub_ps(low, high), reduce);
+  const __m256 denominator = _mm256_blendv_ps(high, _mm256_add_ps(low, high), reduce);
+  const __m256 t = _mm256_andnot_ps(
+      _mm256_cmp_ps(denominator, _mm256_setzero_ps(), _CMP_EQ_OQ),
+      _mm256_div_ps(numerator, denominator));
+  const __m256 t2 = _mm256_mul_ps(t, t);
+  __m256 p = _mm256_fmadd_ps(_mm256_set1_ps(kAtan[0]), t2, _mm256_set1_ps(kAtan[1]));
+  p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(kAtan[2]));
+  p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(kAtan[3]));
+  __m256 angle = _mm256_fmadd_ps(_mm256_mul_ps(p, t2), t, t);
+  angle = _mm256_add_ps(angle, _mm256_and_ps(reduce, _mm256_set1_ps(0.25f * kPi)));
+
+  angle = _mm256_blendv_ps(
+      angle,
+      _mm256_sub_ps(_mm256_set1_ps(0.5f * kPi), angle),
+      _mm256_cmp_ps(absY, absX, _CMP_GT_OQ));
+  // blendv only looks at the sign bit
+  angle = _mm256_blendv_ps(angle, _mm256_sub_ps(_mm256_set1_ps(kPi), angle), x);
+  return _mm256_xor_ps(angle, _mm256_and_ps(sign, y));
+}
+
+__attribute__((target("avx2,fma"))) inline void
+sinCosDegreesAvx2(__m256 degrees, __m256& sine, __m256& cosine) {
+  const __m256i quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(degrees, _mm256_set1_ps(1.f / 90.f)));
+  const __m256 x = _mm256_mul_ps(
+      _mm256_fnmadd_ps(_mm256_cvtepi32_ps(quadrant), _mm256_set1_ps(90.f), degrees),
+      _mm256_set1_ps(kDegreesToRadians));
+  const __m256 x2 = _mm256_mul_ps(x, x);
+  __m256 s = _mm256_fmadd_ps(_mm256_set1_ps(kSin[0]), x2, _mm256_set1_ps(kSin[1]));
+  s = _mm256_fmadd_ps(s, x2, _mm256_set1_ps(kSin[2]));
+  s = _mm256_fmadd_ps(_mm256_mul_ps(s, x2), x, x);
+  __m256 c = _mm256_fmadd_ps(_mm256_set1_ps(kCos[0]), x2, _mm256_set1_ps(kCos[1]));
+  c = _mm256_fmadd_ps(c, x2, _mm256_set1_ps(kCos[2]));
+  c = _mm256_fmadd_ps(
+      _mm256_mul_ps(c, x2), x2, _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), x2, _mm256_set1_ps(1.f)));
+
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i two = _mm256_set1_epi32(2);
+  const __m256 swap =
+      _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, one), one));
+  const __m256 sinSign =
+      _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, two), 30));
+  const __m256 cosSign = _mm256_castsi256_ps(
+      _mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(quadrant, one), two), 30));
+  sine = _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sinSign);
+  cosine = _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), cosSign);
+}
+
+__attribute__((target("avx2,fma"))) void rotateAvx2(
+    ConstQuats rotations,
+    bool anti,
+    ConstVectors vectors,
+    Vectors output,
+    size_t count) {
+  const __m256 sign = _mm256_set1_ps(-0.f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256 q[4] = {
+        _mm256_loadu_ps(rotations.x + i),
+        _mm256_loadu_ps(rotations.y + i),
+        _mm256_loadu_ps(rotations.z + i),
+        _mm256_loadu_ps(rotations.w + i)};
+    const __m256 conjugate[4] = {
+        _mm256_xor_ps(q[0], sign), _mm256_xor_ps(q[1], sign), _mm256_xor_ps(q[2], sign), q[3]};
+    __m256 x = _mm256_loadu_ps(vectors.x + i);
+    __m256 y = _mm256_loadu_ps(vectors.y + i);
+    __m256 z = _mm256_loadu_ps(vectors.z + i);
+    sandwichAvx2(anti ? conjugate : q, anti ? q : conjugate, x, y, z);
+    _mm256_storeu_ps(output.x + i, x);
+    _mm256_storeu_ps(output.y + i, y);
+    _mm256_storeu_ps(output.z + i, z);
+  }
+  rotateScalar(rotations, anti, vectors, output, i, count);
+}
+
+__attribute__((target("avx2,fma"))) void getAedAvx2(
+    const TBQuat& listenerRotation,
+    const TBVector& listenerPosition,
+    ConstVectors sources,
+    float* azimuth,
+    float* elevation,
+    float* distance,
+    size_t count) {
+  const __m256 conjugate[4] = {
+      _mm256_set1_ps(-listenerRotation.x),
+      _mm256_set1_ps(-listenerRotation.y),
+      _mm256_set1_ps(-listenerRotation.z),
+      _mm256_set1_ps(listenerRotation.w)};
+  const __m256 q[4] = {
+      _mm256_set1_ps(listenerRotation.x),
+      _mm256_set1_ps(listenerRotation.y),
+      _mm256_set1_ps(listenerRotation.z),
+      _mm256_set1_ps(listenerRotation.w)};
+  const __m256 toDegrees = _mm256_set1_ps(kRadiansToDegrees);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 x = _mm256_sub_ps(_mm256_loadu_ps(sources.x + i), _mm256_set1_ps(listenerPosition.x));
+    __m256 y = _mm256_sub_ps(_mm256_loadu_ps(sources.y + i), _mm256_set1_ps(listenerPosition.y));
+    __m256 z = _mm256_sub_ps(_mm256_loadu_ps(sources.z + i), _mm256_set1_ps(listenerPosition.z));
+    sandwichAvx2(conjugate, q, x, y, z);
+    const __m256 xx = _mm256_mul_ps(x, x);
+    const __m256 zz = _mm256_mul_ps(z, z);
+    _mm256_storeu_ps(azimuth + i, _mm256_mul_ps(atan2Avx2(x, z), toDegrees));
+    _mm256_storeu_ps(
+        elevation + i,
+        _mm256_mul_ps(atan2Avx2(y, _mm256_sqrt_ps(_mm256_add_ps(xx, zz))), toDegrees));
+    _mm256_storeu_ps(
+        distance + i, _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(xx, _mm256_mul_ps(y, y)), zz)));
+  }
+  getAedScalar(
+      listenerRotation, listenerPosition, sources, azimuth, elevation, distance, i, count);
+}
+
+__attribute__((target("avx2,fma"))) void getVectorAvx2(
+    const float* azimuth,
+    const float* elevation,
+    const float* distance,
+    Vectors output,
+    size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 sinAzimuth, cosAzimuth, sinElevation, cosElevation;
+    sinCosDegreesAvx2(_mm256_loadu_ps(azimuth + i), sinAzimuth, cosAzimuth);
+    sinCosDegreesAvx2(_mm256_loadu_ps(elevation + i), sinElevation, cosElevation);
+    const __m256 d = _mm256_loadu_ps(distance + i);
+    _mm256_storeu_ps(output.x + i, _mm256_mul_ps(_mm256_mul_ps(d, sinAzimuth), cosElevation));
+    _mm256_storeu_ps(output.y + i, _mm256_mul_ps(d, sinElevation));
+    _mm256_storeu_ps(output.z + i, _mm256_mul_ps(_mm256_mul_ps(d, cosAzimuth), cosElevation));
+  }
+  getVectorScalar(azimuth, elevation, distance, output, i, count);
+}
+#endif
+
+#if FBA_BATCH_NEON
+inline float32x4_t xorNeon(float32x4_t a, uint32x4_t b) {
+  return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), b));
+}
+
+inline void sandwichNeon(
+    const float32x4_t* a,
+    const float32x4_t* b,
+    float32x4_t& x,
+    float32x4_t& y,
+    float32x4_t& z) {
+  const float32x4_t fw = vsubq_f32(
+      vsubq_f32(vsubq_f32(vdupq_n_f32(0.f), vmulq_f32(a[0], x)), vmulq_f32(a[1], y)),
+      vmulq_f32(a[2], z));
+  const float32x4_t fx =
+      vsubq_f32(vaddq_f32(vmulq_f32(a[3], x), vmulq_f32(a[1], z)), vmulq_f32(a[2], y));
+  const float32x4_t fy =
+      vaddq_f32(vsubq_f32(vmulq_f32(a[3], y), vmulq_f32(a[0], z)), vmulq_f32(a[2], x));
+  const float32x4_t fz =
+      vsubq_f32(vaddq_f32(vmulq_f32(a[3], z), vmulq_f32(a[0], y)), vmulq_f32(a[1], x));
+  x = vsubq_f32(
+      vaddq_f32(vaddq_f32(vmulq_f32(fw, b[0]), vmulq_f32(fx, b[3])), vmulq_f32(fy, b[2])),
+      vmulq_f32(fz, b[1]));
+  y = vaddq_f32(
+      vaddq_f32(vsubq_f32(vmulq_f32(fw, b[1]), vmulq_f32(fx, b[2])), vmulq_f32(fy, b[3])),
+      vmulq_f32(fz, b[0]));
+  z = vaddq_f32(
+      vsubq_f32(vaddq_f32(vmulq_f32(fw, b[2]), vmulq_f32(fx, b[1])), vmulq_f32(fy, b[0])),
+      vmulq_f32(fz, b[3]));
+}
+
+inline float32x4_t atan2Neon(float32x4_t y, float32x4_t x) {
+  const uint32x4_t sign = vdupq_n_u32(0x80000000u);
+  const float32x4_t absX = vabsq_f32(x);
+  const float32x4_t absY = vabsq_f32(y);
+  const float32x4_t low = vminq_f32(absX, absY);
+  const float32x4_t high = vmaxq_f32(absX, absY);
+  const uint32x4_t reduce = vcgtq_f32(low, vmulq_n_f32(high, kTanPiOver8));
+  const float32x4_t numerator = vbslq_f32(reduce, vsubq_f32(low, high), low);
+  const float32x4_t denominator = vbslq_f32(reduce, vaddq_f32(low, high), high);
+  const float32x4_t t = vbslq_f32(
+      vceqq_f32(denominator, vdupq_n_f32(0.f)),
+      vdupq_n_f32(0.f),
+      vdivq_f32(numerator, denominator));
+  const float32x4_t t2 = vmulq_f32(t, t);
+  float32x4_t p = vmlaq_f32(vdupq_n_f32(kAtan[1]), vdupq_n_f32(kAtan[0]), t2);
+  p = vmlaq_f32(vdupq_n_f32(kAtan[2]), p, t2);
+  p = vmlaq_f32(vdupq_n_f32(kAtan[3]), p, t2);
+  float32x4_t angle = vmlaq_f32(t, vmulq_f32(p, t2), t);
+  angle = vbslq_f32(reduce, vaddq_f32(angle, vdupq_n_f32(0.25f * kPi)), angle);
+
+  angle = vbslq_f32(vcgtq_f32(absY, absX), vsubq_f32(vdupq_n_f32(0.5f * kPi), angle), angle);
+  const uint32x4_t negativeX = vreinterpretq_u32_s32(vshrq_n_s32(vreinterpretq_s32_f32(x), 31));
+  angle = vbslq_f32(negativeX, vsubq_f32(vdupq_n_f32(kPi), angle), angle);
+  return xorNeon(angle, vandq_u32(vreinterpretq_u32_f32(y), sign));
+}
+
+inline void sinCosDegreesNeon(float32x4_t degrees, float32x4_t& sine, float32x4_t& cosine) {
+  const int32x4_t quadrant = vcvtnq_s32_f32(vmulq_n_f32(degrees, 1.f / 90.f));
+  const float32x4_t x =
+      vmulq_n_f32(vmlsq_n_f32(degrees, vcvtq_f32_s32(quadrant), 90.f), kDegreesToRadians);
+  const float32x4_t x2 = vmulq_f32(x, x);
+  float32x4_t s = vmlaq_f32(vdupq_n_f32(kSin[1]), vdupq_n_f32(kSin[0]), x2);
+  s = vmlaq_f32(vdupq_n_f32(kSin[2]), s, x2);
+  s = vmlaq_f32(x, vmulq_f32(s, x2), x);
+  float32x4_t c = vmlaq_f32(vdupq_n_f32(kCos[1]), vdupq_n_f32(kCos[0]), x2);
+  c = vmlaq_f32(vdupq_n_f32(kCos[2]), c, x2);
+  c = vmlaq_f32(vmlsq_n_f32(vdupq_n_f32(1.f), x2, 0.5f), vmulq_f32(c, x2), x2);
+
+  const int32x4_t one = vdupq_n_s32(1);
+  const int32x4_t two = vdupq_n_s32(2);
+  const uint32x4_t swap = vceqq_s32(vandq_s32(quadrant, one), one);
+  const uint32x4_t sinSign = vreinterpretq_u32_s32(vshlq_n_s32(vandq_s32(quadrant, two), 30));
+  const uint32x4_t cosSign =
+      vreinterpretq_u32_s32(vshlq_n_s32(vandq_s32(vaddq_s32(quadrant, one), two), 30));
+  sine = xorNeon(vbslq_f32(swap, c, s), sinSign);
+  cosine = xorNeon(vbslq_f32(swap, s, c), cosSign);
+}
+
+void rotateNeon(
+    ConstQuats rotations,
+    bool anti,
+    ConstVectors vectors,
+    Vectors output,
+    size_t count) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const float32x4_t q[4] = {
+        vld1q_f32(rotations.x + i),
+        vld1q_f32(rotations.y + i),
+        vld1q_f32(rotations.z + i),
+        vld1q_f32(rotations.w + i)};
+    const float32x4_t conjugate[4] = {vnegq_f32(q[0]), vnegq_f32(q[1]), vnegq_f32(q[2]), q[3]};
+    float32x4_t x = vld1q_f32(vectors.x + i);
+    float32x4_t y = vld1q_f32(vectors.y + i);
+    float32x4_t z = vld1q_f32(vectors.z + i);
+    sandwichNeon(anti ? conjugate : q, anti ? q : conjugate, x, y, z);
+    vst1q_f32(output.x + i, x);
+    vst1q_f32(output.y + i, y);
+    vst1q_f32(output.z + i, z);
+  }
+  rotateScalar(rotations, anti, vectors, output, i, count);
+}
+
+void getAedNeon(
+    const TBQuat& listenerRotation,
+    const TBVector& listenerPosition,
+    ConstVectors sources,
+    float* azimuth,
+    float* elevation,
+    float* distance,
+    size_t count) {
+  const float32x4_t conjugate[4] = {
+      vdupq_n_f32(-listenerRotation.x),
+      vdupq_n_f32(-listenerRotation.y),
+      vdupq_n_f32(-listenerRotation.z),
+      vdupq_n_f32(listenerRotation.w)};
+  const float32x4_t q[4] = {
+      vdupq_n_f32(listenerRotation.x),
+      vdupq_n_f32(listenerRotation.y),
+      vdupq_n_f32(listenerRotation.z),
+      vdupq_n_f32(listenerRotation.w)};
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    float32x4_t x = vsubq_f32(vld1q_f32(sources.x + i), vdupq_n_f32(listenerPosition.x));
+    float32x4_t y = vsubq_f32(vld1q_f32(sources.y + i), vdupq_n_f32(listenerPosition.y));
+    float32x4_t z = vsubq_f32(vld1q_f32(sources.z + i), vdupq_n_f32(listenerPosition.z));
+    sandwichNeon(conjugate, q, x, y, z);
+    const float32x4_t xx = vmulq_f32(x, x);
+    const float32x4_t zz = vmulq_f32(z, z);
+    vst1q_f32(azimuth + i, vmulq_n_f32(atan2Neon(x, z), kRadiansToDegrees));
+    vst1q_f32(
+        elevation + i,
+        vmulq_n_f32(atan2Neon(y, vsqrtq_f32(vaddq_f32(xx, zz))), kRadiansToDegrees));
+    vst1q_f32(distance + i, vsqrtq_f32(vaddq_f32(vaddq_f32(xx, vmulq_f32(y, y)), zz)));
+  }
+  getAedScalar(
+      listenerRotation, listenerPosition, sources, azimuth, elevation, distance, i, count);
+}
+
+void getVectorNeon(
+    const float* azimuth,
+    const float* elevation,
+    const float* distance,
+    Vectors output,
+    size_t count) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    float32x4_t sinAzimuth, cosAzimuth, sinElevation, cosElevation;
+    sinCosDegreesNeon(vld1q_f32(azimuth + i), sinAzimuth, cosAzimuth);
+    sinCosDegreesNeon(vld1q_f32(elevation + i), sinElevation, cosElevation);
+    const float32x4_t d = vld1q_f32(distance + i);
+    vst1q_f32(output.x + i, vmulq_f32(vmulq_f32(d, sinAzimuth), cosElevation));
+    vst1q_f32(output.y + i, vmulq_f32(d, sinElevation));
+    vst1q_f32(output.z + i, vmulq_f32(vmulq_f32(d, cosAzimuth), cosElevation));
+  }
+  getVectorScalar(azimuth, elevation, distance, output, i, count);
+}
+#endif
+} // namespace
+
+struct VectorBatch::KernelFunctions {
+  void (*rotate)(ConstQuats rotations, bool anti, ConstVectors vectors, Vectors output, size_t);
+  void (*getAed)(
+      const TBQuat& listenerRotation,
+      const TBVector& listenerPosition,
+      ConstVectors sources,
+      float* azimuth,
+      float* elevation,
+      float* distance,
+      size_t count);
+  void (*getVector)(
+      const float* azimuth,
+      const float* elevation,
+      const float* distance,
+      Vectors output,
+      size_t count);
+};
+
+VectorBatch::VectorBatch() : kernel_(&getKernelFunctions(getBestKernel())) {}
+
+bool VectorBatch::isKernelSupported(Kernel kernel) {
+  switch (kernel) {
+    case Kernel::SCALAR:
+      return true;
+#if FBA_BATCH_SSE
+    case Kernel::SSE:
+      return true;
+#endif
+#if FBA_BATCH_AVX2
+    case Kernel::AVX2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#if FBA_BATCH_NEON
+    case Kernel::NEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+VectorBatch::Kernel VectorBatch::getBestKernel() {
+  static const Kernel kFastestFirst[] = {Kernel::AVX2, Kernel::SSE, Kernel::NEON};
+  for (Kernel kernel : kFastestFirst) {
+    if (isKernelSupported(kernel)) {
+      return kernel;
+    }
+  }
+  return Kernel::SCALAR;
+}
+
+const VectorBatch::KernelFunctions& VectorBatch::getKernelFunctions(Kernel kernel) {
+  static const KernelFunctions kScalar = {rotateScalar, getAedScalar, getVectorScalar};
+  switch (kernel) {
+#if FBA_BATCH_SSE
+    case Kernel::SSE: {
+      static const KernelFunctions kSse = {rotateSse, getAedSse, getVectorSse};
+      return kSse;
+    }
+#endif
+#if FBA_BATCH_AVX2
+    case Kernel::AVX2: {
+      static const KernelFunctions kAvx2 = {rotateAvx2, getAedAvx2, getVectorAvx2};
+      return kAvx2;
+    }
+#endif
+#if FBA_BATCH_NEON
+    case Kernel::NEON: {
+      static const KernelFunctions kNeon = {rotateNeon, getAedNeon, getVectorNeon};
+      return kNeon;
+    }
+#endif
+    default:
+      return kScalar;
+  }
+}
+
+bool VectorBatch::setKernel(Kernel kernel) {
+  if (!isKernelSupported(kernel)) {
+    return false;
+  }
+  kernel_ = &getKernelFunctions(kernel);
+  return true;
+}
+
+void VectorBatch::rotateVectorByQuat(
+    ConstQuats rotations,
+    ConstVectors vectors,
+    Vectors output,
+    size_t count) const {
+  kernel_->rotate(rotations, false, vectors, output, count);
+}
+
+void VectorBatch::antiRotateVectorByQuat(
+    ConstQuats rotations,
+    ConstVectors vectors,
+    Vectors output,
+    size_t count) const {
+  kernel_->rotate(rotations, true, vectors, output, count);
+}
+
+void VectorBatch::getAedFromQuat(
+    const TBQuat& listenerRotation,
+    const TBVector& listenerPosition,
+    ConstVectors sourcePositions,
+    float* azimuth,
+    float* elevation,
+    float* distance,
+    size_t count) const {
+  kernel_->getAed(
+      listenerRotation, listenerPosition, sourcePositions, azimuth, elevation, distance, count);
+}
+
+void VectorBatch::getVectorFromAziEleDist(
+    const float* azimuth,
+    const float* elevation,
+    const float* distance,
+    Vectors output,
+    size_t count) const {
+  kernel_->getVector(azimuth, elevation, distance, output, count);
+}
+} // namespace TBE
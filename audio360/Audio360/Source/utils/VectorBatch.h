@@ -0,0 +1,116 @@
+#ifndef FBA_VECTORBATCH_H
+#define FBA_VECTORBATCH_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include "TBE_Quat.hh"
+#include "TBE_Vector.hh"
+
+namespace TBE {
+/// Batch versions of the inline TBQuat and TBVector helpers, for arrays of vectors and quaternions
+/// kept as one array per component. Arrays are processed by an SSE, AVX2 or NEON kernel picked at
+/// runtime, with a scalar fallback that calls the inline helpers element by element.
+///
+/// The vector kernels compute the quaternion products in the same order as the inline helpers, so
+/// rotations match them exactly with SSE and NEON, and to a few ulps with AVX2, whose products
+/// may be contracted into FMAs. Angles use polynomial approximations of atan2, sin and cos
+/// accurate to a few ulps: azimuths and elevations are within 1e-4 degrees of the inline helpers
+/// and vectors from angles within 1e-6 of their length.
+class VectorBatch {
+ public:
+  /// Implementations of the batch functions
+  enum class Kernel {
+    SCALAR, /// Portable reference: the inline helpers
+    SSE, /// 4 elements at a time, x86
+    AVX2, /// 8 elements at a time with FMA, x86 CPUs that support it
+    NEON, /// 4 elements at a time, AArch64
+  };
+
+  /// Vectors to read, one array per coordinate
+  struct ConstVectors {
+    const float* x;
+    const float* y;
+    const float* z;
+  };
+
+  /// Vectors to write, one array per coordinate
+  struct Vectors {
+    float* x;
+    float* y;
+    float* z;
+  };
+
+  /// Quaternions to read, one array per component
+  struct ConstQuats {
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* w;
+  };
+
+  VectorBatch();
+
+  /// @return The fastest kernel the CPU supports
+  static Kernel getBestKernel();
+
+  /// @return True if the kernel was compiled in and the CPU supports it
+  static bool isKernelSupported(Kernel kernel);
+
+  /// Use a specific kernel, e.g. the scalar reference for comparison. Defaults to getBestKernel().
+  /// @return False if the kernel isn't supported, in which case the current one is kept
+  bool setKernel(Kernel kernel);
+
+  /// TBQuat::rotateVectorByQuat() of every vector by the quaternion at the same index
+  /// @param output May be the input arrays
+  void rotateVectorByQuat(
+      ConstQuats rotations,
+      ConstVectors vectors,
+      Vectors output,
+      size_t count) const;
+
+  /// TBQuat::antiRotateVectorByQuat() of every vector by the quaternion at the same index
+  /// @param output May be the input arrays
+  void antiRotateVectorByQuat(
+      ConstQuats rotations,
+      ConstVectors vectors,
+      Vectors output,
+      size_t count) const;
+
+  /// TBQuat::getAedFromQuat() of every source for one listener: azimuth, elevation (in degrees)
+  /// and distance of each source in the listener's frame. Note that TBQuat::getAedFromQuat() takes
+  /// the source position before the listener position, despite the names in its declaration.
+  void getAedFromQuat(
+      const TBQuat& listenerRotation,
+      const TBVector& listenerPosition,
+      ConstVectors sourcePositions,
+      float* azimuth,
+      float* elevation,
+      float* distance,
+      size_t count) const;
+
+  /// TBVector::getVectorFromAziEleDist() of every azimuth, elevation and distance
+  /// @param azimuth, elevation In degrees
+  /// @param output May alias the input arrays
+  void getVectorFromAziEleDist(
+      const float* azimuth,
+      const float* elevation,
+      const float* distance,
+      Vectors output,
+      size_t count) const;
+
+ private:
+  /// One function per operation, all from the same kernel
+  struct KernelFunctions;
+
+  static const KernelFunctions& getKernelFunctions(Kernel kernel);
+
+  const KernelFunctions* kernel_;
+};
+} // namespace TBE
+
+#endif // FBA_VECTORBATCH_H
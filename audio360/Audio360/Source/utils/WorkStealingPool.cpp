@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <chrono>
+#include "Futex.h"
+#include "ThreadScheduling.h"
+
+namespace TBE {
+const size_t WorkStealingPool::kMaxTasks;
+
+WorkStealingPool::WorkStealingPool(size_t numThreads, ThreadInit threadInit)
+    : ranges_(new Range[std::max<size_t>(1, numThreads)]) {
+  for (size_t thread = 1; thread < numThreads; ++thread) {
+    workers_.emplace_back(&WorkStealingPool::workerLoop, this, thread, threadInit);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  running_.store(false);
+  batch_.fetch_add(1, std::memory_order_release);
+#if FBA_HAS_FUTEX
+  Futex::wakeAll(batch_);
+#endif
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+EngineError WorkStealingPool::setScheduling(const ThreadScheduling& scheduling) {
+  for (auto& worker : workers_) {
+    const EngineError error = applyThreadScheduling(worker, scheduling);
+    if (error != EngineError::OK) {
+      return error;
+    }
+  }
+  return EngineError::OK;
+}
+
+void WorkStealingPool::run(size_t numTasks, Task task, void* userData) {
+  if (workers_.empty()) {
+    for (size_t index = 0; index < numTasks; ++index) {
+      task(index, userData);
+    }
+    return;
+  }
+  if (numTasks <= kMaxTasks) {
+    runBatch(numTasks, task, userData);
+    return;
+  }
+  // Larger batches would overflow the ranges, so they run in parts
+  struct Part {
+    Task task;
+    void* userData;
+    size_t first;
+  };
+  for (size_t first = 0; first < numTasks; first += kMaxTasks) {
+    Part part = {task, userData, first};
+    runBatch(
+        std::min(kMaxTasks, numTasks - first),
+        [](size_t index, void* data) {
+          const auto* part = static_cast<const Part*>(data);
+          part->task(part->first + index, part->userData);
+        },
+        &part);
+  }
+}
+
+void WorkStealingPool::runBatch(size_t numTasks, Task task, void* userData) {
+  if (numTasks == 0) {
+    return;
+  }
+  // The previous batch has completed, so no thread can claim anything until the new number is
+  // published: stale threads only ever see ranges of other batches
+  const uint32_t batch = batch_.load(std::memory_order_relaxed) + 1;
+  task_.store(task, std::memory_order_relaxed);
+  userData_.store(userData, std::memory_order_relaxed);
+  numRemaining_.store(numTasks, std::memory_order_relaxed);
+  const size_t numThreads = getNumThreads();
+  for (size_t thread = 0; thread < numThreads; ++thread) {
+    ranges_[thread].bits.store(
+        pack(batch, numTasks * thread / numThreads, numTasks * (thread + 1) / numThreads),
+        std::memory_order_relaxed);
+  }
+  batch_.store(batch, std::memory_order_release);
+#if FBA_HAS_FUTEX
+  Futex::wakeAll(batch_);
+#endif
+
+  work(0, batch, task, userData);
+  // Only tasks already claimed by other threads are left
+  while (numRemaining_.load(std::memory_order_acquire) != 0) {
+    std::this_thread::yield();
+  }
+}
+
+void WorkStealingPool::work(size_t thread, uint32_t batch, Task task, void* userData) {
+  const size_t numThreads = getNumThreads();
+  for (size_t i = 0; i < numThreads; ++i) {
+    const size_t victim = (thread + i) % numThreads;
+    Range& range = ranges_[victim];
+    uint64_t bits = range.bits.load(std::memory_order_acquire);
+    for (;;) {
+      const uint32_t rangeBatch = static_cast<uint32_t>(bits >> 32);
+      const size_t begin = static_cast<size_t>((bits >> 16) & 0xffff);
+      const size_t end = static_cast<size_t>(bits & 0xffff);
+      if (rangeBatch != batch || begin >= end) {
+        break;
+      }
+      // Owners take from the front, thieves from the back
+      const bool own = victim == thread;
+      const size_t index = own ? begin : end - 1;
+      const uint64_t claimed = own ? pack(batch, begin + 1, end) : pack(batch, begin, end - 1);
+      if (range.bits.compare_exchange_weak(bits, claimed, std::memory_order_acquire)) {
+        task(index, userData);
+        numRemaining_.fetch_sub(1, std::memory_order_release);
+        bits = range.bits.load(std::memory_order_acquire);
+      }
+    }
+  }
+}
+
+void WorkStealingPool::workerLoop(size_t thread, ThreadInit threadInit) {
+  if (threadInit) {
+    threadInit();
+  }
+  uint32_t seen = 0;
+  for (;;) {
+    const uint32_t batch = batch_.load(std::memory_order_acquire);
+    if (!running_.load()) {
+      return;
+    }
+    if (batch == seen) {
+#if FBA_HAS_FUTEX
+      Futex::wait(batch_, seen, -1);
+#else
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+      continue;
+    }
+    seen = batch;
+    // May belong to a later batch if this thread is late, in which case the ranges of this batch
+    // are all empty and nothing is claimed
+    const Task task = task_.load(std::memory_order_relaxed);
+    void* const userData = userData_.load(std::memory_order_relaxed);
+    work(thread, batch, task, userData);
+  }
+}
+} // namespace TBE
@@ -0,0 +1,88 @@
+#ifndef FBA_WORKSTEALINGPOOL_H
+#define FBA_WORKSTEALINGPOOL_H
+
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "TBE_AudioEngineDefinitions.h"
+
+namespace TBE {
+/// Fork-join pool for the audio thread. run() splits a batch of tasks into one contiguous range
+/// per thread, the calling thread included. Each thread takes tasks from the front of its own
+/// range and, once it is empty, steals from the back of the others, so a few expensive tasks
+/// don't hold the batch up. Claiming a task is a compare-and-swap on the range, which carries the
+/// batch number so that a thread waking up late can't claim tasks of the next batch.
+///
+/// Idle workers sleep on a futex and run() wakes them with one system call; nothing locks or
+/// allocates while a batch runs. Where futexes aren't available, idle workers poll every
+/// millisecond and the calling thread does the work they haven't picked up.
+class WorkStealingPool {
+ public:
+  typedef void (*Task)(size_t index, void* userData);
+  typedef void (*ThreadInit)();
+
+  /// Largest number of tasks in a batch, larger batches are split
+  static const size_t kMaxTasks = 0xffff;
+
+  /// @param numThreads Threads running tasks, including the one calling run(). 0 is the same as 1,
+  /// in which case run() calls the tasks in order on the calling thread.
+  /// @param threadInit Called on every worker thread when it starts, or nullptr
+  explicit WorkStealingPool(size_t numThreads, ThreadInit threadInit = nullptr);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  /// @return Threads running tasks, including the calling thread
+  size_t getNumThreads() const {
+    return workers_.size() + 1;
+  }
+
+  /// Apply a scheduling policy, priority and CPU affinity to the worker threads
+  /// @return The first error, or EngineError::OK
+  EngineError setScheduling(const ThreadScheduling& scheduling);
+
+  /// Call task(index, userData) for every index below numTasks, and return once every call has
+  /// returned. Tasks may run on any thread, in any order. Must not be called concurrently.
+  void run(size_t numTasks, Task task, void* userData);
+
+ private:
+  /// Unclaimed tasks of a thread: batch number, first and one past the last task. Padded to a
+  /// cache line, since every claim writes it.
+  struct Range {
+    std::atomic<uint64_t> bits{0};
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+  };
+
+  static uint64_t pack(uint32_t batch, size_t begin, size_t end) {
+    return (static_cast<uint64_t>(batch) << 32) | (static_cast<uint64_t>(begin) << 16) | end;
+  }
+
+  void runBatch(size_t numTasks, Task task, void* userData);
+
+  /// Run tasks of a batch until every range is empty, own range first
+  void work(size_t thread, uint32_t batch, Task task, void* userData);
+
+  void workerLoop(size_t thread, ThreadInit threadInit);
+
+  std::unique_ptr<Range[]> ranges_; // One per thread, the calling thread first
+  std::vector<std::thread> workers_;
+
+  std::atomic<uint32_t> batch_{0}; // Futex word, incremented for every batch
+  std::atomic<Task> task_{nullptr};
+  std::atomic<void*> userData_{nullptr};
+  std::atomic<size_t> numRemaining_{0};
+  std::atomic<bool> running_{true};
+};
+} // namespace TBE
+
+#endif // FBA_WORKSTEALINGPOOL_H
@@ -21,6 +21,15 @@ typedef struct {
 } AudioAssetHandle;
 const AudioAssetHandle InvalidAudioAssetHandle;
 
+/// Counters of the decoded memory budget, see AudioAssetManager::setDecodedMemoryBudget()
+struct AudioAssetCacheStatistics {
+  size_t hits{0}; /// Streams and decoders created from decoded audio held in memory
+  size_t misses{0}; /// Streams and decoders created from the fallback of an evicted asset
+  size_t evictions{0}; /// Decoded assets released to stay within the budget
+  size_t decodedBytes{0}; /// Decoded audio currently held in memory, in bytes
+  size_t budgetBytes{0}; /// Budget for decoded audio in bytes, 0 if unlimited
+};
+
 ///
 /// AudioAssetManager is to open file or allocate memory and load audio data
 /// from file to memory only once to read audio data efficiently.
@@ -110,6 +119,29 @@ class AudioAssetManager {
   /// AssetAccessMode::DECODED_MEMORY)
   /// @return The total size in bytes of assets loaded in memory
   virtual size_t getBytesInMemory() = 0;
+
+  /// Bound the memory used by AssetAccessMode::DECODED_MEMORY assets. When loading an asset takes
+  /// the decoded audio over the budget, the least recently used decoded assets are released and
+  /// from then on served in fallbackMode, so handles stay valid: getNewStream() and getNewDecoder()
+  /// read the file, or its raw bytes loaded to memory, instead. Loading an evicted asset again
+  /// decodes it again. getMode() reports the mode an asset is currently served in.
+  /// Streams that are still open keep the decoded audio they read alive until they are destroyed.
+  /// @param budgetInBytes Budget for decoded audio in bytes, 0 for no limit (the default)
+  /// @param fallbackMode AssetAccessMode::FILE or AssetAccessMode::MEMORY
+  /// @return EngineError::NOT_SUPPORTED if the asset manager has no budget, or
+  /// EngineError::INVALID_PARAM if fallbackMode is not FILE or MEMORY
+  virtual EngineError setDecodedMemoryBudget(
+      size_t budgetInBytes,
+      AssetAccessMode fallbackMode = AssetAccessMode::FILE) {
+    (void)budgetInBytes;
+    (void)fallbackMode;
+    return EngineError::NOT_SUPPORTED;
+  }
+
+  /// @return Hit, miss and eviction counters of the decoded memory budget
+  virtual AudioAssetCacheStatistics getCacheStatistics() {
+    return AudioAssetCacheStatistics();
+  }
 };
 
 } // namespace TBE
@@ -121,6 +153,19 @@ extern "C" {
 /// @param engine Pointer to the asset manager instance (must be null)
 /// @return Relevant error or EngineError::OK
 API_EXPORT TBE::EngineError TBE_CreateAudioAssetManager(TBE::AudioAssetManager*& assetManager);
+
+/// Create an asset manager that publishes DECODED_MEMORY assets in POSIX shared memory. Processes
+/// using the same pool name decode each asset once and map the same copy of it: an asset is keyed
+/// by its canonical path, AssetDescriptor, file size and modification time, reference counted
+/// across processes and unlinked when the last process unloads it. Pass the manager to the engine
+/// through MemorySettings::audioAssetManager. Linux only.
+/// @param assetManager Pointer to the asset manager instance (must be null)
+/// @param poolName Name of the pool, without '/' and at most 200 characters
+/// @return EngineError::NOT_SUPPORTED if shared memory pools are not supported on this platform,
+/// relevant error or EngineError::OK
+API_EXPORT TBE::EngineError TBE_CreateSharedAudioAssetManager(
+    TBE::AudioAssetManager*& assetManager,
+    const char* poolName);
 }
 
 #endif // FBA_TBE_AUDIOASSETMANAGER_H
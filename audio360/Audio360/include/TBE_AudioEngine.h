@@ -368,7 +368,10 @@ class AudioEngine {
   /// @return Relevant error or EngineError::OK
   virtual EngineError getMasterBusName(char name[AUDIO360_MAX_BUS_NAME_SIZE]) = 0;
 
-  /// Set a function to receive events from the audio engine.
+  /// Set a function to receive events from the audio engine. With an audio device,
+  /// Event::ERROR_BUFFER_UNDERRUN is sent from the audio thread when a block took longer to render
+  /// than to play. With AudioDeviceType::DISABLED, nothing plays the mix in real time, and such
+  /// blocks are only counted in StageStatistics::numSlowBlocks.
   /// @param callback Event callback function
   /// @param userData User data. Can be nullptr
   /// @return Relevant error or EngineError::OK
@@ -551,6 +554,75 @@ class AudioEngine {
   /// @param path Path and file name
   /// @return true on success
   virtual bool saveGraph(const char* path) = 0;
+
+  /// Experimental, use with caution! Start or stop recording the activity of the audio and
+  /// decoder threads: audio callbacks, decode jobs, queue underruns and voice mode changes. Events
+  /// go into a lock-free ring per thread that keeps the most recent ones. Off by default.
+  /// @param enabled true to record
+  virtual void enableTracing(bool enabled) {
+    (void)enabled;
+  }
+
+  /// Experimental, use with caution! Save the recorded activity as Chrome trace event json, which
+  /// chrome://tracing and Perfetto open. Can be called while tracing.
+  /// @param path Path and file name
+  /// @return true on success
+  virtual bool saveTrace(const char* path) {
+    (void)path;
+    return false;
+  }
+
+  /// Switch the master reverb between the parametric reverb and convolution with the impulse
+  /// response set with setMasterReverbImpulseResponse(). The convolution reverb is silent until a
+  /// response is set. Room size, dampening and width only apply to the parametric reverb.
+  /// Default: MasterReverbMode::PARAMETRIC
+  /// @param mode The reverb algorithm
+  /// @return Relevant error or EngineError::OK
+  virtual EngineError setMasterReverbMode(MasterReverbMode mode) {
+    return mode == MasterReverbMode::PARAMETRIC ? EngineError::OK : EngineError::NOT_SUPPORTED;
+  }
+
+  /// Get the master reverb algorithm
+  /// @return The reverb algorithm
+  virtual MasterReverbMode getMasterReverbMode() {
+    return MasterReverbMode::PARAMETRIC;
+  }
+
+  /// Load the binaural room impulse response used by MasterReverbMode::CONVOLUTION from a mono or
+  /// stereo (left, right) wav file. The file is resampled to the engine's sample rate. Responses
+  /// can be several seconds long: with an audio device, the tail is convolved on a background
+  /// thread that the audio thread never waits for, and a late tail block is played as silence and
+  /// counted in StageStatistics::numLateReverbBlocks. With AudioDeviceType::DISABLED, the tail is
+  /// convolved in getAudioMix(). Returns EngineError::NOT_SUPPORTED if the engine's buffer size
+  /// isn't a multiple of 16.
+  /// @param nameAndPath Path of the wav file
+  /// @return Relevant error or EngineError::OK
+  virtual EngineError setMasterReverbImpulseResponse(const char* nameAndPath) {
+    (void)nameAndPath;
+    return EngineError::NOT_SUPPORTED;
+  }
+
+  /// Set the binaural room impulse response used by MasterReverbMode::CONVOLUTION from memory.
+  /// The response is copied.
+  /// @param left Left ear response at the engine's sample rate
+  /// @param right Right ear response, or nullptr to use the left ear response for both ears
+  /// @param numSamples Number of samples of each response
+  /// @return Relevant error or EngineError::OK
+  virtual EngineError
+  setMasterReverbImpulseResponse(const float* left, const float* right, size_t numSamples) {
+    (void)left;
+    (void)right;
+    (void)numSamples;
+    return EngineError::NOT_SUPPORTED;
+  }
+
+  /// Get the time spent in each stage of rendering a block and by the most expensive AudioObjects,
+  /// over the last StageStatistics::kTimingWindow blocks. Lock-free, can be called from any thread
+  /// without delaying the audio thread.
+  /// @return The statistics, all zero if they aren't supported
+  virtual StageStatistics getStageStatistics() {
+    return StageStatistics();
+  }
 };
 
 class TransportControl {
@@ -830,11 +902,31 @@ class SpatDecoderInterface : public Object3D {
   virtual ~SpatDecoderInterface() {}
 };
 
+/// Space in a SpatDecoderQueue reserved with SpatDecoderQueue::reserveWrite(), to be filled with
+/// interleaved float samples and then passed to SpatDecoderQueue::commitWrite(). The space is split
+/// in two spans where it wraps around the end of the queue; samples go into first, then second.
+struct QueueWriteRegion {
+  float* first{nullptr};
+  int32_t firstSize{0}; /// Samples, including all channels
+  float* second{nullptr};
+  int32_t secondSize{0}; /// Samples, including all channels
+  int32_t numTotalSamples{0}; /// firstSize + secondSize, 0 if nothing could be reserved
+  ChannelMap channelMap{ChannelMap::INVALID}; /// Set by the queue
+  uint64_t position{0}; /// Set by the queue
+};
+
 /// An object for enqueuing and processing spatial audio buffers.
 /// Data that is enqueued will be dequeued and processed by the audio engine in the audio device
 /// callback. If the audio device is disabled, the data will be processed when
-/// AudioEngine::getAudioMix is called. The audio queue is implemented as a lock-free circular
-/// buffer (thread safe for one producer and one consumer).
+/// AudioEngine::getAudioMix is called. The audio queue is implemented as a circular buffer: any
+/// number of threads can enqueue concurrently, and the engine dequeues without locking. Each
+/// enqueueData() or enqueueSilence() call queues a contiguous run of whole frames, which are never
+/// interleaved with frames from another call. Calls from different threads are queued in the order
+/// they reserved space in the queue. Reserving space is lock-free but not wait-free: a thread only
+/// retries when another one reserved in the meantime, but can retry any number of times while
+/// others keep reserving. Publication is ordered: a call can block until the calls that reserved
+/// space before it have written their data, which commitWrite() can bound with a timeout. With a
+/// single producer thread, enqueueing never blocks.
 class SpatDecoderQueue : public SpatDecoderInterface {
  public:
   /// Get the free space in the queue (in number of samples) for the kind of data you are enqueueing
@@ -883,6 +975,83 @@ class SpatDecoderQueue : public SpatDecoderInterface {
   /// Returns true if the end of stream flag has been set using setEndOfStream(..)
   virtual bool getEndOfStreamStatus() const = 0;
 
+  /// Reserve space to write interleaved float samples straight into the queue, without the copy
+  /// made by enqueueData(). Every reserved region must be committed with commitWrite(), even if
+  /// nothing was written to it, as data enqueued later from other threads is only played after it.
+  /// The spans stay valid until then.
+  /// @param numTotalSamples Number of total samples to reserve (including all channels). Rounded
+  /// down to whole frames and to the free space in the queue.
+  /// @param channelMap The channel map for the data being enqueued
+  /// @return The reserved region, with numTotalSamples set to 0 if the queue is full or the channel
+  /// map isn't supported
+  virtual QueueWriteRegion reserveWrite(int32_t numTotalSamples, ChannelMap channelMap) {
+    (void)numTotalSamples;
+    QueueWriteRegion region;
+    region.channelMap = channelMap;
+    return region;
+  }
+
+  /// Enqueue samples written into a region returned by reserveWrite(), once every region reserved
+  /// before it has been enqueued.
+  /// A partial commit only gives back the unwritten rest of the region if nothing was reserved
+  /// after it. If another thread reserved space in the meantime, the rest of the region is played
+  /// as silence, in the middle of the stream, between these samples and the next thread's.
+  /// @param region The reserved region
+  /// @param numTotalSamples Number of total samples written from the start of the region
+  /// (including all channels)
+  /// @param timeoutMs Longest wait in milliseconds for the regions reserved before this one, or
+  /// negative to wait until they are enqueued
+  /// @return Number of samples successfully been queued, or -1 if the wait timed out. The region
+  /// then stays reserved, and commitWrite() must be called for it again.
+  virtual int32_t
+  commitWrite(const QueueWriteRegion& region, int32_t numTotalSamples, int32_t timeoutMs) {
+    (void)region;
+    (void)numTotalSamples;
+    (void)timeoutMs;
+    return 0;
+  }
+
+  /// Block the calling thread until the queue has free space for numTotalSamples samples, instead
+  /// of polling getFreeSpaceInQueue(). The engine wakes waiting threads after dequeueing, only when
+  /// enough space has been freed. Any number of threads can wait.
+  /// @param numTotalSamples Number of total samples to wait for (including all channels)
+  /// @param channelMap The channel map for the data being enqueued
+  /// @param timeoutMs Longest wait in milliseconds, or negative to wait until the space is free.
+  /// With 0 the call doesn't block, but arms the descriptor returned by getFreeSpaceEventFD().
+  /// @return EngineError::OK if the space is free, EngineError::QUEUE_FULL if the wait timed out,
+  /// or EngineError::INVALID_PARAM if the channel map isn't supported or numTotalSamples is larger
+  /// than the queue
+  virtual EngineError
+  waitForFreeSpace(int32_t numTotalSamples, ChannelMap channelMap, int32_t timeoutMs) {
+    (void)numTotalSamples;
+    (void)channelMap;
+    (void)timeoutMs;
+    return EngineError::NOT_SUPPORTED;
+  }
+
+  /// A non-blocking file descriptor that becomes readable when a waitForFreeSpace() call that
+  /// returned EngineError::QUEUE_FULL could now succeed, for ingest loops built on epoll or poll.
+  /// Read 8 bytes from it to reset it, then call waitForFreeSpace() with a timeout of 0 to check
+  /// the space and re-arm it. The descriptor is owned by the queue. Linux only.
+  /// @param channelMap The channel map for the data being enqueued
+  /// @return The file descriptor, or -1 if it isn't supported
+  virtual int getFreeSpaceEventFD(ChannelMap channelMap) {
+    (void)channelMap;
+    return -1;
+  }
+
+  /// Fill level watermarks and underruns of the queue for a channel map, since it was created or
+  /// resetQueueStatistics() was last called. Lock-free, can be called from any thread.
+  /// @param channelMap Channel map for the data
+  /// @return The statistics, all zero if the channel map isn't supported
+  virtual QueueStatistics getQueueStatistics(ChannelMap channelMap) const {
+    (void)channelMap;
+    return QueueStatistics();
+  }
+
+  /// Clear the watermarks and underrun counters of every queue. Applied on the next audio block.
+  virtual void resetQueueStatistics() {}
+
  protected:
   virtual ~SpatDecoderQueue() {}
 };
@@ -985,6 +1154,15 @@ class SpeakersVirtualizer : public TransportControl {
   /// @see setVolume, setVolumeDecibels
   virtual float getVolumeDecibels() const = 0;
 
+  /// Fill level watermarks and underruns of the queue since the virtualizer was created or
+  /// resetQueueStatistics() was last called. Lock-free, can be called from any thread.
+  virtual QueueStatistics getQueueStatistics() const {
+    return QueueStatistics();
+  }
+
+  /// Clear the watermarks and underrun counters. Applied on the next audio block.
+  virtual void resetQueueStatistics() {}
+
  protected:
   virtual ~SpeakersVirtualizer(){};
 };
@@ -1124,7 +1302,10 @@ extern "C" {
 /// @param engine Pointer to the engine instance
 /// @param initSettings Initialisation settings. Can be TBE::EngineInitSettings_default.
 /// @see TBE::EngineInitSettings for all the initialisation settings.
-/// @return Relevant error or EngineError::OK
+/// @return Relevant error or EngineError::OK. EngineError::CANNOT_APPLY_THREAD_SETTINGS if the
+/// system refused the scheduling or memory locking requested in TBE::ThreadSettings. The error
+/// of reading the HRIRs or their manifest if TBE::HrtfSettings::manifestPath is set, or
+/// EngineError::NOT_SUPPORTED if the buffer size is too small for binaural rendering.
 API_EXPORT TBE::EngineError TBE_CreateAudioEngine(
     TBE::AudioEngine*& engine,
     TBE::EngineInitSettings initSettings = TBE::EngineInitSettings());
@@ -49,6 +49,7 @@ struct AAssetManager;
 namespace TBE {
 
 class AudioAssetManager;
+class AudioObject;
 
 //--------- ENUMS --------------//
 
@@ -94,6 +95,7 @@ enum class AttenuationType {
 };
 
 enum class EngineError {
+  CANNOT_APPLY_THREAD_SETTINGS = -30,
   CANNOT_CREATE_VOICE = -29,
   VOICE_LIMIT_REACHED = -28,
   VOICE_NOT_FOUND = -27,
@@ -235,6 +237,68 @@ struct EngineStatistics {
   size_t numSpatDecoderQueuesPlaying{0};
 };
 
+/// Time spent in one stage of rendering per block, over the last StageStatistics::kTimingWindow
+/// blocks
+struct StageTiming {
+  float minMicroSec{0.f};
+  float meanMicroSec{0.f};
+  float p99MicroSec{0.f}; /// 99th percentile
+  float maxMicroSec{0.f};
+};
+
+/// Time spent rendering an AudioObject per block
+struct AudioObjectCost {
+  AudioObject* object{nullptr}; /// Only valid until the object is destroyed
+  float meanMicroSec{0.f}; /// Moving average over about StageStatistics::kTimingWindow blocks
+  float maxMicroSec{0.f}; /// Longest block within the last one to two windows
+};
+
+/// Where the time of the audio callback goes, by stage of rendering and by AudioObject. See
+/// AudioEngine::getStageStatistics().
+struct StageStatistics {
+  static const size_t kTimingWindow = 512; /// Blocks summarised by each StageTiming
+  static const size_t kMaxObjectCosts = 8;
+
+  StageTiming callbackTiming; /// Rendering a whole block, the sum of the stages below and more
+  StageTiming decodeTiming; /// Decoding in the audio thread (ThreadSettings::useDecoderThread off)
+  StageTiming binauralConvolutionTiming; /// HRIR convolution of objects rendered binaurally
+  StageTiming rotationTiming; /// Rotating the ambisonic beds of SpatDecoders and AudioObjects
+  StageTiming binauralDecodeTiming; /// Decoding the ambisonic mix to binaural
+  StageTiming reverbTiming; /// Master reverb, in the audio thread
+  StageTiming loudnessTiming; /// Loudness metering
+  StageTiming mixTiming; /// Bus gains, summing the mixes and applying the master gain
+  StageTiming decoderThreadTiming; /// One pass of the decoder thread, which runs on its own
+
+  size_t numObjectCosts{0};
+  AudioObjectCost objectCosts[kMaxObjectCosts]; /// The most expensive AudioObjects first
+
+  size_t numBinauralObjects{0}; /// AudioObjects rendered with SpatialisationType::BINAURAL in the
+                                /// last block
+  float binauralCrossfadeFraction{0.f}; /// Of the AudioObjects rendered binaurally over the last
+                                        /// kTimingWindow blocks, the fraction that crossfaded
+                                        /// between two HRIRs, 0 to 1
+  bool binauralAmbisonic{false}; /// AudioObjects rendered binaurally went through the ambisonic
+                                 /// bus of BinauralRendering in the last block
+
+  size_t numSlowBlocks{0}; /// Blocks that took longer to render than to play, since the engine
+                           /// was created. Each one would have starved an audio device.
+  size_t numLateReverbBlocks{0}; /// Tail blocks of the convolution reverb played as silence
+                                 /// because its thread fell behind, since the engine was created
+};
+
+/// Fill level history of a queue played by the engine, for sizing
+/// MemorySettings::spatQueueSizePerChannel from measurements. Watermarks are taken at the start of
+/// every block the queue plays. See SpatDecoderQueue::getQueueStatistics() and
+/// SpeakersVirtualizer::getQueueStatistics().
+struct QueueStatistics {
+  size_t queueSize{0}; /// Size of the queue, in samples including all channels
+  size_t numQueued{0}; /// Samples currently queued
+  size_t highWatermark{0}; /// Most samples queued at the start of a block
+  size_t lowWatermark{0}; /// Fewest samples queued at the start of a block, once playback started
+  size_t numUnderrunBlocks{0}; /// Blocks that could not be played in full for lack of data
+  int64_t lastStarvationDSPTime{-1}; /// AudioEngine::getDSPTime() of the last underrun, or -1
+};
+
 //--------- STRUCTURES --------------//
 
 struct AttenuationProps {
@@ -299,6 +363,11 @@ enum class SpatialisationType {
   BINAURAL,
 };
 
+enum class MasterReverbMode {
+  PARAMETRIC, /// Algorithmic reverb controlled by room size, dampening and width
+  CONVOLUTION, /// Measured binaural room impulse response
+};
+
 enum class AssetAccessMode {
   FILE,
   MEMORY,
@@ -364,7 +433,24 @@ struct PlatformSettings {
 struct Experimental {
   AmbisonicRenderer ambisonicRenderer{AmbisonicRenderer::AMBISONIC};
   bool useFba{false};
-  uint8_t fbaNumThreads{0};
+  uint8_t fbaNumThreads{0}; /// Threads rendering AudioObjects, including the audio thread.
+                            /// Above 1, groups of objects are rendered on a work-stealing pool
+                            /// of mixer threads. The mix is bit-identical for any value.
+};
+
+/// Scheduling policy of an engine thread
+enum class ThreadPolicy {
+  DEFAULT, /// The platform's time-sharing policy
+  FIFO, /// Real-time, runs until it blocks or a higher priority thread runs (SCHED_FIFO)
+  ROUND_ROBIN, /// Real-time, time-sliced between threads of the same priority (SCHED_RR)
+};
+
+/// Scheduling of the engine's decoder or mixer threads. Only supported on Linux, where real-time
+/// policies need CAP_SYS_NICE or an RLIMIT_RTPRIO of at least the priority.
+struct ThreadScheduling {
+  ThreadPolicy policy{ThreadPolicy::DEFAULT};
+  int32_t priority{0}; /// 1 (lowest) to 99 for real-time policies, ignored by DEFAULT
+  uint64_t cpuAffinityMask{0}; /// Bit n lets the threads run on CPU n. 0 for any CPU.
 };
 
 struct ThreadSettings {
@@ -377,8 +463,66 @@ struct ThreadSettings {
 };
 
 struct VoiceManagerSettings {
-  size_t maxPhysicalVoices{0};
-  size_t maxVirtualVoices{0};
+  size_t maxPhysicalVoices{0}; /// Voices rendered by an AudioObject. 0 for one per pooled
+                               /// AudioObject.
+  size_t maxVirtualVoices{0}; /// Voices beyond maxPhysicalVoices, tracked without being rendered
+                              /// until they are among the most audible. Limited by
+                              /// kMaxTotalVoices.
+};
+
+/// How AudioObjects rendered with SpatialisationType::BINAURAL follow a measured HRTF as they move
+enum class HrtfInterpolation {
+  NEAREST, /// The nearest measurement's HRIRs, crossfaded with the previous ones when it changes
+  INTERPOLATED, /// The three nearest measurements' HRIRs with their delays removed, mixed with
+                /// interpolated magnitudes, followed by a delay line per ear playing the
+                /// interpolated interaural time delay. The HRIRs are only recomputed and
+                /// crossfaded when the direction has moved by crossfadeThresholdDegrees.
+};
+
+/// How AudioObjects rendered with SpatialisationType::BINAURAL are convolved with the HRTF
+enum class BinauralRendering {
+  PER_OBJECT, /// Every object through its own HRIR convolution, whose cost grows with the HRIRs
+  AMBISONIC, /// Every object encoded into a shared ambiX bus with spherical harmonic gains, and
+             /// the bus rendered once through 2 x (N + 1)^2 convolutions with spherical harmonic
+             /// domain HRIRs. Objects then cost (N + 1)^2 multiply-adds per sample, whatever the
+             /// HRTF.
+  AUTOMATIC, /// AMBISONIC while more than ambisonicObjectThreshold objects are rendered binaurally,
+             /// PER_OBJECT again once at most three quarters of the threshold are
+};
+
+/// HRTF of AudioObjects rendered with SpatialisationType::BINAURAL. By default they use the
+/// engine's spherical head model. A measured HRTF is read from a manifest: one measurement per
+/// line, "azimuth elevation file.wav", with the angles in degrees (azimuth positive to the right,
+/// elevation positive up, as TBVector::getVectorFromAziEle()), the path relative to the manifest
+/// and a stereo (left, right) WAV HRIR. Lines starting with '#' are comments.
+struct HrtfSettings {
+  const char* manifestPath{nullptr}; /// Measured HRTF manifest, nullptr for the head model
+  const char* cachePath{nullptr}; /// File keeping the filters computed from the manifest, so that
+                                  /// they are read back instead of computed the next time the
+                                  /// engine is created with the same HRIRs, sample rate and
+                                  /// buffer size. nullptr to compute them every time.
+  HrtfInterpolation interpolation{HrtfInterpolation::NEAREST}; /// Measured HRTFs only
+  float crossfadeThresholdDegrees{2.f}; /// With HrtfInterpolation::INTERPOLATED, the angle an
+                                        /// object's direction must move by before its HRIRs are
+                                        /// recomputed and crossfaded, paying for a second
+                                        /// convolution for one block
+  BinauralRendering rendering{BinauralRendering::PER_OBJECT};
+  ChannelMap ambisonicFormat{ChannelMap::AMBIX_16}; /// Bus of BinauralRendering::AMBISONIC:
+                                                    /// AMBIX_4, AMBIX_9 or AMBIX_16
+  size_t ambisonicObjectThreshold{16}; /// Objects rendered binaurally above which
+                                       /// BinauralRendering::AUTOMATIC uses the ambisonic bus
+};
+
+/// Number and scheduling of the engine's threads, in addition to ThreadSettings
+struct ThreadSchedulingSettings {
+  int32_t numMixerThreads{0}; /// Threads rendering AudioObjects, including the audio thread.
+                              /// 0 to use Experimental::fbaNumThreads.
+  ThreadScheduling decoderThread; /// Scheduling of the decoder thread
+  ThreadScheduling mixerThreads; /// Scheduling of the mixer threads. The audio thread belongs to
+                                 /// the audio device or to the caller of getAudioMix().
+  bool lockMemory{false}; /// Lock all current and future memory of the process into RAM with
+                          /// mlockall() once the engine is created, so that the audio thread
+                          /// never waits for a page fault. It is never unlocked.
 };
 
 struct EngineInitSettings {
@@ -388,6 +532,8 @@ struct EngineInitSettings {
   ThreadSettings threads;
   Experimental experimental;
   VoiceManagerSettings voiceManagerSettings;
+  HrtfSettings hrtf;
+  ThreadSchedulingSettings threadScheduling;
 };
 
 enum class EventTransportMessageType { Note, Control, Tempo, TimeSignature, Custom };
@@ -27,6 +27,8 @@ class AudioObject : public SpatDecoderInterface {
 
   /// Use this function to set a callback for audio data to be provided by the client
   /// The client must ensure the callback pointer is valid for the lifetime of the AudioObject
+  /// The callback is called from the audio thread, or from one of the engine's mixer threads if
+  /// Experimental::fbaNumThreads is larger than 1. Callbacks of different objects can run at once.
   /// If a file has been previously opened with the @ref open() call it will be closed
   /// @param BufferCallback The callback pointer to be called for providing audio
   /// @param numChannels The number of channels of audio data the client wants to provide. 1, 2 and
@@ -144,8 +146,9 @@ class AudioObject : public SpatDecoderInterface {
   /// @param override true to override
   virtual void overrideRanking(bool override) = 0;
 
-  /// This feature is currently unsupported and will return an EngineError.
-  /// Switch spatialization type between ambisonics and binaural.
+  /// Switch spatialization type between ambisonics and binaural. Binaural objects are convolved
+  /// with HRIRs directly instead of being mixed into the ambisonic sound field. Returns
+  /// EngineError::NOT_SUPPORTED if the engine's buffer size isn't a multiple of 16.
   /// Default: ambisonics
   /// @param spatType ambisonics or binaural
   /// @return Relevant error or EngineError::OK
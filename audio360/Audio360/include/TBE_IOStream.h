@@ -70,6 +70,18 @@ class IOStream {
   /// @return the file descriptor, if available. Returns -1 if there's an error or unavailable.
   virtual int getFD() = 0;
 
+  /// Borrow the next bytes of the stream without copying them and advance past them. Only streams
+  /// backed by memory support this; the pointer stays valid until the stream is destroyed.
+  /// @param numBytes Number of bytes to borrow
+  /// @param numBorrowed Set to the number of bytes available at the returned pointer, which is
+  /// less than numBytes at the end of the stream
+  /// @return Pointer to the bytes, or nullptr if the stream does not support borrowing
+  virtual const void* borrow(size_t numBytes, size_t& numBorrowed) {
+    (void)numBytes;
+    numBorrowed = 0;
+    return nullptr;
+  }
+
   /// Create a basic file stream object to read/write files.
   /// @param file Path and name of file
   /// @param options If the file must read, write or both
@@ -78,6 +90,27 @@ class IOStream {
   API_EXPORT static IOStream*
   createFileStream(const char* file, StreamOptions options, AssetDescriptor ad = AssetDescriptor());
 
+  /// Create a read-only stream that memory maps a file. Reads are served from the page cache with
+  /// sequential read-ahead, and borrow() hands out pointers into the mapping, which lets decoders
+  /// read PCM without copying it. The file must not be truncated while the stream is open.
+  /// @param file Path and name of file
+  /// @param ad Optional AssetDecriptor for mapping a chunk of a larger file, such as a bundle.
+  /// @return New IOStream object, or nullptr if the file could not be mapped or memory mapping is
+  /// not supported on this platform
+  API_EXPORT static IOStream*
+  createMappedFileStream(const char* file, AssetDescriptor ad = AssetDescriptor());
+
+  /// Create a read-only file stream that reads ahead asynchronously. Every stream created this way
+  /// submits its reads through a single io_uring submission queue and keeps a window of reads in
+  /// flight ahead of its position, so that a thread serving many streams, such as SpatDecoderFiles
+  /// opened with open(IOStream* streams[2], ...), rarely waits on the disk.
+  /// @param file Path and name of file
+  /// @param ad Optional AssetDecriptor for specifying a custom size and offset.
+  /// @return New IOStream object, or nullptr if the file could not be opened or io_uring is not
+  /// available (Linux 5.1 and above)
+  API_EXPORT static IOStream*
+  createAsyncFileStream(const char* file, AssetDescriptor ad = AssetDescriptor());
+
   /// Create a read-only stream from a buffer of memory
   /// @param sizeInBytes size of the memory in bytes
   /// @param offsetInBytes Offset in bytes from which to start reading the buffer
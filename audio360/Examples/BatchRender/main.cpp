@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TBE_AudioEngine.h"
+#include "TBE_AudioFormat.h"
+#include "TBE_AudioObject.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace TBE;
+
+/// A listener orientation at a point in time, in degrees
+struct Keyframe {
+  double timeSec{0.0};
+  float yaw{0.f};
+  float pitch{0.f};
+  float roll{0.f};
+};
+
+struct Job {
+  size_t line{0};
+  std::string input;
+  std::string output;
+  ChannelMap map{ChannelMap::UNKNOWN};
+  std::vector<Keyframe> trajectory;
+  EngineError error{EngineError::OK}; /// Set if the job can't be rendered
+};
+
+struct Settings {
+  unsigned int numWorkers{0};
+  float sampleRate{48000.f};
+  int bufferSize{1024};
+  bool pinWorkers{true};
+  bool reverb{false};
+  double tailSec{2.0};
+};
+
+struct JobResult {
+  EngineError error{EngineError::OK};
+  double renderedSec{0.0};
+  double elapsedSec{0.0};
+};
+
+static const struct {
+  const char* name;
+  ChannelMap map;
+} kChannelMaps[] = {
+    {"TBE_8_2", ChannelMap::TBE_8_2},
+    {"TBE_8", ChannelMap::TBE_8},
+    {"TBE_6_2", ChannelMap::TBE_6_2},
+    {"TBE_6", ChannelMap::TBE_6},
+    {"TBE_4_2", ChannelMap::TBE_4_2},
+    {"TBE_4", ChannelMap::TBE_4},
+    {"HEADLOCKED_STEREO", ChannelMap::HEADLOCKED_STEREO},
+    {"AMBIX_4", ChannelMap::AMBIX_4},
+    {"AMBIX_4_2", ChannelMap::AMBIX_4_2},
+    {"AMBIX_9", ChannelMap::AMBIX_9},
+    {"AMBIX_9_2", ChannelMap::AMBIX_9_2},
+    {"AMBIX_16", ChannelMap::AMBIX_16},
+    {"AMBIX_16_2", ChannelMap::AMBIX_16_2},
+    {"MONO", ChannelMap::MONO},
+    {"STEREO", ChannelMap::STEREO},
+    {"UNKNOWN", ChannelMap::UNKNOWN},
+};
+
+static bool parseChannelMap(const std::string& name, ChannelMap& map) {
+  for (const auto& entry : kChannelMaps) {
+    if (name == entry.name) {
+      map = entry.map;
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Keyframes are separated by commas: time:yaw[:pitch[:roll]], in seconds and degrees
+static bool parseTrajectory(const std::string& text, std::vector<Keyframe>& trajectory) {
+  std::istringstream keyframes(text);
+  std::string keyframe;
+  while (std::getline(keyframes, keyframe, ',')) {
+    Keyframe k;
+    float values[3] = {0.f, 0.f, 0.f};
+    const int numParsed = std::sscanf(
+        keyframe.c_str(), "%lf:%f:%f:%f", &k.timeSec, &values[0], &values[1], &values[2]);
+    if (numParsed < 2 || (!trajectory.empty() && k.timeSec < trajectory.back().timeSec)) {
+      return false;
+    }
+    k.yaw = values[0];
+    k.pitch = values[1];
+    k.roll = values[2];
+    trajectory.push_back(k);
+  }
+  return !trajectory.empty();
+}
+
+/// Each line holds: input output [channelMap=UNKNOWN] [trajectory=0:0]. A trajectory starting with
+/// @ is read from a file with one keyframe per line: a job whose file can't be opened fails, the
+/// others still render. Empty lines and lines starting with # are skipped. Paths can't contain
+/// spaces.
+static bool parseManifest(const std::string& path, std::vector<Job>& jobs) {
+  std::ifstream manifest(path);
+  if (!manifest.is_open()) {
+    std::cerr << "Could not open " << path << "\n";
+    return false;
+  }
+  std::string line;
+  size_t lineNumber = 0;
+  while (std::getline(manifest, line)) {
+    lineNumber++;
+    std::istringstream fields(line);
+    Job job;
+    job.line = lineNumber;
+    std::string map, trajectory;
+    if (!(fields >> job.input) || job.input[0] == '#') {
+      continue;
+    }
+    fields >> job.output >> map >> trajectory;
+    std::string keyframes = trajectory.empty() ? "0:0" : trajectory;
+    if (!trajectory.empty() && trajectory[0] == '@') {
+      std::ifstream file(trajectory.substr(1));
+      if (!file.is_open()) {
+        std::cerr << path << ":" << lineNumber << ": could not open " << trajectory.substr(1)
+                  << "\n";
+        job.error = EngineError::ERROR_OPENING_FILE;
+        jobs.push_back(job);
+        continue;
+      }
+      std::string keyframe;
+      keyframes.clear();
+      while (file >> keyframe) {
+        keyframes += (keyframes.empty() ? "" : ",") + keyframe;
+      }
+    }
+    if (job.output.empty() || !parseChannelMap(map.empty() ? "UNKNOWN" : map, job.map) ||
+        !parseTrajectory(keyframes, job.trajectory)) {
+      std::cerr << path << ":" << lineNumber << ": invalid job\n";
+      return false;
+    }
+    jobs.push_back(job);
+  }
+  return true;
+}
+
+static Keyframe interpolate(const std::vector<Keyframe>& trajectory, double timeSec) {
+  auto next = std::upper_bound(
+      trajectory.begin(), trajectory.end(), timeSec, [](double t, const Keyframe& k) {
+        return t < k.timeSec;
+      });
+  if (next == trajectory.begin()) {
+    return trajectory.front();
+  }
+  if (next == trajectory.end()) {
+    return trajectory.back();
+  }
+  const Keyframe& a = *(next - 1);
+  const Keyframe& b = *next;
+  const float t = static_cast<float>((timeSec - a.timeSec) / (b.timeSec - a.timeSec));
+  Keyframe k;
+  k.timeSec = timeSec;
+  k.yaw = a.yaw + (b.yaw - a.yaw) * t;
+  k.pitch = a.pitch + (b.pitch - a.pitch) * t;
+  k.roll = a.roll + (b.roll - a.roll) * t;
+  return k;
+}
+
+/// Renders jobs one after the other on its own engine and thread
+class Worker {
+ public:
+  explicit Worker(const Settings& settings) : settings_(settings) {
+    EngineInitSettings init;
+    init.audioSettings.deviceType = AudioDeviceType::DISABLED;
+    init.audioSettings.sampleRate = settings.sampleRate;
+    init.audioSettings.bufferSize = settings.bufferSize;
+    // Decode in getAudioMix(), so that a worker never uses more than one core
+    init.threads.useDecoderThread = false;
+    error_ = TBE_CreateAudioEngine(engine_, init);
+    if (engine_) {
+      engine_->setMasterReverbBypass(!settings.reverb);
+      mix_.resize(static_cast<size_t>(engine_->getBufferSize()) * 2);
+    }
+  }
+
+  ~Worker() {
+    if (engine_) {
+      TBE_DestroyAudioEngine(engine_);
+    }
+  }
+
+  JobResult render(const Job& job) {
+    JobResult result;
+    if (!engine_ || job.error != EngineError::OK) {
+      result.error = engine_ ? job.error : error_;
+      return result;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    finished_ = false;
+
+    const bool isObject = job.map == ChannelMap::MONO || job.map == ChannelMap::STEREO;
+    AudioObject* object = nullptr;
+    SpatDecoderFile* file = nullptr;
+    if (isObject) {
+      result.error = engine_->createAudioObject(object);
+      if (result.error == EngineError::OK) {
+        // In front of the listener, so that the trajectory moves it around the head
+        object->setPosition(TBVector(0.f, 0.f, 1.f));
+        object->setEventCallback(onEvent, this);
+        result.error = object->open(job.input.c_str());
+        object->play();
+      }
+    } else {
+      result.error = engine_->createSpatDecoderFile(file);
+      if (result.error == EngineError::OK) {
+        file->setEventCallback(onEvent, this);
+        result.error = file->open(job.input.c_str(), job.map);
+        file->play();
+      }
+    }
+
+    if (result.error == EngineError::OK) {
+      result.error = renderToFile(job, result.renderedSec);
+    }
+
+    if (object) {
+      engine_->destroyAudioObject(object);
+    }
+    if (file) {
+      engine_->destroySpatDecoderFile(file);
+    }
+    result.elapsedSec =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+  }
+
+ private:
+  static void onEvent(Event event, void* userData) {
+    if (event == Event::END_OF_STREAM) {
+      static_cast<Worker*>(userData)->finished_ = true;
+    }
+  }
+
+  EngineError renderToFile(const Job& job, double& renderedSec) {
+    IOStream* stream =
+        IOStream::createFileStream(job.output.c_str(), IOStream::StreamOptions::WRITE_BINARY);
+    if (!stream) {
+      return EngineError::ERROR_OPENING_FILE;
+    }
+    const int bufferSize = engine_->getBufferSize();
+    const float sampleRate = engine_->getSampleRate();
+    AudioFormatEncoder* encoder = nullptr;
+    const EngineError error = TBE_CreateAudioFormatEncoder(
+        encoder,
+        stream,
+        AudioFormat::WAV,
+        sampleRate,
+        sampleRate,
+        static_cast<size_t>(bufferSize),
+        2,
+        AudioFormatQuality::HIGH);
+    if (error != EngineError::OK) {
+      delete stream;
+      return error;
+    }
+
+    // Keep rendering after the end of the input when the reverb is on, so that the tail ends up in
+    // this job's output rather than the next one's
+    const size_t tailBlocks =
+        settings_.reverb ? static_cast<size_t>(settings_.tailSec * sampleRate / bufferSize) : 0;
+    size_t numBlocks = 0;
+    size_t blocksAfterEnd = 0;
+    while (blocksAfterEnd <= tailBlocks) {
+      const double timeSec = static_cast<double>(numBlocks) * bufferSize / sampleRate;
+      const Keyframe k = interpolate(job.trajectory, timeSec);
+      engine_->setListenerRotation(k.yaw, k.pitch, k.roll);
+      engine_->getAudioMix(mix_.data(), static_cast<int>(mix_.size()), 2);
+      encoder->encode(mix_.data(), mix_.size(), false);
+      numBlocks++;
+      blocksAfterEnd += finished_ ? 1 : 0;
+    }
+    encoder->encode(nullptr, 0, true);
+    delete encoder;
+    delete stream;
+    renderedSec = static_cast<double>(numBlocks) * bufferSize / sampleRate;
+    return EngineError::OK;
+  }
+
+  const Settings settings_;
+  AudioEngine* engine_{nullptr};
+  EngineError error_{EngineError::OK};
+  std::vector<float> mix_;
+  std::atomic<bool> finished_{false};
+};
+
+/// Pin the calling thread to one of the cores it is allowed to run on, e.g. under taskset or in a
+/// container limited to some cores
+/// @param index Index of the core among the allowed ones, wrapping around
+/// @return false if the thread could not be pinned
+static bool pinCurrentThread(unsigned int index) {
+#if defined(__linux__)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+    return false;
+  }
+  unsigned int remaining = index % static_cast<unsigned int>(CPU_COUNT(&allowed));
+  for (int core = 0; core < CPU_SETSIZE; ++core) {
+    if (CPU_ISSET(core, &allowed) && remaining-- == 0) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(core, &cpus);
+      return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+    }
+  }
+  return false;
+#else
+  (void)index;
+  return false;
+#endif
+}
+
+static void printUsage(const char* name) {
+  std::cout << "Usage: " << name << " manifest.txt [options]\n"
+            << "  --threads N       Number of workers (default: number of cores)\n"
+            << "  --sample-rate SR  Output sample rate (default: 48000)\n"
+            << "  --buffer-size N   Engine buffer size (default: 1024)\n"
+            << "  --no-pin          Don't pin workers to cores\n"
+            << "  --reverb S        Enable the master reverb and render S seconds of tail\n\n"
+            << "Manifest lines: input output [channelMap] [time:yaw:pitch:roll,...|@file]\n";
+}
+
+int main(int argc, const char* argv[]) {
+  if (argc < 2) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  Settings settings;
+  for (int i = 2; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    try {
+      if (arg == "--threads" && hasValue) {
+        settings.numWorkers = static_cast<unsigned int>(std::stoul(argv[++i]));
+      } else if (arg == "--sample-rate" && hasValue) {
+        settings.sampleRate = std::stof(argv[++i]);
+      } else if (arg == "--buffer-size" && hasValue) {
+        settings.bufferSize = std::stoi(argv[++i]);
+      } else if (arg == "--no-pin") {
+        settings.pinWorkers = false;
+      } else if (arg == "--reverb" && hasValue) {
+        settings.reverb = true;
+        settings.tailSec = std::stod(argv[++i]);
+      } else {
+        printUsage(argv[0]);
+        return 1;
+      }
+    } catch (const std::logic_error&) {
+      // Not a number, or out of range
+      std::cerr << "Invalid value for " << arg << ": " << argv[i] << "\n";
+      return 1;
+    }
+  }
+
+  std::vector<Job> jobs;
+  if (!parseManifest(argv[1], jobs)) {
+    return 1;
+  }
+  const unsigned int numCores = std::max(1u, std::thread::hardware_concurrency());
+  const unsigned int numWorkers = std::min<unsigned int>(
+      settings.numWorkers > 0 ? settings.numWorkers : numCores,
+      static_cast<unsigned int>(std::max<size_t>(1, jobs.size())));
+
+  std::cout << "Rendering " << jobs.size() << " jobs on " << numWorkers << " workers\n";
+  std::vector<JobResult> results(jobs.size());
+  std::atomic<size_t> nextJob{0};
+  std::mutex printMutex;
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> workers;
+  for (unsigned int w = 0; w < numWorkers; ++w) {
+    workers.emplace_back([&, w]() {
+      if (settings.pinWorkers && !pinCurrentThread(w)) {
+        std::lock_guard<std::mutex> lock(printMutex);
+        std::cout << "[" << w << "] could not pin to a core\n";
+      }
+      Worker worker(settings);
+      for (size_t j = nextJob++; j < jobs.size(); j = nextJob++) {
+        results[j] = worker.render(jobs[j]);
+        const JobResult& r = results[j];
+        std::lock_guard<std::mutex> lock(printMutex);
+        if (r.error != EngineError::OK) {
+          std::cout << "[" << w << "] FAILED " << jobs[j].input << " (line " << jobs[j].line
+                    << "): error " << static_cast<int>(r.error) << "\n";
+        } else {
+          std::cout << "[" << w << "] " << jobs[j].output << ": " << r.renderedSec << " s in "
+                    << r.elapsedSec << " s ("
+                    << (r.elapsedSec > 0.0 ? r.renderedSec / r.elapsedSec : 0.0)
+                    << "x realtime)\n";
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  const double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double rendered = 0.0;
+  size_t numFailed = 0;
+  for (const auto& result : results) {
+    rendered += result.renderedSec;
+    numFailed += result.error != EngineError::OK ? 1 : 0;
+  }
+  std::cout << "Rendered " << rendered << " s of audio in " << elapsed << " s ("
+            << (elapsed > 0.0 ? rendered / elapsed : 0.0) << "x realtime), " << numFailed
+            << " failed\n";
+  return numFailed > 0 ? 2 : 0;
+}
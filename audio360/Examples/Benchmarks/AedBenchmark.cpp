@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "TBE_Quat.hh"
+#include "TBE_Vector.hh"
+
+using namespace TBE;
+
+/// Azimuth, elevation and distance of many sources relative to a listener, and Euler angles of
+/// many rotations, with the AccurateTrig (standard library) and FastTrig (polynomial) policies.
+/// Also measures the largest error of FastTrig::atan2 and FastTrig::asin over their whole domain,
+/// and of the angles computed with them.
+
+static const double kSecondsPerRun = 0.3;
+static const size_t kNumSources = 1024;
+
+/// Keeps the compiler from dropping the work
+static volatile float sink;
+
+/// @return Seconds per call
+template <typename Call>
+static double time(Call call) {
+  const auto start = std::chrono::steady_clock::now();
+  double elapsed = 0.0;
+  int calls = 0;
+  while (elapsed < kSecondsPerRun) {
+    for (int i = 0; i < 100; ++i) {
+      call();
+    }
+    calls += 100;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  return elapsed / calls;
+}
+
+/// Difference between two angles in degrees, so that -180 and 180 are the same
+static float angleError(float a, float b) {
+  const float difference = std::abs(a - b);
+  return std::min(difference, std::abs(difference - 360.f));
+}
+
+static void measureFunctions() {
+  // Every direction on a fine circle, at several magnitudes, and the axes with signed zeros
+  double atan2Error = 0.0;
+  const int numAngles = 1 << 20;
+  for (int i = 0; i < numAngles; ++i) {
+    const double angle = 2.0 * M_PI * i / numAngles;
+    for (float magnitude : {1e-6f, 1.f, 1e6f}) {
+      const float y = magnitude * static_cast<float>(std::sin(angle));
+      const float x = magnitude * static_cast<float>(std::cos(angle));
+      atan2Error = std::max(
+          atan2Error,
+          std::abs(static_cast<double>(FastTrig::atan2(y, x)) - std::atan2(double(y), double(x))));
+    }
+  }
+  for (float y : {0.f, -0.f, 1.f, -1.f}) {
+    for (float x : {0.f, -0.f, 1.f, -1.f}) {
+      atan2Error =
+          std::max(atan2Error, double(std::abs(FastTrig::atan2(y, x) - std::atan2(y, x))));
+    }
+  }
+
+  double asinError = 0.0;
+  for (int i = -numAngles; i <= numAngles; ++i) {
+    const float x = static_cast<float>(i) / numAngles;
+    asinError = std::max(
+        asinError, std::abs(static_cast<double>(FastTrig::asin(x)) - std::asin(double(x))));
+  }
+
+  std::cout << "FastTrig::atan2 max error " << atan2Error << " rad ("
+            << atan2Error * 180.0 / M_PI << " deg)\n"
+            << "FastTrig::asin max error " << asinError << " rad (" << asinError * 180.0 / M_PI
+            << " deg)\n\n";
+}
+
+int main() {
+  measureFunctions();
+
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> coordinate(-50.f, 50.f);
+  std::uniform_real_distribution<float> angle(-M_PIF, M_PIF);
+  std::vector<TBVector> sources(kNumSources);
+  std::vector<TBQuat> rotations(kNumSources);
+  for (size_t i = 0; i < kNumSources; ++i) {
+    sources[i] = TBVector(coordinate(random), coordinate(random), coordinate(random));
+    rotations[i] =
+        TBQuat::getQuatFromEulerAngles(0.5f * angle(random), angle(random), angle(random));
+  }
+  const TBQuat listenerRotation = TBQuat::getQuatFromEulerAngles(0.1f, 2.f, 0.f);
+  const TBVector listenerPosition(0.5f, 0.f, -1.f);
+
+  std::vector<Aed> accurateAed(kNumSources), fastAed(kNumSources);
+  std::vector<TBVector> accurateEuler(kNumSources), fastEuler(kNumSources);
+  const double accurateAedTime = time([&]() {
+    for (size_t i = 0; i < kNumSources; ++i) {
+      accurateAed[i] =
+          TBQuat::getAedFromQuat<AccurateTrig>(listenerRotation, sources[i], listenerPosition);
+    }
+    sink = accurateAed[kNumSources / 2].azimuth;
+  });
+  const double fastAedTime = time([&]() {
+    for (size_t i = 0; i < kNumSources; ++i) {
+      fastAed[i] = TBQuat::getAedFromQuat<FastTrig>(listenerRotation, sources[i], listenerPosition);
+    }
+    sink = fastAed[kNumSources / 2].azimuth;
+  });
+  const double accurateEulerTime = time([&]() {
+    for (size_t i = 0; i < kNumSources; ++i) {
+      accurateEuler[i] = TBQuat::getEulerAnglesFromQuat<AccurateTrig>(rotations[i]);
+    }
+    sink = accurateEuler[kNumSources / 2].y;
+  });
+  const double fastEulerTime = time([&]() {
+    for (size_t i = 0; i < kNumSources; ++i) {
+      fastEuler[i] = TBQuat::getEulerAnglesFromQuat<FastTrig>(rotations[i]);
+    }
+    sink = fastEuler[kNumSources / 2].y;
+  });
+
+  float aedError = 0.f;
+  float eulerError = 0.f;
+  for (size_t i = 0; i < kNumSources; ++i) {
+    aedError = std::max(
+        {aedError,
+         angleError(fastAed[i].azimuth, accurateAed[i].azimuth),
+         std::abs(fastAed[i].elevation - accurateAed[i].elevation)});
+    const TBVector difference = (fastEuler[i] - accurateEuler[i]) * (180.f / M_PIF);
+    eulerError = std::max(
+        {eulerError,
+         angleError(difference.x, 0.f),
+         angleError(difference.y, 0.f),
+         angleError(difference.z, 0.f)});
+  }
+
+  std::cout << "function\taccurate ns\tfast ns\tspeedup\tmax error deg\n";
+  std::cout << "getAedFromQuat\t" << accurateAedTime * 1.e9 / kNumSources << "\t"
+            << fastAedTime * 1.e9 / kNumSources << "\t" << accurateAedTime / fastAedTime << "x\t"
+            << aedError << "\n";
+  std::cout << "getEulerAnglesFromQuat\t" << accurateEulerTime * 1.e9 / kNumSources << "\t"
+            << fastEulerTime * 1.e9 / kNumSources << "\t" << accurateEulerTime / fastEulerTime
+            << "x\t" << eulerError << "\n";
+  return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#include "dsp/BinauralFilterBank.h"
+#include "dsp/HeadModelHrtf.h"
+
+using namespace TBE;
+
+/// Cost of rendering AudioObjects binaurally: many moving sources sharing one BinauralFilterBank,
+/// at the engine buffer sizes used for low-latency headphones and for the default.
+/// Reports the time per object per block and the share of the block's real time budget it uses.
+
+static const float kSampleRate = 48000.f;
+static const int kNumObjects = 32;
+static const double kSecondsPerRun = 1.0;
+
+/// Keeps the compiler from dropping the work
+static volatile float sink;
+
+static void run(int bufferSize, bool moving) {
+  const HeadModelHrtf hrtf(kSampleRate);
+  const int blockSize = BinauralFilterBank::getBlockSizeFor(bufferSize);
+  const BinauralFilterBank bank(hrtf, blockSize);
+
+  std::vector<std::unique_ptr<BinauralPanner>> panners;
+  for (int i = 0; i < kNumObjects; ++i) {
+    panners.emplace_back(new BinauralPanner(bank));
+  }
+  std::vector<float> input(bufferSize);
+  std::vector<float> left(bufferSize, 0.f);
+  std::vector<float> right(bufferSize, 0.f);
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> noise(-1.f, 1.f);
+  for (auto& sample : input) {
+    sample = noise(random);
+  }
+
+  const int numBlocks = static_cast<int>(kSecondsPerRun * kSampleRate / bufferSize);
+  const auto start = std::chrono::steady_clock::now();
+  for (int b = 0; b < numBlocks; ++b) {
+    for (int i = 0; i < kNumObjects; ++i) {
+      // Moving objects cross to another filter every block, so every block crossfades
+      const float angle = moving ? static_cast<float>(b * 3 + i) * 0.0174533f : 0.5f * i;
+      const TBVector direction(std::sin(angle), 0.f, std::cos(angle));
+      panners[i]->processAdd(input.data(), direction, left.data(), right.data(), bufferSize);
+    }
+  }
+  const double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  const double perObjectUs = elapsed * 1.e6 / numBlocks / kNumObjects;
+  const double blockUs = bufferSize * 1.e6 / kSampleRate;
+  std::cout << bufferSize << "\t" << blockSize << "\t" << bank.getNumPartitions() << "\t"
+            << (moving ? "moving" : "static") << "\t" << perObjectUs << "\t"
+            << 100.0 * perObjectUs / blockUs << "%\t" << static_cast<int>(blockUs / perObjectUs)
+            << "\n";
+  sink = left[0] + right[0];
+}
+
+int main() {
+  std::cout << "HRIR length " << HeadModelHrtf(kSampleRate).getLength() << " taps, " << kNumObjects
+            << " objects\n"
+            << "buffer\tblock\tparts\tsource\tus/obj\tbudget\tmax objects\n";
+  for (int bufferSize : {64, 128, 1024}) {
+    run(bufferSize, false);
+    run(bufferSize, true);
+  }
+  return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include "utils/SampleRingBuffer.h"
+
+using namespace TBE;
+
+/// Several producers and one consumer on a small SampleRingBuffer, as decoder threads writing to
+/// one SpatDecoderQueue through reserveWrite/commitWrite. Every producer reserves regions of
+/// random sizes and commits none, part or all of each one. The consumer checks that every
+/// committed sample arrives exactly once and in order for its producer, and that everything else
+/// it reads is silence. A run that stops making progress is reported as a hang. Producers commit
+/// with a short timeout and retry, as a decoder thread that does other work between attempts
+/// would.
+
+static const size_t kSamplesPerProducer = 1 << 20;
+static const double kTimeoutSeconds = 30.0;
+static const std::chrono::microseconds kCommitTimeout(5);
+
+enum CommitType { ZERO, PARTIAL, FULL, NUM_COMMIT_TYPES };
+
+/// Samples are numbered from 1 per producer, which fits a float exactly for 16 producers
+static float encode(size_t producer, size_t index) {
+  return static_cast<float>((producer << 20) + index + 1);
+}
+
+struct Producer {
+  std::thread thread;
+  size_t committed{0};
+  size_t commits[NUM_COMMIT_TYPES]{};
+  size_t timeouts{0};
+};
+
+static void produce(SampleRingBuffer& ring, size_t id, Producer& producer) {
+  std::mt19937 random(static_cast<unsigned>(id + 1));
+  std::uniform_int_distribution<size_t> sizes(1, 96);
+  std::uniform_int_distribution<int> types(0, NUM_COMMIT_TYPES - 1);
+  while (producer.committed < kSamplesPerProducer) {
+    const auto reservation = ring.reserve(sizes(random));
+    if (reservation.numSamples == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    const int type = types(random);
+    size_t count = reservation.numSamples;
+    if (type == ZERO) {
+      count = 0;
+    } else if (type == PARTIAL && count > 1) {
+      count = std::uniform_int_distribution<size_t>(1, count - 1)(random);
+    }
+    count = std::min(count, kSamplesPerProducer - producer.committed);
+    // Fill the whole region, so that a tail that is not silenced shows up as a duplicate
+    for (size_t i = 0; i < reservation.numSamples; ++i) {
+      float* sample = i < reservation.firstSize ? reservation.first + i
+                                                : reservation.second + (i - reservation.firstSize);
+      *sample = encode(id, producer.committed + std::min(i, count));
+    }
+    // Give the other producers a chance to reserve after this region, as decoding would
+    if (random() % 2) {
+      std::this_thread::yield();
+    }
+    while (!ring.commit(reservation, count, kCommitTimeout)) {
+      producer.timeouts++;
+    }
+    producer.committed += count;
+    producer.commits[type]++;
+  }
+}
+
+/// @return true if every sample arrived exactly once and in order
+static bool run(size_t numProducers, size_t capacity) {
+  SampleRingBuffer ring(capacity);
+  std::vector<Producer> producers(numProducers);
+  std::vector<size_t> expected(numProducers, 0);
+  size_t silence = 0;
+  size_t errors = 0;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t p = 0; p < numProducers; ++p) {
+    producers[p].thread = std::thread(produce, std::ref(ring), p, std::ref(producers[p]));
+  }
+
+  std::vector<float> block(capacity);
+  size_t received = 0;
+  auto lastProgress = start;
+  while (received < numProducers * kSamplesPerProducer) {
+    const size_t count = ring.read(block.data(), block.size());
+    const auto now = std::chrono::steady_clock::now();
+    if (count == 0) {
+      if (std::chrono::duration<double>(now - lastProgress).count() > kTimeoutSeconds) {
+        std::printf(
+            "%2zu producers, capacity %4zu: HANG after %zu of %zu samples\n",
+            numProducers,
+            capacity,
+            received,
+            numProducers * kSamplesPerProducer);
+        // The producers are stuck in commit, so they cannot be joined
+        std::exit(1);
+      }
+      std::this_thread::yield();
+      continue;
+    }
+    lastProgress = now;
+    for (size_t i = 0; i < count; ++i) {
+      if (block[i] == 0.f) {
+        silence++;
+        continue;
+      }
+      const size_t value = static_cast<size_t>(block[i]) - 1;
+      const size_t p = value >> 20;
+      const size_t index = value & ((1 << 20) - 1);
+      if (p >= numProducers || index != expected[p]) {
+        errors++;
+        continue;
+      }
+      expected[p]++;
+      received++;
+    }
+  }
+
+  size_t commits[NUM_COMMIT_TYPES]{};
+  size_t timeouts = 0;
+  for (auto& producer : producers) {
+    producer.thread.join();
+    timeouts += producer.timeouts;
+    for (int t = 0; t < NUM_COMMIT_TYPES; ++t) {
+      commits[t] += producer.commits[t];
+    }
+  }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const bool ok = errors == 0 && ring.getNumAvailable() == 0;
+  std::printf(
+      "%2zu producers, capacity %4zu: %8zu zero, %8zu partial, %8zu full commits, %7zu timed "
+      "out, %9zu silent samples, %5.2f s: %s\n",
+      numProducers,
+      capacity,
+      commits[ZERO],
+      commits[PARTIAL],
+      commits[FULL],
+      timeouts,
+      silence,
+      seconds,
+      ok ? "ok" : "FAILED");
+  if (errors) {
+    std::printf("  %zu samples out of order, duplicated or corrupted\n", errors);
+  }
+  return ok;
+}
+
+int main() {
+  bool ok = true;
+  for (size_t producers : {1, 2, 3, 8}) {
+    for (size_t capacity : {97, 1024}) {
+      ok = run(producers, capacity) && ok;
+    }
+  }
+  return ok ? 0 : 1;
+}
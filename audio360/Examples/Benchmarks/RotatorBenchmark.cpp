@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "dsp/AmbisonicRotator.h"
+#include "utils/AudioBuffer.h"
+
+using namespace TBE;
+
+/// Cost of rotating a head-tracked ambiX bed: rotation matrix generation from a TBQuat, and the
+/// block kernels that apply it, interpolating from the previous block's matrix, compared with the
+/// scalar reference. Also checks that each kernel matches the reference.
+
+static const double kSecondsPerRun = 0.5;
+
+/// Keeps the compiler from dropping the work
+static volatile float sink;
+
+static const char* getName(AmbisonicRotator::Kernel kernel) {
+  switch (kernel) {
+    case AmbisonicRotator::Kernel::SCALAR:
+      return "scalar";
+    case AmbisonicRotator::Kernel::SSE:
+      return "sse";
+    case AmbisonicRotator::Kernel::AVX2:
+      return "avx2";
+    case AmbisonicRotator::Kernel::NEON:
+      return "neon";
+  }
+  return "?";
+}
+
+/// A slowly turning head, one orientation per block
+static TBQuat getRotation(int block) {
+  const float yaw = 0.01f * static_cast<float>(block);
+  const float pitch = 0.2f * std::sin(0.003f * static_cast<float>(block));
+  return TBQuat::getQuatFromEulerAngles(pitch, yaw, 0.f);
+}
+
+static void benchmarkMatrices() {
+  float matrix[AmbisonicRotator::kMaxChannels * AmbisonicRotator::kMaxChannels];
+  const int numMatrices = 20000;
+  for (int method = 0; method < 2; ++method) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numMatrices; ++i) {
+      if (method == 0) {
+        AmbisonicRotator::computeMatrix(getRotation(i), 3, matrix);
+      } else {
+        AmbisonicRotator::computeRotationMatrix(getRotation(i), 3, matrix);
+      }
+      sink = matrix[AmbisonicRotator::kMaxChannels + 1];
+    }
+    const double elapsed =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << (method == 0 ? "quadrature" : "recursive") << "\t"
+              << elapsed * 1.e6 / numMatrices << " us per third order matrix\n";
+  }
+}
+
+/// @return Seconds per block
+static double run(
+    AmbisonicRotator::Kernel kernel,
+    int order,
+    int numFrames,
+    const AudioBuffer& input,
+    AudioBuffer& output) {
+  const int numChannels = SphericalHarmonics::getNumChannels(order);
+  const float* inputs[AmbisonicRotator::kMaxChannels];
+  float* outputs[AmbisonicRotator::kMaxChannels];
+  for (int ch = 0; ch < numChannels; ++ch) {
+    inputs[ch] = input.getChannel(static_cast<size_t>(ch));
+    outputs[ch] = output.getChannel(static_cast<size_t>(ch));
+  }
+  output.clear();
+
+  AmbisonicRotator rotator;
+  rotator.setKernel(kernel);
+  float matrix[AmbisonicRotator::kMaxChannels * AmbisonicRotator::kMaxChannels];
+  const int numBlocks = std::max(1, static_cast<int>(kSecondsPerRun * 48000.0 / numFrames));
+  const auto start = std::chrono::steady_clock::now();
+  for (int b = 0; b < numBlocks; ++b) {
+    AmbisonicRotator::computeRotationMatrix(getRotation(b), order, matrix);
+    rotator.setMatrix(matrix, true);
+    rotator.processAdd(inputs, outputs, numChannels, numFrames);
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() /
+      numBlocks;
+}
+
+int main() {
+  benchmarkMatrices();
+
+  const int maxFrames = 1024;
+  AudioBuffer input(AmbisonicRotator::kMaxChannels, maxFrames);
+  AudioBuffer reference(AmbisonicRotator::kMaxChannels, maxFrames);
+  AudioBuffer output(AmbisonicRotator::kMaxChannels, maxFrames);
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> noise(-1.f, 1.f);
+  for (size_t ch = 0; ch < input.getNumChannels(); ++ch) {
+    for (size_t n = 0; n < input.getNumFrames(); ++n) {
+      input.getChannel(ch)[n] = noise(random);
+    }
+  }
+
+  std::cout << "\nkernel\torder\tframes\tus/block\tspeedup\trelative error\n";
+  const AmbisonicRotator::Kernel kernels[] = {AmbisonicRotator::Kernel::SCALAR,
+                                              AmbisonicRotator::Kernel::SSE,
+                                              AmbisonicRotator::Kernel::AVX2,
+                                              AmbisonicRotator::Kernel::NEON};
+  for (int order = 1; order <= SphericalHarmonics::kMaxOrder; ++order) {
+    for (int numFrames : {64, 256, 1024}) {
+      const double scalar =
+          run(AmbisonicRotator::Kernel::SCALAR, order, numFrames, input, reference);
+      for (auto kernel : kernels) {
+        if (!AmbisonicRotator::isKernelSupported(kernel)) {
+          continue;
+        }
+        const double elapsed = run(kernel, order, numFrames, input, output);
+        // Outputs accumulate every block of the run, so the error is relative to their peak
+        float error = 0.f;
+        float peak = 0.f;
+        for (int ch = 0; ch < SphericalHarmonics::getNumChannels(order); ++ch) {
+          for (int n = 0; n < numFrames; ++n) {
+            const float expected = reference.getChannel(ch)[n];
+            error = std::max(error, std::abs(output.getChannel(ch)[n] - expected));
+            peak = std::max(peak, std::abs(expected));
+          }
+        }
+        error /= std::max(peak, 1.e-9f);
+        std::cout << getName(kernel) << "\t" << order << "\t" << numFrames << "\t"
+                  << elapsed * 1.e6 << "\t" << scalar / elapsed << "x\t" << error << "\n";
+      }
+    }
+  }
+  return 0;
+}
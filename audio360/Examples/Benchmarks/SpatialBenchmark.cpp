@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "engine/ObjectSpatialStore.h"
+
+using namespace TBE;
+
+/// Per block spatial state of positional AudioObjects: distance, direction in the listener's
+/// frame, distance attenuation and directivity. Compares the ObjectSpatialStore, which computes
+/// every object in passes over structure-of-arrays state, with the same computation done object
+/// by object from array-of-structures state, as AudioObjects did before the store. Also checks
+/// that both agree.
+
+static const double kSecondsPerRun = 0.5;
+static const float kPi = 3.14159265358979323846f;
+
+/// Keeps the compiler from dropping the work
+static volatile float sink;
+
+/// Spatial parameters of an object, as each AudioObject keeps them
+struct Source {
+  TBVector position;
+  TBQuat rotation;
+  AttenuationMode mode;
+  AttenuationProps attenuation;
+  bool directivity;
+  DirectionalProps directional;
+};
+
+/// The reference: one object at a time
+static ObjectSpatialStore::Result
+computeSource(const Source& source, const TBQuat& listenerRotation, const TBVector& listener) {
+  ObjectSpatialStore::Result result;
+  const TBVector relative = source.position - listener;
+  const float distance = TBVector::magnitude(relative);
+  result.distance = distance;
+
+  const AttenuationProps& props = source.attenuation;
+  if (source.mode == AttenuationMode::LOGARITHMIC) {
+    const float clamped =
+        std::max(props.minimumDistance, std::min(props.maximumDistance, distance));
+    result.attenuation = props.maxDistanceMute && distance >= props.maximumDistance
+        ? 0.f
+        : std::pow(props.minimumDistance / clamped, props.factor);
+  } else if (source.mode == AttenuationMode::LINEAR) {
+    result.attenuation = distance <= props.minimumDistance
+        ? 1.f
+        : (distance >= props.maximumDistance
+               ? 0.f
+               : 1.f -
+                   (distance - props.minimumDistance) /
+                       (props.maximumDistance - props.minimumDistance));
+  }
+
+  if (distance > ObjectSpatialStore::kMinDistance) {
+    const TBVector toListener = relative * (-1.f / distance);
+    if (source.directivity) {
+      const TBVector forward = TBQuat::getForwardFromQuat(source.rotation);
+      const float cosAngle =
+          std::max(-1.f, std::min(1.f, TBVector::DotProduct(forward, toListener)));
+      const float angle = std::acos(cosAngle) * 180.f / kPi;
+      const float halfCone = 0.5f * source.directional.coneArea;
+      if (angle > halfCone) {
+        result.outsideCone = true;
+        result.directivity = source.directional.effectLevel *
+            std::min(1.f, (angle - halfCone) / std::max(1.f, 180.f - halfCone));
+      }
+    }
+    result.direction =
+        TBQuat::antiRotateVectorByQuat(listenerRotation, relative * (1.f / distance));
+  }
+  return result;
+}
+
+/// @return Seconds per block
+template <typename Block>
+static double time(Block block) {
+  const int numBlocks = 2000;
+  const auto start = std::chrono::steady_clock::now();
+  double elapsed = 0.0;
+  int blocks = 0;
+  while (elapsed < kSecondsPerRun) {
+    for (int b = 0; b < numBlocks; ++b) {
+      block(blocks + b);
+    }
+    blocks += numBlocks;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  return elapsed / blocks;
+}
+
+int main() {
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> coordinate(-50.f, 50.f);
+  std::uniform_real_distribution<float> angle(-180.f, 180.f);
+  std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+  std::cout << "objects\tper object us\tstore us\tstore+gather us\tspeedup\tmax error\n";
+  for (size_t numObjects : {128, 512, 1024}) {
+    std::vector<Source> sources(numObjects);
+    for (size_t i = 0; i < numObjects; ++i) {
+      Source& source = sources[i];
+      source.position = TBVector(coordinate(random), coordinate(random), coordinate(random));
+      source.rotation = TBQuat::getQuatFromEulerAngles(angle(random), angle(random), 0.f);
+      source.mode = static_cast<AttenuationMode>(i % 3);
+      source.attenuation = AttenuationProps(1.f, 40.f, 0.5f + unit(random), i % 4 == 0);
+      source.directivity = i % 2 == 0;
+      source.directional = DirectionalProps(unit(random), 359.f * unit(random));
+    }
+    std::vector<ObjectSpatialStore::Result> results(numObjects);
+    ObjectSpatialStore store(numObjects);
+    const auto gather = [&]() {
+      store.clear();
+      for (const Source& source : sources) {
+        store.add(
+            source.position,
+            source.rotation,
+            source.mode,
+            source.attenuation,
+            source.directivity,
+            source.directional);
+      }
+    };
+    // A slowly turning and moving listener, one pose per block
+    const auto listenerRotation = [](int block) {
+      return TBQuat::getQuatFromEulerAngles(0.f, 0.01f * static_cast<float>(block), 0.f);
+    };
+    const auto listenerPosition = [](int block) {
+      return TBVector(0.001f * static_cast<float>(block), 0.f, 0.f);
+    };
+
+    const double perObject = time([&](int block) {
+      const TBQuat rotation = listenerRotation(block);
+      const TBVector position = listenerPosition(block);
+      for (size_t i = 0; i < numObjects; ++i) {
+        results[i] = computeSource(sources[i], rotation, position);
+      }
+      sink = results[block % numObjects].attenuation;
+    });
+    gather();
+    const double computeOnly = time([&](int block) {
+      store.compute(listenerRotation(block), listenerPosition(block), 1.f);
+      sink = store.getResult(static_cast<size_t>(block) % numObjects).attenuation;
+    });
+    const double withGather = time([&](int block) {
+      gather();
+      store.compute(listenerRotation(block), listenerPosition(block), 1.f);
+      sink = store.getResult(static_cast<size_t>(block) % numObjects).attenuation;
+    });
+
+    // Largest difference in any gain, directivity or direction component
+    float error = 0.f;
+    const int block = 123;
+    gather();
+    store.compute(listenerRotation(block), listenerPosition(block), 1.f);
+    for (size_t i = 0; i < numObjects; ++i) {
+      const ObjectSpatialStore::Result expected =
+          computeSource(sources[i], listenerRotation(block), listenerPosition(block));
+      const ObjectSpatialStore::Result actual = store.getResult(i);
+      error = std::max(
+          {error,
+           std::abs(actual.attenuation - expected.attenuation),
+           std::abs(actual.directivity - expected.directivity),
+           std::abs(actual.direction.x - expected.direction.x),
+           std::abs(actual.direction.y - expected.direction.y),
+           std::abs(actual.direction.z - expected.direction.z)});
+    }
+
+    std::cout << numObjects << "\t" << perObject * 1.e6 << "\t" << computeOnly * 1.e6 << "\t"
+              << withGather * 1.e6 << "\t" << perObject / withGather << "x\t" << error << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TBE_IOStream.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace TBE;
+
+/// Many files streamed by one thread, as the decoder thread does for SpatDecoderFiles: each stream
+/// reads its own region of a large file one block at a time, round robin, starting from a cold
+/// page cache. Compares stdio streams (createFileStream), memory mapped streams and io_uring
+/// streams (createAsyncFileStream) at 8, 32 and 128 concurrent streams. Reports the throughput and
+/// how long the thread waited for a single read, which is what makes the decoder thread fall
+/// behind.
+
+/// A third order 16 bit bed, 512 frames per read
+static const size_t kReadSize = 16 * 2 * 512;
+
+enum class StreamType { FILE, MAPPED, ASYNC };
+
+static const char* getName(StreamType type) {
+  switch (type) {
+    case StreamType::FILE:
+      return "file";
+    case StreamType::MAPPED:
+      return "mapped";
+    case StreamType::ASYNC:
+      return "async";
+  }
+  return "?";
+}
+
+static IOStream* createStream(StreamType type, const std::string& path, AssetDescriptor ad) {
+  switch (type) {
+    case StreamType::FILE:
+      return IOStream::createFileStream(path.c_str(), IOStream::StreamOptions::READ_BINARY, ad);
+    case StreamType::MAPPED:
+      return IOStream::createMappedFileStream(path.c_str(), ad);
+    case StreamType::ASYNC:
+      return IOStream::createAsyncFileStream(path.c_str(), ad);
+  }
+  return nullptr;
+}
+
+/// Drop the file from the page cache, so that every run reads from the disk
+static void evict(const std::string& path) {
+#if defined(__unix__) || defined(__APPLE__)
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd >= 0) {
+#if defined(POSIX_FADV_DONTNEED)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    close(fd);
+  }
+#endif
+}
+
+static bool createFile(const std::string& path, size_t size) {
+  std::ifstream existing(path, std::ios::binary | std::ios::ate);
+  if (existing && static_cast<size_t>(existing.tellg()) >= size) {
+    return true;
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  std::vector<char> block(1 << 20);
+  for (size_t i = 0; i < block.size(); ++i) {
+    block[i] = static_cast<char>(i * 31 + 7);
+  }
+  for (size_t written = 0; written < size && file; written += block.size()) {
+    file.write(block.data(), static_cast<std::streamsize>(block.size()));
+  }
+  file.flush();
+  if (!file) {
+    return false;
+  }
+#if defined(__unix__) || defined(__APPLE__)
+  // Dirty pages can't be evicted
+  sync();
+#endif
+  return true;
+}
+
+static void run(StreamType type, const std::string& path, size_t fileSize, size_t numStreams) {
+  evict(path);
+  const size_t region = fileSize / numStreams;
+  std::vector<std::unique_ptr<IOStream>> streams;
+  for (size_t i = 0; i < numStreams; ++i) {
+    streams.emplace_back(createStream(type, path, AssetDescriptor(i * region, region)));
+    if (!streams.back()) {
+      std::cout << getName(type) << "\t" << numStreams << "\tnot available\n";
+      return;
+    }
+  }
+
+  std::vector<char> buffer(kReadSize);
+  std::vector<double> waits;
+  waits.reserve(fileSize / kReadSize + numStreams);
+  size_t numBytes = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (bool reading = true; reading;) {
+    reading = false;
+    for (auto& stream : streams) {
+      const auto readStart = std::chrono::steady_clock::now();
+      const size_t numRead = stream->read(buffer.data(), buffer.size());
+      waits.push_back(
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - readStart).count());
+      if (numRead != IOSTREAM_OPERATION_FAIL && numRead > 0) {
+        numBytes += numRead;
+        reading = true;
+      }
+    }
+  }
+  const double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::sort(waits.begin(), waits.end());
+  const double p99 = waits[waits.size() * 99 / 100];
+  std::cout << getName(type) << "\t" << numStreams << "\t"
+            << static_cast<double>(numBytes) / (1 << 20) / elapsed << "\t" << p99 * 1.e6 << "\t"
+            << waits.back() * 1.e6 << "\n";
+}
+
+int main(int argc, const char* argv[]) {
+  const std::string path = argc > 1 ? argv[1] : "audio360_stream_benchmark.bin";
+  const size_t fileSize = static_cast<size_t>(argc > 2 ? std::stoi(argv[2]) : 256) << 20;
+  if (!createFile(path, fileSize)) {
+    std::cout << "Could not create " << path << "\n";
+    return 1;
+  }
+
+  std::cout << "Reading " << (fileSize >> 20) << " MB from " << path << " in " << kReadSize
+            << " byte reads, cold page cache\n";
+  std::cout << "stream\tstreams\tMB/s\tp99 read (us)\tmax read (us)\n";
+  for (size_t numStreams : {8, 32, 128}) {
+    for (StreamType type : {StreamType::FILE, StreamType::MAPPED, StreamType::ASYNC}) {
+      run(type, path, fileSize, numStreams);
+    }
+  }
+  return 0;
+}
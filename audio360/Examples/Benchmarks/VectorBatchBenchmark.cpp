@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "utils/VectorBatch.h"
+
+using namespace TBE;
+
+/// Batch rotations, anti-rotations, listener relative azimuth/elevation/distance and vectors from
+/// angles: each VectorBatch kernel against the inline TBQuat and TBVector helpers called element
+/// by element. Also checks every kernel against the inline helpers, including the axes and the
+/// origin, where the angles are the most sensitive to the signs of zeros, and fails if a kernel
+/// is further from them than VectorBatch.h allows.
+
+static const double kSecondsPerRun = 0.3;
+static const size_t kNumElements = 1027; // Leaves a tail for the vector kernels
+
+/// Tolerances against the inline helpers. SSE and NEON compute the quaternion products in the same
+/// order as the helpers, so their rotations must be bit-exact. AVX2 may contract the products into
+/// FMAs, which rounds differently by a few ulps of the length of the vector.
+static const float kFmaRotationUlps = 4.f;
+/// The Cephes polynomials of atan, sin and cos are accurate to about an ulp on their reduced
+/// ranges. Azimuths up to 180 degrees, with the rounding of the conversion from radians, stay
+/// within 1e-4 degrees, and vectors from angles within 1e-6 of their length.
+static const float kAngleToleranceDegrees = 1e-4f;
+static const float kVectorTolerance = 1e-6f;
+/// Distances only add a square root to the same sums of squares
+static const float kDistanceUlps = 4.f;
+
+/// Keeps the compiler from dropping the work
+static volatile float sink;
+
+static const char* getName(VectorBatch::Kernel kernel) {
+  switch (kernel) {
+    case VectorBatch::Kernel::SCALAR:
+      return "scalar";
+    case VectorBatch::Kernel::SSE:
+      return "sse";
+    case VectorBatch::Kernel::AVX2:
+      return "avx2";
+    case VectorBatch::Kernel::NEON:
+      return "neon";
+  }
+  return "?";
+}
+
+/// @return Seconds per call
+template <typename Call>
+static double time(Call call) {
+  const auto start = std::chrono::steady_clock::now();
+  double elapsed = 0.0;
+  int calls = 0;
+  while (elapsed < kSecondsPerRun) {
+    for (int i = 0; i < 100; ++i) {
+      call();
+    }
+    calls += 100;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  return elapsed / calls;
+}
+
+/// Difference between two angles in degrees, so that -180 and 180 are the same
+static float angleError(float a, float b) {
+  const float difference = std::abs(a - b);
+  return std::min(difference, std::abs(difference - 360.f));
+}
+
+struct Arrays {
+  std::vector<float> x, y, z;
+
+  explicit Arrays(size_t size) : x(size), y(size), z(size) {}
+
+  VectorBatch::ConstVectors read() const {
+    return {x.data(), y.data(), z.data()};
+  }
+
+  VectorBatch::Vectors write() {
+    return {x.data(), y.data(), z.data()};
+  }
+
+  TBVector get(size_t i) const {
+    return TBVector(x[i], y[i], z[i]);
+  }
+};
+
+int main() {
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> coordinate(-50.f, 50.f);
+  std::uniform_real_distribution<float> angle(-180.f, 180.f);
+  std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+  Arrays positions(kNumElements);
+  std::vector<float> qx(kNumElements), qy(kNumElements), qz(kNumElements), qw(kNumElements);
+  std::vector<float> azimuths(kNumElements), elevations(kNumElements), distances(kNumElements);
+  const TBVector special[] = {TBVector(0.f, 0.f, 0.f),
+                              TBVector(1.f, 0.f, 0.f),
+                              TBVector(-1.f, 0.f, 0.f),
+                              TBVector(0.f, 1.f, 0.f),
+                              TBVector(0.f, -1.f, 0.f),
+                              TBVector(0.f, 0.f, 1.f),
+                              TBVector(0.f, 0.f, -1.f)};
+  const size_t numSpecial = sizeof(special) / sizeof(special[0]);
+  for (size_t i = 0; i < kNumElements; ++i) {
+    const TBVector position = i < numSpecial
+        ? special[i]
+        : TBVector(coordinate(random), coordinate(random), coordinate(random));
+    positions.x[i] = position.x;
+    positions.y[i] = position.y;
+    positions.z[i] = position.z;
+    const TBQuat rotation = i < numSpecial
+        ? TBQuat::identity()
+        : TBQuat::getQuatFromEulerAngles(
+              angle(random) * M_PIF / 180.f,
+              angle(random) * M_PIF / 180.f,
+              angle(random) * M_PIF / 180.f);
+    qx[i] = rotation.x;
+    qy[i] = rotation.y;
+    qz[i] = rotation.z;
+    qw[i] = rotation.w;
+    azimuths[i] = i < numSpecial ? 90.f * static_cast<float>(i) - 270.f : angle(random);
+    elevations[i] = i < numSpecial ? 45.f * static_cast<float>(i) - 135.f : 0.5f * angle(random);
+    distances[i] = 100.f * unit(random);
+  }
+  const VectorBatch::ConstQuats rotations = {qx.data(), qy.data(), qz.data(), qw.data()};
+  const TBQuat listenerRotation = TBQuat::getQuatFromEulerAngles(0.1f, 2.f, 0.f);
+  const TBVector listenerPosition(0.5f, 0.f, -1.f);
+
+  // The inline helpers
+  Arrays expectedRotated(kNumElements);
+  Arrays expectedAntiRotated(kNumElements);
+  Arrays expectedAed(kNumElements);
+  Arrays expectedVectors(kNumElements);
+  for (size_t i = 0; i < kNumElements; ++i) {
+    const TBQuat rotation(qx[i], qy[i], qz[i], qw[i]);
+    const TBVector rotated = TBQuat::rotateVectorByQuat(rotation, positions.get(i));
+    const TBVector antiRotated = TBQuat::antiRotateVectorByQuat(rotation, positions.get(i));
+    const Aed aed = TBQuat::getAedFromQuat(listenerRotation, positions.get(i), listenerPosition);
+    const TBVector vector =
+        TBVector::getVectorFromAziEleDist(azimuths[i], elevations[i], distances[i]);
+    expectedRotated.x[i] = rotated.x;
+    expectedRotated.y[i] = rotated.y;
+    expectedRotated.z[i] = rotated.z;
+    expectedAntiRotated.x[i] = antiRotated.x;
+    expectedAntiRotated.y[i] = antiRotated.y;
+    expectedAntiRotated.z[i] = antiRotated.z;
+    expectedAed.x[i] = aed.azimuth;
+    expectedAed.y[i] = aed.elevation;
+    expectedAed.z[i] = aed.distance;
+    expectedVectors.x[i] = vector.x;
+    expectedVectors.y[i] = vector.y;
+    expectedVectors.z[i] = vector.z;
+  }
+
+  std::cout << "function\tkernel\tns/element\tspeedup\tmax error\ttolerance\tresult\n";
+  const VectorBatch::Kernel kernels[] = {VectorBatch::Kernel::SCALAR,
+                                         VectorBatch::Kernel::SSE,
+                                         VectorBatch::Kernel::AVX2,
+                                         VectorBatch::Kernel::NEON};
+  const char* functions[] = {"rotateVectorByQuat",
+                             "antiRotateVectorByQuat",
+                             "getAedFromQuat",
+                             "getVectorFromAziEleDist"};
+  double scalar[4] = {};
+  bool ok = true;
+  for (auto kernel : kernels) {
+    if (!VectorBatch::isKernelSupported(kernel)) {
+      continue;
+    }
+    VectorBatch batch;
+    batch.setKernel(kernel);
+    Arrays output(kNumElements);
+    for (int function = 0; function < 4; ++function) {
+      const auto call = [&]() {
+        switch (function) {
+          case 0:
+            batch.rotateVectorByQuat(rotations, positions.read(), output.write(), kNumElements);
+            break;
+          case 1:
+            batch.antiRotateVectorByQuat(
+                rotations, positions.read(), output.write(), kNumElements);
+            break;
+          case 2:
+            batch.getAedFromQuat(
+                listenerRotation,
+                listenerPosition,
+                positions.read(),
+                output.x.data(),
+                output.y.data(),
+                output.z.data(),
+                kNumElements);
+            break;
+          default:
+            batch.getVectorFromAziEleDist(
+                azimuths.data(), elevations.data(), distances.data(), output.write(), kNumElements);
+            break;
+        }
+        sink = output.x[kNumElements / 2];
+      };
+      const double elapsed = time(call);
+      if (kernel == VectorBatch::Kernel::SCALAR) {
+        scalar[function] = elapsed;
+      }
+
+      // Degrees for angles. Rotations are relative to the length of the vector, vectors from
+      // angles and distances to their distance.
+      call();
+      const Arrays& expected = function == 0
+          ? expectedRotated
+          : (function == 1 ? expectedAntiRotated
+                           : (function == 2 ? expectedAed : expectedVectors));
+      float error = 0.f;
+      float distanceError = 0.f;
+      for (size_t i = 0; i < kNumElements; ++i) {
+        if (function == 2) {
+          error = std::max(
+              {error,
+               angleError(output.x[i], expected.x[i]),
+               std::abs(output.y[i] - expected.y[i])});
+          distanceError = std::max(
+              distanceError,
+              std::abs(output.z[i] - expected.z[i]) / std::max(expected.z[i], 1e-9f));
+        } else {
+          const float length = function == 3 ? distances[i] : TBVector::magnitude(positions.get(i));
+          const float scale = 1.f / std::max(length, 1e-9f);
+          error = std::max(
+              {error,
+               std::abs(output.x[i] - expected.x[i]) * scale,
+               std::abs(output.y[i] - expected.y[i]) * scale,
+               std::abs(output.z[i] - expected.z[i]) * scale});
+        }
+      }
+      // The scalar kernel calls the inline helpers, so it must match them everywhere
+      float tolerance = kVectorTolerance;
+      if (kernel == VectorBatch::Kernel::SCALAR) {
+        tolerance = 0.f;
+      } else if (function < 2) {
+        tolerance = kernel == VectorBatch::Kernel::AVX2 ? kFmaRotationUlps * FLT_EPSILON : 0.f;
+      } else if (function == 2) {
+        tolerance = kAngleToleranceDegrees;
+      }
+      const bool passed = error <= tolerance && distanceError <= kDistanceUlps * FLT_EPSILON;
+      std::cout << functions[function] << "\t" << getName(kernel) << "\t"
+                << elapsed * 1.e9 / kNumElements << "\t" << scalar[function] / elapsed << "x\t"
+                << error << "\t" << tolerance << "\t" << (passed ? "ok" : "FAIL") << "\n";
+      if (error > tolerance) {
+        std::cout << "FAIL: " << functions[function] << " " << getName(kernel) << " error "
+                  << error << " above " << tolerance << "\n";
+      }
+      if (distanceError > kDistanceUlps * FLT_EPSILON) {
+        std::cout << "FAIL: " << functions[function] << " " << getName(kernel)
+                  << " distance error " << distanceError << " above "
+                  << kDistanceUlps * FLT_EPSILON << "\n";
+      }
+      ok = ok && passed;
+    }
+  }
+  return ok ? 0 : 1;
+}
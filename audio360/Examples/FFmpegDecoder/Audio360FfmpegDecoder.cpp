@@ -152,6 +152,12 @@ Audio360FfmpegDecoder::Status Audio360FfmpegDecoder::enqueueNextPacket() {
   // 2. Decode the opus packet
   // 3. Enqueue decoded audio for spatialization
 
+  // Leave the packet for the next call if the largest decoded packet might not fit in the queue,
+  // rather than decoding it and dropping the samples that don't
+  if (spatQueue_->getFreeSpaceInQueue(channelMap_) < pcmBufferSize_) {
+    return Status::OK;
+  }
+
   // READ a frame
   TBE::ScopedAVPacket avPacket(ffmpeg_.av_packet_unref);
   auto err = ffmpeg_.av_read_frame(context_, &avPacket.packet_);
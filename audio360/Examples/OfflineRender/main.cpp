@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2020-present, Facebook, Inc.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "TBE_AudioEngine.h"
+#include "TBE_AudioFormat.h"
+#include "TBE_AudioObject.h"
+
+#define THROW_IF_ERROR(error, what)                                                  \
+  do {                                                                               \
+    if (error != EngineError::OK) {                                                  \
+      throw std::runtime_error(std::string(what) + ": " + std::to_string((int)error)); \
+    }                                                                                \
+  } while (0)
+
+using namespace TBE;
+
+/// Renders a file to a binaural wav file without an audio device, as fast as possible.
+/// Mono and stereo files are played through an AudioObject orbiting the listener, anything else
+/// through a SpatDecoderFile (TBE and ambiX).
+class OfflineRenderer {
+ public:
+  /// @param hrtf Empty to render the AudioObject through the sound field, "headmodel" to convolve
+  /// it with the head model's HRIRs, or the manifest of a measured HRTF to convolve it with
+  OfflineRenderer(
+      const std::string& input,
+      float sampleRate,
+      int bufferSize,
+      float orbitDegPerSec,
+      const std::string& hrtf)
+      : bufferSize_(bufferSize), orbitDegPerSec_(orbitDegPerSec) {
+    EngineInitSettings settings;
+    settings.audioSettings.deviceType = AudioDeviceType::DISABLED;
+    settings.audioSettings.sampleRate = sampleRate;
+    settings.audioSettings.bufferSize = bufferSize;
+    // The filters computed from a measured HRTF are cached next to its manifest
+    const std::string hrtfCache = hrtf + ".fbahrtf";
+    if (!hrtf.empty() && hrtf != "headmodel") {
+      settings.hrtf.manifestPath = hrtf.c_str();
+      settings.hrtf.cachePath = hrtfCache.c_str();
+    }
+    // Decode in getAudioMix(): rendering never waits on a streaming thread
+    settings.threads.useDecoderThread = false;
+    auto err = TBE_CreateAudioEngine(engine_, settings);
+    THROW_IF_ERROR(err, "Could not create the engine");
+
+    AudioFormatDecoder* decoder = nullptr;
+    err = TBE_CreateAudioFormatDecoder(decoder, input.c_str(), bufferSize, sampleRate);
+    THROW_IF_ERROR(err, "Could not open " + input);
+
+    if (decoder->getNumOfChannels() <= 2) {
+      err = engine_->createAudioObject(object_);
+      THROW_IF_ERROR(err, "Could not create an AudioObject");
+      object_->setEventCallback(onEvent, this);
+      object_->setPosition(TBVector(0.f, 0.f, 2.f));
+      if (!hrtf.empty()) {
+        err = object_->setSpatialisationType(SpatialisationType::BINAURAL);
+        THROW_IF_ERROR(err, "Could not render the AudioObject binaurally");
+      }
+      // The object owns the decoder from here on
+      err = object_->open(decoder);
+      THROW_IF_ERROR(err, "Could not open " + input);
+      object_->play();
+    } else {
+      delete decoder;
+      err = engine_->createSpatDecoderFile(file_);
+      THROW_IF_ERROR(err, "Could not create a SpatDecoderFile");
+      file_->setEventCallback(onEvent, this);
+      err = file_->open(input.c_str());
+      THROW_IF_ERROR(err, "Could not open " + input);
+      file_->play();
+    }
+  }
+
+  ~OfflineRenderer() {
+    if (engine_) {
+      TBE_DestroyAudioEngine(engine_);
+    }
+  }
+
+  /// Render until the end of the input
+  /// @return Seconds of audio rendered
+  double render(const std::string& output) {
+    IOStream* stream =
+        IOStream::createFileStream(output.c_str(), IOStream::StreamOptions::WRITE_BINARY);
+    if (!stream) {
+      throw std::runtime_error("Could not create " + output);
+    }
+    AudioFormatEncoder* encoder = nullptr;
+    const float sampleRate = engine_->getSampleRate();
+    auto err = TBE_CreateAudioFormatEncoder(
+        encoder,
+        stream,
+        AudioFormat::WAV,
+        sampleRate,
+        sampleRate,
+        bufferSize_,
+        2,
+        AudioFormatQuality::HIGH);
+    if (err != EngineError::OK) {
+      delete stream;
+      THROW_IF_ERROR(err, "Could not create the encoder");
+    }
+
+    std::vector<float> mix(static_cast<size_t>(bufferSize_) * 2);
+    size_t numBlocks = 0;
+    while (!finished_) {
+      if (object_) {
+        // One orbit around the listener every 360 / orbitDegPerSec seconds
+        const float seconds = static_cast<float>(numBlocks * bufferSize_) / sampleRate;
+        const float angle = seconds * orbitDegPerSec_ * 0.017453292f;
+        object_->setPosition(TBVector(2.f * std::sin(angle), 0.f, 2.f * std::cos(angle)));
+      }
+      engine_->getAudioMix(mix.data(), static_cast<int>(mix.size()), 2);
+      encoder->encode(mix.data(), mix.size(), false);
+      numBlocks++;
+    }
+    encoder->encode(nullptr, 0, true);
+    delete encoder;
+    delete stream;
+    return static_cast<double>(numBlocks * bufferSize_) / sampleRate;
+  }
+
+ private:
+  static void onEvent(Event event, void* userData) {
+    if (event == Event::END_OF_STREAM) {
+      static_cast<OfflineRenderer*>(userData)->finished_ = true;
+    }
+  }
+
+  const int bufferSize_;
+  const float orbitDegPerSec_;
+  AudioEngine* engine_{nullptr};
+  AudioObject* object_{nullptr};
+  SpatDecoderFile* file_{nullptr};
+  std::atomic<bool> finished_{false};
+};
+
+int main(int argc, const char* argv[]) {
+  if (argc < 3) {
+    std::cout << "Usage: " << argv[0]
+              << " input.wav output.wav [sampleRate=48000] [bufferSize=1024] [orbitDegPerSec=45]"
+              << " [headmodel|hrtf_manifest.txt]\n"
+              << "Mono and stereo inputs orbit the listener, ambisonic inputs are decoded as is.\n"
+              << "With an HRTF, mono and stereo inputs are convolved with it instead of going\n"
+              << "through the sound field.\n";
+    return 1;
+  }
+  const float sampleRate = argc > 3 ? std::stof(argv[3]) : 48000.f;
+  const int bufferSize = argc > 4 ? std::stoi(argv[4]) : 1024;
+  const float orbitDegPerSec = argc > 5 ? std::stof(argv[5]) : 45.f;
+  const std::string hrtf = argc > 6 ? argv[6] : "";
+
+  try {
+    OfflineRenderer renderer(argv[1], sampleRate, bufferSize, orbitDegPerSec, hrtf);
+    const auto start = std::chrono::steady_clock::now();
+    const double rendered = renderer.render(argv[2]);
+    const double elapsed =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Rendered " << rendered << " s in " << elapsed << " s ("
+              << (elapsed > 0.0 ? rendered / elapsed : 0.0) << "x realtime)\n";
+  } catch (std::exception& e) {
+    std::cout << "FAILED! " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}